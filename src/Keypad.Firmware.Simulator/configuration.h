@@ -0,0 +1,66 @@
+// Host stand-in for the generated configuration.h, staged next to the sketch.
+// The capacities and LED count come from the blob header (configuration_limits.h,
+// written by limits.awk per configuration); the port masks are derived from the
+// loaded bindings at startup, the same way ConfigurationGenerator derives them.
+
+#pragma once
+
+#include <stdint.h>
+#include "configuration_limits.h"
+
+#define CONFIGURATION_DEBUG_MODE 0
+
+#define DEBUG_NOISE_FILTER_ENABLED 1
+#define DEBUG_PULLUPS_ENABLED 1
+#define DEBUG_CONFIRM_SAMPLES 3
+#define DEBUG_CONFIRM_DELAY_MS 1
+#define DEBUG_CAPTURE_RATE_HZ 0
+
+// firmware options, overridable with DEFINES=-D... on the make command line
+#ifndef CONFIGURATION_SCAN_RATE_HZ
+#define CONFIGURATION_SCAN_RATE_HZ 0
+#endif
+#ifndef CONFIGURATION_DEBOUNCE_MS
+#define CONFIGURATION_DEBOUNCE_MS 5
+#endif
+#ifndef CONFIGURATION_ENCODER_ISR
+#define CONFIGURATION_ENCODER_ISR 0
+#endif
+#ifndef CONFIGURATION_ENCODER_ACCELERATION_MS
+#define CONFIGURATION_ENCODER_ACCELERATION_MS 0
+#endif
+#ifndef CONFIGURATION_ENCODER_ACCELERATION_MAX
+#define CONFIGURATION_ENCODER_ACCELERATION_MAX 8
+#endif
+#ifndef CONFIGURATION_HID_POLL_INTERVAL_MS
+#define CONFIGURATION_HID_POLL_INTERVAL_MS 10
+#endif
+#ifndef CONFIGURATION_HID_NKRO
+#define CONFIGURATION_HID_NKRO 0
+#endif
+#ifndef CONFIGURATION_LED_MAX_REFRESH_HZ
+#define CONFIGURATION_LED_MAX_REFRESH_HZ 50
+#endif
+#define CONFIGURATION_LATENCY_PROBE 0
+#define CONFIGURATION_LOOP_PROFILER 0
+#ifndef CONFIGURATION_LAYER_FEEDBACK
+#define CONFIGURATION_LAYER_FEEDBACK 1
+#endif
+
+extern uint8_t sim_button_p1_mask, sim_button_p3_mask;
+extern uint8_t sim_button_p1_active_low, sim_button_p3_active_low;
+extern uint8_t sim_encoder_p1_mask, sim_encoder_p3_mask;
+
+#define CONFIGURATION_BUTTON_P1_MASK sim_button_p1_mask
+#define CONFIGURATION_BUTTON_P3_MASK sim_button_p3_mask
+#define CONFIGURATION_BUTTON_P1_ACTIVE_LOW sim_button_p1_active_low
+#define CONFIGURATION_BUTTON_P3_ACTIVE_LOW sim_button_p3_active_low
+#define CONFIGURATION_ENCODER_P1_MASK sim_encoder_p1_mask
+#define CONFIGURATION_ENCODER_P3_MASK sim_encoder_p3_mask
+
+#define NEO_GRB
+#define NEO_REVERSED 0
+
+#define USER_USB_RAM 148
+
+#include "src/configuration_data.h"
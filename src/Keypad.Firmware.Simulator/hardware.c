@@ -0,0 +1,302 @@
+// ===================================================================================
+// Simulated CH552: registers, virtual clock, timer interrupts, the USB host and LEDs
+// ===================================================================================
+
+#include <Arduino.h>
+#include "configuration.h"
+#include "src/encoder.h"
+#include "src/pins.h"
+#include "src/scan.h"
+#include "src/util.h"
+#include "src/userUsbHidKeyboardMouse/USBhandler.h"
+#include "sim.h"
+
+// WS2812 bit-banging: 24 bits of 1.25us per LED, then the NEO_latch() reset pause
+#define SIM_NEO_US_PER_LED 30
+#define SIM_NEO_LATCH_US 281
+
+volatile uint8_t P1, P3, EA;
+volatile uint8_t TMOD, T2MOD, T2CON, TR1, ET1, TH1, TL1;
+volatile uint8_t TR2, ET2, TF2, RCAP2L, RCAP2H, TL2, TH2;
+volatile uint8_t IE_USB, U_TOG_OK, UEP0_T_LEN, UEP1_T_LEN, UEP2_T_LEN, UEP1_CTRL;
+
+uint8_t Ep0Buffer[64];
+uint8_t Ep1Buffer[128];
+volatile uint8_t UsbConfig;
+
+// defined with the report queue in USBHIDKeyboardMouse.c
+extern volatile uint8_t UpPoint1_Busy;
+
+uint8_t sim_button_p1_mask, sim_button_p3_mask;
+uint8_t sim_button_p1_active_low, sim_button_p3_active_low;
+uint8_t sim_encoder_p1_mask, sim_encoder_p3_mask;
+
+uint64_t sim_now_us = 0;
+uint32_t sim_pass_us = 50;
+uint32_t sim_led_frames = 0;
+uint32_t sim_reports[4];
+
+static uint64_t poll_next_us_s = 0;
+static uint64_t timer1_next_us_s = 0; // 0 while the timer or its interrupt is off
+static uint64_t timer2_next_us_s = 0;
+
+void sim_hardware_reset(void)
+{
+    P1 = 0xFF;
+    P3 = 0xFF;
+    EA = 1;
+    TR1 = ET1 = TR2 = ET2 = TF2 = 0;
+    UsbConfig = 0;
+    sim_now_us = 0;
+    sim_led_frames = 0;
+    sim_reports[0] = sim_reports[1] = sim_reports[2] = sim_reports[3] = 0;
+    poll_next_us_s = CONFIGURATION_HID_POLL_INTERVAL_MS * 1000UL;
+    timer1_next_us_s = 0;
+    timer2_next_us_s = 0;
+}
+
+void sim_derive_port_masks(void)
+{
+    size_t i;
+
+    sim_button_p1_mask = sim_button_p3_mask = 0;
+    sim_button_p1_active_low = sim_button_p3_active_low = 0;
+    sim_encoder_p1_mask = sim_encoder_p3_mask = 0;
+    for (i = 0; i < button_binding_count; ++i)
+    {
+        uint8_t pin = button_bindings[i].pin;
+        uint8_t *mask = PIN_PORT(pin) == 3 ? &sim_button_p3_mask : &sim_button_p1_mask;
+        uint8_t *active_low = PIN_PORT(pin) == 3 ? &sim_button_p3_active_low : &sim_button_p1_active_low;
+        *mask |= PIN_BIT(pin);
+        if (button_bindings[i].active_low)
+        {
+            *active_low |= PIN_BIT(pin);
+        }
+    }
+    for (i = 0; i < encoder_binding_count; ++i)
+    {
+        uint8_t a = encoder_bindings[i].pin_a;
+        uint8_t b = encoder_bindings[i].pin_b;
+        *(PIN_PORT(a) == 3 ? &sim_encoder_p3_mask : &sim_encoder_p1_mask) |= PIN_BIT(a);
+        *(PIN_PORT(b) == 3 ? &sim_encoder_p3_mask : &sim_encoder_p1_mask) |= PIN_BIT(b);
+    }
+}
+
+void sim_pin_write(uint8_t pin, bool level)
+{
+    volatile uint8_t *port = PIN_PORT(pin) == 3 ? &P3 : &P1;
+    if (level)
+    {
+        *port |= PIN_BIT(pin);
+    }
+    else
+    {
+        *port &= (uint8_t)~PIN_BIT(pin);
+    }
+}
+
+// both timers count Fsys/12; periods are rounded to the simulator's microsecond
+static uint64_t timer_period_us(uint32_t ticks)
+{
+    uint64_t period = ((uint64_t)ticks * 12 * 1000000UL + F_CPU / 2) / F_CPU;
+    return period == 0 ? 1 : period;
+}
+
+static void timers_service(void)
+{
+#if CONFIGURATION_ENCODER_ISR
+    // Timer1 mode 2: 8-bit auto-reload from TH1
+    if (TR1 && ET1 && EA)
+    {
+        if (timer1_next_us_s == 0)
+        {
+            timer1_next_us_s = sim_now_us + timer_period_us(256 - TH1);
+        }
+        else if (sim_now_us >= timer1_next_us_s)
+        {
+            timer1_next_us_s += timer_period_us(256 - TH1);
+            encoder_timer_interrupt();
+        }
+    }
+    else
+    {
+        timer1_next_us_s = 0;
+    }
+#endif
+#if CONFIGURATION_SCAN_RATE_HZ > 0
+    // Timer2: 16-bit auto-reload from RCAP2H:RCAP2L
+    if (TR2 && ET2 && EA)
+    {
+        uint32_t ticks = 65536UL - (((uint32_t)RCAP2H << 8) | RCAP2L);
+        if (timer2_next_us_s == 0)
+        {
+            timer2_next_us_s = sim_now_us + timer_period_us(ticks);
+        }
+        else if (sim_now_us >= timer2_next_us_s)
+        {
+            timer2_next_us_s += timer_period_us(ticks);
+            TF2 = 1;
+            scan_timer_interrupt();
+        }
+    }
+    else
+    {
+        timer2_next_us_s = 0;
+    }
+#endif
+}
+
+// the host polls the interrupt endpoint once per bInterval and takes whatever EP1 holds
+static void host_poll_service(void)
+{
+    if (sim_now_us < poll_next_us_s)
+    {
+        return;
+    }
+    poll_next_us_s += CONFIGURATION_HID_POLL_INTERVAL_MS * 1000UL;
+    if (!UpPoint1_Busy)
+    {
+        return;
+    }
+    if (Ep1Buffer[64] < 4)
+    {
+        sim_reports[Ep1Buffer[64]]++;
+    }
+    sim_on_report(&Ep1Buffer[64], UEP1_T_LEN);
+    USB_EP1_IN();
+}
+
+static uint64_t earliest(uint64_t a, uint64_t b)
+{
+    return b != 0 && b < a ? b : a;
+}
+
+static uint64_t next_event_us(uint64_t until)
+{
+    uint64_t next = earliest(until, trace_next_us());
+    next = earliest(next, poll_next_us_s);
+    next = earliest(next, timer1_next_us_s);
+    return earliest(next, timer2_next_us_s);
+}
+
+void sim_advance(uint32_t us)
+{
+    const uint64_t until = sim_now_us + us;
+
+    for (;;)
+    {
+        uint64_t next = next_event_us(until);
+        if (next > sim_now_us)
+        {
+            sim_now_us = next;
+        }
+
+        trace_apply_due();
+        timers_service();
+        host_poll_service();
+        if (sim_now_us >= until)
+        {
+            return;
+        }
+    }
+}
+
+void sim_idle(void)
+{
+    uint64_t next = next_event_us(UINT64_MAX);
+    sim_advance(next > sim_now_us ? (uint32_t)(next - sim_now_us) : 0);
+}
+
+// ===================================================================================
+// CH55xDuino core
+// ===================================================================================
+
+uint32_t millis(void)
+{
+    return (uint32_t)(sim_now_us / 1000);
+}
+
+uint32_t micros(void)
+{
+    return (uint32_t)sim_now_us;
+}
+
+void delay(uint32_t ms)
+{
+    sim_advance(ms * 1000);
+}
+
+void delayMicroseconds(uint16_t us)
+{
+    sim_advance(us);
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    (void)pin;
+    (void)mode; // inputs idle high either way: the trace drives the levels
+}
+
+uint8_t digitalRead(uint8_t pin)
+{
+    return pins_test(pin, P1, P3) ? HIGH : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    sim_pin_write(pin, value != LOW);
+}
+
+void BOOT_now(void)
+{
+    sim_on_bootloader();
+}
+
+// ===================================================================================
+// USB device setup: the host enumerates the keypad as soon as USBInit() runs
+// ===================================================================================
+
+void USBDeviceCfg(void)
+{
+    UsbConfig = 1;
+}
+
+void USBDeviceEndPointCfg(void)
+{
+    UEP1_CTRL = UEP_T_RES_NAK;
+}
+
+void USBDeviceIntCfg(void)
+{
+    IE_USB = 1;
+}
+
+// ===================================================================================
+// LEDs
+// ===================================================================================
+
+void NEO_update(void)
+{
+    sim_led_frames++;
+    sim_advance(NEO_COUNT * SIM_NEO_US_PER_LED + SIM_NEO_LATCH_US);
+}
+
+void NEO_clearAll(void)
+{
+    NEO_update();
+}
+
+void NEO_writeColor(uint8_t pixel, uint8_t r, uint8_t g, uint8_t b)
+{
+    (void)pixel;
+    (void)r;
+    (void)g;
+    (void)b;
+}
+
+void NEO_writeHue(uint8_t pixel, uint8_t hue, uint8_t bright)
+{
+    (void)pixel;
+    (void)hue;
+    (void)bright;
+}
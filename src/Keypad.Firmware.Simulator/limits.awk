@@ -0,0 +1,19 @@
+# Writes configuration_limits.h for a generated configuration.c from the blob
+# header line:
+#     'K', 'P', version, buttons, encoders, leds, layers, ...
+/'K', 'P'/ {
+    sub(/^[ \t]+/, "")
+    split($0, field, /, */)
+    printf "#pragma once\n"
+    printf "#define CONFIGURATION_BUTTON_CAPACITY %d\n", field[4]
+    printf "#define CONFIGURATION_ENCODER_CAPACITY %d\n", field[5]
+    printf "#define NEO_COUNT %d\n", field[6]
+    found = 1
+    exit
+}
+END {
+    if (!found) {
+        print "no configuration blob header in " FILENAME > "/dev/stderr"
+        exit 1
+    }
+}
@@ -0,0 +1,367 @@
+// ===================================================================================
+// Keypad firmware simulator: runs the sketch's setup()/loop() against a pin trace
+// on a virtual clock and reports scan rate, decode accuracy and input latency
+// ===================================================================================
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "configuration.h"
+#include "src/hid.h"
+#include "sim.h"
+
+// quiet time before the first trace event and after the last, for reports to drain
+#define SIM_SETTLE_US 50000UL
+#define SIM_DRAIN_US 500000UL
+#define SIM_PENDING_LIMIT 256
+
+typedef enum
+{
+    SIM_INPUT_BUTTON,
+    SIM_INPUT_ENCODER,
+    SIM_INPUT_COUNT
+} sim_input_t;
+
+typedef struct
+{
+    uint32_t *samples_us;
+    size_t count;
+    size_t capacity;
+    uint32_t unanswered; // acted on but no report followed
+} sim_latency_t;
+
+typedef struct
+{
+    uint64_t edge_us;
+    sim_input_t input;
+} sim_pending_t;
+
+void setup(void);
+void loop(void);
+
+void __real_hid_handle_button(size_t button_index, hid_trigger_mode_t mode);
+void __real_hid_handle_encoder(size_t encoder_index, bool clockwise, uint8_t steps);
+void __real_buttons_update(void);
+
+static jmp_buf bootloader_jmp_s;
+static uint64_t bootloader_at_us_s = 0;
+
+static uint32_t scans_s = 0;
+static uint32_t presses_s = 0;
+static uint32_t detents_cw_s = 0;
+static uint32_t detents_ccw_s = 0;
+static uint32_t batches_s = 0;
+
+static sim_pending_t pending_s[SIM_PENDING_LIMIT];
+static size_t pending_count_s = 0;
+static sim_latency_t latency_s[SIM_INPUT_COUNT];
+
+static void latency_add(sim_input_t input, uint32_t us)
+{
+    sim_latency_t *latency = &latency_s[input];
+    if (latency->count == latency->capacity)
+    {
+        latency->capacity = latency->capacity ? latency->capacity * 2 : 64;
+        latency->samples_us = realloc(latency->samples_us, latency->capacity * sizeof(uint32_t));
+        if (latency->samples_us == NULL)
+        {
+            perror("latency");
+            exit(1);
+        }
+    }
+    latency->samples_us[latency->count++] = us;
+}
+
+static void pending_push(uint64_t edge_us, sim_input_t input)
+{
+    if (pending_count_s == SIM_PENDING_LIMIT)
+    {
+        latency_s[pending_s[0].input].unanswered++;
+        memmove(pending_s, pending_s + 1, (SIM_PENDING_LIMIT - 1) * sizeof(pending_s[0]));
+        pending_count_s--;
+    }
+    pending_s[pending_count_s].edge_us = edge_us;
+    pending_s[pending_count_s].input = input;
+    pending_count_s++;
+}
+
+// Latency runs from the physical edge to the first report the host takes after
+// the firmware acted on it. Release reports (all zero) close nothing.
+void sim_on_report(const uint8_t *report, uint8_t length)
+{
+    uint8_t i;
+    size_t p;
+
+    for (i = 1; i < length && report[i] == 0; ++i)
+    {
+    }
+    if (i == length)
+    {
+        return;
+    }
+    for (p = 0; p < pending_count_s; ++p)
+    {
+        latency_add(pending_s[p].input, (uint32_t)(sim_now_us - pending_s[p].edge_us));
+    }
+    pending_count_s = 0;
+}
+
+void sim_on_bootloader(void)
+{
+    bootloader_at_us_s = sim_now_us;
+    longjmp(bootloader_jmp_s, 1);
+}
+
+// ===================================================================================
+// Hooks between the firmware modules (linked with --wrap)
+// ===================================================================================
+
+void __wrap_buttons_update(void)
+{
+    scans_s++;
+    __real_buttons_update();
+}
+
+void __wrap_hid_handle_button(size_t button_index, hid_trigger_mode_t mode)
+{
+    if (mode == HID_TRIGGER_PRESS)
+    {
+        presses_s++;
+        pending_push(trace_take_press_edge(button_index), SIM_INPUT_BUTTON);
+    }
+    __real_hid_handle_button(button_index, mode);
+}
+
+// a batch is one step per detent unless the build accelerates, which the accuracy check then overstates
+void __wrap_hid_handle_encoder(size_t encoder_index, bool clockwise, uint8_t steps)
+{
+    uint8_t step;
+
+    batches_s++;
+    for (step = 0; step < steps; ++step)
+    {
+        if (clockwise)
+        {
+            detents_cw_s++;
+        }
+        else
+        {
+            detents_ccw_s++;
+        }
+        pending_push(trace_take_detent_edge(encoder_index, clockwise), SIM_INPUT_ENCODER);
+    }
+    __real_hid_handle_encoder(encoder_index, clockwise, steps);
+}
+
+// ===================================================================================
+// Report
+// ===================================================================================
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static void print_latency(const sim_latency_t *latency)
+{
+    uint64_t total = 0;
+    size_t i;
+
+    if (latency->count == 0)
+    {
+        printf("no reports");
+    }
+    else
+    {
+        qsort(latency->samples_us, latency->count, sizeof(uint32_t), compare_u32);
+        for (i = 0; i < latency->count; ++i)
+        {
+            total += latency->samples_us[i];
+        }
+        printf("latency ms min %.2f avg %.2f p99 %.2f max %.2f over %u",
+               latency->samples_us[0] / 1000.0,
+               (double)total / latency->count / 1000.0,
+               latency->samples_us[(latency->count * 99) / 100] / 1000.0,
+               latency->samples_us[latency->count - 1] / 1000.0,
+               (unsigned)latency->count);
+    }
+    if (latency->unanswered)
+    {
+        printf(", %u unanswered", (unsigned)latency->unanswered);
+    }
+    printf("\n");
+}
+
+static void usage(const char *self)
+{
+    fprintf(stderr,
+            "usage: %s [--name label] [--trace file] [--rpm n] [--detents n] [--detents-per-rev n]\n"
+            "          [--bounces n] [--bounce-us n] [--hold-ms n] [--gap-ms n] [--pass-us n]\n"
+            "          [--min-accuracy percent]\n",
+            self);
+    exit(2);
+}
+
+static unsigned long parse_number(const char *self, const char *value)
+{
+    char *end;
+    unsigned long number;
+
+    if (value == NULL)
+    {
+        usage(self);
+    }
+    number = strtoul(value, &end, 10);
+    if (*value == '\0' || *end != '\0')
+    {
+        usage(self);
+    }
+    return number;
+}
+
+int main(int argc, char **argv)
+{
+    sim_scenario_t scenario = {60, 24, 20, 3, 200, 40, 40};
+    const char *name = "simulation";
+    const char *trace_path = NULL;
+    unsigned long min_accuracy = 100;
+    uint32_t presses_expected;
+    uint32_t detents_expected;
+    uint32_t detents_matched;
+    struct timespec host_start;
+    struct timespec host_end;
+    double host_ns;
+    double simulated_s;
+    bool passed = true;
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        const char *option = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(option, "--name") == 0 && value != NULL)
+            name = value;
+        else if (strcmp(option, "--trace") == 0 && value != NULL)
+            trace_path = value;
+        else if (strcmp(option, "--rpm") == 0)
+            scenario.rpm = (uint32_t)parse_number(argv[0], value);
+        else if (strcmp(option, "--detents") == 0)
+            scenario.detents = (uint16_t)parse_number(argv[0], value);
+        else if (strcmp(option, "--detents-per-rev") == 0)
+            scenario.detents_per_rev = (uint16_t)parse_number(argv[0], value);
+        else if (strcmp(option, "--bounces") == 0)
+            scenario.bounces = (uint8_t)parse_number(argv[0], value);
+        else if (strcmp(option, "--bounce-us") == 0)
+            scenario.bounce_us = (uint16_t)parse_number(argv[0], value);
+        else if (strcmp(option, "--hold-ms") == 0)
+            scenario.hold_ms = (uint16_t)parse_number(argv[0], value);
+        else if (strcmp(option, "--gap-ms") == 0)
+            scenario.gap_ms = (uint16_t)parse_number(argv[0], value);
+        else if (strcmp(option, "--pass-us") == 0)
+            sim_pass_us = (uint32_t)parse_number(argv[0], value);
+        else if (strcmp(option, "--min-accuracy") == 0)
+            min_accuracy = parse_number(argv[0], value);
+        else
+            usage(argv[0]);
+        i++;
+    }
+    if (scenario.rpm == 0 || scenario.detents_per_rev == 0)
+    {
+        usage(argv[0]);
+    }
+
+    // setup() loads the blob again; the masks must be known before it reads the ports
+    sim_hardware_reset();
+    if (!configuration_load())
+    {
+        fprintf(stderr, "%s: configuration blob rejected\n", name);
+        return 1;
+    }
+    sim_derive_port_masks();
+    if (trace_path != NULL && !trace_load(trace_path))
+    {
+        return 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &host_start);
+    if (setjmp(bootloader_jmp_s) == 0)
+    {
+        uint64_t end_us;
+
+        setup();
+        if (trace_path == NULL)
+        {
+            trace_generate(&scenario, sim_now_us + SIM_SETTLE_US);
+        }
+        end_us = trace_last_us() + SIM_DRAIN_US;
+        while (sim_now_us < end_us)
+        {
+            uint32_t scans = scans_s;
+            loop();
+            // a fixed-rate scan returns without scanning until its tick is due
+            if (scans_s != scans)
+            {
+                sim_advance(sim_pass_us);
+            }
+            else
+            {
+                sim_idle();
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &host_end);
+    host_ns = (host_end.tv_sec - host_start.tv_sec) * 1e9 + (host_end.tv_nsec - host_start.tv_nsec);
+    simulated_s = sim_now_us / 1e6;
+
+    for (size_t p = 0; p < pending_count_s; ++p)
+    {
+        latency_s[pending_s[p].input].unanswered++;
+    }
+
+    presses_expected = trace_truth.presses;
+    detents_expected = trace_truth.detents_cw + trace_truth.detents_ccw;
+    detents_matched = (detents_cw_s < trace_truth.detents_cw ? detents_cw_s : trace_truth.detents_cw) +
+                      (detents_ccw_s < trace_truth.detents_ccw ? detents_ccw_s : trace_truth.detents_ccw);
+
+    printf("%s\n", name);
+    printf("  scans     %u in %.2f s simulated (%.1f/s), %.0f ns host per scan\n",
+           (unsigned)scans_s, simulated_s, simulated_s > 0 ? scans_s / simulated_s : 0.0,
+           scans_s ? host_ns / scans_s : 0.0);
+    printf("  buttons   %u/%u presses, ", (unsigned)presses_s, (unsigned)presses_expected);
+    print_latency(&latency_s[SIM_INPUT_BUTTON]);
+    if (encoder_binding_count > 0)
+    {
+        printf("  encoders  %u/%u detents (%.1f%%) in %u batches", (unsigned)detents_matched, (unsigned)detents_expected,
+               detents_expected ? 100.0 * detents_matched / detents_expected : 100.0, (unsigned)batches_s);
+        if (trace_path == NULL)
+        {
+            printf(" at %u rpm", (unsigned)scenario.rpm);
+        }
+        printf(", ");
+        print_latency(&latency_s[SIM_INPUT_ENCODER]);
+    }
+    printf("  reports   keyboard %u, mouse %u, consumer %u; %u LED frames\n",
+           (unsigned)sim_reports[1], (unsigned)sim_reports[2], (unsigned)sim_reports[3], (unsigned)sim_led_frames);
+
+    if (bootloader_at_us_s != 0)
+    {
+        printf("  FAIL      bootloader entered at %.1f ms\n", bootloader_at_us_s / 1000.0);
+        passed = false;
+    }
+    if (presses_s != presses_expected)
+    {
+        printf("  FAIL      %u presses decoded, the trace has %u\n", (unsigned)presses_s, (unsigned)presses_expected);
+        passed = false;
+    }
+    if (detents_expected && 100.0 * detents_matched / detents_expected < min_accuracy)
+    {
+        printf("  FAIL      encoder accuracy below %lu%%\n", min_accuracy);
+        passed = false;
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "include/ch5xx.h"
+
+// The slice of the CH55xDuino core the firmware uses; time is the simulator's
+// virtual clock and pins read the simulated P1/P3 latches
+#define INPUT 0
+#define INPUT_PULLUP 1
+#define OUTPUT 2
+#define HIGH 1
+#define LOW 0
+
+uint32_t millis(void);
+uint32_t micros(void);
+void delay(uint32_t ms);
+void delayMicroseconds(uint16_t us);
+void pinMode(uint8_t pin, uint8_t mode);
+uint8_t digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
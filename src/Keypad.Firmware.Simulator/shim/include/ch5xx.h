@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+
+// CH552 special function registers as plain variables (defined in hardware.c);
+// only the ones the application modules and the HID report queue touch
+extern volatile uint8_t P1, P3, EA;
+extern volatile uint8_t TMOD, T2MOD, T2CON, TR1, ET1, TH1, TL1;
+extern volatile uint8_t TR2, ET2, TF2, RCAP2L, RCAP2H, TL2, TH2;
+extern volatile uint8_t IE_USB, U_TOG_OK, UEP0_T_LEN, UEP1_T_LEN, UEP2_T_LEN, UEP1_CTRL;
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define INT_NO_TMR1 3
+#define INT_NO_TMR2 5
+
+#define bT1_M1 0x20
+#define bTMR_CLK 0x80
+#define bT2_CLK 0x40
+#define bT1_CLK 0x20
+
+#define MASK_UEP_T_RES 0x03
+#define UEP_T_RES_ACK 0x00
+#define UEP_T_RES_NAK 0x02
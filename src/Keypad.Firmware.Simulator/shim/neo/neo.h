@@ -0,0 +1,11 @@
+#pragma once
+#include <stdint.h>
+
+// Replaces src/neo/neo.h in the staged sketch: frames are counted and the
+// bit-banging time is charged to the virtual clock (hardware.c)
+#define NEO_init() ((void)0)
+
+void NEO_clearAll(void);
+void NEO_update(void);
+void NEO_writeColor(uint8_t pixel, uint8_t r, uint8_t g, uint8_t b);
+void NEO_writeHue(uint8_t pixel, uint8_t hue, uint8_t bright);
@@ -0,0 +1,14 @@
+#pragma once
+#include <stdint.h>
+
+// SDCC memory spaces and interrupt attributes compiled away for the host;
+// forced into every translation unit with -include
+#define __code
+#define __data
+#define __xdata
+#define __idata
+#define __bit uint8_t
+#define __at(address)
+#define __interrupt(vector)
+#define __using(bank)
+#define __critical
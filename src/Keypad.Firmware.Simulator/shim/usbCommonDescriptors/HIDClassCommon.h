@@ -0,0 +1,4 @@
+#pragma once
+#include "StdDescriptors.h"
+
+typedef USB_Descriptor_Header_t USB_HID_Descriptor_HID_t;
@@ -0,0 +1,9 @@
+#pragma once
+#include <stdint.h>
+
+// descriptors are never enumerated on the host, the types only need to exist
+typedef struct { uint8_t bLength; } USB_Descriptor_Header_t;
+typedef USB_Descriptor_Header_t USB_Descriptor_Configuration_Header_t;
+typedef USB_Descriptor_Header_t USB_Descriptor_Interface_t;
+typedef USB_Descriptor_Header_t USB_Descriptor_Endpoint_t;
+typedef USB_Descriptor_Header_t USB_Descriptor_Device_t;
@@ -0,0 +1,85 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// ===================================================================================
+// Clock and peripherals (hardware.c)
+// ===================================================================================
+
+// virtual time since reset; the firmware sees it through millis()/micros()
+extern uint64_t sim_now_us;
+
+// cost of one pass over the loop() tasks, charged on top of any delay() it makes
+extern uint32_t sim_pass_us;
+
+// frames sent to the LEDs and reports the host took, by report ID (1 keyboard, 2 mouse, 3 consumer)
+extern uint32_t sim_led_frames;
+extern uint32_t sim_reports[4];
+
+// power-on state: pins pulled up, timers stopped, USB not configured
+void sim_hardware_reset(void);
+
+// run the pin trace, timer interrupts and host polls forward by us microseconds
+void sim_advance(uint32_t us);
+
+// skip ahead to whatever happens next, for a loop() that found nothing to do
+void sim_idle(void);
+
+// compute the CONFIGURATION_*_MASK stand-ins from the loaded bindings
+void sim_derive_port_masks(void);
+
+// set a pin's input level in the P1/P3 latch
+void sim_pin_write(uint8_t pin, bool level);
+
+// ===================================================================================
+// Pin traces (trace.c)
+// ===================================================================================
+
+typedef struct
+{
+    uint32_t rpm;             // encoder shaft speed
+    uint16_t detents;         // per direction, per encoder
+    uint16_t detents_per_rev; // 20 for the common EC11 parts
+    uint8_t bounces;          // extra contact chatter at each button edge
+    uint16_t bounce_us;       // length of each chatter pulse
+    uint16_t hold_ms;         // button held down
+    uint16_t gap_ms;          // idle between inputs
+} sim_scenario_t;
+
+// a press of each button, then each encoder turned both ways, from start_us on
+void trace_generate(const sim_scenario_t *scenario, uint64_t start_us);
+
+// lines of "<ms> <pin> <level>", '#' starts a comment; times may be fractional
+bool trace_load(const char *path);
+
+// time of the next pin change, UINT64_MAX once the trace is done
+uint64_t trace_next_us(void);
+uint64_t trace_last_us(void);
+
+// apply every pin change due by sim_now_us
+void trace_apply_due(void);
+
+// the trace decoded at full resolution, as the firmware should see it
+typedef struct
+{
+    uint32_t presses;        // active edges after the pin stayed open for the debounce window
+    uint32_t detents_cw;
+    uint32_t detents_ccw;
+} trace_truth_t;
+
+extern trace_truth_t trace_truth;
+
+// when the press or detent the firmware just acted on physically happened
+uint64_t trace_take_press_edge(size_t button);
+uint64_t trace_take_detent_edge(size_t encoder, bool clockwise);
+
+// ===================================================================================
+// Harness (main.c)
+// ===================================================================================
+
+// the host took a report off EP1
+void sim_on_report(const uint8_t *report, uint8_t length);
+
+// BOOT_now() was called; does not return
+void sim_on_bootloader(void);
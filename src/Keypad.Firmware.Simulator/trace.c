@@ -0,0 +1,350 @@
+// ===================================================================================
+// Pin traces: generated scenarios or recorded files, replayed against the P1/P3
+// latches, and decoded at full resolution to know what the firmware should report
+// ===================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Arduino.h>
+#include "configuration.h"
+#include "src/pins.h"
+#include "sim.h"
+
+// quadrature steps per detent, as encoder.c counts them
+#define TRACE_STEPS_PER_DETENT 4
+#define TRACE_DETENT_FIFO 64
+
+typedef struct
+{
+    uint64_t at_us;
+    uint8_t pin;
+    uint8_t level;
+} trace_event_t;
+
+typedef struct
+{
+    uint64_t inactive_since_us; // last opening edge, 0 while closed
+    uint64_t press_us;          // edge of a press the firmware has not acted on yet, 0 when none
+    bool active;
+} trace_button_t;
+
+typedef struct
+{
+    uint8_t state; // A << 1 | B
+    int8_t delta;
+    uint64_t detent_us[TRACE_DETENT_FIFO];
+    bool detent_cw[TRACE_DETENT_FIFO];
+    uint8_t detent_head;
+    uint8_t detent_count;
+} trace_encoder_t;
+
+trace_truth_t trace_truth;
+
+static trace_event_t *events_s = NULL;
+static size_t event_count_s = 0;
+static size_t event_capacity_s = 0;
+static size_t event_next_s = 0;
+
+static trace_button_t buttons_s[CONFIGURATION_BUTTON_CAPACITY > 0 ? CONFIGURATION_BUTTON_CAPACITY : 1];
+static trace_encoder_t encoders_s[CONFIGURATION_ENCODER_CAPACITY > 0 ? CONFIGURATION_ENCODER_CAPACITY : 1];
+
+// same table as encoder.c: prev << 2 | current
+static const int8_t rotary_table_s[16] = {
+    0, -1,  1, 0,
+    1,  0,  0,-1,
+   -1,  0,  0, 1,
+    0,  1, -1, 0};
+
+static void trace_push(uint64_t at_us, uint8_t pin, bool level)
+{
+    if (event_count_s == event_capacity_s)
+    {
+        event_capacity_s = event_capacity_s ? event_capacity_s * 2 : 256;
+        events_s = realloc(events_s, event_capacity_s * sizeof(*events_s));
+        if (events_s == NULL)
+        {
+            perror("trace");
+            exit(1);
+        }
+    }
+    events_s[event_count_s].at_us = at_us;
+    events_s[event_count_s].pin = pin;
+    events_s[event_count_s].level = level ? 1 : 0;
+    event_count_s++;
+}
+
+static int trace_compare(const void *a, const void *b)
+{
+    const trace_event_t *x = a;
+    const trace_event_t *y = b;
+    return x->at_us < y->at_us ? -1 : (x->at_us > y->at_us ? 1 : 0);
+}
+
+// level a button pin sits at when pressed or open
+static bool trace_button_level(size_t button, bool pressed)
+{
+    return button_bindings[button].active_low ? !pressed : pressed;
+}
+
+static uint64_t trace_button_edge(uint64_t at_us, size_t button, bool pressed, const sim_scenario_t *scenario)
+{
+    uint8_t pin = button_bindings[button].pin;
+    uint8_t i;
+
+    // chatter: the contact settles after a few short opposite pulses
+    for (i = 0; i < scenario->bounces; ++i)
+    {
+        trace_push(at_us, pin, trace_button_level(button, pressed));
+        at_us += scenario->bounce_us;
+        trace_push(at_us, pin, trace_button_level(button, !pressed));
+        at_us += scenario->bounce_us;
+    }
+    trace_push(at_us, pin, trace_button_level(button, pressed));
+    return at_us;
+}
+
+static uint64_t trace_turn(uint64_t at_us, size_t encoder, bool clockwise, const sim_scenario_t *scenario)
+{
+    // Gray code order that encoder.c counts up, starting and ending on a detent (both high)
+    static const uint8_t cw_s[TRACE_STEPS_PER_DETENT] = {1, 0, 2, 3};
+    static const uint8_t ccw_s[TRACE_STEPS_PER_DETENT] = {2, 0, 1, 3};
+    const uint8_t *steps = clockwise ? cw_s : ccw_s;
+    const uint64_t step_us = 60000000ULL / ((uint64_t)scenario->rpm * scenario->detents_per_rev * TRACE_STEPS_PER_DETENT);
+    uint8_t state = 3;
+    uint16_t detent;
+    uint8_t i;
+
+    for (detent = 0; detent < scenario->detents; ++detent)
+    {
+        for (i = 0; i < TRACE_STEPS_PER_DETENT; ++i)
+        {
+            uint8_t next = steps[i];
+            at_us += step_us;
+            if ((next ^ state) & 2)
+            {
+                trace_push(at_us, encoder_bindings[encoder].pin_a, (next & 2) != 0);
+            }
+            if ((next ^ state) & 1)
+            {
+                trace_push(at_us, encoder_bindings[encoder].pin_b, (next & 1) != 0);
+            }
+            state = next;
+        }
+    }
+    return at_us;
+}
+
+static void trace_reset_truth(void)
+{
+    size_t i;
+
+    memset(&trace_truth, 0, sizeof(trace_truth));
+    memset(buttons_s, 0, sizeof(buttons_s));
+    memset(encoders_s, 0, sizeof(encoders_s));
+    for (i = 0; i < encoder_binding_count && i < CONFIGURATION_ENCODER_CAPACITY; ++i)
+    {
+        encoders_s[i].state = (uint8_t)((pins_test(encoder_bindings[i].pin_a, P1, P3) ? 2 : 0) |
+                                        (pins_test(encoder_bindings[i].pin_b, P1, P3) ? 1 : 0));
+    }
+}
+
+void trace_generate(const sim_scenario_t *scenario, uint64_t start_us)
+{
+    uint64_t at_us = start_us;
+    size_t i;
+
+    event_count_s = 0;
+    event_next_s = 0;
+    trace_reset_truth();
+    for (i = 0; i < button_binding_count; ++i)
+    {
+        at_us = trace_button_edge(at_us, i, true, scenario) + scenario->hold_ms * 1000UL;
+        at_us = trace_button_edge(at_us, i, false, scenario) + scenario->gap_ms * 1000UL;
+    }
+    for (i = 0; i < encoder_binding_count; ++i)
+    {
+        at_us = trace_turn(at_us, i, true, scenario) + scenario->gap_ms * 1000UL;
+        at_us = trace_turn(at_us, i, false, scenario) + scenario->gap_ms * 1000UL;
+    }
+}
+
+bool trace_load(const char *path)
+{
+    char line[128];
+    FILE *file = fopen(path, "r");
+    unsigned number = 0;
+
+    if (file == NULL)
+    {
+        perror(path);
+        return false;
+    }
+    event_count_s = 0;
+    event_next_s = 0;
+    trace_reset_truth();
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        double at_ms;
+        unsigned pin;
+        unsigned level;
+        char *comment = strchr(line, '#');
+
+        number++;
+        if (comment != NULL)
+        {
+            *comment = '\0';
+        }
+        if (strspn(line, " \t\r\n") == strlen(line))
+        {
+            continue;
+        }
+        if (sscanf(line, "%lf %u %u", &at_ms, &pin, &level) != 3 || at_ms < 0 ||
+            (PIN_PORT(pin) != 1 && PIN_PORT(pin) != 3) || pin % 10 > 7 || level > 1)
+        {
+            fprintf(stderr, "%s:%u: expected \"<ms> <pin> <0|1>\"\n", path, number);
+            fclose(file);
+            return false;
+        }
+        trace_push((uint64_t)(at_ms * 1000.0 + 0.5), (uint8_t)pin, level != 0);
+    }
+    fclose(file);
+    qsort(events_s, event_count_s, sizeof(*events_s), trace_compare);
+    return true;
+}
+
+uint64_t trace_next_us(void)
+{
+    return event_next_s < event_count_s ? events_s[event_next_s].at_us : UINT64_MAX;
+}
+
+uint64_t trace_last_us(void)
+{
+    return event_count_s ? events_s[event_count_s - 1].at_us : 0;
+}
+
+static void trace_watch_buttons(void)
+{
+    size_t i;
+
+    for (i = 0; i < button_binding_count && i < CONFIGURATION_BUTTON_CAPACITY; ++i)
+    {
+        trace_button_t *button = &buttons_s[i];
+        bool active = pins_test(button_bindings[i].pin, P1, P3) != (button_bindings[i].active_low != 0);
+
+        if (active == button->active)
+        {
+            continue;
+        }
+        button->active = active;
+        if (!active)
+        {
+            button->inactive_since_us = sim_now_us;
+            continue;
+        }
+        // a closing edge inside the window is chatter the debouncer must swallow
+        if (button->inactive_since_us == 0 ||
+            sim_now_us - button->inactive_since_us >= CONFIGURATION_DEBOUNCE_MS * 1000UL)
+        {
+            trace_truth.presses++;
+            if (button->press_us == 0)
+            {
+                button->press_us = sim_now_us;
+            }
+        }
+    }
+}
+
+static void trace_watch_encoders(void)
+{
+    size_t i;
+
+    for (i = 0; i < encoder_binding_count && i < CONFIGURATION_ENCODER_CAPACITY; ++i)
+    {
+        trace_encoder_t *encoder = &encoders_s[i];
+        uint8_t state = (uint8_t)((pins_test(encoder_bindings[i].pin_a, P1, P3) ? 2 : 0) |
+                                  (pins_test(encoder_bindings[i].pin_b, P1, P3) ? 1 : 0));
+        bool clockwise;
+
+        if (state == encoder->state)
+        {
+            continue;
+        }
+        encoder->delta = (int8_t)(encoder->delta + rotary_table_s[(encoder->state << 2) | state]);
+        encoder->state = state;
+        if (encoder->delta >= TRACE_STEPS_PER_DETENT)
+        {
+            encoder->delta -= TRACE_STEPS_PER_DETENT;
+            clockwise = true;
+            trace_truth.detents_cw++;
+        }
+        else if (encoder->delta <= -TRACE_STEPS_PER_DETENT)
+        {
+            encoder->delta += TRACE_STEPS_PER_DETENT;
+            clockwise = false;
+            trace_truth.detents_ccw++;
+        }
+        else
+        {
+            continue;
+        }
+        if (encoder->detent_count < TRACE_DETENT_FIFO)
+        {
+            uint8_t slot = (uint8_t)((encoder->detent_head + encoder->detent_count) % TRACE_DETENT_FIFO);
+            encoder->detent_us[slot] = sim_now_us;
+            encoder->detent_cw[slot] = clockwise;
+            encoder->detent_count++;
+        }
+    }
+}
+
+void trace_apply_due(void)
+{
+    while (event_next_s < event_count_s && events_s[event_next_s].at_us <= sim_now_us)
+    {
+        sim_pin_write(events_s[event_next_s].pin, events_s[event_next_s].level != 0);
+        event_next_s++;
+        // simultaneous changes (both encoder phases in a recorded trace) land in one decode
+        if (event_next_s == event_count_s || events_s[event_next_s].at_us != events_s[event_next_s - 1].at_us)
+        {
+            trace_watch_buttons();
+            trace_watch_encoders();
+        }
+    }
+}
+
+uint64_t trace_take_press_edge(size_t button)
+{
+    uint64_t at_us;
+
+    if (button >= CONFIGURATION_BUTTON_CAPACITY || buttons_s[button].press_us == 0)
+    {
+        return sim_now_us;
+    }
+    at_us = buttons_s[button].press_us;
+    buttons_s[button].press_us = 0;
+    return at_us;
+}
+
+uint64_t trace_take_detent_edge(size_t encoder, bool clockwise)
+{
+    trace_encoder_t *state;
+
+    if (encoder >= CONFIGURATION_ENCODER_CAPACITY)
+    {
+        return sim_now_us;
+    }
+    state = &encoders_s[encoder];
+    // detents the firmware missed or saw backwards are skipped over
+    while (state->detent_count > 0)
+    {
+        uint8_t head = state->detent_head;
+        state->detent_head = (uint8_t)((head + 1) % TRACE_DETENT_FIFO);
+        state->detent_count--;
+        if (state->detent_cw[head] == clockwise)
+        {
+            return state->detent_us[head];
+        }
+    }
+    return sim_now_us;
+}
@@ -8,6 +8,7 @@
 
 //app include
 #include "src/debug_mode.h"
+#include "src/debug_capture.h"
 #if !CONFIGURATION_DEBUG_MODE
 #if NEO_COUNT > 0
 #include "src/neo/neo.h"
@@ -17,6 +18,8 @@
 #include "src/encoder.h"
 #include "src/hid.h"
 #include "src/led.h"
+#include "src/profiler.h"
+#include "src/scan.h"
 #include "src/util.h"
 #endif
 
@@ -26,6 +29,8 @@
 // Initialize pins
 void setup()
 {
+  // bindings and lighting come from the configuration blob; leaves everything unbound if it is invalid
+  configuration_load();
 #if CONFIGURATION_DEBUG_MODE
   debug_mode_setup();
 #else
@@ -49,22 +54,60 @@ void setup()
   buttons_setup();
   encoder_setup();
   USBInit();
+#if CONFIGURATION_SCAN_RATE_HZ > 0
+  scan_setup();
+#endif
 #endif
 }
 
 
+#if !CONFIGURATION_DEBUG_MODE
+// one pass over the input and HID tasks
+static void loop_tasks(void)
+{
+  profile_loop_start();
+  profile_task_begin();
+  buttons_update();
+  profile_task_end(PROFILE_TASK_BUTTONS);
+  profile_task_begin();
+  encoder_update();
+  profile_task_end(PROFILE_TASK_ENCODER);
+  profile_task_begin();
+  hid_service();
+  profile_task_end(PROFILE_TASK_HID);
+}
+
+#if NEO_COUNT > 0
+static void loop_leds(void)
+{
+  profile_task_begin();
+  led_update();
+  profile_task_end(PROFILE_TASK_LED);
+}
+#endif
+#endif
+
 //Main loop, read buttons
 void loop()
 {
 #if CONFIGURATION_DEBUG_MODE
   debug_mode_loop();
+#elif CONFIGURATION_SCAN_RATE_HZ > 0
+  // fixed-rate scan: inputs run on each Timer2 tick, LEDs only between ticks so a frame
+  // never pushes back the scan it shares a pass with
+  if (scan_tick_take())
+  {
+    loop_tasks();
+    return;
+  }
+#if NEO_COUNT > 0
+  loop_leds();
+#endif
 #else
   //task update
-  buttons_update();
-  encoder_update();
-  hid_service();
+  loop_tasks();
 #if NEO_COUNT > 0
-  led_update();
+  loop_leds();
 #endif
 
   // light idle to avoid saturating USB
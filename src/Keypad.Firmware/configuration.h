@@ -11,8 +11,26 @@
 #define DEBUG_PULLUPS_ENABLED 1
 #define DEBUG_CONFIRM_SAMPLES 3
 #define DEBUG_CONFIRM_DELAY_MS 1
+#define DEBUG_CAPTURE_RATE_HZ 0
 
-#define HID_MAX_KEY_STEPS 1
+#define CONFIGURATION_SCAN_RATE_HZ 0
+#define CONFIGURATION_DEBOUNCE_MS 5
+#define CONFIGURATION_ENCODER_ISR 0
+#define CONFIGURATION_ENCODER_ACCELERATION_MS 0
+#define CONFIGURATION_ENCODER_ACCELERATION_MAX 8
+#define CONFIGURATION_HID_POLL_INTERVAL_MS 10
+#define CONFIGURATION_HID_NKRO 0
+#define CONFIGURATION_LED_MAX_REFRESH_HZ 50
+#define CONFIGURATION_LATENCY_PROBE 0
+#define CONFIGURATION_LOOP_PROFILER 0
+#define CONFIGURATION_LAYER_FEEDBACK 1
+
+#define CONFIGURATION_BUTTON_P1_MASK 0xC2
+#define CONFIGURATION_BUTTON_P3_MASK 0x08
+#define CONFIGURATION_BUTTON_P1_ACTIVE_LOW 0xC2
+#define CONFIGURATION_BUTTON_P3_ACTIVE_LOW 0x08
+#define CONFIGURATION_ENCODER_P1_MASK 0x00
+#define CONFIGURATION_ENCODER_P3_MASK 0x03
 
 #define PIN_NEO P34
 #define NEO_COUNT 3
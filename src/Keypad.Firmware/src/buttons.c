@@ -1,20 +1,38 @@
 #include <Arduino.h>
 #include "../configuration.h"
 #include "hid.h"
+#include "latency.h"
 #include "util.h"
 #include "buttons.h"
 #include "configuration_data.h"
 #include "led.h"
+#include "pins.h"
 
 #if !CONFIGURATION_DEBUG_MODE
 
+#ifndef CONFIGURATION_DEBOUNCE_MS
+#define CONFIGURATION_DEBOUNCE_MS 0
+#endif
+
 static bool *button_state_s = NULL;
+static uint16_t *button_stamp_s = NULL; // millis() of the last reported edge or raw release
 static size_t button_state_capacity_s = 0;
 static size_t button_state_count_s = 0;
+static uint8_t button_p1_s = 0;
+static uint8_t button_p3_s = 0;
+static bool button_pending_s = false; // a key is still inside its debounce window
+
+// active-high snapshot of every button bit on P1/P3
+static void buttons_read_ports(uint8_t *p1, uint8_t *p3)
+{
+    *p1 = (uint8_t)((P1 ^ CONFIGURATION_BUTTON_P1_ACTIVE_LOW) & CONFIGURATION_BUTTON_P1_MASK);
+    *p3 = (uint8_t)((P3 ^ CONFIGURATION_BUTTON_P3_ACTIVE_LOW) & CONFIGURATION_BUTTON_P3_MASK);
+}
 
 void buttons_setup(void)
 {
     button_state_s = configuration_button_state_storage();
+    button_stamp_s = configuration_button_debounce_storage();
     button_state_capacity_s = configuration_button_state_capacity();
 
     if (button_binding_count == 0)
@@ -23,7 +41,7 @@ void buttons_setup(void)
         return;
     }
 
-    if (button_state_s == NULL || button_state_capacity_s == 0)
+    if (button_state_s == NULL || button_stamp_s == NULL || button_state_capacity_s == 0)
     {
         button_state_count_s = 0;
         return;
@@ -38,9 +56,15 @@ void buttons_setup(void)
     for (size_t i = 0; i < button_state_count_s; ++i)
     {
         pinMode(button_bindings[i].pin, button_bindings[i].active_low ? INPUT_PULLUP : INPUT);
-        bool active = button_bindings[i].active_low ? !digitalRead(button_bindings[i].pin)
-                                                   : digitalRead(button_bindings[i].pin);
+    }
+
+    buttons_read_ports(&button_p1_s, &button_p3_s);
+    uint16_t now = (uint16_t)millis();
+    for (size_t i = 0; i < button_state_count_s; ++i)
+    {
+        bool active = pins_test(button_bindings[i].pin, button_p1_s, button_p3_s);
         button_state_s[i] = active;
+        button_stamp_s[i] = (uint16_t)(now - CONFIGURATION_DEBOUNCE_MS);
         if (active)
         {
             hid_handle_button(i, HID_TRIGGER_PRESS);
@@ -55,26 +79,60 @@ void buttons_update(void)
         return;
     }
 
+    uint8_t p1;
+    uint8_t p3;
+    buttons_read_ports(&p1, &p3);
+    uint8_t prev_p1 = button_p1_s;
+    uint8_t prev_p3 = button_p3_s;
+    if (((uint8_t)(p1 ^ prev_p1) | (uint8_t)(p3 ^ prev_p3)) == 0 && !button_pending_s)
+    {
+        return; // nothing moved and nothing waiting to settle
+    }
+    button_p1_s = p1;
+    button_p3_s = p3;
+
+    uint16_t now = (uint16_t)millis();
+    bool pending = false;
     bool has_bootloader_chord = false;
     bool bootloader_chord_candidate = true;
 
     for (size_t i = 0; i < button_state_count_s; ++i)
     {
-        bool active = button_bindings[i].active_low ? !digitalRead(button_bindings[i].pin)
-                                                   : digitalRead(button_bindings[i].pin);
-        if (button_bindings[i].bootloader_chord_member)
-        {
-            has_bootloader_chord = true;
-            bootloader_chord_candidate &= active;
-        }
+        uint8_t pin = button_bindings[i].pin;
+        bool active = pins_test(pin, p1, p3);
 
+        // eager press, deferred release: a press is reported as soon as the key is
+        // outside its window, a release only once the contact stayed open for the window
         if (button_state_s[i] != active)
         {
-            hid_handle_button(i, active ? HID_TRIGGER_PRESS : HID_TRIGGER_RELEASE);
-            button_state_s[i] = active;
+            if (!active && pins_test(pin, prev_p1, prev_p3))
+            {
+                button_stamp_s[i] = now; // every opening bounce restarts the release window
+            }
+
+            if ((uint16_t)(now - button_stamp_s[i]) >= CONFIGURATION_DEBOUNCE_MS)
+            {
+                if (active)
+                {
+                    latency_mark_edge(); // releases queue no reports of their own
+                }
+                hid_handle_button(i, active ? HID_TRIGGER_PRESS : HID_TRIGGER_RELEASE);
+                button_state_s[i] = active;
+                button_stamp_s[i] = now;
+            }
+            else
+            {
+                pending = true;
+            }
         }
 
+        if (button_bindings[i].bootloader_chord_member)
+        {
+            has_bootloader_chord = true;
+            bootloader_chord_candidate &= button_state_s[i];
+        }
     }
+    button_pending_s = pending;
 
     if (has_bootloader_chord && bootloader_chord_candidate)
     {
@@ -2,7 +2,24 @@
 
 #include "../configuration.h"
 
+#define BLOB_MAGIC_0 'K'
+#define BLOB_MAGIC_1 'P'
+#define BLOB_SETTINGS_SIZE 4
+#define BLOB_BRIGHTNESS_TABLE_SIZE 256
+
+const __code button_binding_t *button_bindings = 0;
+size_t button_binding_count = 0;
+const __code encoder_binding_t *encoder_bindings = 0;
+size_t encoder_binding_count = 0;
+const __code hid_binding_t *layer_bindings = 0;
+uint8_t layer_count = 0;
+uint8_t layer_binding_stride = 0;
+const __code uint8_t *hid_macro_code = configuration_blob;
+led_configuration_t led_configuration;
+const __code uint8_t *led_brightness_table = configuration_blob;
+
 static bool button_state_storage_s[CONFIGURATION_BUTTON_CAPACITY > 0 ? CONFIGURATION_BUTTON_CAPACITY : 1];
+static uint16_t button_debounce_storage_s[CONFIGURATION_BUTTON_CAPACITY > 0 ? CONFIGURATION_BUTTON_CAPACITY : 1];
 
 size_t configuration_button_state_capacity(void)
 {
@@ -14,12 +31,19 @@ bool *configuration_button_state_storage(void)
     return button_state_storage_s;
 }
 
+uint16_t *configuration_button_debounce_storage(void)
+{
+    return button_debounce_storage_s;
+}
+
 #if CONFIGURATION_ENCODER_CAPACITY > 0
 static uint8_t encoder_prev_storage_s[CONFIGURATION_ENCODER_CAPACITY];
 static int8_t encoder_delta_storage_s[CONFIGURATION_ENCODER_CAPACITY];
+static uint16_t encoder_mask_storage_s[CONFIGURATION_ENCODER_CAPACITY * 2];
 #else
 static uint8_t encoder_prev_storage_s[1];
 static int8_t encoder_delta_storage_s[1];
+static uint16_t encoder_mask_storage_s[2];
 #endif
 
 size_t configuration_encoder_state_capacity(void)
@@ -37,6 +61,105 @@ int8_t *configuration_encoder_delta_storage(void)
     return encoder_delta_storage_s;
 }
 
+uint16_t *configuration_encoder_mask_storage(void)
+{
+    return encoder_mask_storage_s;
+}
+
+static uint16_t blob_read16(uint16_t offset)
+{
+    return (uint16_t)configuration_blob[offset] | ((uint16_t)configuration_blob[offset + 1] << 8);
+}
+
+bool configuration_load(void)
+{
+    const __code uint8_t *cursor;
+    uint8_t buttons;
+    uint8_t encoders;
+    uint8_t leds;
+    uint8_t layers;
+    uint8_t stride;
+    uint16_t length;
+    uint16_t fixed;
+    uint16_t checksum = 0;
+    uint16_t i;
+
+    if (configuration_blob[0] != BLOB_MAGIC_0 || configuration_blob[1] != BLOB_MAGIC_1 ||
+        configuration_blob[2] != CONFIGURATION_BLOB_VERSION)
+    {
+        return false;
+    }
+
+    buttons = configuration_blob[3];
+    encoders = configuration_blob[4];
+    leds = configuration_blob[5];
+    layers = configuration_blob[6];
+    // the capacities size the state arrays and NEO_COUNT the LED frame, so the blob must fit the build
+    if (buttons > CONFIGURATION_BUTTON_CAPACITY || encoders > CONFIGURATION_ENCODER_CAPACITY ||
+        leds > NEO_COUNT || layers == 0 || layers > CONFIGURATION_LAYER_LIMIT ||
+        configuration_blob[7] > hid_function_count)
+    {
+        return false;
+    }
+
+    stride = buttons + 2 * encoders;
+    length = blob_read16(8);
+    fixed = (uint16_t)buttons * sizeof(button_binding_t) + (uint16_t)encoders * sizeof(encoder_binding_t) +
+            (uint16_t)layers * stride * sizeof(hid_binding_t) + BLOB_SETTINGS_SIZE;
+    if (leds > 0)
+    {
+        fixed += (uint16_t)leds * (2 + 2 * sizeof(led_rgb_t)) + BLOB_BRIGHTNESS_TABLE_SIZE;
+    }
+    if (length > CONFIGURATION_BLOB_CAPACITY - CONFIGURATION_BLOB_HEADER_SIZE || fixed > length)
+    {
+        return false;
+    }
+
+    cursor = &configuration_blob[CONFIGURATION_BLOB_HEADER_SIZE];
+    for (i = 0; i < length; ++i)
+    {
+        checksum += cursor[i];
+    }
+    if (checksum != blob_read16(10))
+    {
+        return false;
+    }
+
+    button_bindings = (const __code button_binding_t *)cursor;
+    cursor += (uint16_t)buttons * sizeof(button_binding_t);
+    encoder_bindings = (const __code encoder_binding_t *)cursor;
+    cursor += (uint16_t)encoders * sizeof(encoder_binding_t);
+    layer_bindings = (const __code hid_binding_t *)cursor;
+    cursor += (uint16_t)layers * stride * sizeof(hid_binding_t);
+
+    led_configuration.brightness_percent = cursor[0];
+    led_configuration.rainbow_step_ms = cursor[1];
+    led_configuration.breathing_min_percent = cursor[2];
+    led_configuration.breathing_step_ms = cursor[3];
+    cursor += BLOB_SETTINGS_SIZE;
+    if (leds > 0)
+    {
+        led_configuration.passive_modes = cursor;
+        cursor += leds;
+        led_configuration.passive_colors = (const __code led_rgb_t *)cursor;
+        cursor += (uint16_t)leds * sizeof(led_rgb_t);
+        led_configuration.active_modes = cursor;
+        cursor += leds;
+        led_configuration.active_colors = (const __code led_rgb_t *)cursor;
+        cursor += (uint16_t)leds * sizeof(led_rgb_t);
+        led_brightness_table = cursor;
+        cursor += BLOB_BRIGHTNESS_TABLE_SIZE;
+    }
+    hid_macro_code = cursor;
+
+    layer_binding_stride = stride;
+    layer_count = layers;
+    led_configuration.count = leds;
+    button_binding_count = buttons;
+    encoder_binding_count = encoders;
+    return true;
+}
+
 bool configuration_bootloader_requested(void)
 {
     bool requested = false;
@@ -31,9 +31,9 @@ typedef enum
 
 typedef struct
 {
-    const led_passive_mode_t *passive_modes;
+    const uint8_t *passive_modes; // led_passive_mode_t per LED
     const led_rgb_t *passive_colors;
-    const led_active_mode_t *active_modes;
+    const uint8_t *active_modes; // led_active_mode_t per LED
     const led_rgb_t *active_colors;
     uint8_t count;
     uint8_t brightness_percent;
@@ -42,37 +42,71 @@ typedef struct
     uint8_t breathing_step_ms;
 } led_configuration_t;
 
-extern const led_configuration_t led_configuration;
+extern led_configuration_t led_configuration;
+// brightness (and gamma) per channel value, inside the configuration blob when NEO_COUNT > 0
+extern const __code uint8_t *led_brightness_table;
+// generated only when NEO_COUNT > 0; breathing level 0..100% to a 0..255 scale factor
+extern __code const uint8_t led_breathing_curve[101];
+
+// Bindings and lighting live in one versioned, checksummed blob at a fixed flash
+// address so the server can rewrite them in a built image without recompiling.
+// All fields are bytes or little-endian uint16 values:
+//   header  'K' 'P', version, buttons, encoders, leds, layers, functions used,
+//           payload length (u16), payload checksum (u16 sum of payload bytes)
+//   payload buttons * button_binding_t, encoders * encoder_binding_t,
+//           layers * (buttons + 2 * encoders) * hid_binding_t,
+//           brightness_percent, rainbow_step_ms, breathing_min_percent, breathing_step_ms,
+//           when leds > 0: passive modes[leds], passive colors[leds], active modes[leds],
+//           active colors[leds], brightness table[256],
+//           then the macro bytecode up to the payload length
+#define CONFIGURATION_BLOB_ADDRESS 0x3400 // code must end below; the server fails builds that overlap it
+#define CONFIGURATION_BLOB_CAPACITY 0x0400 // ends where the bootloader starts
+#define CONFIGURATION_BLOB_VERSION 2
+#define CONFIGURATION_BLOB_HEADER_SIZE 12
+#define CONFIGURATION_LAYER_LIMIT 8
+// one uint16 field in the generated blob initializer
+#define CONFIGURATION_BLOB_U16(value) ((uint8_t)((value) & 0xFF)), ((uint8_t)((value) >> 8))
+
+// generated at CONFIGURATION_BLOB_ADDRESS
+extern __code const uint8_t configuration_blob[CONFIGURATION_BLOB_CAPACITY];
 
 typedef struct
 {
     uint8_t pin;
-    bool active_low;
-    int8_t led_index;             // -1 when no LED mapping
-    bool bootloader_on_boot;      // check during power-on to jump directly
-    bool bootloader_chord_member; // contributes to in-field boot chord
-    hid_binding_t function;
+    uint8_t active_low;
+    int8_t led_index;                // -1 when no LED mapping
+    uint8_t bootloader_on_boot;      // check during power-on to jump directly
+    uint8_t bootloader_chord_member; // contributes to in-field boot chord
 } button_binding_t;
 
 typedef struct
 {
     uint8_t pin_a;
     uint8_t pin_b;
-    hid_binding_t clockwise;
-    hid_binding_t counter_clockwise;
 } encoder_binding_t;
 
-extern const button_binding_t button_bindings[];
-extern const size_t button_binding_count;
+extern const __code button_binding_t *button_bindings;
+extern size_t button_binding_count;
+
+extern const __code encoder_binding_t *encoder_bindings;
+extern size_t encoder_binding_count;
+
+// [layer][slot] macro spans; slot is the button index, or button_binding_count + 2 * encoder
+// index for clockwise and one more for counter-clockwise
+extern const __code hid_binding_t *layer_bindings;
+extern uint8_t layer_count;
+extern uint8_t layer_binding_stride;
 
-extern const encoder_binding_t encoder_bindings[];
-extern const size_t encoder_binding_count;
+// point the tables above into configuration_blob; on a bad blob every count stays 0
+bool configuration_load(void);
 
 size_t configuration_button_state_capacity(void);
 bool *configuration_button_state_storage(void);
+uint16_t *configuration_button_debounce_storage(void);
 
 size_t configuration_encoder_state_capacity(void);
 uint8_t *configuration_encoder_prev_storage(void);
 int8_t *configuration_encoder_delta_storage(void);
+uint16_t *configuration_encoder_mask_storage(void);
 
 bool configuration_bootloader_requested(void);
@@ -0,0 +1,168 @@
+#include <Arduino.h>
+#include "../configuration.h"
+#include "debug_capture.h"
+
+#if CONFIGURATION_DEBUG_MODE && DEBUG_CAPTURE_RATE_HZ > 0
+
+#include "userUsbCdcDebug/USBCDC.h"
+
+// Timer2 runs from Fsys/12 in 16-bit auto-reload mode
+#define CAPTURE_TIMER_TICKS (F_CPU / 12 / DEBUG_CAPTURE_RATE_HZ)
+#define CAPTURE_TIMER_RELOAD (65536UL - CAPTURE_TIMER_TICKS)
+
+#if CAPTURE_TIMER_TICKS < 1 || CAPTURE_TIMER_TICKS > 65535
+#error "DEBUG_CAPTURE_RATE_HZ is out of range for Timer2"
+#endif
+
+// power of two so the ring indices wrap with a mask
+#define CAPTURE_RING_SIZE 64
+#define CAPTURE_RING_MASK (CAPTURE_RING_SIZE - 1)
+#define CAPTURE_FRAME_RECORDS 16
+#define CAPTURE_HEARTBEAT_MS 250UL
+
+// P3.6/P3.7 are the USB data lines
+#define CAPTURE_P3_MASK 0x3F
+
+typedef struct
+{
+    uint16_t tick;
+    uint8_t p1;
+    uint8_t p3;
+} capture_record_t;
+
+static __xdata capture_record_t ring_s[CAPTURE_RING_SIZE];
+static volatile uint8_t ring_head_s = 0;
+static volatile uint8_t ring_tail_s = 0;
+static volatile uint8_t dropped_s = 0;
+static volatile uint32_t tick_s = 0;
+static uint8_t last_p1_s;
+static uint8_t last_p3_s;
+static uint32_t last_frame_ms_s = 0;
+static uint8_t checksum_s;
+
+static void debug_capture_put(uint8_t value);
+static void debug_capture_put16(uint16_t value);
+
+void debug_capture_interrupt(void) __interrupt(INT_NO_TMR2)
+{
+    uint8_t p1;
+    uint8_t p3;
+    uint8_t next;
+
+    TF2 = 0;
+    ++tick_s;
+    p1 = P1;
+    p3 = P3 & CAPTURE_P3_MASK;
+    if (p1 == last_p1_s && p3 == last_p3_s)
+    {
+        return;
+    }
+
+    next = (ring_head_s + 1) & CAPTURE_RING_MASK;
+    if (next == ring_tail_s)
+    {
+        // leave last_* alone so the change is recorded once the host catches up
+        if (dropped_s != 0xFF)
+        {
+            dropped_s++;
+        }
+        return;
+    }
+
+    ring_s[ring_head_s].tick = (uint16_t)tick_s;
+    ring_s[ring_head_s].p1 = p1;
+    ring_s[ring_head_s].p3 = p3;
+    last_p1_s = p1;
+    last_p3_s = p3;
+    ring_head_s = next;
+}
+
+void debug_capture_start(void)
+{
+    TR2 = 0;
+    ET2 = 0;
+    T2MOD &= ~bT2_CLK; // Fsys/12 regardless of bTMR_CLK
+    T2CON = 0; // 16-bit auto-reload, timer mode
+    RCAP2L = (uint8_t)(CAPTURE_TIMER_RELOAD & 0xFF);
+    RCAP2H = (uint8_t)(CAPTURE_TIMER_RELOAD >> 8);
+    TL2 = RCAP2L;
+    TH2 = RCAP2H;
+
+    tick_s = 0;
+    ring_tail_s = 0;
+    last_p1_s = P1;
+    last_p3_s = P3 & CAPTURE_P3_MASK;
+    ring_s[0].tick = 0;
+    ring_s[0].p1 = last_p1_s;
+    ring_s[0].p3 = last_p3_s;
+    ring_head_s = 1;
+    last_frame_ms_s = millis();
+
+    ET2 = 1;
+    TR2 = 1;
+}
+
+void debug_capture_service(void)
+{
+    uint32_t now = millis();
+    uint32_t tick;
+    uint8_t count;
+    uint8_t dropped;
+    uint8_t index;
+    uint8_t i;
+
+    // head is read before the tick so every record sent is no newer than the frame tick
+    count = (ring_head_s - ring_tail_s) & CAPTURE_RING_MASK;
+    if (count == 0 && (now - last_frame_ms_s) < CAPTURE_HEARTBEAT_MS)
+    {
+        return;
+    }
+    if (count > CAPTURE_FRAME_RECORDS)
+    {
+        count = CAPTURE_FRAME_RECORDS;
+    }
+
+    ET2 = 0;
+    tick = tick_s;
+    dropped = dropped_s;
+    dropped_s = 0;
+    ET2 = 1;
+
+    USBSerial_write(DEBUG_CAPTURE_SYNC_0);
+    USBSerial_write(DEBUG_CAPTURE_SYNC_1);
+    checksum_s = 0;
+    debug_capture_put(DEBUG_CAPTURE_VERSION);
+    debug_capture_put(count);
+    debug_capture_put(dropped);
+    debug_capture_put16((uint16_t)tick);
+    debug_capture_put16((uint16_t)(tick >> 16));
+    debug_capture_put16(DEBUG_CAPTURE_RATE_HZ);
+
+    index = ring_tail_s;
+    for (i = 0; i < count; ++i)
+    {
+        debug_capture_put16(ring_s[index].tick);
+        debug_capture_put(ring_s[index].p1);
+        debug_capture_put(ring_s[index].p3);
+        index = (index + 1) & CAPTURE_RING_MASK;
+    }
+    ring_tail_s = index;
+
+    USBSerial_write(checksum_s);
+    USBSerial_flush();
+    last_frame_ms_s = now;
+}
+
+static void debug_capture_put(uint8_t value)
+{
+    checksum_s += value;
+    USBSerial_write(value);
+}
+
+static void debug_capture_put16(uint16_t value)
+{
+    debug_capture_put((uint8_t)(value & 0xFF));
+    debug_capture_put((uint8_t)(value >> 8));
+}
+
+#endif
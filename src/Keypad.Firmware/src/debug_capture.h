@@ -0,0 +1,30 @@
+#pragma once
+#include "../configuration.h"
+
+// 0 keeps debug mode's human-readable change log
+#ifndef DEBUG_CAPTURE_RATE_HZ
+#define DEBUG_CAPTURE_RATE_HZ 0
+#endif
+
+// Binary capture stream, all fields little-endian:
+//   0xA5 0x5A, version, record count, dropped, tick (u32), rate Hz (u16),
+//   count * { tick low (u16), P1, P3 }, checksum (sum of every byte after the sync)
+// A record is written for each sample where P1 or P3 differs from the previous
+// record; tick counts samples since capture start so a record's full tick is
+// recovered from the frame tick as long as it is under 65536 samples old.
+#define DEBUG_CAPTURE_SYNC_0 0xA5
+#define DEBUG_CAPTURE_SYNC_1 0x5A
+#define DEBUG_CAPTURE_VERSION 1
+
+#if CONFIGURATION_DEBUG_MODE && DEBUG_CAPTURE_RATE_HZ > 0
+#include "include/ch5xx.h"
+
+// latch the current port state as the first record and start sampling on Timer2
+void debug_capture_start(void);
+
+// drain pending records into one frame; also sends an empty frame as a heartbeat
+void debug_capture_service(void);
+
+// Timer2 overflow handler, must be visible to the sketch so SDCC emits the vector
+void debug_capture_interrupt(void) __interrupt(INT_NO_TMR2);
+#endif
@@ -5,6 +5,7 @@
 #if CONFIGURATION_DEBUG_MODE
 
 #include "configuration_data.h"
+#include "debug_capture.h"
 #include "userUsbCdcDebug/USBCDC.h"
 
 typedef struct
@@ -55,6 +56,7 @@ static void debug_mode_format_label(uint8_t pin, char *buffer, size_t buffer_len
 static uint8_t debug_mode_is_reserved_pin(uint8_t pin);
 static void debug_mode_print_timestamp_prefix(const char *tag);
 static uint8_t debug_mode_confirm_change(uint8_t pin, uint8_t previous_state);
+static void debug_mode_report_changes(void);
 
 void debug_mode_setup(void)
 {
@@ -77,9 +79,28 @@ void debug_mode_setup(void)
 
     USBSerial_flush();
     last_summary_ms_s = millis();
+#if DEBUG_CAPTURE_RATE_HZ > 0
+    debug_mode_print_timestamp_prefix("debug");
+    debug_serial_print_s("capture ");
+    debug_serial_print_i((long)DEBUG_CAPTURE_RATE_HZ);
+    debug_serial_print_s("Hz, binary frames follow");
+    debug_serial_println_only();
+    USBSerial_flush();
+    debug_capture_start();
+#endif
 }
 
 void debug_mode_loop(void)
+{
+#if DEBUG_CAPTURE_RATE_HZ > 0
+    // the Timer2 sampler replaces polling, confirmation delays and text output
+    debug_capture_service();
+#else
+    debug_mode_report_changes();
+#endif
+}
+
+static void debug_mode_report_changes(void)
 {
     uint8_t i;
     uint8_t changed = 0;
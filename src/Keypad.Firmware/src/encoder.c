@@ -6,8 +6,11 @@
 #include <Arduino.h>
 
 #include "../configuration.h"
+#include "encoder.h"
 #include "hid.h"
+#include "latency.h"
 #include "configuration_data.h"
+#include "pins.h"
 
 #if !CONFIGURATION_DEBUG_MODE
 
@@ -18,27 +21,145 @@ static const int8_t rotary_table_s[16] = {
    -1,  0,  0, 1,
     0,  1, -1, 0};
 
-static uint8_t *encoder_prev_values_s = NULL;
-static int8_t *encoder_delta_s = NULL;
-static size_t encoder_state_count_s = 0;
+// With the timer decoding, everything the interrupt touches is volatile so loop() never works
+// from a stale register copy; loop() only writes it with Timer1 masked
+#if CONFIGURATION_ENCODER_ISR
+#define ENCODER_SHARED volatile
+#else
+#define ENCODER_SHARED
+#endif
+
+static ENCODER_SHARED uint8_t *encoder_prev_values_s = NULL;
+static ENCODER_SHARED int8_t *encoder_delta_s = NULL;
+static ENCODER_SHARED uint8_t encoder_state_count_s = 0;
 static size_t encoder_state_capacity_s = 0;
+static ENCODER_SHARED uint8_t encoder_p1_s = 0;
+static ENCODER_SHARED uint8_t encoder_p3_s = 0;
+
+#if CONFIGURATION_ENCODER_ACCELERATION_MS
+static uint16_t encoder_detent_ms_s[CONFIGURATION_ENCODER_CAPACITY > 0 ? CONFIGURATION_ENCODER_CAPACITY : 1];
+static bool encoder_clockwise_s[CONFIGURATION_ENCODER_CAPACITY > 0 ? CONFIGURATION_ENCODER_CAPACITY : 1];
+
+// Steps per detent are ACCELERATION_MS over the time per detent since the last pass that had one,
+// from 1 up to ACCELERATION_MAX, so turning twice as fast goes four times as far. A reversal, or
+// a turn slower than ACCELERATION_MS per detent, moves one step per detent
+static uint8_t encoder_accelerate(size_t index, bool clockwise, uint8_t detents)
+{
+    uint16_t now = (uint16_t)millis();
+    uint16_t interval = (uint16_t)(now - encoder_detent_ms_s[index]) / detents;
+    uint16_t factor = 1;
+    uint16_t steps;
+
+    if (clockwise == encoder_clockwise_s[index])
+    {
+        factor = interval == 0 ? CONFIGURATION_ENCODER_ACCELERATION_MAX : CONFIGURATION_ENCODER_ACCELERATION_MS / interval;
+        if (factor > CONFIGURATION_ENCODER_ACCELERATION_MAX)
+        {
+            factor = CONFIGURATION_ENCODER_ACCELERATION_MAX;
+        }
+        if (factor == 0)
+        {
+            factor = 1;
+        }
+    }
+    encoder_detent_ms_s[index] = now;
+    encoder_clockwise_s[index] = clockwise;
+
+    steps = (uint16_t)detents * factor;
+    return steps > 0xFF ? 0xFF : (uint8_t)steps;
+}
+#endif
+
+// Whole detents taken on one pass go to hid as a single batch, whichever way they turned
+static void encoder_emit(size_t index, int8_t detents)
+{
+    bool clockwise = detents > 0;
+    uint8_t steps = (uint8_t)(clockwise ? detents : -detents);
+
+    latency_mark_edge();
+#if CONFIGURATION_ENCODER_ACCELERATION_MS
+    steps = encoder_accelerate(index, clockwise, steps);
+#endif
+    hid_handle_encoder(index, clockwise, steps);
+}
+
+#if CONFIGURATION_ENCODER_ISR
+// Timer1 in 8-bit auto-reload mode from Fsys/12
+#define ENCODER_TIMER_TICKS (F_CPU / 12 / ENCODER_SAMPLE_HZ)
+
+#if ENCODER_TIMER_TICKS < 1 || ENCODER_TIMER_TICKS > 256
+#error "ENCODER_SAMPLE_HZ is out of range for Timer1"
+#endif
+
+// two masks per encoder (phase A, phase B) over a P3 << 8 | P1 snapshot
+static ENCODER_SHARED uint16_t *encoder_masks_s = NULL;
+
+void encoder_timer_interrupt(void) __interrupt(INT_NO_TMR1)
+{
+    uint8_t p1 = P1 & CONFIGURATION_ENCODER_P1_MASK;
+    uint8_t p3 = P3 & CONFIGURATION_ENCODER_P3_MASK;
+    uint16_t snapshot;
+    uint8_t index;
+
+    if (p1 == encoder_p1_s && p3 == encoder_p3_s)
+    {
+        return;
+    }
+    encoder_p1_s = p1;
+    encoder_p3_s = p3;
+    snapshot = ((uint16_t)p3 << 8) | p1;
+
+    // decode inline: SDCC would otherwise need a reentrant helper shared with loop()
+    for (index = 0; index < encoder_state_count_s; ++index)
+    {
+        uint8_t new_val = (uint8_t)(((snapshot & encoder_masks_s[index << 1]) ? 2 : 0)
+                                  | ((snapshot & encoder_masks_s[(index << 1) + 1]) ? 1 : 0));
+        uint8_t combined = (uint8_t)((encoder_prev_values_s[index] << 2) | new_val);
+        encoder_prev_values_s[index] = new_val;
+        encoder_delta_s[index] = (int8_t)(encoder_delta_s[index] + rotary_table_s[combined]);
+    }
+}
 
-static void encoder_sample(size_t index)
+static uint16_t encoder_pin_mask(uint8_t pin)
+{
+    return PIN_PORT(pin) == 3 ? ((uint16_t)PIN_BIT(pin) << 8) : PIN_BIT(pin);
+}
+
+static void encoder_timer_setup(void)
+{
+    TR1 = 0;
+    ET1 = 0;
+    TMOD = (TMOD & 0x0F) | bT1_M1; // mode 2, 8-bit auto-reload
+    T2MOD &= ~bT1_CLK;             // Fsys/12
+    TH1 = (uint8_t)(256 - ENCODER_TIMER_TICKS);
+    TL1 = TH1;
+    ET1 = 1;
+    TR1 = 1;
+}
+#else
+static void encoder_sample(size_t index, uint8_t p1, uint8_t p3)
 {
-    int valA = digitalRead(encoder_bindings[index].pin_a);
-    int valB = digitalRead(encoder_bindings[index].pin_b);
+    uint8_t valA = pins_test(encoder_bindings[index].pin_a, p1, p3) ? 1 : 0;
+    uint8_t valB = pins_test(encoder_bindings[index].pin_b, p1, p3) ? 1 : 0;
     uint8_t new_val = (uint8_t)((valA << 1) | valB);
     uint8_t prev = encoder_prev_values_s[index];
     uint8_t combined = (uint8_t)((prev << 2) | new_val);
     encoder_prev_values_s[index] = new_val;
     encoder_delta_s[index] = (int8_t)(encoder_delta_s[index] + rotary_table_s[combined]);
 }
+#endif
 
 void encoder_setup(void)
 {
+#if CONFIGURATION_ENCODER_ISR
+    ET1 = 0; // the interrupt reads all of this; encoder_timer_setup() unmasks it again
+#endif
     encoder_prev_values_s = configuration_encoder_prev_storage();
     encoder_delta_s = configuration_encoder_delta_storage();
     encoder_state_capacity_s = configuration_encoder_state_capacity();
+#if CONFIGURATION_ENCODER_ISR
+    encoder_masks_s = configuration_encoder_mask_storage();
+#endif
 
     if (encoder_binding_count == 0)
     {
@@ -46,28 +167,48 @@ void encoder_setup(void)
         return;
     }
 
-    if (encoder_prev_values_s == NULL || encoder_delta_s == NULL || encoder_state_capacity_s == 0)
+    if (encoder_prev_values_s == NULL || encoder_delta_s == NULL || encoder_state_capacity_s == 0
+#if CONFIGURATION_ENCODER_ISR
+        || encoder_masks_s == NULL
+#endif
+        )
     {
         encoder_state_count_s = 0;
         return;
     }
 
-    encoder_state_count_s = encoder_binding_count;
-    if (encoder_state_count_s > encoder_state_capacity_s)
-    {
-        encoder_state_count_s = encoder_state_capacity_s;
-    }
+    // both at most CONFIGURATION_ENCODER_CAPACITY, so one byte the interrupt reads in one go
+    encoder_state_count_s = (uint8_t)(encoder_binding_count < encoder_state_capacity_s
+                                          ? encoder_binding_count
+                                          : encoder_state_capacity_s);
 
     for (size_t i = 0; i < encoder_state_count_s; ++i)
     {
         pinMode(encoder_bindings[i].pin_a, INPUT_PULLUP);
         pinMode(encoder_bindings[i].pin_b, INPUT_PULLUP);
+    }
 
-        int valA = digitalRead(encoder_bindings[i].pin_a);
-        int valB = digitalRead(encoder_bindings[i].pin_b);
+    encoder_p1_s = P1 & CONFIGURATION_ENCODER_P1_MASK;
+    encoder_p3_s = P3 & CONFIGURATION_ENCODER_P3_MASK;
+    for (size_t i = 0; i < encoder_state_count_s; ++i)
+    {
+        uint8_t valA = pins_test(encoder_bindings[i].pin_a, encoder_p1_s, encoder_p3_s) ? 1 : 0;
+        uint8_t valB = pins_test(encoder_bindings[i].pin_b, encoder_p1_s, encoder_p3_s) ? 1 : 0;
         encoder_prev_values_s[i] = (uint8_t)((valA << 1) | valB);
         encoder_delta_s[i] = 0;
+#if CONFIGURATION_ENCODER_ACCELERATION_MS
+        // as if the last detent were long ago, so the first one is never accelerated
+        encoder_detent_ms_s[i] = (uint16_t)((uint16_t)millis() - 0x8000);
+#endif
+#if CONFIGURATION_ENCODER_ISR
+        encoder_masks_s[i << 1] = encoder_pin_mask(encoder_bindings[i].pin_a);
+        encoder_masks_s[(i << 1) + 1] = encoder_pin_mask(encoder_bindings[i].pin_b);
+#endif
     }
+
+#if CONFIGURATION_ENCODER_ISR
+    encoder_timer_setup();
+#endif
 }
 
 void encoder_update(void)
@@ -77,29 +218,48 @@ void encoder_update(void)
         return;
     }
 
-    for (size_t index = 0; index < encoder_state_count_s; ++index)
+#if CONFIGURATION_ENCODER_ISR
+    // transitions were already decoded by the timer; take whole detents and leave the rest
+    for (uint8_t index = 0; index < encoder_state_count_s; ++index)
+    {
+        int8_t detents;
+
+        ET1 = 0;
+        detents = (int8_t)(encoder_delta_s[index] / 4);
+        encoder_delta_s[index] = (int8_t)(encoder_delta_s[index] - detents * 4);
+        ET1 = 1;
+
+        if (detents != 0)
+        {
+            encoder_emit(index, detents);
+        }
+    }
+#else
+    uint8_t p1 = P1 & CONFIGURATION_ENCODER_P1_MASK;
+    uint8_t p3 = P3 & CONFIGURATION_ENCODER_P3_MASK;
+    if (((uint8_t)(p1 ^ encoder_p1_s) | (uint8_t)(p3 ^ encoder_p3_s)) == 0)
     {
-        encoder_sample(index);
+        return; // no edge on any encoder pin, nothing to decode or drain
     }
+    encoder_p1_s = p1;
+    encoder_p3_s = p3;
 
     for (size_t index = 0; index < encoder_state_count_s; ++index)
     {
-        int8_t delta = encoder_delta_s[index];
+        encoder_sample(index, p1, p3);
+    }
 
-        while (delta >= 4)
-        {
-            delta -= 4;
-            hid_handle_encoder(index, true);
-        }
+    for (size_t index = 0; index < encoder_state_count_s; ++index)
+    {
+        int8_t detents = (int8_t)(encoder_delta_s[index] / 4);
 
-        while (delta <= -4)
+        if (detents != 0)
         {
-            delta += 4;
-            hid_handle_encoder(index, false);
+            encoder_delta_s[index] = (int8_t)(encoder_delta_s[index] - detents * 4);
+            encoder_emit(index, detents);
         }
-
-        encoder_delta_s[index] = delta;
     }
+#endif
 }
 
 #endif
\ No newline at end of file
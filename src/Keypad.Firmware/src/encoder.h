@@ -1,5 +1,32 @@
 #pragma once
 #include <stdint.h>
+#include "../configuration.h"
+
+// 1 decodes quadrature from a Timer1 interrupt instead of once per loop()
+#ifndef CONFIGURATION_ENCODER_ISR
+#define CONFIGURATION_ENCODER_ISR 0
+#endif
+
+// Acceleration: detents closer together than ACCELERATION_MS count for up to ACCELERATION_MAX
+// steps each; 0 sends one step per detent
+#ifndef CONFIGURATION_ENCODER_ACCELERATION_MS
+#define CONFIGURATION_ENCODER_ACCELERATION_MS 0
+#endif
+
+#ifndef CONFIGURATION_ENCODER_ACCELERATION_MAX
+#define CONFIGURATION_ENCODER_ACCELERATION_MAX 8
+#endif
+
+#ifndef ENCODER_SAMPLE_HZ
+#define ENCODER_SAMPLE_HZ 8000
+#endif
+
+#if !CONFIGURATION_DEBUG_MODE && CONFIGURATION_ENCODER_ISR
+#include "include/ch5xx.h"
+
+// Timer1 overflow handler, must be visible to the sketch so SDCC emits the vector
+void encoder_timer_interrupt(void) __interrupt(INT_NO_TMR1);
+#endif
 
 // setup encoder pins connected to the rotary encoder(s)
 void encoder_setup(void);
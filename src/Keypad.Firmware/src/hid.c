@@ -15,186 +15,492 @@
 #define HID_CONSUMER_SCAN_PREV 0x00B6
 #define HID_CONSUMER_STOP 0x00B7
 
-static int consumer_volume_pending_s = 0;
-static uint8_t consumer_phase_s = 0; // 0 idle, 1 waiting to release
+typedef struct
+{
+  uint16_t usage;
+  uint8_t count; // presses left to send; repeats of the newest usage fold in here
+} hid_consumer_entry_t;
+
+static hid_consumer_entry_t consumer_queue_s[HID_CONSUMER_QUEUE_LENGTH];
+static uint8_t consumer_queue_head_s = 0;
+static uint8_t consumer_queue_count_s = 0;
+static bool consumer_release_pending_s = false;
+
+typedef enum
+{
+  HID_MACRO_IDLE,
+  HID_MACRO_READY, // next step may start on this pass
+  HID_MACRO_HOLD,  // key step pressed, waiting for hold_ms
+  HID_MACRO_GAP,   // waiting for gap_ms before the next step
+  HID_MACRO_TEXT,  // text step typing, one report pair per pass
+} hid_macro_phase_t;
+
+typedef struct
+{
+  const hid_key_sequence_t *sequence;
+  hid_trigger_mode_t mode;
+  uint8_t plays; // times left to play, the current one included; repeats of the newest entry fold in here
+} hid_macro_entry_t;
+
+static hid_macro_entry_t macro_queue_s[HID_MACRO_QUEUE_LENGTH];
+static uint8_t macro_queue_head_s = 0;
+static uint8_t macro_queue_count_s = 0;
+static hid_macro_phase_t macro_phase_s = HID_MACRO_IDLE;
+static uint16_t macro_pc_s = 0;  // offset of the next step in hid_macro_code
+static uint16_t macro_end_s = 0; // one past the active sequence
+static uint8_t macro_gap_s = 0;  // gap_ms of the step in progress
+static uint16_t macro_text_end_s = 0; // one past the text being typed
+static uint8_t macro_text_mods_s = 0;
+static uint16_t macro_started_s = 0;
+static uint8_t macro_wait_s = 0;
 
-static void hid_run_key_sequence(hid_key_sequence_t sequence, hid_trigger_mode_t mode)
+static uint8_t active_layer_s = 0;
+
+// defaulted here rather than in hid.h: the generated configuration.h reaches hid.h through
+// configuration_data.h before it defines its own options
+#ifndef CONFIGURATION_LAYER_FEEDBACK
+#define CONFIGURATION_LAYER_FEEDBACK 1
+#endif
+#define HID_LAYER_FEEDBACK_ENABLED (NEO_COUNT > 0 && CONFIGURATION_LAYER_FEEDBACK)
+
+#if HID_LAYER_FEEDBACK_ENABLED
+static uint8_t layer_feedback_led_s = 0xFF; // LED lit for the last layer change, 0xFF when none
+static uint16_t layer_feedback_started_s = 0;
+#endif
+
+// reports a single step can queue: four modifiers plus the key
+#define HID_STEP_MAX_REPORTS 5
+
+static void hid_queue_key_sequence(const hid_key_sequence_t *sequence, hid_trigger_mode_t mode, uint8_t plays)
 {
-  uint8_t i;
+  uint8_t slot;
 
-  if (mode == HID_TRIGGER_RELEASE)
+  if (mode == HID_TRIGGER_RELEASE || sequence->length == 0 || plays == 0)
   {
     return;
   }
-
-  for (i = 0; i < sequence.length; i++)
+  if (macro_queue_count_s > 0)
   {
-    hid_key_step_t *step = &sequence.steps[i];
-    switch (step->kind)
+    slot = macro_queue_head_s + macro_queue_count_s - 1;
+    if (slot >= HID_MACRO_QUEUE_LENGTH)
     {
-    case HID_STEP_PAUSE:
-      if (step->gap_ms > 0)
-      {
-        delay(step->gap_ms);
-      }
-      break;
-    case HID_STEP_MOUSE:
-      switch (step->pointer_type)
-      {
-      case HID_POINTER_MOVE_UP:
-        Mouse_move(0, -(int8_t)step->pointer_value);
-        break;
-      case HID_POINTER_MOVE_DOWN:
-        Mouse_move(0, (int8_t)step->pointer_value);
-        break;
-      case HID_POINTER_MOVE_LEFT:
-        Mouse_move(-(int8_t)step->pointer_value, 0);
-        break;
-      case HID_POINTER_MOVE_RIGHT:
-        Mouse_move((int8_t)step->pointer_value, 0);
-        break;
-      case HID_POINTER_LEFT_CLICK:
-        Mouse_click(MOUSE_LEFT);
-        break;
-      case HID_POINTER_RIGHT_CLICK:
-        Mouse_click(MOUSE_RIGHT);
-        break;
-      case HID_POINTER_SCROLL_UP:
-        Mouse_scroll(step->pointer_value);
-        break;
-      case HID_POINTER_SCROLL_DOWN:
-        Mouse_scroll(-(int8_t)step->pointer_value);
-        break;
-      default:
-        break;
-      }
-      if (step->gap_ms > 0)
-      {
-        delay(step->gap_ms);
-      }
-      break;
-    case HID_STEP_FUNCTION:
-      if (step->functionPointer)
-      {
-        uint8_t times = step->function_value == 0 ? 1 : step->function_value;
-        while (times--)
-        {
-          step->functionPointer(mode);
-        }
-      }
-      if (step->gap_ms > 0)
-      {
-        delay(step->gap_ms);
-      }
-      break;
-    case HID_STEP_KEY:
-    default:
+      slot -= HID_MACRO_QUEUE_LENGTH;
+    }
+    // joining the newest entry keeps a spinning encoder from dropping detents on a full queue
+    if (macro_queue_s[slot].sequence == sequence && macro_queue_s[slot].mode == mode)
     {
-      uint8_t mods = step->modifiers;
-      uint8_t hold_ms = step->hold_ms;
-      uint8_t gap_ms = step->gap_ms;
-      uint8_t key = step->keycode;
+      macro_queue_s[slot].plays = macro_queue_s[slot].plays > (uint8_t)(0xFF - plays)
+                                      ? 0xFF
+                                      : (uint8_t)(macro_queue_s[slot].plays + plays);
+      return;
+    }
+  }
+  if (macro_queue_count_s >= HID_MACRO_QUEUE_LENGTH)
+  {
+    return; // queue full, drop the request
+  }
 
-      if (mods & 0x01) Keyboard_press(KEY_LEFT_CTRL);
-      if (mods & 0x02) Keyboard_press(KEY_LEFT_SHIFT);
-      if (mods & 0x04) Keyboard_press(KEY_LEFT_ALT);
-      if (mods & 0x08) Keyboard_press(KEY_LEFT_GUI);
+  slot = macro_queue_head_s + macro_queue_count_s;
+  if (slot >= HID_MACRO_QUEUE_LENGTH)
+  {
+    slot -= HID_MACRO_QUEUE_LENGTH;
+  }
+  macro_queue_s[slot].sequence = sequence;
+  macro_queue_s[slot].mode = mode;
+  macro_queue_s[slot].plays = plays;
+  macro_queue_count_s++;
+}
 
-      if (key != 0)
-      {
-        Keyboard_press(key);
-      }
-      if (hold_ms == 0)
-      {
-        hold_ms = 10; // default hold for reliability
-      }
-      delay(hold_ms);
-      Keyboard_releaseAll();
+// A binding that is one pointer move, scroll or function step plays its queued repeats at once:
+// one report with the summed value, or one call per repeat that the consumer queue folds into a
+// count. Returns how many plays the step stands for, leaving the last for the end of the sequence.
+static uint8_t hid_fold_plays(uint8_t step_length, uint8_t per_play, uint8_t limit)
+{
+  hid_macro_entry_t *entry = &macro_queue_s[macro_queue_head_s];
+  uint8_t plays = entry->plays;
 
-      if (gap_ms > 0)
-      {
-        delay(gap_ms);
-      }
-      break;
-    }
-    }
+  if (entry->sequence->length != step_length || plays <= 1)
+  {
+    return 1;
+  }
+  if (per_play != 0 && plays > limit / per_play)
+  {
+    plays = limit / per_play;
   }
+  if (plays == 0)
+  {
+    return 1;
+  }
+  entry->plays = (uint8_t)(entry->plays - (plays - 1));
+  return plays;
 }
 
-static void hid_run_binding(const hid_binding_t *binding, hid_trigger_mode_t mode)
+static void hid_macro_wait(uint8_t ms, hid_macro_phase_t phase)
 {
-  switch (binding->type)
+  macro_started_s = (uint16_t)millis();
+  macro_wait_s = ms;
+  macro_phase_s = phase;
+}
+
+static bool hid_macro_elapsed(void)
+{
+  return (uint16_t)((uint16_t)millis() - macro_started_s) >= macro_wait_s;
+}
+
+static void hid_start_mouse(uint8_t type, uint8_t value)
+{
+  switch (type)
   {
-  case HID_BINDING_SEQUENCE:
-    hid_run_key_sequence(binding->function.sequence, mode);
+  case HID_POINTER_MOVE_UP:
+    Mouse_move(0, -(int8_t)value);
+    break;
+  case HID_POINTER_MOVE_DOWN:
+    Mouse_move(0, (int8_t)value);
+    break;
+  case HID_POINTER_MOVE_LEFT:
+    Mouse_move(-(int8_t)value, 0);
+    break;
+  case HID_POINTER_MOVE_RIGHT:
+    Mouse_move((int8_t)value, 0);
+    break;
+  case HID_POINTER_LEFT_CLICK:
+    Mouse_click(MOUSE_LEFT);
+    break;
+  case HID_POINTER_RIGHT_CLICK:
+    Mouse_click(MOUSE_RIGHT);
+    break;
+  case HID_POINTER_SCROLL_UP:
+    Mouse_scroll(value);
+    break;
+  case HID_POINTER_SCROLL_DOWN:
+    Mouse_scroll(-(int8_t)value);
     break;
-  case HID_BINDING_NULL:
   default:
     break;
   }
 }
 
-void hid_consumer_volume_up(hid_trigger_mode_t mode)
+static void hid_set_layer(uint8_t layer)
 {
-  if (mode != HID_TRIGGER_PRESS && mode != HID_TRIGGER_CLICK)
+  if (layer >= layer_count || layer == active_layer_s)
   {
     return;
   }
-  consumer_volume_pending_s++;
+  active_layer_s = layer;
+
+#if HID_LAYER_FEEDBACK_ENABLED
+  // flash the key whose LED index matches the layer through its active colour
+  if (layer_feedback_led_s != 0xFF)
+  {
+    led_set_key_state(layer_feedback_led_s, false);
+    layer_feedback_led_s = 0xFF;
+  }
+  if (layer < NEO_COUNT)
+  {
+    layer_feedback_led_s = layer;
+    layer_feedback_started_s = (uint16_t)millis();
+    led_set_key_state(layer, true);
+  }
+#endif
 }
 
-void hid_consumer_volume_down(hid_trigger_mode_t mode)
+#if HID_LAYER_FEEDBACK_ENABLED
+static void hid_layer_feedback_service(void)
 {
-  if (mode != HID_TRIGGER_PRESS && mode != HID_TRIGGER_CLICK)
+  if (layer_feedback_led_s == 0xFF ||
+      (uint16_t)((uint16_t)millis() - layer_feedback_started_s) < HID_LAYER_FEEDBACK_MS)
   {
     return;
   }
-  consumer_volume_pending_s--;
+  led_set_key_state(layer_feedback_led_s, false);
+  layer_feedback_led_s = 0xFF;
 }
+#endif
 
-void hid_consumer_mute(hid_trigger_mode_t mode)
+static const hid_binding_t *hid_layer_binding(uint8_t slot)
 {
-  if (mode != HID_TRIGGER_PRESS && mode != HID_TRIGGER_CLICK)
+  return &layer_bindings[(uint16_t)active_layer_s * layer_binding_stride + slot];
+}
+
+// Decode the step at macro_pc_s, start it, and move macro_pc_s past it.
+static void hid_start_step(hid_trigger_mode_t mode)
+{
+  const __code uint8_t *code = &hid_macro_code[macro_pc_s];
+  const uint8_t op = code[0];
+
+  switch (op & HID_OP_MASK)
+  {
+  case HID_OP_PAUSE:
+    macro_gap_s = code[1];
+    macro_pc_s += 2;
+    break;
+  case HID_OP_MOUSE:
+  {
+    const uint8_t type = op & 0x0F;
+    uint8_t value = code[1];
+    // clicks stay one per play; moves and scrolls add up to what one int8 report axis holds
+    if (type != HID_POINTER_LEFT_CLICK && type != HID_POINTER_RIGHT_CLICK)
+    {
+      value = (uint8_t)(value * hid_fold_plays(3, value, 127));
+    }
+    hid_start_mouse(type, value);
+    macro_gap_s = code[2];
+    macro_pc_s += 3;
+    break;
+  }
+  case HID_OP_FUNCTION:
   {
+    // an index past the table (a blob built for another image) plays as an empty step
+    const hid_function_t fn = code[1] < hid_function_count ? hid_function_table[code[1]] : NULL;
+    uint8_t times = code[2] == 0 ? 1 : code[2];
+    times = (uint8_t)(times * hid_fold_plays(4, times, 0xFF));
+    macro_gap_s = code[3];
+    macro_pc_s += 4;
+    if (fn)
+    {
+      while (times--)
+      {
+        fn(mode);
+      }
+    }
+    break;
+  }
+  case HID_OP_LAYER:
+    hid_set_layer(op & 0x0F);
+    macro_gap_s = code[1];
+    macro_pc_s += 2;
+    break;
+  case HID_OP_TEXT:
+    macro_text_mods_s = op & 0x0F;
+    macro_gap_s = code[1];
+    macro_pc_s += 3;
+    macro_text_end_s = macro_pc_s + code[2];
+    macro_phase_s = HID_MACRO_TEXT;
     return;
+  case HID_OP_TAP:
+  case HID_OP_KEY:
+  {
+    const uint8_t mods = op & 0x0F;
+    const uint8_t key = code[1];
+    uint8_t hold_ms;
+
+    if ((op & HID_OP_MASK) == HID_OP_TAP)
+    {
+      hold_ms = HID_TAP_MS;
+      macro_gap_s = HID_TAP_MS;
+      macro_pc_s += 2;
+    }
+    else
+    {
+      hold_ms = code[2];
+      macro_gap_s = code[3];
+      macro_pc_s += 4;
+    }
+
+    if (mods & 0x01) Keyboard_press(KEY_LEFT_CTRL);
+    if (mods & 0x02) Keyboard_press(KEY_LEFT_SHIFT);
+    if (mods & 0x04) Keyboard_press(KEY_LEFT_ALT);
+    if (mods & 0x08) Keyboard_press(KEY_LEFT_GUI);
+
+    if (key != 0)
+    {
+      Keyboard_press(key);
+    }
+    if (hold_ms == 0)
+    {
+      hold_ms = 10; // default hold for reliability
+    }
+    hid_macro_wait(hold_ms, HID_MACRO_HOLD);
+    return;
+  }
+  default:
+    macro_gap_s = 0;
+    macro_pc_s = macro_end_s; // unknown opcode, abandon the sequence
+    break;
   }
-  Keyboard_consumer_send(HID_CONSUMER_MUTE);
+
+  hid_macro_wait(macro_gap_s, HID_MACRO_GAP);
 }
 
-void hid_consumer_media_play_pause(hid_trigger_mode_t mode)
+// Advance the active macro by at most one step; called once per loop pass.
+static void hid_macro_service(void)
 {
-  if (mode != HID_TRIGGER_PRESS && mode != HID_TRIGGER_CLICK)
+  if (macro_phase_s == HID_MACRO_IDLE)
   {
-    return;
+    const hid_key_sequence_t *sequence;
+
+    if (macro_queue_count_s == 0)
+    {
+      return;
+    }
+    sequence = macro_queue_s[macro_queue_head_s].sequence;
+    macro_pc_s = sequence->offset;
+    macro_end_s = sequence->offset + sequence->length;
+    macro_phase_s = HID_MACRO_READY;
+  }
+
+  if (macro_phase_s == HID_MACRO_HOLD)
+  {
+    if (!hid_macro_elapsed() || USB_EP1_free() == 0)
+    {
+      return;
+    }
+    Keyboard_releaseAll();
+    hid_macro_wait(macro_gap_s, HID_MACRO_GAP);
+  }
+
+  if (macro_phase_s == HID_MACRO_TEXT)
+  {
+    if (macro_pc_s < macro_text_end_s)
+    {
+      macro_pc_s += Keyboard_type(&hid_macro_code[macro_pc_s],
+                                  (uint8_t)(macro_text_end_s - macro_pc_s),
+                                  macro_text_mods_s);
+      if (macro_pc_s < macro_text_end_s)
+      {
+        return;
+      }
+    }
+    hid_macro_wait(macro_gap_s, HID_MACRO_GAP);
+  }
+
+  if (macro_phase_s == HID_MACRO_GAP)
+  {
+    if (!hid_macro_elapsed())
+    {
+      return;
+    }
+    macro_phase_s = HID_MACRO_READY;
+    if (macro_pc_s >= macro_end_s && --macro_queue_s[macro_queue_head_s].plays != 0)
+    {
+      macro_pc_s = macro_queue_s[macro_queue_head_s].sequence->offset;
+    }
+    else if (macro_pc_s >= macro_end_s)
+    {
+      macro_phase_s = HID_MACRO_IDLE;
+      if (++macro_queue_head_s >= HID_MACRO_QUEUE_LENGTH)
+      {
+        macro_queue_head_s = 0;
+      }
+      macro_queue_count_s--;
+      return;
+    }
+  }
+
+  if (USB_EP1_free() < HID_STEP_MAX_REPORTS)
+  {
+    return; // report queue backed up, start the step once the host catches up
   }
-  Keyboard_consumer_send(HID_CONSUMER_PLAY_PAUSE);
+  hid_start_step(macro_queue_s[macro_queue_head_s].mode);
 }
 
-void hid_consumer_media_next(hid_trigger_mode_t mode)
+
+static void hid_queue_consumer(uint16_t usage, hid_trigger_mode_t mode)
 {
+  uint8_t slot;
+
   if (mode != HID_TRIGGER_PRESS && mode != HID_TRIGGER_CLICK)
   {
     return;
   }
-  Keyboard_consumer_send(HID_CONSUMER_SCAN_NEXT);
+
+  if (consumer_queue_count_s > 0)
+  {
+    slot = consumer_queue_head_s + consumer_queue_count_s - 1;
+    if (slot >= HID_CONSUMER_QUEUE_LENGTH)
+    {
+      slot -= HID_CONSUMER_QUEUE_LENGTH;
+    }
+    // a fast encoder spin becomes one entry instead of filling the queue
+    if (consumer_queue_s[slot].usage == usage && consumer_queue_s[slot].count != 0xFF)
+    {
+      consumer_queue_s[slot].count++;
+      return;
+    }
+  }
+  if (consumer_queue_count_s >= HID_CONSUMER_QUEUE_LENGTH)
+  {
+    return; // queue full, drop the request
+  }
+
+  slot = consumer_queue_head_s + consumer_queue_count_s;
+  if (slot >= HID_CONSUMER_QUEUE_LENGTH)
+  {
+    slot -= HID_CONSUMER_QUEUE_LENGTH;
+  }
+  consumer_queue_s[slot].usage = usage;
+  consumer_queue_s[slot].count = 1;
+  consumer_queue_count_s++;
 }
 
-void hid_consumer_media_previous(hid_trigger_mode_t mode)
+// one consumer report per pass: a press, then its release on the next pass
+static void hid_consumer_service(void)
 {
-  if (mode != HID_TRIGGER_PRESS && mode != HID_TRIGGER_CLICK)
+  hid_consumer_entry_t *entry;
+
+  if (consumer_release_pending_s)
   {
+    if (Keyboard_consumer_try_send(0))
+    {
+      consumer_release_pending_s = false;
+    }
     return;
   }
-  Keyboard_consumer_send(HID_CONSUMER_SCAN_PREV);
-}
 
-void hid_consumer_media_stop(hid_trigger_mode_t mode)
-{
-  if (mode != HID_TRIGGER_PRESS && mode != HID_TRIGGER_CLICK)
+  if (consumer_queue_count_s == 0)
   {
     return;
   }
-  Keyboard_consumer_send(HID_CONSUMER_STOP);
+
+  entry = &consumer_queue_s[consumer_queue_head_s];
+  if (!Keyboard_consumer_try_send(entry->usage))
+  {
+    return;
+  }
+  consumer_release_pending_s = true;
+  if (--entry->count == 0)
+  {
+    if (++consumer_queue_head_s >= HID_CONSUMER_QUEUE_LENGTH)
+    {
+      consumer_queue_head_s = 0;
+    }
+    consumer_queue_count_s--;
+  }
+}
+
+void hid_consumer_volume_up(hid_trigger_mode_t mode)
+{
+  hid_queue_consumer(HID_CONSUMER_VOLUME_INCREMENT, mode);
+}
+
+void hid_consumer_volume_down(hid_trigger_mode_t mode)
+{
+  hid_queue_consumer(HID_CONSUMER_VOLUME_DECREMENT, mode);
+}
+
+void hid_consumer_mute(hid_trigger_mode_t mode)
+{
+  hid_queue_consumer(HID_CONSUMER_MUTE, mode);
+}
+
+void hid_consumer_media_play_pause(hid_trigger_mode_t mode)
+{
+  hid_queue_consumer(HID_CONSUMER_PLAY_PAUSE, mode);
+}
+
+void hid_consumer_media_next(hid_trigger_mode_t mode)
+{
+  hid_queue_consumer(HID_CONSUMER_SCAN_NEXT, mode);
+}
+
+void hid_consumer_media_previous(hid_trigger_mode_t mode)
+{
+  hid_queue_consumer(HID_CONSUMER_SCAN_PREV, mode);
+}
+
+void hid_consumer_media_stop(hid_trigger_mode_t mode)
+{
+  hid_queue_consumer(HID_CONSUMER_STOP, mode);
 }
 
 void hid_handle_button(size_t button_index, hid_trigger_mode_t mode)
@@ -220,48 +526,29 @@ void hid_handle_button(size_t button_index, hid_trigger_mode_t mode)
   }
 #endif
 
-  hid_run_binding(&binding->function, mode);
+  hid_queue_key_sequence(hid_layer_binding((uint8_t)button_index), mode, 1);
 }
 
-void hid_handle_encoder(size_t encoder_index, bool clockwise)
+void hid_handle_encoder(size_t encoder_index, bool clockwise, uint8_t steps)
 {
   if (encoder_index >= encoder_binding_count)
   {
     return;
   }
 
-  const encoder_binding_t *binding = &encoder_bindings[encoder_index];
-  const hid_binding_t *fn = clockwise ? &binding->clockwise : &binding->counter_clockwise;
-  hid_run_binding(fn, HID_TRIGGER_CLICK);
+  const uint8_t slot = (uint8_t)(button_binding_count + 2 * encoder_index) + (clockwise ? 0 : 1);
+  hid_queue_key_sequence(hid_layer_binding(slot), HID_TRIGGER_CLICK, steps);
 }
 
 void hid_service(void)
 {
-  if (consumer_phase_s == 1)
-  {
-    if (Keyboard_consumer_try_send(0))
-    {
-      consumer_phase_s = 0;
-    }
-    return;
-  }
-
-  if (consumer_volume_pending_s > 0)
-  {
-    if (Keyboard_consumer_try_send(HID_CONSUMER_VOLUME_INCREMENT))
-    {
-      consumer_volume_pending_s--;
-      consumer_phase_s = 1;
-    }
-  }
-  else if (consumer_volume_pending_s < 0)
-  {
-    if (Keyboard_consumer_try_send(HID_CONSUMER_VOLUME_DECREMENT))
-    {
-      consumer_volume_pending_s++;
-      consumer_phase_s = 1;
-    }
-  }
+  USB_EP1_flush();
+  hid_macro_service();
+  Mouse_flush();
+  hid_consumer_service();
+#if HID_LAYER_FEEDBACK_ENABLED
+  hid_layer_feedback_service();
+#endif
 }
 
 #endif
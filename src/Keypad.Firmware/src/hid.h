@@ -29,55 +29,56 @@ typedef struct
   uint8_t value;
 } hid_pointer_event_t;
 
-typedef enum
-{
-  HID_STEP_KEY,
-  HID_STEP_PAUSE,
-  HID_STEP_FUNCTION,
-  HID_STEP_MOUSE,
-} hid_step_kind_t;
-
-#ifndef HID_MAX_KEY_STEPS
-#define HID_MAX_KEY_STEPS 16
+// Macro bytecode. The high nibble of a step's first byte is the opcode and
+// the low nibble an inline argument; the remaining bytes follow in order.
+#define HID_OP_MASK 0xF0
+#define HID_OP_KEY 0x10      // | modifiers (1=Ctrl, 2=Shift, 4=Alt, 8=GUI), keycode, hold_ms, gap_ms
+#define HID_OP_PAUSE 0x20    // gap_ms
+#define HID_OP_FUNCTION 0x30 // hid_function_table index, repeat count, gap_ms
+#define HID_OP_MOUSE 0x40    // | hid_pointer_event_type_t, pointer value, gap_ms
+#define HID_OP_TEXT 0x50     // | modifiers, gap_ms, length, then length ASCII characters
+#define HID_OP_LAYER 0x60    // | layer, gap_ms
+#define HID_OP_TAP 0x70      // | modifiers, keycode; held and followed by HID_TAP_MS
+#define HID_TAP_MS 10
+
+// Sequences that can be queued at once, including the one playing
+#ifndef HID_MACRO_QUEUE_LENGTH
+#define HID_MACRO_QUEUE_LENGTH 4
 #endif
 
-typedef struct
-{
-  hid_step_kind_t kind;
-  uint8_t keycode;
-  uint8_t modifiers; // bitmask: 1=Ctrl, 2=Shift, 4=Alt, 8=GUI
-  uint8_t hold_ms;   // how long to hold key+mods
-  uint8_t gap_ms;    // delay after releasing before next step or gap after function/mouse
-  void (*functionPointer)(hid_trigger_mode_t mode);
-  uint8_t function_value;
-  hid_pointer_event_type_t pointer_type;
-  uint8_t pointer_value;
-} hid_key_step_t;
+// How long the key LED whose index is a newly selected layer lights up, when
+// CONFIGURATION_LAYER_FEEDBACK is on; layers without such an LED change silently
+#ifndef HID_LAYER_FEEDBACK_MS
+#define HID_LAYER_FEEDBACK_MS 300
+#endif
 
+// Distinct consumer usages that can wait for the host; repeats of the newest one coalesce
+#ifndef HID_CONSUMER_QUEUE_LENGTH
+#define HID_CONSUMER_QUEUE_LENGTH 8
+#endif
+
+// A binding's steps are a slice of hid_macro_code
 typedef struct
 {
-  hid_key_step_t steps[HID_MAX_KEY_STEPS];
-  uint8_t length;
+  uint16_t offset;
+  uint16_t length; // bytes, 0 for an empty binding
 } hid_key_sequence_t;
 
-typedef enum
-{
-  HID_BINDING_SEQUENCE,
-  HID_BINDING_NULL,
-} hid_binding_type_t;
+typedef void (*hid_function_t)(hid_trigger_mode_t mode);
 
-typedef struct
-{
-  hid_binding_type_t type;
-  union
-  {
-    hid_key_sequence_t sequence;
-  } function;
-} hid_binding_t;
+// every binding's bytecode back to back, inside the configuration blob
+extern const __code uint8_t *hid_macro_code;
+// generated: the functions HID_OP_FUNCTION steps index into
+extern const hid_function_t hid_function_table[];
+extern const uint8_t hid_function_count;
+
+// A zero-length span leaves the input unbound
+typedef hid_key_sequence_t hid_binding_t;
 
 
 void hid_handle_button(size_t button_index, hid_trigger_mode_t mode);
-void hid_handle_encoder(size_t encoder_index, bool clockwise);
+// steps plays of the direction's binding, queued as one entry that batches them where it can
+void hid_handle_encoder(size_t encoder_index, bool clockwise, uint8_t steps);
 
 void hid_consumer_volume_up(hid_trigger_mode_t mode);
 void hid_consumer_volume_down(hid_trigger_mode_t mode);
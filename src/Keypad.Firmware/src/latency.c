@@ -0,0 +1,107 @@
+#include <Arduino.h>
+#include "../configuration.h"
+#include "latency.h"
+
+#if !CONFIGURATION_DEBUG_MODE && CONFIGURATION_LATENCY_PROBE
+
+// an edge that produced no report within this window (an empty binding, a
+// full macro queue) is counted as dropped instead of skewing the next sample
+#define LATENCY_TIMEOUT_US 250000UL
+
+static __xdata uint32_t edge_us_s = 0;
+static volatile __bit edge_armed_s = 0;
+
+static __xdata uint16_t samples_s = 0;
+static __xdata uint16_t dropped_s = 0;
+static __xdata uint16_t min_us_s = 0xFFFF;
+static __xdata uint16_t max_us_s = 0;
+static __xdata uint32_t total_us_s = 0;
+static __xdata uint16_t histogram_s[LATENCY_HISTOGRAM_BUCKETS];
+
+void latency_mark_edge(void)
+{
+    if (edge_armed_s)
+    {
+        return;
+    }
+    // micros() is not reentrant and the USB interrupt calls it as well
+    IE_USB = 0;
+    edge_us_s = micros();
+    edge_armed_s = 1;
+    IE_USB = 1;
+}
+
+#pragma save
+#pragma nooverlay
+void latency_mark_sent(void)
+{
+    uint32_t elapsed;
+    uint16_t us;
+    uint8_t bucket;
+
+    if (!edge_armed_s)
+    {
+        return;
+    }
+    edge_armed_s = 0;
+    elapsed = micros() - edge_us_s;
+
+    if (elapsed >= LATENCY_TIMEOUT_US)
+    {
+        if (dropped_s != 0xFFFF)
+        {
+            dropped_s++;
+        }
+        return;
+    }
+    if (samples_s == 0xFFFF)
+    {
+        return; // saturated; the average would drift from here on
+    }
+
+    us = elapsed > 0xFFFF ? 0xFFFF : (uint16_t)elapsed;
+    samples_s++;
+    total_us_s += elapsed;
+    if (us < min_us_s)
+    {
+        min_us_s = us;
+    }
+    if (us > max_us_s)
+    {
+        max_us_s = us;
+    }
+
+    elapsed >>= 10;
+    for (bucket = 0; bucket < LATENCY_HISTOGRAM_BUCKETS - 1 && elapsed != 0; ++bucket)
+    {
+        elapsed >>= 1;
+    }
+    histogram_s[bucket]++;
+}
+
+static void latency_put16(__xdata uint8_t *buffer, uint16_t value)
+{
+    buffer[0] = (uint8_t)(value & 0xFF);
+    buffer[1] = (uint8_t)(value >> 8);
+}
+
+void latency_report_fill(__xdata uint8_t *buffer)
+{
+    uint8_t i;
+
+    buffer[0] = LATENCY_REPORT_ID;
+    buffer[1] = LATENCY_REPORT_VERSION;
+    latency_put16(&buffer[2], samples_s);
+    latency_put16(&buffer[4], dropped_s);
+    latency_put16(&buffer[6], samples_s == 0 ? 0 : min_us_s);
+    latency_put16(&buffer[8], max_us_s);
+    latency_put16(&buffer[10], (uint16_t)(total_us_s & 0xFFFF));
+    latency_put16(&buffer[12], (uint16_t)(total_us_s >> 16));
+    for (i = 0; i < LATENCY_HISTOGRAM_BUCKETS; ++i)
+    {
+        latency_put16(&buffer[14 + (i << 1)], histogram_s[i]);
+    }
+}
+#pragma restore
+
+#endif
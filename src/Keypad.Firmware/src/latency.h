@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+#include "../configuration.h"
+
+// 1 times each input edge until the next report leaves EP1 and serves the
+// statistics as a vendor HID feature report
+#ifndef CONFIGURATION_LATENCY_PROBE
+#define CONFIGURATION_LATENCY_PROBE 0
+#endif
+
+#if !CONFIGURATION_DEBUG_MODE && CONFIGURATION_LATENCY_PROBE
+
+#define LATENCY_REPORT_ID 4
+#define LATENCY_REPORT_VERSION 1
+#define LATENCY_HISTOGRAM_BUCKETS 8
+
+// report ID, version, samples, dropped, min_us, max_us, total_us (32-bit), then
+// one count per bucket; bucket n holds latencies below 1024 << n us, the last
+// one everything above. Multi-byte fields are little-endian.
+#define LATENCY_REPORT_SIZE (1 + 1 + 2 + 2 + 2 + 2 + 4 + 2 * LATENCY_HISTOGRAM_BUCKETS)
+
+// main loop: an input edge that will produce a report; the oldest unanswered edge wins
+void latency_mark_edge(void);
+
+// USB interrupt: EP1 handed a report to the host
+void latency_mark_sent(void);
+
+// USB interrupt: fill buffer with LATENCY_REPORT_SIZE bytes of feature report
+void latency_report_fill(__xdata uint8_t *buffer);
+
+#else
+#define latency_mark_edge() ((void)0)
+#endif
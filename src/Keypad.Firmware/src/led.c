@@ -2,6 +2,7 @@
 #include <stdbool.h>
 #include "../configuration.h"
 #include "led.h"
+#include "configuration_data.h"
 
 #if !CONFIGURATION_DEBUG_MODE && NEO_COUNT > 0
 #ifndef NEO_REVERSED
@@ -9,6 +10,16 @@
 #endif
 #include "neo/neo.h"
 
+// 0 sends every changed frame immediately
+#ifndef CONFIGURATION_LED_MAX_REFRESH_HZ
+#define CONFIGURATION_LED_MAX_REFRESH_HZ 50
+#endif
+#if CONFIGURATION_LED_MAX_REFRESH_HZ > 0
+#define LED_FRAME_MIN_MS (1000 / CONFIGURATION_LED_MAX_REFRESH_HZ)
+#else
+#define LED_FRAME_MIN_MS 0
+#endif
+
 static const led_configuration_t *led_cfg_s = &led_configuration;
 static bool pressed_s[NEO_COUNT] = {0};      // pressed state per logical LED
 static const uint8_t LED_RAINBOW_DEFAULT_STEP_MS = 20;
@@ -18,6 +29,11 @@ static uint32_t last_breath_step_ms_s = 0;
 static uint8_t breath_percent_s = 100; // 0..100%
 static bool breath_descending_s = true;
 static uint8_t rainbow_phase_s = 0; // shared hue phase for rolling rainbow
+static bool has_rainbow_s = false;
+static bool has_breathing_s = false;
+// NEO_update masks interrupts while it bit-bangs, so only send frames that changed
+static bool frame_dirty_s = true;
+static uint16_t last_frame_ms_s = 0;
 
 static uint8_t led_count(void)
 {
@@ -29,11 +45,6 @@ static uint8_t clamp_percent(uint8_t value)
   return value > 100 ? 100 : value;
 }
 
-static uint8_t brightness_percent(void)
-{
-  return clamp_percent(led_cfg_s->brightness_percent);
-}
-
 static uint8_t rainbow_step_ms(void)
 {
   const uint8_t configured = led_cfg_s->rainbow_step_ms;
@@ -79,25 +90,24 @@ static void hue_to_rgb(uint8_t hue, led_rgb_t *out)
   }
 }
 
-static uint8_t scale_component(uint8_t value, uint8_t percent)
-{
-  return (uint8_t)(((uint16_t)value * percent) / 100);
-}
+#define LED_LEVEL_FULL 255
 
-static void scale_color(const led_rgb_t *color, uint8_t percent, led_rgb_t *out)
+// level comes from led_breathing_curve; global brightness and gamma live in the table
+static uint8_t scale_component(uint8_t value, uint8_t level)
 {
-  out->r = scale_component(color->r, percent);
-  out->g = scale_component(color->g, percent);
-  out->b = scale_component(color->b, percent);
+  if (level != LED_LEVEL_FULL)
+  {
+    value = (uint8_t)(((uint16_t)value * level) >> 8);
+  }
+  return led_brightness_table[value];
 }
 
-static void write_scaled_color(uint8_t physical, const led_rgb_t *color, uint8_t percent)
+static void write_scaled_color(uint8_t physical, const led_rgb_t *color, uint8_t level)
 {
-  const uint8_t global_percent = brightness_percent();
-  const uint8_t effective = (uint8_t)(((uint16_t)percent * global_percent) / 100);
-  led_rgb_t scaled;
-  scale_color(color, effective, &scaled);
-  NEO_writeColor(physical, scaled.r, scaled.g, scaled.b);
+  NEO_writeColor(physical,
+                 scale_component(color->r, level),
+                 scale_component(color->g, level),
+                 scale_component(color->b, level));
 }
 
 static led_passive_mode_t passive_mode_for(uint8_t led)
@@ -106,7 +116,7 @@ static led_passive_mode_t passive_mode_for(uint8_t led)
   {
     return LED_PASSIVE_OFF;
   }
-  return led_cfg_s->passive_modes[led];
+  return (led_passive_mode_t)led_cfg_s->passive_modes[led];
 }
 
 static uint8_t led_physical_index(uint8_t logical)
@@ -128,6 +138,23 @@ void led_show_bootloader_indicator(void)
 
 void led_init(void)
 {
+  const uint8_t count = led_count();
+  has_rainbow_s = false;
+  has_breathing_s = false;
+  for (uint8_t i = 0; i < count; ++i)
+  {
+    const led_passive_mode_t mode = passive_mode_for(i);
+    if (mode == LED_PASSIVE_RAINBOW)
+    {
+      has_rainbow_s = true;
+    }
+    if (mode == LED_PASSIVE_BREATHING)
+    {
+      has_breathing_s = true;
+    }
+  }
+
+  frame_dirty_s = true;
   rainbow_phase_s = 0;
   last_rainbow_step_ms_s = millis();
   last_breath_step_ms_s = millis();
@@ -142,33 +169,18 @@ void led_set_key_state(int key, bool pressed)
   {
     return;
   }
-  pressed_s[key] = pressed;
+  if (pressed_s[key] != pressed)
+  {
+    pressed_s[key] = pressed;
+    frame_dirty_s = true;
+  }
 }
 
 void led_update()
 {
   const uint8_t count = led_count();
-  bool has_rainbow = false;
-  bool has_breathing = false;
-  for (uint8_t i = 0; i < count; ++i)
-  {
-    const led_passive_mode_t mode = passive_mode_for(i);
-    if (mode == LED_PASSIVE_RAINBOW)
-    {
-      has_rainbow = true;
-    }
-    if (mode == LED_PASSIVE_BREATHING)
-    {
-      has_breathing = true;
-    }
-    if (has_rainbow && has_breathing)
-    {
-      break;
-    }
-  }
-
   const uint32_t now = millis();
-  if (has_rainbow)
+  if (has_rainbow_s)
   {
     const uint8_t step_ms = rainbow_step_ms();
     const uint16_t elapsed = (uint16_t)(now - last_rainbow_step_ms_s);
@@ -192,10 +204,11 @@ void led_update()
         }
       }
       rainbow_phase_s = (uint8_t)phase;
+      frame_dirty_s = true;
     }
   }
 
-  if (has_breathing)
+  if (has_breathing_s)
   {
     const uint8_t step_ms = breathing_step_ms();
     const uint16_t elapsed = (uint16_t)(now - last_breath_step_ms_s);
@@ -210,6 +223,7 @@ void led_update()
       }
       last_breath_step_ms_s = now - remaining_ms;
       const uint8_t min_percent = breathing_min_percent();
+      const uint8_t previous_percent = breath_percent_s;
       while (steps > 0)
       {
         if (breath_descending_s)
@@ -236,19 +250,34 @@ void led_update()
         }
         steps--;
       }
+      if (breath_percent_s != previous_percent)
+      {
+        frame_dirty_s = true;
+      }
     }
   }
 
+  if (!frame_dirty_s)
+  {
+    return;
+  }
+  if ((uint16_t)((uint16_t)now - last_frame_ms_s) < LED_FRAME_MIN_MS)
+  {
+    return; // keep the frame dirty until the refresh cap allows another send
+  }
+  frame_dirty_s = false;
+  last_frame_ms_s = (uint16_t)now;
+
   for (uint8_t led = 0; led < count; ++led)
   {
     const uint8_t physical = led_physical_index(led);
     if (pressed_s[led])
     {
-      const led_active_mode_t mode = led_cfg_s->active_modes[led];
+      const led_active_mode_t mode = (led_active_mode_t)led_cfg_s->active_modes[led];
       if (mode == LED_ACTIVE_SOLID)
       {
         const led_rgb_t *color = &led_cfg_s->active_colors[led];
-        write_scaled_color(physical, color, 100);
+        write_scaled_color(physical, color, LED_LEVEL_FULL);
         continue;
       }
       if (mode == LED_ACTIVE_OFF)
@@ -267,13 +296,13 @@ void led_update()
     case LED_PASSIVE_STATIC:
       {
         const led_rgb_t *color = &led_cfg_s->passive_colors[led];
-        write_scaled_color(physical, color, 100);
+        write_scaled_color(physical, color, LED_LEVEL_FULL);
       }
       break;
     case LED_PASSIVE_BREATHING:
       {
         const led_rgb_t *color = &led_cfg_s->passive_colors[led];
-        write_scaled_color(physical, color, breath_percent_s);
+        write_scaled_color(physical, color, led_breathing_curve[breath_percent_s]);
       }
       break;
     case LED_PASSIVE_RAINBOW:
@@ -288,7 +317,7 @@ void led_update()
         }
         led_rgb_t hue_color;
         hue_to_rgb((uint8_t)hue, &hue_color);
-        write_scaled_color(physical, &hue_color, 100);
+        write_scaled_color(physical, &hue_color, LED_LEVEL_FULL);
       }
       break;
     }
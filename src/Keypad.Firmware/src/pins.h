@@ -0,0 +1,13 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// CH55xDuino pin numbers encode the port and bit as PORT * 10 + BIT (P1.5 -> 15)
+#define PIN_PORT(pin) ((uint8_t)((pin) / 10))
+#define PIN_BIT(pin) ((uint8_t)(1 << ((pin) % 10)))
+
+// pick the bit for a pin out of P1/P3 snapshots
+static inline bool pins_test(uint8_t pin, uint8_t p1, uint8_t p3)
+{
+    return ((PIN_PORT(pin) == 3 ? p3 : p1) & PIN_BIT(pin)) != 0;
+}
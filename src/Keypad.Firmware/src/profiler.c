@@ -0,0 +1,98 @@
+#include <Arduino.h>
+#include "../configuration.h"
+#include "profiler.h"
+
+#if !CONFIGURATION_DEBUG_MODE && CONFIGURATION_LOOP_PROFILER
+
+typedef struct
+{
+    uint16_t samples;
+    uint16_t max_us;
+    uint32_t total_us;
+} profile_stat_t;
+
+// one slot per task plus the loop period in the last
+static __xdata profile_stat_t stats_s[PROFILE_TASK_COUNT + 1];
+static __xdata uint32_t task_start_us_s = 0;
+static __xdata uint32_t loop_start_us_s = 0;
+static bool loop_started_s = false;
+
+static uint32_t profile_now(void)
+{
+    uint32_t now;
+
+    // the USB interrupt reads the stats, and with the latency probe calls micros() too
+    IE_USB = 0;
+    now = micros();
+    IE_USB = 1;
+    return now;
+}
+
+static void profile_record(uint8_t slot, uint32_t elapsed)
+{
+    __xdata profile_stat_t *stat = &stats_s[slot];
+    uint16_t us = elapsed > 0xFFFF ? 0xFFFF : (uint16_t)elapsed;
+
+    IE_USB = 0;
+    if (stat->samples == 0xFFFF)
+    {
+        stat->samples >>= 1;
+        stat->total_us >>= 1;
+    }
+    stat->samples++;
+    stat->total_us += elapsed;
+    if (us > stat->max_us)
+    {
+        stat->max_us = us;
+    }
+    IE_USB = 1;
+}
+
+void profile_loop_start(void)
+{
+    uint32_t now = profile_now();
+
+    if (loop_started_s)
+    {
+        profile_record(PROFILE_TASK_COUNT, now - loop_start_us_s);
+    }
+    loop_start_us_s = now;
+    loop_started_s = true;
+}
+
+void profile_task_begin(void)
+{
+    task_start_us_s = profile_now();
+}
+
+void profile_task_end(profile_task_t task)
+{
+    profile_record((uint8_t)task, profile_now() - task_start_us_s);
+}
+
+#pragma save
+#pragma nooverlay
+void profile_report_fill(__xdata uint8_t *buffer)
+{
+    uint8_t slot;
+
+    buffer[0] = PROFILE_REPORT_ID;
+    buffer[1] = PROFILE_REPORT_VERSION;
+    buffer += 2;
+    for (slot = 0; slot <= PROFILE_TASK_COUNT; ++slot)
+    {
+        const __xdata profile_stat_t *stat = &stats_s[slot];
+        buffer[0] = (uint8_t)(stat->samples & 0xFF);
+        buffer[1] = (uint8_t)(stat->samples >> 8);
+        buffer[2] = (uint8_t)(stat->max_us & 0xFF);
+        buffer[3] = (uint8_t)(stat->max_us >> 8);
+        buffer[4] = (uint8_t)(stat->total_us & 0xFF);
+        buffer[5] = (uint8_t)((stat->total_us >> 8) & 0xFF);
+        buffer[6] = (uint8_t)((stat->total_us >> 16) & 0xFF);
+        buffer[7] = (uint8_t)(stat->total_us >> 24);
+        buffer += PROFILE_STAT_SIZE;
+    }
+}
+#pragma restore
+
+#endif
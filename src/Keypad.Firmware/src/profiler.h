@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+#include "../configuration.h"
+
+// 1 times every loop() task and the loop period and serves the figures as a
+// vendor HID feature report next to the latency one
+#ifndef CONFIGURATION_LOOP_PROFILER
+#define CONFIGURATION_LOOP_PROFILER 0
+#endif
+
+#if !CONFIGURATION_DEBUG_MODE && CONFIGURATION_LOOP_PROFILER
+
+typedef enum
+{
+    PROFILE_TASK_BUTTONS,
+    PROFILE_TASK_ENCODER,
+    PROFILE_TASK_HID,
+    PROFILE_TASK_LED,
+    PROFILE_TASK_COUNT
+} profile_task_t;
+
+#define PROFILE_REPORT_ID 5
+#define PROFILE_REPORT_VERSION 1
+
+// report ID, version, then per task and finally for the loop period:
+// samples, max_us, total_us (32-bit). Averages are total_us / samples; both
+// halve together before samples would overflow. Little-endian throughout.
+#define PROFILE_STAT_SIZE (2 + 2 + 4)
+#define PROFILE_REPORT_SIZE (1 + 1 + PROFILE_STAT_SIZE * (PROFILE_TASK_COUNT + 1))
+
+// start of a loop() pass that runs the tasks
+void profile_loop_start(void);
+
+// bracket one task; the reads cost a micros() call each
+void profile_task_begin(void);
+void profile_task_end(profile_task_t task);
+
+// USB interrupt: fill buffer with PROFILE_REPORT_SIZE bytes of feature report
+void profile_report_fill(__xdata uint8_t *buffer);
+
+#else
+#define profile_loop_start() ((void)0)
+#define profile_task_begin() ((void)0)
+#define profile_task_end(task) ((void)0)
+#endif
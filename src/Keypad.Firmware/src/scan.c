@@ -0,0 +1,48 @@
+#include <Arduino.h>
+#include "../configuration.h"
+#include "scan.h"
+
+#if !CONFIGURATION_DEBUG_MODE && CONFIGURATION_SCAN_RATE_HZ > 0
+
+// Timer2 runs from Fsys/12 in 16-bit auto-reload mode
+#define SCAN_TIMER_TICKS (F_CPU / 12 / CONFIGURATION_SCAN_RATE_HZ)
+#define SCAN_TIMER_RELOAD (65536UL - SCAN_TIMER_TICKS)
+
+#if SCAN_TIMER_TICKS < 1 || SCAN_TIMER_TICKS > 65535
+#error "CONFIGURATION_SCAN_RATE_HZ is out of range for Timer2"
+#endif
+
+static volatile __bit scan_due_s = 0;
+
+void scan_timer_interrupt(void) __interrupt(INT_NO_TMR2)
+{
+    TF2 = 0;
+    scan_due_s = 1;
+}
+
+void scan_setup(void)
+{
+    TR2 = 0;
+    ET2 = 0;
+    T2MOD &= ~bT2_CLK; // Fsys/12 regardless of bTMR_CLK
+    T2CON = 0; // 16-bit auto-reload, timer mode
+    RCAP2L = (uint8_t)(SCAN_TIMER_RELOAD & 0xFF);
+    RCAP2H = (uint8_t)(SCAN_TIMER_RELOAD >> 8);
+    TL2 = RCAP2L;
+    TH2 = RCAP2H;
+    scan_due_s = 0;
+    ET2 = 1;
+    TR2 = 1;
+}
+
+bool scan_tick_take(void)
+{
+    if (!scan_due_s)
+    {
+        return false;
+    }
+    scan_due_s = 0;
+    return true;
+}
+
+#endif
@@ -0,0 +1,21 @@
+#pragma once
+#include <stdbool.h>
+#include "../configuration.h"
+
+// 0 keeps the free-running loop() + delay(1) scan
+#ifndef CONFIGURATION_SCAN_RATE_HZ
+#define CONFIGURATION_SCAN_RATE_HZ 0
+#endif
+
+#if !CONFIGURATION_DEBUG_MODE && CONFIGURATION_SCAN_RATE_HZ > 0
+#include "include/ch5xx.h"
+
+// start Timer2 ticking at CONFIGURATION_SCAN_RATE_HZ
+void scan_setup(void);
+
+// true once per elapsed tick; ticks missed while busy are coalesced
+bool scan_tick_take(void);
+
+// Timer2 overflow handler, must be visible to the sketch so SDCC emits the vector
+void scan_timer_interrupt(void) __interrupt(INT_NO_TMR2);
+#endif
@@ -20,7 +20,7 @@ extern __xdata __at (EP1_ADDR) uint8_t Ep1Buffer[];
 volatile __xdata uint8_t UpPoint1_Busy =
     0; // Flag of whether upload pointer is busy
 
-__xdata uint8_t HIDKey[8] = {0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0};
+__xdata uint8_t HIDKey[KEYBOARD_REPORT_SIZE] = {0};
 __xdata uint8_t HIDMouse[4] = {0x0, 0x0, 0x0, 0x0};
 __xdata uint16_t HIDConsumer = 0;
 
@@ -159,8 +159,6 @@ __code uint8_t _asciimap[128] = {
 
 typedef void (*pTaskFn)(void);
 
-void delayMicroseconds(uint16_t us);
-
 void USBInit() {
   USBDeviceCfg();         // Device mode configuration
   USBDeviceEndPointCfg(); // Endpoint configuration
@@ -170,10 +168,65 @@ void USBInit() {
   UEP2_T_LEN = 0;
 }
 
+// Reports are queued here and handed to EP1 one at a time: the main loop
+// only ever appends at the tail, the EP1 IN interrupt pops from the head.
+#ifndef HID_REPORT_QUEUE_LENGTH
+#define HID_REPORT_QUEUE_LENGTH 8
+#endif
+#define HID_REPORT_MAX_SIZE (1 + sizeof(HIDKey)) // report ID + largest payload
+
+__xdata uint8_t reportQueue[HID_REPORT_QUEUE_LENGTH][HID_REPORT_MAX_SIZE];
+__xdata uint8_t reportQueueLen[HID_REPORT_QUEUE_LENGTH];
+volatile __data uint8_t reportQueueHead = 0; // next report for the endpoint
+volatile __data uint8_t reportQueueTail = 0; // next free slot
+
+// Mouse motion is summed here and sent as one report once the host has taken
+// the previous one; a click is a press report followed by a release report.
+#define MOUSE_CLICK_IDLE 0
+#define MOUSE_CLICK_PRESS 1
+#define MOUSE_CLICK_RELEASE 2
+
+__xdata int16_t mouseDx = 0;
+__xdata int16_t mouseDy = 0;
+__xdata int16_t mouseWheel = 0;
+__xdata uint8_t mouseClickPhase = MOUSE_CLICK_IDLE;
+__xdata uint8_t mouseClickButtons = 0;
+__xdata uint8_t mouseClickNext = 0;       // click requested while one is running
+volatile __bit mouseReportInFlight = 0;   // a mouse report is queued or on EP1
+
+// Copy the head report into the endpoint buffer and arm it. Runs from the USB
+// interrupt or from the main loop with the USB interrupt masked.
+#pragma save
+#pragma nooverlay
+static void USB_EP1_load(void) {
+  __data uint8_t len = reportQueueLen[reportQueueHead];
+  for (__data uint8_t i = 0; i < len; i++) {
+    Ep1Buffer[64 + i] = reportQueue[reportQueueHead][i];
+  }
+  UEP1_T_LEN = len;
+  reportQueueHead = reportQueueHead + 1 >= HID_REPORT_QUEUE_LENGTH
+                        ? 0
+                        : reportQueueHead + 1;
+
+  UpPoint1_Busy = 1;
+  UEP1_CTRL = UEP1_CTRL & ~MASK_UEP_T_RES |
+              UEP_T_RES_ACK; // upload data and respond ACK
+}
+#pragma restore
+
 void USB_EP1_IN() {
   UEP1_T_LEN = 0;
   UEP1_CTRL = UEP1_CTRL & ~MASK_UEP_T_RES | UEP_T_RES_NAK; // Default NAK
   UpPoint1_Busy = 0;                                       // Clear busy flag
+#if CONFIGURATION_LATENCY_PROBE
+  latency_mark_sent();
+#endif
+  if (Ep1Buffer[64] == 2) {
+    mouseReportInFlight = 0; // host took the mouse report, the next may go
+  }
+  if (reportQueueHead != reportQueueTail) {
+    USB_EP1_load();
+  }
 }
 
 void USB_EP1_OUT() {
@@ -182,83 +235,70 @@ void USB_EP1_OUT() {
   }
 }
 
-static uint8_t USB_EP1_send_consumer(uint8_t wait_for_ready) {
-  if (UsbConfig == 0) {
-    return 0;
-  }
+uint8_t USB_EP1_free(void) {
+  __data uint8_t used = reportQueueTail >= reportQueueHead
+                            ? reportQueueTail - reportQueueHead
+                            : HID_REPORT_QUEUE_LENGTH - reportQueueHead +
+                                  reportQueueTail;
+  return HID_REPORT_QUEUE_LENGTH - 1 - used;
+}
 
-  if (wait_for_ready) {
-    __data uint16_t waitWriteCount = 0;
-    while (UpPoint1_Busy) {
-      waitWriteCount++;
-      delayMicroseconds(5);
-      if (waitWriteCount >= 50000) {
-        return 0;
-      }
-    }
-  } else {
-    if (UpPoint1_Busy) {
-      return 0;
-    }
+void USB_EP1_flush(void) {
+  IE_USB = 0;
+  if (UsbConfig == 0) {
+    // not configured (or bus reset): anything queued is stale
+    reportQueueHead = reportQueueTail;
+    UpPoint1_Busy = 0;
+    mouseReportInFlight = 0;
+  } else if (!UpPoint1_Busy && reportQueueHead != reportQueueTail) {
+    USB_EP1_load();
   }
-
-  Ep1Buffer[64 + 0] = 3;
-  Ep1Buffer[64 + 1] = (uint8_t)(HIDConsumer & 0xFF);
-  Ep1Buffer[64 + 2] = (uint8_t)(HIDConsumer >> 8);
-  UEP1_T_LEN = 1 + sizeof(HIDConsumer);
-
-  UpPoint1_Busy = 1;
-  UEP1_CTRL = UEP1_CTRL & ~MASK_UEP_T_RES | UEP_T_RES_ACK;
-
-  return 1;
+  IE_USB = 1;
 }
 
+// Snapshot the current report for reportID into the queue; 0 when full.
 uint8_t USB_EP1_send(__data uint8_t reportID) {
-  if (reportID == 3) {
-    return USB_EP1_send_consumer(1);
-  }
+  __data uint8_t next;
+  __xdata uint8_t *slot;
 
   if (UsbConfig == 0) {
     return 0;
   }
 
-  __data uint16_t waitWriteCount = 0;
-
-  waitWriteCount = 0;
-  while (UpPoint1_Busy) { // wait for 250ms or give up
-    waitWriteCount++;
-    delayMicroseconds(5);
-    if (waitWriteCount >= 50000)
-      return 0;
+  next = reportQueueTail + 1 >= HID_REPORT_QUEUE_LENGTH ? 0 : reportQueueTail + 1;
+  if (next == reportQueueHead) {
+    return 0;
   }
 
+  slot = reportQueue[reportQueueTail];
+  slot[0] = reportID;
   if (reportID == 1) {
-    Ep1Buffer[64 + 0] = 1;
-    for (__data uint8_t i = 0; i < sizeof(HIDKey); i++) { // load data for
-                                                          // upload
-      Ep1Buffer[64 + 1 + i] = HIDKey[i];
+    for (__data uint8_t i = 0; i < sizeof(HIDKey); i++) {
+      slot[1 + i] = HIDKey[i];
     }
-    UEP1_T_LEN = 1 + sizeof(HIDKey); // data length
+    reportQueueLen[reportQueueTail] = 1 + sizeof(HIDKey);
   } else if (reportID == 2) {
-    Ep1Buffer[64 + 0] = 2;
-    for (__data uint8_t i = 0; i < sizeof(HIDMouse);
-         i++) { // load data for upload
-      Ep1Buffer[64 + 1 + i] = ((uint8_t *)HIDMouse)[i];
+    for (__data uint8_t i = 0; i < sizeof(HIDMouse); i++) {
+      slot[1 + i] = HIDMouse[i];
     }
-    UEP1_T_LEN = 1 + sizeof(HIDMouse); // data length
+    reportQueueLen[reportQueueTail] = 1 + sizeof(HIDMouse);
+  } else if (reportID == 3) {
+    slot[1] = (uint8_t)(HIDConsumer & 0xFF);
+    slot[2] = (uint8_t)(HIDConsumer >> 8);
+    reportQueueLen[reportQueueTail] = 1 + sizeof(HIDConsumer);
   } else {
-    UEP1_T_LEN = 0;
+    return 0;
   }
+  reportQueueTail = next;
 
-  UpPoint1_Busy = 1;
-  UEP1_CTRL = UEP1_CTRL & ~MASK_UEP_T_RES |
-              UEP_T_RES_ACK; // upload data and respond ACK
-
+  USB_EP1_flush();
   return 1;
 }
 
 uint8_t Keyboard_press(__data uint8_t k) {
+#if !CONFIGURATION_HID_NKRO
   __data uint8_t i;
+#endif
   if (k >= 136) { // it's a non-printing key (not a modifier)
     k = k - 136;
   } else if (k >= 128) { // it's a modifier key
@@ -277,6 +317,12 @@ uint8_t Keyboard_press(__data uint8_t k) {
     }
   }
 
+#if CONFIGURATION_HID_NKRO
+  // one bit per usage; non-printing keys top out at 0xFF - 136 = 0x77
+  if (k) {
+    HIDKey[1 + (k >> 3)] |= (uint8_t)(1 << (k & 7));
+  }
+#else
   // Add k to the key report only if it's not already present
   // and if there is an empty slot.
   if (HIDKey[2] != k && HIDKey[3] != k && HIDKey[4] != k && HIDKey[5] != k &&
@@ -293,8 +339,39 @@ uint8_t Keyboard_press(__data uint8_t k) {
       return 0;
     }
   }
-  USB_EP1_send(1);
-  return 1;
+#endif
+  return USB_EP1_send(1);
+}
+
+uint8_t Keyboard_release(__data uint8_t k) {
+  if (k >= 136) { // it's a non-printing key (not a modifier)
+    k = k - 136;
+  } else if (k >= 128) { // it's a modifier key
+    HIDKey[0] &= ~(1 << (k - 128));
+    k = 0;
+  } else { // it's a printing key
+    k = _asciimap[k];
+    if (!k) {
+      return 0;
+    }
+    if (k & 0x80) { // it's a capital letter or other character reached with shift
+      HIDKey[0] &= ~(0x02); // the left shift modifier
+      k &= 0x7F;
+    }
+  }
+
+  if (k) {
+#if CONFIGURATION_HID_NKRO
+    HIDKey[1 + (k >> 3)] &= (uint8_t)~(1 << (k & 7));
+#else
+    for (__data uint8_t i = 2; i < 8; i++) {
+      if (HIDKey[i] == k) {
+        HIDKey[i] = 0x00;
+      }
+    }
+#endif
+  }
+  return USB_EP1_send(1);
 }
 
 void Keyboard_releaseAll(void) {
@@ -304,45 +381,146 @@ void Keyboard_releaseAll(void) {
   USB_EP1_send(1);
 }
 
-uint8_t Keyboard_consumer_send(__data uint16_t usage) {
-  HIDConsumer = usage;
-  if (!USB_EP1_send_consumer(1)) {
+// Press a run of printable characters in one report, then release them.
+// The run ends on a repeated key or a shift change. Under NKRO it ends when a
+// usage is not above the last one, because hosts read the bitmap in usage
+// order. Returns the number of characters consumed, or 0 when the queue has no
+// room for both reports. Characters with no mapping are skipped.
+uint8_t Keyboard_type(const __code uint8_t *text, __data uint8_t length,
+                      __data uint8_t modifiers) {
+  __data uint8_t used = 0;
+  __data uint8_t keys = 0;
+  __data uint8_t shift = 0;
+  __data uint8_t i;
+#if CONFIGURATION_HID_NKRO
+  __data uint8_t last = 0;
+#endif
+
+  if (length == 0 || USB_EP1_free() < 2) {
     return 0;
   }
-  HIDConsumer = 0;
-  if (!USB_EP1_send_consumer(1)) {
-    return 0;
+  for (i = 0; i < sizeof(HIDKey); i++) {
+    HIDKey[i] = 0;
   }
-  return 1;
+
+  while (used < length && keys < 6) {
+    __data uint8_t k = text[used];
+    k = k < 128 ? _asciimap[k] : 0;
+    if (!k) {
+      used++;
+      continue;
+    }
+    if (keys && (k & 0x80) != shift) {
+      break;
+    }
+    shift = k & 0x80;
+    k &= 0x7F;
+#if CONFIGURATION_HID_NKRO
+    if (keys && k <= last) {
+      break;
+    }
+    last = k;
+    HIDKey[1 + (k >> 3)] |= (uint8_t)(1 << (k & 7));
+#else
+    for (i = 2; i < 2 + keys; i++) {
+      if (HIDKey[i] == k) {
+        break;
+      }
+    }
+    if (i < 2 + keys) {
+      break;
+    }
+    HIDKey[2 + keys] = k;
+#endif
+    keys++;
+    used++;
+  }
+
+  if (keys) {
+    HIDKey[0] = modifiers | (shift ? 0x02 : 0);
+    USB_EP1_send(1);
+    Keyboard_releaseAll();
+  }
+  return used;
 }
 
 uint8_t Keyboard_consumer_try_send(__data uint16_t usage) {
   HIDConsumer = usage;
-  return USB_EP1_send_consumer(0);
+  return USB_EP1_send(3);
+}
+
+static int16_t Mouse_accumulate(__data int16_t total, __data int8_t delta) {
+  // saturate well clear of int16 overflow; the host never sees more than +-127
+  if (delta > 0 && total > 0x7000) {
+    return total;
+  }
+  if (delta < 0 && total < -0x7000) {
+    return total;
+  }
+  return total + delta;
+}
+
+static int8_t Mouse_take(__xdata int16_t *total) {
+  __data int16_t value = *total;
+  if (value > 127) {
+    value = 127;
+  } else if (value < -127) {
+    value = -127;
+  }
+  *total -= value;
+  return (int8_t)value;
 }
 
 uint8_t Mouse_click(__data uint8_t k) {
-  memset(HIDMouse, 0, sizeof(HIDMouse));
-  HIDMouse[0] = k;
-  USB_EP1_send(2);
-  delayMicroseconds(10000);
-  memset(HIDMouse, 0, sizeof(HIDMouse));
-  USB_EP1_send(2);
+  if (mouseClickPhase == MOUSE_CLICK_IDLE) {
+    mouseClickButtons = k;
+    mouseClickPhase = MOUSE_CLICK_PRESS;
+  } else {
+    mouseClickNext |= k;
+  }
   return 1;
 }
 
 uint8_t Mouse_move(__data int8_t x, __xdata int8_t y) {
-  memset(HIDMouse, 0, sizeof(HIDMouse));
-  HIDMouse[1] = x;
-  HIDMouse[2] = y;
-  USB_EP1_send(2);
+  mouseDx = Mouse_accumulate(mouseDx, x);
+  mouseDy = Mouse_accumulate(mouseDy, y);
   return 1;
 }
 
 uint8_t Mouse_scroll(__data int8_t tilt) {
-  memset(HIDMouse, 0, sizeof(HIDMouse));
-  HIDMouse[3] = tilt;
-  USB_EP1_send(2);
+  mouseWheel = Mouse_accumulate(mouseWheel, tilt);
   return 1;
 }
+
+void Mouse_flush(void) {
+  __data uint8_t buttons = 0;
+
+  if (mouseReportInFlight || UsbConfig == 0 || USB_EP1_free() == 0) {
+    return;
+  }
+
+  if (mouseClickPhase == MOUSE_CLICK_PRESS) {
+    buttons = mouseClickButtons;
+    mouseClickPhase = MOUSE_CLICK_RELEASE;
+  } else if (mouseClickPhase == MOUSE_CLICK_RELEASE) {
+    if (mouseClickNext) {
+      mouseClickButtons = mouseClickNext;
+      mouseClickNext = 0;
+      mouseClickPhase = MOUSE_CLICK_PRESS;
+    } else {
+      mouseClickPhase = MOUSE_CLICK_IDLE;
+    }
+  } else if (mouseDx == 0 && mouseDy == 0 && mouseWheel == 0) {
+    return;
+  }
+
+  HIDMouse[0] = buttons;
+  HIDMouse[1] = Mouse_take(&mouseDx);
+  HIDMouse[2] = Mouse_take(&mouseDy);
+  HIDMouse[3] = Mouse_take(&mouseWheel);
+  mouseReportInFlight = 1; // set first: EP1 may complete before send returns
+  if (!USB_EP1_send(2)) {
+    mouseReportInFlight = 0;
+  }
+}
 #endif
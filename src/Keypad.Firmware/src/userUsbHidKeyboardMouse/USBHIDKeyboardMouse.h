@@ -68,13 +68,23 @@ extern "C" {
 
 void USBInit(void);
 
+// free slots in the HID report queue; API calls return 0 once it is full
+uint8_t USB_EP1_free(void);
+// hand the next queued report to EP1 if the endpoint is idle
+void USB_EP1_flush(void);
+
 uint8_t Keyboard_press(__data uint8_t k);
+uint8_t Keyboard_release(__data uint8_t k);
 void Keyboard_releaseAll(void);
-uint8_t Keyboard_consumer_send(__data uint16_t usage);
+// type as many characters of text as fit in one report; returns how many were used
+uint8_t Keyboard_type(const __code uint8_t *text, __data uint8_t length,
+                      __data uint8_t modifiers);
 uint8_t Keyboard_consumer_try_send(__data uint16_t usage);
 uint8_t Mouse_click(__data uint8_t k);
 uint8_t Mouse_move(__data int8_t x, __xdata int8_t y);
 uint8_t Mouse_scroll(__data int8_t tilt);
+// send accumulated motion and click state once the host took the last report
+void Mouse_flush(void);
 
 #ifdef __cplusplus
 } // extern "C"
@@ -78,7 +78,7 @@ __code USB_Descriptor_Configuration_t ConfigurationDescriptor = {
                                  (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC |
                                   ENDPOINT_USAGE_DATA),
                              .EndpointSize = KEYBOARD_MOUSE_EPSIZE,
-                             .PollingIntervalMS = 10},
+                             .PollingIntervalMS = CONFIGURATION_HID_POLL_INTERVAL_MS},
 
     .HID_ReportOUTEndpoint = {.Header = {.Size =
                                              sizeof(USB_Descriptor_Endpoint_t),
@@ -89,7 +89,7 @@ __code USB_Descriptor_Configuration_t ConfigurationDescriptor = {
                                   (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC |
                                    ENDPOINT_USAGE_DATA),
                               .EndpointSize = KEYBOARD_MOUSE_EPSIZE,
-                              .PollingIntervalMS = 10},
+                              .PollingIntervalMS = CONFIGURATION_HID_POLL_INTERVAL_MS},
 };
 
 __code uint8_t ReportDescriptor[] = {
@@ -105,6 +105,14 @@ __code uint8_t ReportDescriptor[] = {
     0x95, 0x08,       //   REPORT_COUNT (8)
     0x75, 0x01,       //   REPORT_SIZE (1)
     0x81, 0x02,       //   INPUT (Data,Var,Abs)
+#if CONFIGURATION_HID_NKRO
+    0x95, 0x80,       //   REPORT_COUNT (128)
+    0x75, 0x01,       //   REPORT_SIZE (1)
+    0x05, 0x07,       //   USAGE_PAGE (Keyboard)
+    0x19, 0x00,       //   USAGE_MINIMUM (Reserved (no event indicated))
+    0x29, 0x7f,       //   USAGE_MAXIMUM (Keyboard Mute)
+    0x81, 0x02,       //   INPUT (Data,Var,Abs)
+#else
     0x95, 0x01,       //   REPORT_COUNT (1)
     0x75, 0x08,       //   REPORT_SIZE (8)
     0x81, 0x03,       //   INPUT (Cnst,Var,Abs)
@@ -116,6 +124,7 @@ __code uint8_t ReportDescriptor[] = {
     0x19, 0x00,       //   USAGE_MINIMUM (Reserved (no event indicated))
     0x29, 0xe7,       //   USAGE_MAXIMUM (Keyboard Right GUI)
     0x81, 0x00,       //   INPUT (Data,Ary,Abs)
+#endif
     0x05, 0x08,       //   USAGE_PAGE (LEDs)
     0x19, 0x01,       //   USAGE_MINIMUM (Num Lock)
     0x29, 0x05,       //   USAGE_MAXIMUM (Kana)
@@ -167,7 +176,28 @@ __code uint8_t ReportDescriptor[] = {
     0x95, 0x01,       //   REPORT_COUNT (1)
     0x75, 0x10,       //   REPORT_SIZE (16)
     0x81, 0x00,       //   INPUT (Data,Ary,Abs)
-    0xc0              // END_COLLECTION
+    0xc0,             // END_COLLECTION
+#if USB_FEATURE_REPORTS
+    0x06, 0x00, 0xff, // USAGE_PAGE (Vendor Defined 0xFF00)
+    0x09, 0x01,       // USAGE (Vendor Usage 1)
+    0xa1, 0x01,       // COLLECTION (Application)
+    0x15, 0x00,       //   LOGICAL_MINIMUM (0)
+    0x26, 0xff, 0x00, //   LOGICAL_MAXIMUM (255)
+    0x75, 0x08,       //   REPORT_SIZE (8)
+#if CONFIGURATION_LATENCY_PROBE
+    0x85, LATENCY_REPORT_ID, //   REPORT_ID (4)
+    0x09, 0x02,       //   USAGE (Vendor Usage 2)
+    0x95, LATENCY_REPORT_SIZE - 1, //   REPORT_COUNT (statistics bytes)
+    0xb1, 0x02,       //   FEATURE (Data,Var,Abs)
+#endif
+#if CONFIGURATION_LOOP_PROFILER
+    0x85, PROFILE_REPORT_ID, //   REPORT_ID (5)
+    0x09, 0x03,       //   USAGE (Vendor Usage 3)
+    0x95, PROFILE_REPORT_SIZE - 1, //   REPORT_COUNT (statistics bytes)
+    0xb1, 0x02,       //   FEATURE (Data,Var,Abs)
+#endif
+    0xc0,             // END_COLLECTION
+#endif
 };
 
 // String Descriptors
@@ -7,6 +7,8 @@
 #include "include/ch5xx_usb.h"
 #include "usbCommonDescriptors/StdDescriptors.h"
 #include "usbCommonDescriptors/HIDClassCommon.h"
+#include "../latency.h"
+#include "../profiler.h"
 // clang-format on
 
 #define EP0_ADDR 0
@@ -14,7 +16,38 @@
 
 #define KEYBOARD_EPADDR 0x81
 #define KEYBOARD_LED_EPADDR 0x01
-#define KEYBOARD_MOUSE_EPSIZE 9
+
+// NKRO swaps the six key slots for one bit per usage 0x00..0x7F
+#ifndef CONFIGURATION_HID_NKRO
+#define CONFIGURATION_HID_NKRO 0
+#endif
+
+#if CONFIGURATION_HID_NKRO
+#define KEYBOARD_NKRO_BYTES 16
+#define KEYBOARD_REPORT_SIZE (1 + KEYBOARD_NKRO_BYTES) // modifiers + bitmap
+#else
+#define KEYBOARD_REPORT_SIZE 8 // modifiers, reserved, six key slots
+#endif
+
+#define KEYBOARD_MOUSE_EPSIZE (1 + KEYBOARD_REPORT_SIZE) // report ID + largest report
+
+// bInterval for both interrupt endpoints; full speed allows 1..255 ms
+#ifndef CONFIGURATION_HID_POLL_INTERVAL_MS
+#define CONFIGURATION_HID_POLL_INTERVAL_MS 10
+#endif
+
+// instrumentation feature reports in a vendor-defined collection
+#define USB_FEATURE_REPORTS (CONFIGURATION_LATENCY_PROBE || CONFIGURATION_LOOP_PROFILER)
+#if CONFIGURATION_LOOP_PROFILER
+#define USB_FEATURE_REPORT_MAX_SIZE PROFILE_REPORT_SIZE // the larger of the two
+#elif CONFIGURATION_LATENCY_PROBE
+#define USB_FEATURE_REPORT_MAX_SIZE LATENCY_REPORT_SIZE
+#endif
+
+#ifndef HID_GET_REPORT
+#define HID_GET_REPORT 0x01
+#endif
+#define HID_REPORT_TYPE_FEATURE 0x03
 
 /** Type define for the device configuration descriptor structure. This must be
  * defined in the application code, as the configuration descriptor contains
@@ -32,6 +32,28 @@ __code uint8_t *__data pDescr;
 
 volatile uint8_t usbMsgFlags = 0; // uint8_t usbMsgFlags copied from VUSB
 
+#if USB_FEATURE_REPORTS
+#define USB_MSG_FEATURE_REPORT 0x01 // EP0 IN continues from featureReport
+
+__xdata uint8_t featureReport[USB_FEATURE_REPORT_MAX_SIZE];
+__xdata uint8_t *__data pFeature;
+
+// Copy the next EP0 packet of the feature report; runs in the USB interrupt.
+#pragma save
+#pragma nooverlay
+static uint8_t USB_EP0_feature_chunk(void) {
+  __data uint8_t len =
+      SetupLen >= DEFAULT_ENDP0_SIZE ? DEFAULT_ENDP0_SIZE : SetupLen;
+  for (__data uint8_t i = 0; i < len; i++) {
+    Ep0Buffer[i] = pFeature[i];
+  }
+  SetupLen -= len;
+  pFeature += len;
+  return len;
+}
+#pragma restore
+#endif
+
 inline void NOP_Process(void) {}
 
 void USB_EP0_SETUP() {
@@ -59,6 +81,36 @@ void USB_EP0_SETUP() {
       }
       case USB_REQ_TYP_CLASS: {
         switch (SetupReq) {
+#if USB_FEATURE_REPORTS
+        case HID_GET_REPORT: {
+          __data uint8_t size = 0;
+          if (UsbSetupBuf->wValueH == HID_REPORT_TYPE_FEATURE) {
+#if CONFIGURATION_LATENCY_PROBE
+            if (UsbSetupBuf->wValueL == LATENCY_REPORT_ID) {
+              latency_report_fill(featureReport);
+              size = LATENCY_REPORT_SIZE;
+            }
+#endif
+#if CONFIGURATION_LOOP_PROFILER
+            if (UsbSetupBuf->wValueL == PROFILE_REPORT_ID) {
+              profile_report_fill(featureReport);
+              size = PROFILE_REPORT_SIZE;
+            }
+#endif
+          }
+          if (size == 0) {
+            len = 0xFF; // only the instrumentation feature reports can be read
+            break;
+          }
+          pFeature = featureReport;
+          if (SetupLen > size) {
+            SetupLen = size;
+          }
+          usbMsgFlags |= USB_MSG_FEATURE_REPORT;
+          len = USB_EP0_feature_chunk();
+          break;
+        }
+#endif
         default:
           len = 0xFF; // command not supported
           break;
@@ -304,6 +356,13 @@ void USB_EP0_SETUP() {
 }
 
 void USB_EP0_IN() {
+#if USB_FEATURE_REPORTS
+  if (usbMsgFlags & USB_MSG_FEATURE_REPORT) {
+    UEP0_T_LEN = USB_EP0_feature_chunk();
+    UEP0_CTRL ^= bUEP_T_TOG; // Switch between DATA0 and DATA1
+    return;
+  }
+#endif
   switch (SetupReq) {
   case USB_GET_DESCRIPTOR: {
     __data uint8_t len = SetupLen >= DEFAULT_ENDP0_SIZE
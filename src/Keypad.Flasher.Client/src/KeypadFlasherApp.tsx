@@ -12,18 +12,27 @@ import {
 import {
   findProfileForBootloaderId,
   DEVICE_PROFILES,
+  MAX_LAYERS,
+  type BindingLayerDto,
   type BindingProfileDto,
   type DeviceLayoutDto,
   type HidBindingDto,
   type HidStepDto,
   type KnownDeviceProfile,
 } from "./lib/keypad-configs";
-import { normalizeIncomingStep } from "./lib/binding-utils";
+import { layerLabel, normalizeIncomingStep } from "./lib/binding-utils";
+import { BUILD_STAGE_LABELS, FIRMWARE_BINARY_TYPE, fetchFirmwareViaJob, isBusy, queuedLabel } from "./lib/build-jobs";
+import { fetchFirmwareVersion, firmwareCacheKey, loadCachedFirmware, storeCachedFirmware } from "./lib/firmware-cache";
 import { cloneLayout, loadLastBootloaderId, loadLastDemoKey, loadStoredConfig, saveLastBootloaderId, saveLastDemoKey, saveStoredConfig } from "./lib/layout-storage";
 import { LayoutPreview } from "./components/LayoutPreview";
 import { LightingPreview } from "./components/LightingPreview";
 import { StatusBanner } from "./components/StatusBanner";
+import { BudgetMeter } from "./components/BudgetMeter";
+import { fetchFirmwareBudget, type FirmwareBudget } from "./lib/firmware-budget";
 import { StepEditor } from "./components/StepEditor";
+import { PinCapturePlot } from "./components/PinCapturePlot";
+import { PROFILE_TASK_LABELS, histogramBucketLabel, readLatencyStats, readLoopProfile, webHidAvailable, type LatencyStats, type TaskTiming } from "./lib/device-instrumentation";
+import { startPinCapture, webSerialAvailable, type PinSample } from "./lib/pin-capture";
 import type { EditTarget, LedConfigurationDto, LedColor, PassiveLedMode, ActiveLedMode } from "./types";
 import "./styles/base.css";
 
@@ -33,6 +42,13 @@ type FirmwareRequestBody = {
   debug: boolean;
   ledConfig: LedConfigurationDto | null;
   debugOptions: DebugOptionsDto | null;
+  firmwareOptions: FirmwareOptionsDto | null;
+};
+
+// only the fields the client changes; the server fills in defaults for the rest
+type FirmwareOptionsDto = {
+  latencyProbe: boolean;
+  loopProfiler: boolean;
 };
 
 type DebugOptionsDto = {
@@ -40,8 +56,14 @@ type DebugOptionsDto = {
   enablePullups: boolean;
   confirmSamples: number;
   confirmDelayMs: number;
+  // 0 keeps the text log; otherwise the sample rate of the binary pin capture
+  captureRateHz: number;
 };
 
+const DEFAULT_CAPTURE_RATE_HZ = 10000;
+const MAX_CAPTURE_SAMPLES = 2000;
+const BUDGET_DEBOUNCE_MS = 400;
+
 type StatusState =
   | "idle"
   | "requesting"
@@ -161,7 +183,38 @@ const validateBindingProfileCandidate = (raw: unknown): BindingProfileDto => {
     }
     return base;
   });
-  return { buttons, encoders };
+  const layers = validateBindingLayersCandidate((raw as { layers?: unknown }).layers);
+  return layers.length > 0 ? { buttons, encoders, layers } : { buttons, encoders };
+};
+
+// older exports have no layers; every field of a layer entry is optional
+const validateBindingLayersCandidate = (raw: unknown): BindingLayerDto[] => {
+  if (raw == null) return [];
+  if (!Array.isArray(raw)) throw new Error("Binding layers must be an array.");
+  if (raw.length + 1 > MAX_LAYERS) throw new Error(`At most ${MAX_LAYERS} layers are supported, including the base layer.`);
+  return raw.map((layer, index): BindingLayerDto => {
+    const label = `Layer ${index + 1}`;
+    if (!layer || typeof layer !== "object") throw new Error(`${label} invalid.`);
+    const candidate = layer as { buttons?: unknown; encoders?: unknown };
+    const btns = candidate.buttons == null ? [] : candidate.buttons;
+    const encs = candidate.encoders == null ? [] : candidate.encoders;
+    if (!Array.isArray(btns) || !Array.isArray(encs)) throw new Error(`${label} buttons and encoders must be arrays.`);
+    const buttons = btns.map((b): BindingLayerDto["buttons"][number] => {
+      const { id, binding } = (b ?? {}) as { id?: unknown; binding?: unknown };
+      if (typeof id !== "number" || !Number.isFinite(id)) throw new Error(`${label} button binding id missing.`);
+      return { id, binding: toSequenceBinding(binding, `${label} button`) };
+    });
+    const encoders = encs.map((e): BindingLayerDto["encoders"][number] => {
+      const { id, clockwise, counterClockwise, press } = (e ?? {}) as { id?: unknown; clockwise?: unknown; counterClockwise?: unknown; press?: unknown };
+      if (typeof id !== "number" || !Number.isFinite(id)) throw new Error(`${label} encoder binding id missing.`);
+      const entry: BindingLayerDto["encoders"][number] = { id };
+      if (clockwise != null) entry.clockwise = toSequenceBinding(clockwise, `${label} encoder clockwise`);
+      if (counterClockwise != null) entry.counterClockwise = toSequenceBinding(counterClockwise, `${label} encoder counter-clockwise`);
+      if (press != null) entry.press = toSequenceBinding(press, `${label} encoder press`);
+      return entry;
+    });
+    return { buttons, encoders };
+  });
 };
 
 const validateLedConfigCandidate = (raw: unknown): LedConfigurationDto => {
@@ -175,6 +228,7 @@ const validateLedConfigCandidate = (raw: unknown): LedConfigurationDto => {
     rainbowStepMs?: unknown;
     breathingMinPercent?: unknown;
     breathingStepMs?: unknown;
+    gammaCorrection?: unknown;
   };
   if (!Array.isArray(rawConfig.passiveModes)) throw new Error("LED config missing passiveModes array.");
   if (!Array.isArray(rawConfig.passiveColors)) throw new Error("LED config missing passiveColors array.");
@@ -209,6 +263,7 @@ const validateLedConfigCandidate = (raw: unknown): LedConfigurationDto => {
     rainbowStepMs: requireNumber(rawConfig.rainbowStepMs, "LED rainbowStepMs"),
     breathingMinPercent: requireNumber(rawConfig.breathingMinPercent, "LED breathingMinPercent"),
     breathingStepMs: requireNumber(rawConfig.breathingStepMs, "LED breathingStepMs"),
+    gammaCorrection: rawConfig.gammaCorrection === true,
   };
 };
 
@@ -409,9 +464,20 @@ export default function KeypadFlasherApp() {
   const [demoMode, setDemoMode] = useState<boolean>(false);
   const [devMode, setDevMode] = useState<boolean>(false);
   const [debugFirmware, setDebugFirmware] = useState<boolean>(false);
-  const defaultDebugOptions: DebugOptionsDto = { enableNoiseFilter: true, enablePullups: true, confirmSamples: 3, confirmDelayMs: 1 };
-  const classicDebugOptions: DebugOptionsDto = { enableNoiseFilter: false, enablePullups: false, confirmSamples: 1, confirmDelayMs: 0 };
+  const defaultDebugOptions: DebugOptionsDto = { enableNoiseFilter: true, enablePullups: true, confirmSamples: 3, confirmDelayMs: 1, captureRateHz: 0 };
+  const classicDebugOptions: DebugOptionsDto = { enableNoiseFilter: false, enablePullups: false, confirmSamples: 1, confirmDelayMs: 0, captureRateHz: 0 };
   const [debugOptions, setDebugOptions] = useState<DebugOptionsDto>(defaultDebugOptions);
+  const [latencyProbe, setLatencyProbe] = useState<boolean>(false);
+  const [latencyStats, setLatencyStats] = useState<LatencyStats | null>(null);
+  const [loopProfiler, setLoopProfiler] = useState<boolean>(false);
+  const [loopProfile, setLoopProfile] = useState<TaskTiming[] | null>(null);
+  const [budget, setBudget] = useState<FirmwareBudget | null>(null);
+  // bumped after each build so the meter picks up the sizes the server just learned
+  const [budgetRevision, setBudgetRevision] = useState<number>(0);
+  const [captureSamples, setCaptureSamples] = useState<PinSample[]>([]);
+  const [captureDropped, setCaptureDropped] = useState<number>(0);
+  const [captureActive, setCaptureActive] = useState<boolean>(false);
+  const stopCaptureRef = useRef<(() => Promise<void>) | null>(null);
   const [selectedProfile, setSelectedProfile] = useState<KnownDeviceProfile | null>(null);
   const [rememberedBootloaderId, setRememberedBootloaderId] = useState<number[] | null>(null);
   const [currentBindings, setCurrentBindings] = useState<BindingProfileDto | null>(null);
@@ -419,6 +485,7 @@ export default function KeypadFlasherApp() {
   const [ledConfig, setLedConfig] = useState<LedConfigurationDto | null>(null);
   const [editorTarget, setEditorTarget] = useState<EditTarget | null>(null);
   const [editorBinding, setEditorBinding] = useState<HidBindingDto | null>(null);
+  const [editLayerIndex, setEditLayerIndex] = useState<number>(0);
   const [stepClipboard, setStepClipboard] = useState<HidStepDto[] | null>(null);
   const [showGlobalLightingModal, setShowGlobalLightingModal] = useState<boolean>(false);
   const [showLightingModal, setShowLightingModal] = useState<boolean>(false);
@@ -539,7 +606,11 @@ export default function KeypadFlasherApp() {
     if (!devMode && debugFirmware) {
       setDebugFirmware(false);
     }
-  }, [devMode, debugFirmware]);
+    if (!devMode && (latencyProbe || loopProfiler)) {
+      setLatencyProbe(false);
+      setLoopProfiler(false);
+    }
+  }, [devMode, debugFirmware, latencyProbe, loopProfiler]);
 
   useEffect(() => {
     const lastId = loadLastBootloaderId();
@@ -755,6 +826,32 @@ export default function KeypadFlasherApp() {
     saveStoredConfig(targetId, { bindings: currentBindings, layout: selectedLayout, ledConfig });
   }, [connectedInfo, rememberedBootloaderId, currentBindings, selectedLayout, ledConfig, demoMode]);
 
+  // follows the editor, trailing each burst of edits so typing a macro is one request
+  useEffect(() => {
+    if (debugFirmware || !selectedLayout || !currentBindings) {
+      setBudget(null);
+      return;
+    }
+    const payload: FirmwareRequestBody = {
+      layout: selectedLayout,
+      bindingProfile: currentBindings,
+      debug: false,
+      ledConfig: ledCountFromLayout(selectedLayout) > 0 ? ledConfig : null,
+      debugOptions: null,
+      firmwareOptions: latencyProbe || loopProfiler ? { latencyProbe, loopProfiler } : null,
+    };
+    const controller = new AbortController();
+    const timer = window.setTimeout(() => {
+      fetchFirmwareBudget(payload, controller.signal).then(setBudget, () => {
+        if (!controller.signal.aborted) setBudget(null);
+      });
+    }, BUDGET_DEBOUNCE_MS);
+    return () => {
+      window.clearTimeout(timer);
+      controller.abort();
+    };
+  }, [debugFirmware, selectedLayout, currentBindings, ledConfig, ledCountFromLayout, latencyProbe, loopProfiler, budgetRevision]);
+
   useEffect(() => {
     if (!webUsbAvailable || typeof navigator === "undefined" || !navigator.usb) return;
     const onUsbDisconnect = (event: USBConnectionEvent) => {
@@ -853,27 +950,56 @@ export default function KeypadFlasherApp() {
       return;
     }
 
+    if (!debugFirmware && budget && !budget.fits) {
+      setStatus({ state: "compileError", detail: `Layout needs ${budget.blob.used} bytes of configuration but the device holds ${budget.blob.limit}. Shorten or remove some macros.` });
+      return;
+    }
+
     try {
-      setStatus({ state: "compiling", detail: debugFirmware ? "Debug firmware" : selectedProfile?.name });
+      const buildLabel = debugFirmware ? "Debug firmware" : selectedProfile?.name;
+      setStatus({ state: "compiling", detail: buildLabel });
       const requestLedConfig = debugFirmware ? null : assertLedConfigMatchesLayout(selectedLayout, ledConfig);
       const sanitizedDebugOptions: DebugOptionsDto = {
         enableNoiseFilter: debugOptions.enableNoiseFilter,
         enablePullups: debugOptions.enablePullups,
         confirmSamples: Math.max(1, Math.min(255, Math.round(debugOptions.confirmSamples))),
         confirmDelayMs: Math.max(0, Math.min(255, Math.round(debugOptions.confirmDelayMs))),
+        captureRateHz: debugOptions.captureRateHz > 0 ? Math.max(1000, Math.min(20000, Math.round(debugOptions.captureRateHz))) : 0,
       };
       const payload: FirmwareRequestBody = debugFirmware
-        ? { layout: null, bindingProfile: null, debug: true, ledConfig: null, debugOptions: sanitizedDebugOptions }
-        : { layout: selectedLayout, bindingProfile: currentBindings, debug: false, ledConfig: requestLedConfig, debugOptions: null };
-
-      const resp = await fetch("flasher", {
-        method: "POST",
-        headers: { "Content-Type": "application/json" },
-        body: JSON.stringify(payload),
-      });
+        ? { layout: null, bindingProfile: null, debug: true, ledConfig: null, debugOptions: sanitizedDebugOptions, firmwareOptions: null }
+        : { layout: selectedLayout, bindingProfile: currentBindings, debug: false, ledConfig: requestLedConfig, debugOptions: null, firmwareOptions: latencyProbe || loopProfiler ? { latencyProbe, loopProfiler } : null };
+
+      // batches of pads with the same configuration only compile and download for the first one;
+      // later ones send the cached copy's ETag and flash it when the server answers 304, which it
+      // does without queueing a build while its result cache still holds the image
+      const firmwareVersion = await fetchFirmwareVersion();
+      const cacheKey = firmwareVersion ? await firmwareCacheKey(firmwareVersion, payload) : null;
+      const cached = cacheKey ? await loadCachedFirmware(cacheKey) : null;
+
+      const withLabel = (detail: string) => (buildLabel ? `${buildLabel} (${detail})` : detail);
+      const resp = await fetchFirmwareViaJob(
+        payload,
+        (stage, queuePosition) => {
+          setStatus({ state: "compiling", detail: withLabel(stage === "Queued" ? queuedLabel(queuePosition) : BUILD_STAGE_LABELS[stage]) });
+        },
+        (retryAfterS) => setStatus({ state: "compiling", detail: withLabel(`server busy, retrying in ${retryAfterS} s`) }),
+        cached?.etag
+      );
+      if (resp.ok || resp.status === 304) setBudgetRevision((revision) => revision + 1);
+      if (cached && resp.status === 304) {
+        await flashBytes(cached.image);
+        return;
+      }
 
       let respBody: { error?: string; exitCode?: number; stdout?: string; stderr?: string; fileBytes?: string; } = {};
       const contentType = resp.headers.get("content-type") || "";
+      if (resp.ok && contentType.includes(FIRMWARE_BINARY_TYPE)) {
+        const image = new Uint8Array(await resp.arrayBuffer());
+        if (cacheKey) await storeCachedFirmware(cacheKey, image, resp.headers.get("etag"));
+        await flashBytes(image);
+        return;
+      }
       if (contentType.includes("application/json")) {
         try { respBody = await resp.json(); } catch { /* ignore parse errors */ }
       } else if (resp.ok) {
@@ -881,6 +1007,10 @@ export default function KeypadFlasherApp() {
       }
 
       if (!resp.ok) {
+        if (isBusy(resp)) {
+          setStatus({ state: "compileError", detail: `The build server is busy${respBody?.error ? `: ${respBody.error}` : "."} Try again in a minute.` });
+          return;
+        }
         if (respBody && respBody.error) {
           const exitCode = respBody.exitCode != null ? ` (exit ${respBody.exitCode})` : "";
           const stdout = respBody.stdout ? `\n--- stdout ---\n${respBody.stdout.trim()}` : "";
@@ -902,20 +1032,91 @@ export default function KeypadFlasherApp() {
     } catch (err) {
       setStatus({ state: "compileError", detail: String((err as Error).message ?? err) });
     }
-  }, [assertLedConfigMatchesLayout, flashBytes, debugFirmware, debugOptions, selectedLayout, selectedProfile, currentBindings, ledConfig]);
+  }, [assertLedConfigMatchesLayout, flashBytes, budget, debugFirmware, debugOptions, latencyProbe, loopProfiler, selectedLayout, selectedProfile, currentBindings, ledConfig]);
+
+  const readLatency = useCallback(async () => {
+    try {
+      setLatencyStats(await readLatencyStats());
+    } catch (err) {
+      showToast(String((err as Error).message ?? err), "error", 4200);
+    }
+  }, [showToast]);
+
+  const readProfile = useCallback(async () => {
+    try {
+      setLoopProfile(await readLoopProfile());
+    } catch (err) {
+      showToast(String((err as Error).message ?? err), "error", 4200);
+    }
+  }, [showToast]);
+
+  const stopCapture = useCallback(async () => {
+    const stop = stopCaptureRef.current;
+    stopCaptureRef.current = null;
+    setCaptureActive(false);
+    if (stop) await stop();
+  }, []);
+
+  const beginCapture = useCallback(async () => {
+    try {
+      setCaptureSamples([]);
+      setCaptureDropped(0);
+      stopCaptureRef.current = await startPinCapture(
+        (chunk) => {
+          setCaptureSamples((prev) => prev.concat(chunk.samples).slice(-MAX_CAPTURE_SAMPLES));
+          if (chunk.dropped > 0) setCaptureDropped((prev) => prev + chunk.dropped);
+        },
+        (err) => {
+          stopCaptureRef.current = null;
+          setCaptureActive(false);
+          showToast(String(err.message ?? err), "error", 4200);
+        }
+      );
+      setCaptureActive(true);
+    } catch (err) {
+      showToast(String((err as Error).message ?? err), "error", 4200);
+    }
+  }, [showToast]);
+
+  useEffect(() => () => { void stopCaptureRef.current?.(); }, []);
 
   const unsupportedDevice = connectedInfo != null && selectedProfile == null;
   const userButtons = selectedLayout ? selectedLayout.buttons : [];
   const buttonCount = userButtons.length;
+  const layerCount = 1 + (currentBindings?.layers?.length ?? 0);
+  const editLayer = Math.min(editLayerIndex, layerCount - 1);
+  const editedLayer = editLayer > 0 ? currentBindings?.layers?.[editLayer - 1] : undefined;
+  // the bindings each input runs on the layer being edited, falling through to the base layer
   const buttonBindings = new Map<number, HidBindingDto>();
   if (currentBindings) {
     currentBindings.buttons.forEach((entry) => buttonBindings.set(entry.id, entry.binding));
+    editedLayer?.buttons.forEach((entry) => buttonBindings.set(entry.id, entry.binding));
   }
   const encoderBindings = new Map<number, { clockwise: HidBindingDto; counterClockwise: HidBindingDto; press?: HidBindingDto }>();
   if (currentBindings) {
-    currentBindings.encoders.forEach((entry) => encoderBindings.set(entry.id, entry));
+    currentBindings.encoders.forEach((entry) => {
+      const layered = editedLayer?.encoders.find((e) => e.id === entry.id);
+      encoderBindings.set(entry.id, {
+        clockwise: layered?.clockwise ?? entry.clockwise,
+        counterClockwise: layered?.counterClockwise ?? entry.counterClockwise,
+        press: layered?.press ?? entry.press,
+      });
+    });
   }
 
+  const addLayer = () => {
+    if (!currentBindings || layerCount >= MAX_LAYERS) return;
+    setCurrentBindings({ ...currentBindings, layers: [...(currentBindings.layers ?? []), { buttons: [], encoders: [] }] });
+    setEditLayerIndex(layerCount);
+  };
+
+  const removeEditedLayer = () => {
+    if (!currentBindings?.layers || editLayer === 0) return;
+    const layers = currentBindings.layers.filter((_, idx) => idx !== editLayer - 1);
+    setCurrentBindings(layers.length > 0 ? { ...currentBindings, layers } : { buttons: currentBindings.buttons, encoders: currentBindings.encoders });
+    setEditLayerIndex(editLayer - 1);
+  };
+
   const layoutLedCount = ledCountFromLayout(selectedLayout);
 
   const openEdit = (target: EditTarget) => {
@@ -952,6 +1153,10 @@ export default function KeypadFlasherApp() {
     });
   };
 
+  const updateLowLatency = (value: boolean) => {
+    setSelectedLayout((prev) => (prev ? { ...prev, latencyProfile: value ? "LowLatency" : "Standard" } : prev));
+  };
+
   const updateBootloaderChordMember = (target: EditTarget, value: boolean) => {
     setSelectedLayout((prev) => {
       if (!prev) return prev;
@@ -997,6 +1202,7 @@ export default function KeypadFlasherApp() {
     rainbowStepMs: config.rainbowStepMs,
     breathingMinPercent: config.breathingMinPercent,
     breathingStepMs: config.breathingStepMs,
+    gammaCorrection: config.gammaCorrection,
   });
 
   const ledDisplayName = (idx: number): string => {
@@ -1213,6 +1419,10 @@ export default function KeypadFlasherApp() {
     setDraftLedConfig((prev) => (prev ? { ...prev, brightnessPercent: value } : prev));
   };
 
+  const setGammaCorrection = (value: boolean) => {
+    setDraftLedConfig((prev) => (prev ? { ...prev, gammaCorrection: value } : prev));
+  };
+
   const setRainbowStepMs = (value: number) => {
     setDraftLedConfig((prev) => (prev ? { ...prev, rainbowStepMs: value } : prev));
   };
@@ -1276,6 +1486,23 @@ export default function KeypadFlasherApp() {
 
   const handleEditorSave = (binding: HidBindingDto) => {
     if (!editorTarget || !currentBindings) return;
+    if (editLayer > 0 && currentBindings.layers) {
+      const layer = currentBindings.layers[editLayer - 1];
+      const nextLayer: BindingLayerDto = (() => {
+        if (editorTarget.type === "button") {
+          const others = layer.buttons.filter((b) => b.id !== editorTarget.buttonId);
+          return { ...layer, buttons: [...others, { id: editorTarget.buttonId, binding }].sort((a, b) => a.id - b.id) };
+        }
+        const updated = { ...(layer.encoders.find((e) => e.id === editorTarget.encoderId) ?? { id: editorTarget.encoderId }) };
+        if (editorTarget.direction === "cw") updated.clockwise = binding;
+        if (editorTarget.direction === "ccw") updated.counterClockwise = binding;
+        if (editorTarget.direction === "press") updated.press = binding;
+        const others = layer.encoders.filter((e) => e.id !== editorTarget.encoderId);
+        return { ...layer, encoders: [...others, updated].sort((a, b) => a.id - b.id) };
+      })();
+      setCurrentBindings({ ...currentBindings, layers: currentBindings.layers.map((l, idx) => (idx === editLayer - 1 ? nextLayer : l)) });
+      return;
+    }
     if (editorTarget.type === "button") {
       const other = currentBindings.buttons.filter((b) => b.id !== editorTarget.buttonId);
       setCurrentBindings({
@@ -1495,7 +1722,93 @@ export default function KeypadFlasherApp() {
                       onChange={(e) => setDebugOptions((prev) => ({ ...prev, confirmDelayMs: Math.max(0, Number(e.target.value) || 0) }))}
                     />
                   </label>
+                  <label className="checkbox" title="Sample ports P1/P3 on a timer and stream transitions as binary frames instead of the text log.">
+                    <input
+                      type="checkbox"
+                      checked={debugOptions.captureRateHz > 0}
+                      onChange={(e) => setDebugOptions((prev) => ({ ...prev, captureRateHz: e.target.checked ? DEFAULT_CAPTURE_RATE_HZ : 0 }))}
+                    />
+                    Binary pin capture
+                  </label>
+                  {debugOptions.captureRateHz > 0 && (
+                    <label className="inline-input">
+                      <span className="input-label" title="Sample rate of the capture timer, 1000 to 20000 Hz.">Capture rate (Hz)</span>
+                      <input
+                        id="debug-capture-rate"
+                        className="text-input"
+                        type="number"
+                        min={1000}
+                        max={20000}
+                        step={1000}
+                        value={debugOptions.captureRateHz}
+                        onChange={(e) => setDebugOptions((prev) => ({ ...prev, captureRateHz: Number(e.target.value) || DEFAULT_CAPTURE_RATE_HZ }))}
+                      />
+                    </label>
+                  )}
+                </div>
+                {debugOptions.captureRateHz > 0 && (
+                  <>
+                    <div style={{ display: "flex", justifyContent: "space-between", alignItems: "center", gap: "10px", flexWrap: "wrap" }}>
+                      <div className="muted small">
+                        Flash the capture firmware, then stream transitions from the keypad over Web Serial.{captureDropped > 0 ? ` ${captureDropped} sample ticks were missed while the buffer was full.` : ""}
+                      </div>
+                      {captureActive ? (
+                        <button className="btn" onClick={() => void stopCapture()}>Stop capture</button>
+                      ) : (
+                        <button className="btn" onClick={() => void beginCapture()} disabled={!webSerialAvailable()} title={webSerialAvailable() ? "Open the debug keypad's serial port." : "Web Serial is not available in this browser."}>
+                          Start capture
+                        </button>
+                      )}
+                    </div>
+                    {(captureActive || captureSamples.length > 0) && <PinCapturePlot samples={captureSamples} />}
+                  </>
+                )}
+              </div>
+            )}
+            {!debugFirmware && (
+              <div className="card subtle" style={{ display: "flex", flexDirection: "column", gap: "10px", marginTop: "12px" }}>
+                <div style={{ display: "flex", justifyContent: "space-between", alignItems: "center", gap: "10px", flexWrap: "wrap" }}>
+                  <label className="checkbox" title="Build firmware that times each press until its report reaches the host.">
+                    <input type="checkbox" checked={latencyProbe} onChange={(event) => setLatencyProbe(event.target.checked)} />
+                    Latency instrumentation
+                  </label>
+                  <button className="btn" onClick={readLatency} disabled={!webHidAvailable()} title={webHidAvailable() ? "Read statistics from a running keypad over WebHID." : "WebHID is not available in this browser."}>
+                    Read latency
+                  </button>
+                </div>
+                <div className="muted small">
+                  Flash with instrumentation on, use the keypad, then read the statistics back over WebHID.
+                </div>
+                {latencyStats && (
+                  <div style={{ display: "grid", gridTemplateColumns: "repeat(auto-fit, minmax(120px, 1fr))", gap: "6px" }}>
+                    <div>Samples: {latencyStats.samples}</div>
+                    <div>Dropped: {latencyStats.dropped}</div>
+                    <div>Min: {latencyStats.samples > 0 ? `${(latencyStats.minUs / 1000).toFixed(2)} ms` : "n/a"}</div>
+                    <div>Avg: {latencyStats.samples > 0 ? `${(latencyStats.avgUs / 1000).toFixed(2)} ms` : "n/a"}</div>
+                    <div>Max: {latencyStats.samples > 0 ? `${(latencyStats.maxUs / 1000).toFixed(2)} ms` : "n/a"}</div>
+                    {latencyStats.histogram.map((count, index) => (
+                      <div key={index} className="muted small">{histogramBucketLabel(index)}: {count}</div>
+                    ))}
+                  </div>
+                )}
+                <div style={{ display: "flex", justifyContent: "space-between", alignItems: "center", gap: "10px", flexWrap: "wrap" }}>
+                  <label className="checkbox" title="Build firmware that times each main-loop task and the loop period.">
+                    <input type="checkbox" checked={loopProfiler} onChange={(event) => setLoopProfiler(event.target.checked)} />
+                    Loop profiler
+                  </label>
+                  <button className="btn" onClick={readProfile} disabled={!webHidAvailable()} title={webHidAvailable() ? "Read task timings from a running keypad over WebHID." : "WebHID is not available in this browser."}>
+                    Read loop profile
+                  </button>
                 </div>
+                {loopProfile && (
+                  <div style={{ display: "grid", gridTemplateColumns: "repeat(auto-fit, minmax(160px, 1fr))", gap: "6px" }}>
+                    {loopProfile.map((timing, index) => (
+                      <div key={PROFILE_TASK_LABELS[index]}>
+                        {PROFILE_TASK_LABELS[index]}: {timing.samples > 0 ? `avg ${timing.avgUs} µs, max ${timing.maxUs} µs` : "n/a"}
+                      </div>
+                    ))}
+                  </div>
+                )}
               </div>
             )}
             <div className="card subtle" style={{ marginTop: "12px" }}>
@@ -1537,6 +1850,8 @@ export default function KeypadFlasherApp() {
           )}
         </div>
 
+        {selectedLayout && !debugFirmware && budget && <BudgetMeter budget={budget} />}
+
         {/* Lighting controls moved into modal; open from Layout card. */}
 
         {selectedLayout && (
@@ -1556,6 +1871,28 @@ export default function KeypadFlasherApp() {
           </>
         )}
 
+        {selectedLayout && currentBindings && (
+          <div className="layer-bar">
+            <span className="muted small">Editing</span>
+            {Array.from({ length: layerCount }, (_, layer) => (
+              <button
+                key={layer}
+                className={`btn ghost${layer === editLayer ? " active" : ""}`}
+                onClick={() => setEditLayerIndex(layer)}
+              >
+                {layer === 0 ? "Base" : `Layer ${layer}`}
+              </button>
+            ))}
+            <button className="btn ghost" onClick={addLayer} disabled={layerCount >= MAX_LAYERS}>Add layer</button>
+            {editLayer > 0 && (
+              <>
+                <button className="btn ghost" onClick={removeEditedLayer}>Remove {layerLabel(editLayer)}</button>
+                <span className="muted small">Inputs you leave alone keep their base binding on this layer. Add a layer switch step somewhere to reach it; the LED with the layer's index flashes on each switch.</span>
+              </>
+            )}
+          </div>
+        )}
+
         {selectedLayout && (
           <LayoutPreview
             layout={selectedLayout}
@@ -1571,6 +1908,7 @@ export default function KeypadFlasherApp() {
             lightingDisabled={!ledConfig || layoutLedCount === 0}
             onToggleBootloaderOnBoot={updateBootloaderOnBoot}
             onToggleBootloaderChord={updateBootloaderChordMember}
+            onToggleLowLatency={updateLowLatency}
             onExportConfig={openExportModal}
             onImportConfig={openImportModal}
             onResetDefaults={selectedProfile?.defaultBindings ? resetToDefaults : undefined}
@@ -1583,6 +1921,7 @@ export default function KeypadFlasherApp() {
             target={editorTarget}
             binding={editorBinding}
             stepClipboard={stepClipboard}
+            layerCount={layerCount}
             onSave={handleEditorSave}
             onClose={handleEditorClose}
             onUpdateStepClipboard={setStepClipboard}
@@ -1675,6 +2014,14 @@ export default function KeypadFlasherApp() {
                       <span style={{ minWidth: "36px", textAlign: "right" }}>{draftLedConfig.brightnessPercent}%</span>
                     </label>
                     <div className="muted small">Brightness scales both passive and active effects together.</div>
+                    <label className="checkbox" title="Apply a gamma curve so dim levels and breathing fade look even to the eye.">
+                      <input
+                        type="checkbox"
+                        checked={draftLedConfig.gammaCorrection === true}
+                        onChange={(e) => setGammaCorrection(e.target.checked)}
+                      />
+                      Gamma correction
+                    </label>
                   </div>
                 ) : (
                   <div className="muted small">No lighting configuration available.</div>
@@ -0,0 +1,39 @@
+import { BUDGET_WARN_FRACTION, usageFraction, type FirmwareBudget, type MemoryUsage } from "../lib/firmware-budget";
+
+type BudgetMeterProps = {
+  budget: FirmwareBudget;
+};
+
+type Section = { label: string; usage: MemoryUsage };
+
+// One bar per memory the layout draws on; sections the server has not compiled for yet are left out
+export function BudgetMeter({ budget }: BudgetMeterProps) {
+  const footprint = budget.footprint;
+  const sections: Section[] = [{ label: "Configuration", usage: budget.blob }];
+  if (footprint?.code) sections.push({ label: "Flash", usage: footprint.code });
+  if (footprint?.xdata) sections.push({ label: "XDATA", usage: footprint.xdata });
+  if (footprint?.data) sections.push({ label: "Internal RAM", usage: footprint.data });
+
+  const worst = Math.max(...sections.map((section) => usageFraction(section.usage)));
+  const tone = !budget.fits ? "error" : worst >= BUDGET_WARN_FRACTION ? "warn" : "info";
+  const title = !budget.fits
+    ? "Layout does not fit"
+    : worst >= BUDGET_WARN_FRACTION ? "Layout is close to the device limit" : "Device memory";
+
+  return (
+    <div className={`status-banner status-${tone}`} style={{ marginTop: "10px" }}>
+      <div className="status-header">
+        <div className="status-title">{title}</div>
+      </div>
+      {!footprint && <div className="status-body">Flash and RAM use show after the first build of this layout.</div>}
+      {sections.map((section) => (
+        <div key={section.label} className="status-progress-block">
+          <div className="status-progress">
+            <div className="status-progress-bar" style={{ width: `${Math.min(100, Math.round(usageFraction(section.usage) * 100))}%` }} />
+          </div>
+          <div className="status-progress-meta">{section.label} {section.usage.used} / {section.usage.limit} bytes</div>
+        </div>
+      ))}
+    </div>
+  );
+}
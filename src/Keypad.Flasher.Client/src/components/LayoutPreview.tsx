@@ -20,12 +20,13 @@ type LayoutPreviewProps = {
   onToggleBootloaderOnBoot: (target: EditTarget, value: boolean) => void;
   onToggleBootloaderChord: (target: EditTarget, value: boolean) => void;
   onResetDefaults?: () => void;
+  onToggleLowLatency?: (value: boolean) => void;
   onExportConfig?: () => void;
   onImportConfig?: () => void;
   canReset?: boolean;
 };
 
-export function LayoutPreview({ layout, layoutRows, buttonBindings, encoderBindings, ledConfig, warnNoBootEntry, warnSingleChord, onEdit, onOpenLightingForLed, onOpenLightingSettings, lightingDisabled, onToggleBootloaderOnBoot, onToggleBootloaderChord, onResetDefaults, onExportConfig, onImportConfig, canReset }: LayoutPreviewProps) {
+export function LayoutPreview({ layout, layoutRows, buttonBindings, encoderBindings, ledConfig, warnNoBootEntry, warnSingleChord, onEdit, onOpenLightingForLed, onOpenLightingSettings, lightingDisabled, onToggleBootloaderOnBoot, onToggleBootloaderChord, onResetDefaults, onToggleLowLatency, onExportConfig, onImportConfig, canReset }: LayoutPreviewProps) {
   const sortedButtons = [...layout.buttons].sort((a, b) => a.id - b.id);
   const encoderCount = layout.encoders.length;
   const [confirmReset, setConfirmReset] = useState(false);
@@ -33,7 +34,6 @@ export function LayoutPreview({ layout, layoutRows, buttonBindings, encoderBindi
   const [gridScrollable, setGridScrollable] = useState(false);
   const [touchArmedKey, setTouchArmedKey] = useState<string | null>(null);
   const touchDeviceRef = useRef<boolean>(false);
-  const [animRevision, setAnimRevision] = useState(0);
 
   const isGridScrollable = (el: HTMLDivElement | null) => !!el && el.scrollWidth > el.clientWidth + 1;
 
@@ -43,16 +43,6 @@ export function LayoutPreview({ layout, layoutRows, buttonBindings, encoderBindi
     touchDeviceRef.current = hasTouch;
   }, []);
 
-  useEffect(() => {
-    // Bump to remount animated tiles so rainbow/breathing stay in sync when timing changes.
-    setAnimRevision((rev) => rev + 1);
-  }, [
-    ledConfig?.rainbowStepMs,
-    ledConfig?.breathingStepMs,
-    ledConfig?.breathingMinPercent,
-    ledConfig?.passiveModes,
-  ]);
-
   useEffect(() => {
     const el = gridRef.current;
     if (!el || typeof ResizeObserver === "undefined") return;
@@ -155,6 +145,16 @@ export function LayoutPreview({ layout, layoutRows, buttonBindings, encoderBindi
           {onOpenLightingSettings && (
             <button className="btn btn-primary" onClick={onOpenLightingSettings} disabled={lightingDisabled} title={lightingDisabled ? "No LEDs available" : undefined}>Global Lighting</button>
           )}
+          {onToggleLowLatency && (
+            <label className="checkbox" title="Ask the host to poll the keypad every 1 ms instead of every 10 ms. Takes effect after the next flash.">
+              <input
+                type="checkbox"
+                checked={layout.latencyProfile === "LowLatency"}
+                onChange={(e) => onToggleLowLatency(e.target.checked)}
+              />
+              Low latency
+            </label>
+          )}
           {onExportConfig && <button className="btn" onClick={onExportConfig}>Export</button>}
           {onImportConfig && <button className="btn" onClick={onImportConfig}>Import</button>}
           {canReset && onResetDefaults && (
@@ -328,7 +328,7 @@ export function LayoutPreview({ layout, layoutRows, buttonBindings, encoderBindi
                             return (
                               <div
                                 className={className}
-                                key={`btn-${rowIdx}-${colIdx}-${animRevision}`}
+                                key={`btn-${rowIdx}-${colIdx}`}
                                 onClick={(e) => handleTileTouchArm(tileKey, e)}
                               >
                                 {hasLed && passive && passiveColor && (
@@ -1,6 +1,7 @@
-import { useEffect, useMemo, useState, type CSSProperties, type KeyboardEvent } from "react";
+import { useEffect, useMemo, useRef, useState, type CSSProperties, type KeyboardEvent } from "react";
 import type { LedColor, PassiveLedMode, ActiveLedMode } from "../types";
-import { getPassiveLightingStyle } from "./lightingStyles";
+import { useLedAnimation } from "./ledAnimator";
+import { getPassiveLedAnimation, getPassiveLightingStyle } from "./lightingStyles";
 
 type LightingPreviewProps = {
   passiveMode: PassiveLedMode;
@@ -40,6 +41,9 @@ export function LightingPreview({ passiveMode, passiveColor, activeMode = "Solid
     muted,
   }), [passiveMode, passiveColor, rainbowStepMs, breathingMinPercent, breathingStepMs, ledIndex, muted]);
 
+  const passiveSurfaceRef = useRef<HTMLDivElement>(null);
+  useLedAnimation(passiveSurfaceRef, getPassiveLedAnimation({ passiveMode, passiveColor, rainbowStepMs, breathingMinPercent, breathingStepMs, ledIndex }));
+
   const activeStyle = useMemo(() => {
     if (!hasActiveStyle) return {} as const;
     if (activeMode === "Off") {
@@ -109,7 +113,7 @@ export function LightingPreview({ passiveMode, passiveColor, activeMode = "Solid
       onKeyDown={handleKeyDown}
       onKeyUp={handleKeyUp}
     >
-      <div className={passiveSurfaceClass} style={passiveStyle.style} />
+      <div ref={passiveSurfaceRef} className={passiveSurfaceClass} style={passiveStyle.style} />
       {hasActiveStyle && (
         <div
           className={activeSurfaceClass}
@@ -0,0 +1,55 @@
+import { useMemo } from "react";
+import { togglingPins, type PinSample } from "../lib/pin-capture";
+
+type PinCapturePlotProps = {
+  samples: PinSample[];
+};
+
+const WIDTH = 640;
+const ROW_HEIGHT = 24;
+const LABEL_WIDTH = 44;
+const TRACE_HEIGHT = 14;
+
+// Timing diagram with one row per pin that toggled; samples only exist at transitions,
+// so each level holds until the next sample.
+export function PinCapturePlot({ samples }: PinCapturePlotProps) {
+  const rows = useMemo(() => {
+    if (samples.length < 2) return [];
+    const start = samples[0].timeUs;
+    const span = Math.max(1, samples[samples.length - 1].timeUs - start);
+    const scale = (WIDTH - LABEL_WIDTH) / span;
+
+    return togglingPins(samples).map(({ port, bit }, row) => {
+      const top = row * ROW_HEIGHT + (ROW_HEIGHT - TRACE_HEIGHT) / 2;
+      const levelY = (sample: PinSample) => {
+        const value = port === 1 ? sample.p1 : sample.p3;
+        return value & (1 << bit) ? top : top + TRACE_HEIGHT;
+      };
+      let points = `${LABEL_WIDTH},${levelY(samples[0])}`;
+      for (let i = 1; i < samples.length; i++) {
+        const x = LABEL_WIDTH + (samples[i].timeUs - start) * scale;
+        points += ` ${x},${levelY(samples[i - 1])} ${x},${levelY(samples[i])}`;
+      }
+      return { label: `P${port}.${bit}`, top, points };
+    });
+  }, [samples]);
+
+  if (rows.length === 0) {
+    return <div className="muted small">No transitions captured yet.</div>;
+  }
+
+  const spanMs = (samples[samples.length - 1].timeUs - samples[0].timeUs) / 1000;
+  return (
+    <div>
+      <svg viewBox={`0 0 ${WIDTH} ${rows.length * ROW_HEIGHT}`} width="100%" role="img" aria-label="Pin capture timing diagram">
+        {rows.map((row) => (
+          <g key={row.label}>
+            <text x={0} y={row.top + TRACE_HEIGHT - 2} fontSize={11} fill="currentColor">{row.label}</text>
+            <polyline points={row.points} fill="none" stroke="currentColor" strokeWidth={1.5} />
+          </g>
+        ))}
+      </svg>
+      <div className="muted small">{samples.length} samples over {spanMs.toFixed(1)} ms</div>
+    </div>
+  );
+}
@@ -8,10 +8,13 @@ import {
   KEY_OPTION_GROUPS,
   KEY_OPTION_LOOKUP,
   MODIFIER_BITS,
+  TEXT_STEP_MAX_LENGTH,
   defaultMouseValue,
   describeStep,
   captureKeyboardEventToKey,
+  isTypeableText,
   keyLabelFromCode,
+  layerLabel,
   normalizeIncomingStep,
 } from "../lib/binding-utils";
 import type { EditTarget } from "../types";
@@ -21,6 +24,7 @@ type StepEditorProps = {
   target: EditTarget | null;
   binding: HidBindingDto | undefined | null;
   stepClipboard: HidStepDto[] | null;
+  layerCount: number;
   onSave: (binding: HidBindingDto) => void;
   onClose: () => void;
   onUpdateStepClipboard: (steps: HidStepDto[]) => void;
@@ -50,6 +54,7 @@ export function StepEditor({
   target,
   binding,
   stepClipboard,
+  layerCount,
   onSave,
   onClose,
   onUpdateStepClipboard,
@@ -270,6 +275,32 @@ export function StepEditor({
     });
   };
 
+  const addTextStep = () => {
+    setEditSteps((prev) => {
+      const nextStep: HidStepDto = { kind: "Text", text: "", modifiers: 0, gapMs: 0 };
+      const next = [...prev, nextStep];
+      const newIdx = next.length - 1;
+      const newId = getStepId(nextStep);
+      scheduleHighlight([newIdx]);
+      setActiveStepIndex(newIdx);
+      setFreshSteps((prevFresh) => [...prevFresh, newId]);
+      return next;
+    });
+  };
+
+  const addLayerStep = () => {
+    setEditSteps((prev) => {
+      const nextStep: HidStepDto = { kind: "Layer", layer: layerCount > 1 ? 1 : 0, gapMs: 0 };
+      const next = [...prev, nextStep];
+      const newIdx = next.length - 1;
+      const newId = getStepId(nextStep);
+      scheduleHighlight([newIdx]);
+      setActiveStepIndex(newIdx);
+      setFreshSteps((prevFresh) => [...prevFresh, newId]);
+      return next;
+    });
+  };
+
   const addFunctionStep = () => {
     setEditSteps((prev) => {
       const nextStep: HidStepDto = { kind: "Function", functionPointer: DEFAULT_FUNCTION_POINTER, functionValue: 1, gapMs: 0 };
@@ -496,7 +527,7 @@ export function StepEditor({
 
   const toggleStepModifier = (index: number, bit: number) => {
     setEditSteps((prev) => prev.map((s, i) => {
-      if (i !== index || s.kind !== "Key") return s;
+      if (i !== index || (s.kind !== "Key" && s.kind !== "Text")) return s;
       const nextStep: HidStepDto = { ...s, modifiers: (s.modifiers & bit) !== 0 ? (s.modifiers & ~bit) : (s.modifiers | bit) };
       return cloneStepWithId(s, nextStep);
     }));
@@ -529,6 +560,12 @@ export function StepEditor({
       if (field === "gapMs" && s.kind === "Mouse") {
         return cloneStepWithId(s, { ...s, gapMs: nextValue });
       }
+      if (field === "gapMs" && s.kind === "Text") {
+        return cloneStepWithId(s, { ...s, gapMs: nextValue });
+      }
+      if (field === "gapMs" && s.kind === "Layer") {
+        return cloneStepWithId(s, { ...s, gapMs: nextValue });
+      }
       return s;
     }));
   };
@@ -543,7 +580,7 @@ export function StepEditor({
         return cloneStepWithId(s, { kind: "Key", keycode, modifiers: s.kind === "Key" ? s.modifiers : 0, holdMs, gapMs });
       }
       if (kind === "Pause") {
-        const gapMs = s.kind === "Key" || s.kind === "Function" || s.kind === "Mouse" ? (s.gapMs > 0 ? s.gapMs : 100) : s.gapMs;
+        const gapMs = s.kind === "Key" || s.kind === "Function" || s.kind === "Mouse" || s.kind === "Text" ? (s.gapMs > 0 ? s.gapMs : 100) : s.gapMs;
         return cloneStepWithId(s, { kind: "Pause", gapMs: gapMs > 0 ? gapMs : 100 });
       }
       if (kind === "Mouse") {
@@ -554,6 +591,17 @@ export function StepEditor({
         const gapMs = s.kind === "Mouse" && s.gapMs >= 0 ? s.gapMs : 0;
         return cloneStepWithId(s, { kind: "Mouse", pointerType: pointerType as HidPointerType, pointerValue, gapMs });
       }
+      if (kind === "Text") {
+        const text = s.kind === "Text" ? s.text : (s.kind === "Key" && s.keycode >= 32 && s.keycode <= 126 ? String.fromCharCode(s.keycode) : "");
+        const modifiers = s.kind === "Text" || s.kind === "Key" ? s.modifiers : 0;
+        const gapMs = s.kind === "Text" && s.gapMs >= 0 ? s.gapMs : 0;
+        return cloneStepWithId(s, { kind: "Text", text, modifiers, gapMs });
+      }
+      if (kind === "Layer") {
+        const layer = s.kind === "Layer" ? s.layer : (layerCount > 1 ? 1 : 0);
+        const gapMs = s.kind === "Layer" && s.gapMs >= 0 ? s.gapMs : 0;
+        return cloneStepWithId(s, { kind: "Layer", layer, gapMs });
+      }
       const gapMs = s.kind === "Function" && s.gapMs >= 0 ? s.gapMs : 0;
       const functionPointer = s.kind === "Function" ? (s.functionPointer || DEFAULT_FUNCTION_POINTER) : DEFAULT_FUNCTION_POINTER;
       const functionValue = FUNCTIONS_WITH_VALUE.has(functionPointer) && s.kind === "Function" && s.functionValue ? s.functionValue : 1;
@@ -582,6 +630,12 @@ export function StepEditor({
           : defaultMouseValue(step.pointerType as HidPointerType);
         return { kind: "Mouse", pointerType: step.pointerType as HidPointerType, pointerValue, gapMs };
       }
+      if (step.kind === "Text") {
+        return { kind: "Text", text: step.text, modifiers: step.modifiers, gapMs: step.gapMs >= 0 ? step.gapMs : 0 };
+      }
+      if (step.kind === "Layer") {
+        return { kind: "Layer", layer: step.layer, gapMs: step.gapMs >= 0 ? step.gapMs : 0 };
+      }
       const keycode = step.keycode;
       const gapMs = step.gapMs > 0 ? step.gapMs : 10;
       const holdMs = step.holdMs > 0 ? step.holdMs : 10;
@@ -594,11 +648,21 @@ export function StepEditor({
       return;
     }
 
+    if (mergedSteps.some((s) => s.kind === "Text" && (s.text.length === 0 || s.text.length > TEXT_STEP_MAX_LENGTH || !isTypeableText(s.text)))) {
+      setLocalError(`Text steps need 1-${TEXT_STEP_MAX_LENGTH} characters of plain ASCII text.`);
+      return;
+    }
+
     if (mergedSteps.some((s) => s.kind === "Function" && !s.functionPointer)) {
       setLocalError("Select a function for all function steps.");
       return;
     }
 
+    if (mergedSteps.some((s) => s.kind === "Layer" && s.layer >= layerCount)) {
+      setLocalError("A layer step targets a layer that no longer exists.");
+      return;
+    }
+
     const nextBinding: HidBindingDto = { type: "Sequence", steps: mergedSteps };
     onSave(nextBinding);
     requestClose();
@@ -679,7 +743,7 @@ export function StepEditor({
               </div>
             </div>
             <div className="steps-list steps-scroll" ref={stepsScrollRef}>
-              {editSteps.length === 0 && <div className="muted small">No steps yet. Add a key, mouse action, function, or pause.</div>}
+              {editSteps.length === 0 && <div className="muted small">No steps yet. Add a key, text, mouse action, function, or pause.</div>}
               {editSteps.map((step, idx) => {
                 const stepKey = getStepId(step);
                 const kind = step.kind;
@@ -729,7 +793,7 @@ export function StepEditor({
                           />
                           <span className="muted small">Select</span>
                         </label>
-                        <div className="step-title">Step {idx + 1} · {kind === "Key" ? "Key" : kind === "Pause" ? "Pause" : kind === "Mouse" ? "Mouse" : "Function"}</div>
+                        <div className="step-title">Step {idx + 1} · {kind === "Key" ? "Key" : kind === "Pause" ? "Pause" : kind === "Mouse" ? "Mouse" : kind === "Text" ? "Text" : kind === "Layer" ? "Layer" : "Function"}</div>
                         {collapsed && collapsedPreview && (
                           <span className="muted small step-preview" title={collapsedPreview}>{collapsedPreview}</span>
                         )}
@@ -769,12 +833,24 @@ export function StepEditor({
                         >
                           Mouse
                         </button>
+                        <button
+                          className={`btn ghost${kind === "Text" ? " active" : ""}`}
+                          onClick={(e) => { e.stopPropagation(); setStepKind(idx, "Text"); }}
+                        >
+                          Text
+                        </button>
                         <button
                           className={`btn ghost${kind === "Function" ? " active" : ""}`}
                           onClick={(e) => { e.stopPropagation(); setStepKind(idx, "Function"); }}
                         >
                           Function
                         </button>
+                        <button
+                          className={`btn ghost${kind === "Layer" ? " active" : ""}`}
+                          onClick={(e) => { e.stopPropagation(); setStepKind(idx, "Layer"); }}
+                        >
+                          Layer
+                        </button>
                       </div>
                       {kind === "Pause" && (
                         <>
@@ -875,6 +951,79 @@ export function StepEditor({
                           </div>
                         </>
                       )}
+                      {kind === "Text" && (
+                        <>
+                          <div className="input-row">
+                            <span className="input-label">Text</span>
+                            <textarea
+                              className="text-input"
+                              rows={3}
+                              maxLength={TEXT_STEP_MAX_LENGTH}
+                              value={step.text}
+                              onChange={(e) => setEditSteps((prev) => prev.map((s, i) => {
+                                if (i !== idx || s.kind !== "Text") return s;
+                                const nextStep: HidStepDto = { ...s, text: e.target.value };
+                                return cloneStepWithId(s, nextStep);
+                              }))}
+                            />
+                            <div className="checkbox-row tight">
+                              {MODIFIER_BITS.map((m) => (
+                                <label key={m.bit} className="checkbox">
+                                  <input
+                                    type="checkbox"
+                                    checked={(step.modifiers & m.bit) !== 0}
+                                    onChange={() => toggleStepModifier(idx, m.bit)}
+                                  />
+                                  {m.label}
+                                </label>
+                              ))}
+                            </div>
+                            {!isTypeableText(step.text) && <div className="muted small">Only plain ASCII text can be typed.</div>}
+                          </div>
+                          <label className="inline-input">
+                            <span className="input-label">Gap after (ms)</span>
+                            <input
+                              className="text-input"
+                              type="number"
+                              min={0}
+                              value={step.gapMs}
+                              onChange={(e) => updateStepTiming(idx, "gapMs", e.target.value)}
+                            />
+                          </label>
+                          <div className="muted small">Types several keys per report, so long snippets go out much faster than key steps.</div>
+                        </>
+                      )}
+                      {kind === "Layer" && (
+                        <>
+                          <label className="inline-input">
+                            <span className="input-label">Switch to</span>
+                            <select
+                              className="text-input"
+                              value={step.layer}
+                              onChange={(e) => setEditSteps((prev) => prev.map((s, i) => {
+                                if (i !== idx || s.kind !== "Layer") return s;
+                                const nextStep: HidStepDto = { ...s, layer: Number(e.target.value) };
+                                return cloneStepWithId(s, nextStep);
+                              }))}
+                            >
+                              {Array.from({ length: Math.max(layerCount, step.layer + 1) }, (_, layer) => (
+                                <option key={layer} value={layer} disabled={layer >= layerCount}>{layerLabel(layer)}</option>
+                              ))}
+                            </select>
+                          </label>
+                          <label className="inline-input">
+                            <span className="input-label">Gap after (ms)</span>
+                            <input
+                              className="text-input"
+                              type="number"
+                              min={0}
+                              value={step.gapMs}
+                              onChange={(e) => updateStepTiming(idx, "gapMs", e.target.value)}
+                            />
+                          </label>
+                          <div className="muted small">Later presses use the bindings of the selected layer until another layer step runs.</div>
+                        </>
+                      )}
                       {kind === "Mouse" && (
                         <>
                           <div className="input-row">
@@ -1006,8 +1155,10 @@ export function StepEditor({
             <div className="step-actions">
               <button className="btn" onClick={addKeyStep}>Add key</button>
               <button className="btn" onClick={addDelayStep}>Add pause</button>
+              <button className="btn" onClick={addTextStep}>Add text</button>
               <button className="btn" onClick={() => setEditSteps((prev) => [...prev, { kind: "Mouse", pointerType: 4, pointerValue: 0, gapMs: 0 }])}>Add mouse</button>
               <button className="btn" onClick={addFunctionStep}>Add function</button>
+              <button className="btn" onClick={addLayerStep}>Add layer switch</button>
             </div>
           </div>
         </div>
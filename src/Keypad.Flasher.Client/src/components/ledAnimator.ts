@@ -0,0 +1,125 @@
+import { useEffect, type RefObject } from "react";
+import type { LedColor } from "../types";
+
+// One requestAnimationFrame loop drives every rainbow and breathing preview. Each frame works out
+// the firmware's state for the current time (led.c: 192 hue steps with an 8-step offset per LED,
+// breathing one percent per step between min and 100) and writes it into CSS custom properties on
+// the element, so React never re-renders for animation. Previews scrolled offscreen are skipped and
+// the loop stops while none are visible.
+
+export type LedAnimation =
+  | { mode: "Rainbow"; stepMs: number; ledIndex: number }
+  | { mode: "Breathing"; stepMs: number; minPercent: number };
+
+type Entry = { animation: LedAnimation; visible: boolean; last: string };
+
+const RAINBOW_STEPS = 192;
+const RAINBOW_LED_OFFSET = 8;
+
+const entries = new Map<HTMLElement, Entry>();
+let frame = 0;
+let observer: IntersectionObserver | null = null;
+
+// led.c hue_to_rgb: three 64-step ramps, red to green to blue and back to red
+export const rainbowColor = (hue: number): LedColor => {
+  const step = Math.round(((hue & 63) * 255) / 63);
+  const nstep = 255 - step;
+  switch (hue >> 6) {
+    case 0: return { r: nstep, g: step, b: 0 };
+    case 1: return { r: 0, g: nstep, b: step };
+    default: return { r: step, g: 0, b: nstep };
+  }
+};
+
+export const rainbowHue = (nowMs: number, stepMs: number, ledIndex: number): number =>
+  (Math.floor(nowMs / stepMs) + ledIndex * RAINBOW_LED_OFFSET) % RAINBOW_STEPS;
+
+// Starts at 100 going down; the firmware spends one step at each end turning around
+export const breathingPercent = (nowMs: number, stepMs: number, minPercent: number): number => {
+  const span = 100 - minPercent;
+  const k = Math.floor(nowMs / stepMs) % (2 * span + 2);
+  return k <= span ? 100 - k : minPercent + (k - span - 1);
+};
+
+const render = (element: HTMLElement, entry: Entry, now: number) => {
+  const { animation } = entry;
+  let value: string;
+  if (animation.mode === "Rainbow") {
+    const { r, g, b } = rainbowColor(rainbowHue(now, animation.stepMs, animation.ledIndex));
+    value = `${r}, ${g}, ${b}`;
+    if (value !== entry.last) element.style.setProperty("--led-rgb", value);
+  } else {
+    value = `${breathingPercent(now, animation.stepMs, animation.minPercent) / 100}`;
+    if (value !== entry.last) element.style.setProperty("--led-level", value);
+  }
+  entry.last = value;
+};
+
+const tick = (now: number) => {
+  frame = 0;
+  let anyVisible = false;
+  entries.forEach((entry, element) => {
+    if (!entry.visible) return;
+    anyVisible = true;
+    render(element, entry, now);
+  });
+  if (anyVisible) frame = requestAnimationFrame(tick);
+};
+
+const schedule = () => {
+  if (frame) return;
+  for (const entry of entries.values()) {
+    if (entry.visible) {
+      frame = requestAnimationFrame(tick);
+      return;
+    }
+  }
+};
+
+const getObserver = (): IntersectionObserver | null => {
+  if (typeof IntersectionObserver === "undefined") return null;
+  if (!observer) {
+    observer = new IntersectionObserver((changes) => {
+      for (const change of changes) {
+        const entry = entries.get(change.target as HTMLElement);
+        if (entry) entry.visible = change.isIntersecting;
+      }
+      schedule();
+    });
+  }
+  return observer;
+};
+
+export const animateLed = (element: HTMLElement, animation: LedAnimation): (() => void) => {
+  const io = getObserver();
+  const entry: Entry = { animation, visible: !io, last: "" };
+  entries.set(element, entry);
+  render(element, entry, performance.now());
+  io?.observe(element);
+  schedule();
+  return () => {
+    io?.unobserve(element);
+    entries.delete(element);
+    if (entries.size === 0 && frame) {
+      cancelAnimationFrame(frame);
+      frame = 0;
+    }
+  };
+};
+
+// Animates ref's element while animation is non-null; primitive fields are the dependencies, so
+// callers can pass a fresh object each render
+export const useLedAnimation = (ref: RefObject<HTMLElement | null>, animation: LedAnimation | null) => {
+  const mode = animation?.mode;
+  const stepMs = animation?.stepMs;
+  const ledIndex = animation?.mode === "Rainbow" ? animation.ledIndex : undefined;
+  const minPercent = animation?.mode === "Breathing" ? animation.minPercent : undefined;
+  useEffect(() => {
+    const element = ref.current;
+    if (!element || !mode || stepMs == null) return;
+    const next: LedAnimation = mode === "Rainbow"
+      ? { mode, stepMs, ledIndex: ledIndex ?? 0 }
+      : { mode, stepMs, minPercent: minPercent ?? 0 };
+    return animateLed(element, next);
+  }, [ref, mode, stepMs, ledIndex, minPercent]);
+};
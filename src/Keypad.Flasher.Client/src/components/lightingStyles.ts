@@ -1,5 +1,6 @@
 import type { CSSProperties } from "react";
 import type { LedColor, PassiveLedMode } from "../types";
+import type { LedAnimation } from "./ledAnimator";
 
 export const DEFAULT_RAINBOW_STEP_MS = 20;
 export const DEFAULT_BREATHING_STEP_MS = 20;
@@ -24,36 +25,29 @@ type PassiveLightingStyleInput = {
 };
 
 type RainbowStyle = CSSProperties & {
-  "--rainbow-duration"?: string;
-  "--rainbow-delay"?: string;
   "--rainbow-alpha"?: string;
 };
 
-type BreathingStyle = CSSProperties & {
-  "--breathing-duration"?: string;
-  "--breathing-min"?: string;
+// Firmware timing for the animated passive modes, clamped as the previews have always shown them;
+// ledAnimator turns it into --led-rgb / --led-level on the preview surface
+export const getPassiveLedAnimation = (input: PassiveLightingStyleInput): LedAnimation | null => {
+  const { passiveMode, rainbowStepMs, breathingMinPercent, breathingStepMs, ledIndex = 0 } = input;
+  if (passiveMode === "Rainbow") {
+    return { mode: "Rainbow", stepMs: Math.max(1, rainbowStepMs ?? DEFAULT_RAINBOW_STEP_MS), ledIndex };
+  }
+  if (passiveMode === "Breathing") {
+    const minPercent = Math.min(MAX_BREATHING_MIN_PERCENT, breathingMinPercent ?? DEFAULT_BREATHING_MIN_PERCENT);
+    return { mode: "Breathing", stepMs: Math.max(1, breathingStepMs ?? DEFAULT_BREATHING_STEP_MS), minPercent };
+  }
+  return null;
 };
 
 export const getPassiveLightingStyle = (input: PassiveLightingStyleInput): { className?: string; style?: CSSProperties } => {
-  const {
-    passiveMode,
-    passiveColor,
-    rainbowStepMs,
-    breathingMinPercent,
-    breathingStepMs,
-    ledIndex = 0,
-    muted = true,
-  } = input;
+  const { passiveMode, passiveColor, muted = true } = input;
 
   if (passiveMode === "Rainbow") {
-    const step = rainbowStepMs ?? DEFAULT_RAINBOW_STEP_MS;
-    const durationSec = Math.max(0.2, (192 * step) / 1000); // firmware: 192 hue steps, one per step_ms
-    const hueOffsetSteps = (ledIndex * 8) % 192; // firmware: per-LED hue offset = led * 8 (mod 192)
-    const delaySec = -(hueOffsetSteps * step) / 1000; // align phase offset in time
     const rainbowAlpha = (muted ? MUTED_ALPHA_SCALE : 1) * BASE_RAINBOW_ALPHA;
     const rainbowStyle: RainbowStyle = {
-      "--rainbow-duration": `${durationSec}s`,
-      "--rainbow-delay": `${delaySec}s`,
       "--rainbow-alpha": `${rainbowAlpha}`,
     };
     return { className: "rainbow", style: rainbowStyle };
@@ -61,20 +55,10 @@ export const getPassiveLightingStyle = (input: PassiveLightingStyleInput): { cla
 
   if (passiveMode === "Static" || passiveMode === "Breathing") {
     const color = passiveColor;
-    const minPercentRaw = breathingMinPercent ?? DEFAULT_BREATHING_MIN_PERCENT;
-    const minPercent = Math.min(MAX_BREATHING_MIN_PERCENT, minPercentRaw);
-    const step = breathingStepMs ?? DEFAULT_BREATHING_STEP_MS;
-    const durationSec = Math.max(0.2, ((100 - minPercent) * 2 * step) / 1000); // firmware: +/-1% per step_ms
     const alphaScale = muted ? MUTED_ALPHA_SCALE : 1;
     const primaryAlpha = BASE_PRIMARY_ALPHA * alphaScale;
     const secondaryAlpha = BASE_SECONDARY_ALPHA * alphaScale;
     const borderAlpha = BASE_BORDER_ALPHA * alphaScale;
-    const breathingStyle: BreathingStyle | undefined = passiveMode === "Breathing"
-      ? {
-        "--breathing-duration": `${durationSec}s`,
-        "--breathing-min": `${Math.max(0.05, Math.min(0.95, minPercent / 100))}`,
-      }
-      : undefined;
     const breathingClass = passiveMode === "Breathing" ? "breathing" : undefined;
 
     return {
@@ -84,7 +68,6 @@ export const getPassiveLightingStyle = (input: PassiveLightingStyleInput): { cla
         backgroundImage: `linear-gradient(135deg, rgba(${color.r}, ${color.g}, ${color.b}, ${primaryAlpha}), rgba(${color.r}, ${color.g}, ${color.b}, ${secondaryAlpha}))`,
         boxShadow: "var(--shadow-strong)",
         borderColor: `rgba(${color.r}, ${color.g}, ${color.b}, ${borderAlpha})`,
-        ...(breathingStyle ?? {}),
       },
     };
   }
@@ -1,5 +1,5 @@
 import type { HidBindingDto, HidPointerType, HidStepDto } from "./keypad-configs";
-import { HID_POINTER_TYPE } from "./keypad-configs";
+import { HID_POINTER_TYPE, MAX_LAYERS } from "./keypad-configs";
 
 export const FRIENDLY_FUNCTIONS: Record<string, string> = {
   hid_consumer_volume_up: "Volume Up",
@@ -177,6 +177,8 @@ export const captureKeyboardEventToKey = (event: KeyboardEvent): { keycode: numb
   return { keycode: codeKey, modifiers };
 };
 
+export const layerLabel = (layer: number): string => (layer === 0 ? "base layer" : `layer ${layer}`);
+
 export const describeStep = (step: HidStepDto): string => {
   if (step.kind === "Pause") {
     const pauseMs = step.gapMs > 0 ? step.gapMs : 0;
@@ -186,6 +188,14 @@ export const describeStep = (step: HidStepDto): string => {
     const friendly = FRIENDLY_FUNCTIONS[step.functionPointer];
     return friendly || step.functionPointer || "(unset)";
   }
+  if (step.kind === "Layer") {
+    return `Switch to ${layerLabel(step.layer)}`;
+  }
+  if (step.kind === "Text") {
+    const mods = MODIFIER_BITS.filter((m) => (step.modifiers & m.bit) !== 0).map((m) => m.label);
+    const quoted = `"${step.text.length > 24 ? `${step.text.slice(0, 24)}…` : step.text}"`;
+    return mods.length > 0 ? `${mods.join("+")}+Type ${quoted}` : `Type ${quoted}`;
+  }
   if (step.kind === "Mouse") {
     switch (step.pointerType) {
       case HID_POINTER_TYPE.MoveUp: return `Mouse up ${step.pointerValue}`;
@@ -206,6 +216,11 @@ export const describeStep = (step: HidStepDto): string => {
   return keyLabel || "(unset)";
 };
 
+export const TEXT_STEP_MAX_LENGTH = 255;
+
+// the firmware maps printable ASCII plus tab and newline
+export const isTypeableText = (text: string): boolean => /^[\x20-\x7e\t\n]*$/.test(text);
+
 export const defaultMouseValue = (pointerType: HidPointerType): number => {
   if (pointerType === HID_POINTER_TYPE.MoveUp || pointerType === HID_POINTER_TYPE.MoveDown || pointerType === HID_POINTER_TYPE.MoveLeft || pointerType === HID_POINTER_TYPE.MoveRight) return 100;
   if (pointerType === HID_POINTER_TYPE.ScrollUp || pointerType === HID_POINTER_TYPE.ScrollDown) return 1;
@@ -232,6 +247,8 @@ export const normalizeIncomingStep = (step: unknown): HidStepDto => {
     pointerValue?: unknown;
     functionPointer?: unknown;
     functionValue?: unknown;
+    text?: unknown;
+    layer?: unknown;
   };
 
   switch (candidate.kind) {
@@ -264,6 +281,22 @@ export const normalizeIncomingStep = (step: unknown): HidStepDto => {
       const functionValue = requireNumber(candidate.functionValue ?? 1, "Function functionValue");
       return { kind: "Function", functionPointer, gapMs, functionValue };
     }
+    case "Text": {
+      if (typeof candidate.text !== "string") {
+        throw new Error("Text step text must be a string.");
+      }
+      const modifiers = requireNumber(candidate.modifiers ?? 0, "Text modifiers");
+      const gapMs = requireNumber(candidate.gapMs ?? 0, "Text gapMs");
+      return { kind: "Text", text: candidate.text, modifiers, gapMs: gapMs >= 0 ? gapMs : 0 };
+    }
+    case "Layer": {
+      const layer = requireNumber(candidate.layer ?? 0, "Layer layer");
+      if (!Number.isInteger(layer) || layer < 0 || layer >= MAX_LAYERS) {
+        throw new Error(`Layer steps must target a layer from 0 to ${MAX_LAYERS - 1}.`);
+      }
+      const gapMs = requireNumber(candidate.gapMs ?? 0, "Layer gapMs");
+      return { kind: "Layer", layer, gapMs: gapMs >= 0 ? gapMs : 0 };
+    }
     default:
       throw new Error("Unsupported step kind.");
   }
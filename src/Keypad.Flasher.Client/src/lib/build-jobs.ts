@@ -0,0 +1,98 @@
+// Compiles through the server's build job API: POST flasher/jobs answers at once with a job id,
+// stage changes arrive as server-sent events (or polling where those are blocked), and the
+// firmware is fetched once the job has finished. A busy server answers 429 or 503 with
+// Retry-After, which is waited out a few times before the refusal is handed back.
+
+export type BuildStage = "Queued" | "Generating" | "Compiling" | "Done" | "Failed";
+
+// queuePosition is 1 for the job that starts next, null once it has left the queue
+type BuildJobStatus = { id: string; stage: BuildStage; error?: string | null; queuePosition?: number | null };
+
+export type StageListener = (stage: BuildStage, queuePosition: number | null) => void;
+
+export const BUILD_STAGE_LABELS: Record<BuildStage, string> = {
+  Queued: "queued",
+  Generating: "generating configuration",
+  Compiling: "compiling",
+  Done: "done",
+  Failed: "failed",
+};
+
+export const FIRMWARE_BINARY_TYPE = "application/octet-stream";
+
+const POLL_INTERVAL_MS = 1000;
+const ADMISSION_ATTEMPTS = 4;
+const MAX_RETRY_AFTER_S = 60;
+
+export const queuedLabel = (queuePosition: number | null) =>
+  queuePosition && queuePosition > 1 ? `queued, ${queuePosition - 1} ahead` : BUILD_STAGE_LABELS.Queued;
+
+const isFinished = (stage: BuildStage) => stage === "Done" || stage === "Failed";
+
+const pollUntilFinished = async (id: string, onStage: StageListener): Promise<void> => {
+  for (;;) {
+    const resp = await fetch(`flasher/jobs/${id}`);
+    if (!resp.ok) throw new Error(`Build job lost: ${resp.status} ${resp.statusText}`);
+    const status = (await resp.json()) as BuildJobStatus;
+    onStage(status.stage, status.queuePosition ?? null);
+    if (isFinished(status.stage)) return;
+    await new Promise((resolve) => setTimeout(resolve, POLL_INTERVAL_MS));
+  }
+};
+
+const waitUntilFinished = (id: string, onStage: StageListener): Promise<void> => {
+  if (typeof EventSource === "undefined") return pollUntilFinished(id, onStage);
+  return new Promise((resolve, reject) => {
+    const source = new EventSource(`flasher/jobs/${id}/events`);
+    let finished = false;
+    source.addEventListener("stage", (event) => {
+      const status = JSON.parse((event as MessageEvent<string>).data) as BuildJobStatus;
+      onStage(status.stage, status.queuePosition ?? null);
+      if (isFinished(status.stage)) {
+        finished = true;
+        source.close();
+        resolve();
+      }
+    });
+    source.onerror = () => {
+      source.close();
+      if (!finished) pollUntilFinished(id, onStage).then(resolve, reject);
+    };
+  });
+};
+
+const postJob = (body: unknown, ifNoneMatch?: string | null) => {
+  const headers: Record<string, string> = { "Content-Type": "application/json" };
+  if (ifNoneMatch) headers["If-None-Match"] = ifNoneMatch;
+  return fetch("flasher/jobs", { method: "POST", headers, body: JSON.stringify(body) });
+};
+
+export const isBusy = (resp: Response) => resp.status === 429 || resp.status === 503;
+
+// Resolves to the same response the synchronous flasher endpoint gives, so callers handle
+// validation errors, compile failures and firmware alike. The firmware itself is asked for as the
+// flat binary image; errors still come back as JSON. With ifNoneMatch, an image that still has
+// that ETag comes back as an empty 304 instead: straight from the POST when the server's result
+// cache holds it, so no job is queued, or from the firmware GET once a rebuild has finished
+export const fetchFirmwareViaJob = async (
+  body: unknown,
+  onStage: StageListener,
+  onBackoff?: (retryAfterS: number) => void,
+  ifNoneMatch?: string | null
+): Promise<Response> => {
+  let resp = await postJob(body, ifNoneMatch);
+  for (let attempt = 1; attempt < ADMISSION_ATTEMPTS && isBusy(resp); attempt++) {
+    const retryAfterS = Math.min(MAX_RETRY_AFTER_S, Number(resp.headers.get("retry-after")) || 5);
+    onBackoff?.(retryAfterS);
+    await new Promise((resolve) => setTimeout(resolve, retryAfterS * 1000));
+    resp = await postJob(body, ifNoneMatch);
+  }
+  if (resp.status !== 202) return resp;
+
+  const job = (await resp.json()) as BuildJobStatus;
+  onStage(job.stage, job.queuePosition ?? null);
+  await waitUntilFinished(job.id, onStage);
+  const headers: Record<string, string> = { Accept: `${FIRMWARE_BINARY_TYPE}, application/json` };
+  if (ifNoneMatch) headers["If-None-Match"] = ifNoneMatch;
+  return fetch(`flasher/jobs/${job.id}/firmware`, { headers });
+};
@@ -13,7 +13,7 @@ function errorMessage(err: unknown): string {
 
 // ===== Types =====
 export type ConnectedInfo = { version: string; id: number[]; deviceIdHex: string };
-export type Progress = { phase: "" | "Writing" | "Verifying"; current: number; total: number };
+export type Progress = { phase: "" | "Comparing" | "Writing" | "Verifying"; current: number; total: number };
 export type ProgressCb = (p: Progress) => void;
 
 export interface BootloaderClient {
@@ -46,18 +46,13 @@ const bootloaderAddessCmd = new Uint8Array([
 const bootloaderEraseCmd = new Uint8Array([0xa4, 0x01, 0x00, 0x08]);
 const bootloaderResetCmd = new Uint8Array([0xa2, 0x01, 0x00, 0x01]); // 0x00 not run, 0x01 run
 
-function makeWriteCmdTemplate(): Uint8Array {
-  const arr = new Uint8Array(64);
-  arr[0] = 0xa5;
-  arr[1] = 0x3d; // default length when payload is 56 bytes
-  return arr;
-}
-function makeVerifyCmdTemplate(): Uint8Array {
-  const arr = new Uint8Array(64);
-  arr[0] = 0xa6;
-  arr[1] = 0x3d; // default length when payload is 56 bytes
-  return arr;
-}
+const WRITE_OPCODE = 0xa5;
+const VERIFY_OPCODE = 0xa6;
+const PACKET_PAYLOAD = 56;
+const PACKET_SLOT = 64;
+
+// Progress is reported at most this often, plus at every phase start and end
+const PROGRESS_INTERVAL_MS = 50;
 
 // ===== Intel HEX parsing (browser-safe) =====
 // Record types
@@ -163,6 +158,53 @@ export function parseIntelHexBrowser(data: string, bufferSize: number): {
   throw new Error("Unexpected end of input: missing or invalid EOF record.");
 }
 
+// Every write/verify command for an image, built once: 64-byte slots of header plus the payload
+// already XORed with the bootloader key. Write and verify differ only in the opcode, which is set
+// per pass, so both reuse the same buffer
+type PacketStream = { commands: Uint8Array; lengths: Uint16Array; totalPackets: number };
+
+function buildPacketStream(hexBytes: Uint8Array, mask: Uint8Array): PacketStream {
+  const totalPackets = Math.floor((hexBytes.length + PACKET_PAYLOAD - 1) / PACKET_PAYLOAD);
+  const commands = new Uint8Array(totalPackets * PACKET_SLOT);
+  const lengths = new Uint16Array(totalPackets);
+  for (let i = 0; i < totalPackets; i++) {
+    const start = i * PACKET_PAYLOAD;
+    const remaining = hexBytes.length - start;
+    const bytesThisPacket = remaining >= PACKET_PAYLOAD ? PACKET_PAYLOAD : Math.ceil(remaining / 8) * 8; // 8-byte aligned
+    const slot = i * PACKET_SLOT;
+    commands[slot + 1] = 61 - (PACKET_PAYLOAD - bytesThisPacket); // length field
+    commands[slot + 3] = start & 0xff;
+    commands[slot + 4] = (start >> 8) & 0xff;
+    // the 8-byte key restarts at each packet
+    for (let j = 0; j < bytesThisPacket; j++) {
+      const value = start + j < hexBytes.length ? hexBytes[start + j] : EMPTY_VALUE;
+      commands[slot + 8 + j] = value ^ mask[j & 7];
+    }
+    lengths[i] = commands[slot + 1] + 3;
+  }
+  return { commands, lengths, totalPackets };
+}
+
+function setOpcode(stream: PacketStream, opcode: number): void {
+  for (let i = 0; i < stream.totalPackets; i++) stream.commands[i * PACKET_SLOT] = opcode;
+}
+
+// Drops updates that arrive within PROGRESS_INTERVAL_MS of the last one, so React does not
+// re-render per packet; the first and last update of each phase always go through
+function throttleProgress(onProgress: ProgressCb | undefined): ProgressCb | undefined {
+  if (!onProgress) return undefined;
+  let lastAt = 0;
+  let lastPhase: Progress["phase"] | null = null;
+  return (p) => {
+    const now = performance.now();
+    if (p.phase !== lastPhase || p.current === 0 || p.current === p.total || now - lastAt >= PROGRESS_INTERVAL_MS) {
+      lastAt = now;
+      lastPhase = p.phase;
+      onProgress(p);
+    }
+  };
+}
+
 // ===== Core class =====
 export class CH55xBootloader implements BootloaderClient {
   public uploadReady = false;
@@ -294,6 +336,7 @@ export class CH55xBootloader implements BootloaderClient {
     const epOut = this.epOut;
 
     if (!device || epIn == null || epOut == null) throw new Error("Connect bootloader first.");
+    const report = throttleProgress(onProgress);
 
     try {
       // init
@@ -308,71 +351,40 @@ export class CH55xBootloader implements BootloaderClient {
       await device.transferOut(epOut, bootloaderAddessCmd.buffer);
       await device.transferIn(epIn, 64);
 
-      // erase
-      await device.transferOut(epOut, bootloaderEraseCmd.buffer);
-      await device.transferIn(epIn, 64);
-
-      // write
-      const writeDataSize = hexBytes.length;
-      const totalPackets = Math.floor((writeDataSize + 55) / 56);
-      const rem = writeDataSize % 56;
-      const lastPacketSize = rem === 0 ? 56 : Math.ceil(rem / 8) * 8; // 8-byte aligned
-
-      onProgress?.({ phase: "Writing", current: 0, total: totalPackets });
-
-      for (let i = 0; i < totalPackets; i++) {
-        const writeCmd = makeWriteCmdTemplate();
-        const bytesThisPacket = (i < totalPackets - 1) ? 56 : lastPacketSize;
-
-        for (let j = 0; j < bytesThisPacket; j++) {
-          writeCmd[8 + j] = hexBytes[i * 56 + j] ?? EMPTY_VALUE;
-        }
-
-        // XOR mask over the actual number of 8-byte blocks
-        const blocks = Math.ceil(bytesThisPacket / 8);
-        for (let b = 0; b < blocks; b++) {
-          for (let ii = 0; ii < 8 && (b * 8 + ii) < bytesThisPacket; ii++) {
-            writeCmd[8 + b * 8 + ii] ^= this.bootloaderMask[ii];
-          }
-        }
-
-        const addr = i * 56;
-        writeCmd[1] = 61 - (56 - bytesThisPacket); // length field
-        writeCmd[3] = addr & 0xff;
-        writeCmd[4] = (addr >> 8) & 0xff;
-
-        await device.transferOut(epOut, writeCmd.slice(0, writeCmd[1] + 3));
-        await device.transferIn(epIn, 64);
-        onProgress?.({ phase: "Writing", current: i + 1, total: totalPackets });
+      const stream = buildPacketStream(hexBytes, this.bootloaderMask);
+      const total = stream.totalPackets;
+
+      // The bootloader only erases the whole application area, so any differing packet means a full
+      // reflash, but an image the device already holds skips erase and write. Compare from the end,
+      // where the config blob sits, so a changed configuration is found within a few packets
+      setOpcode(stream, VERIFY_OPCODE);
+      report?.({ phase: "Comparing", current: 0, total });
+      let matches = true;
+      for (let i = total - 1; i >= 0 && matches; i--) {
+        matches = await this.sendPacket(device, epIn, epOut, stream, i);
+        report?.({ phase: "Comparing", current: total - i, total });
       }
 
-      // verify
-      onProgress?.({ phase: "Verifying", current: 0, total: totalPackets });
-      for (let i = 0; i < totalPackets; i++) {
-        const verifyCmd = makeVerifyCmdTemplate();
-        const bytesThisPacket = (i < totalPackets - 1) ? 56 : lastPacketSize;
+      if (!matches) {
+        // erase
+        await device.transferOut(epOut, bootloaderEraseCmd.buffer);
+        await device.transferIn(epIn, 64);
 
-        for (let j = 0; j < bytesThisPacket; j++) {
-          verifyCmd[8 + j] = hexBytes[i * 56 + j] ?? EMPTY_VALUE;
+        // write
+        setOpcode(stream, WRITE_OPCODE);
+        report?.({ phase: "Writing", current: 0, total });
+        for (let i = 0; i < total; i++) {
+          await this.sendPacket(device, epIn, epOut, stream, i);
+          report?.({ phase: "Writing", current: i + 1, total });
         }
 
-        const blocks = Math.ceil(bytesThisPacket / 8);
-        for (let b = 0; b < blocks; b++) {
-          for (let ii = 0; ii < 8 && (b * 8 + ii) < bytesThisPacket; ii++) {
-            verifyCmd[8 + b * 8 + ii] ^= this.bootloaderMask[ii];
-          }
+        // verify
+        setOpcode(stream, VERIFY_OPCODE);
+        report?.({ phase: "Verifying", current: 0, total });
+        for (let i = 0; i < total; i++) {
+          if (!(await this.sendPacket(device, epIn, epOut, stream, i))) throw new Error(`Packet ${i + 1} does not match`);
+          report?.({ phase: "Verifying", current: i + 1, total });
         }
-
-        const addr = i * 56;
-        verifyCmd[1] = 61 - (56 - bytesThisPacket);
-        verifyCmd[3] = addr & 0xff;
-        verifyCmd[4] = (addr >> 8) & 0xff;
-
-        await device.transferOut(epOut, verifyCmd.slice(0, verifyCmd[1] + 3));
-        const res = await device.transferIn(epIn, 64);
-        const r = new Uint8Array(res.data!.buffer);
-        if (r[4] !== 0 || r[5] !== 0) throw new Error(`Packet ${i + 1} does not match`);
-        onProgress?.({ phase: "Verifying", current: i + 1, total: totalPackets });
       }
 
       await device.transferOut(epOut, bootloaderResetCmd.buffer);
@@ -382,6 +394,18 @@ export class CH55xBootloader implements BootloaderClient {
     }
   }
 
+  // One command/ACK round trip. The IN transfer is queued before the OUT so the ACK is picked up
+  // as soon as the bootloader has it; true when the status bytes report success or a match
+  private async sendPacket(device: USBDevice, epIn: number, epOut: number, stream: PacketStream, index: number): Promise<boolean> {
+    const slot = index * PACKET_SLOT;
+    const ack = device.transferIn(epIn, 64);
+    ack.catch(() => undefined); // a failed OUT throws below; don't leave this rejection unhandled
+    await device.transferOut(epOut, stream.commands.subarray(slot, slot + stream.lengths[index]));
+    const res = await ack;
+    const r = new Uint8Array(res.data!.buffer);
+    return r[4] === 0 && r[5] === 0;
+  }
+
   async disconnect(): Promise<void> {
     if (!this.device) return;
     try {
@@ -0,0 +1,142 @@
+// Reads the instrumentation feature reports that firmware built with
+// CONFIGURATION_LATENCY_PROBE or CONFIGURATION_LOOP_PROFILER exposes in a
+// vendor HID collection (see src/latency.h and src/profiler.h).
+
+// Minimal WebHID surface; the DOM lib does not ship these types yet.
+type HidDeviceLike = {
+  opened: boolean;
+  productName: string;
+  open(): Promise<void>;
+  close(): Promise<void>;
+  receiveFeatureReport(reportId: number): Promise<DataView>;
+};
+
+type HidLike = {
+  requestDevice(options: { filters: { vendorId?: number; productId?: number; usagePage?: number; usage?: number }[] }): Promise<HidDeviceLike[]>;
+};
+
+const VENDOR_ID = 0x1209;
+const PRODUCT_ID = 0xc55d;
+const VENDOR_USAGE_PAGE = 0xff00;
+const INSTRUMENTATION_USAGE = 0x01;
+const LATENCY_REPORT_ID = 4;
+const LATENCY_REPORT_VERSION = 1;
+const HISTOGRAM_BUCKETS = 8;
+const PROFILE_REPORT_ID = 5;
+const PROFILE_REPORT_VERSION = 1;
+const PROFILE_STAT_SIZE = 8;
+
+export const PROFILE_TASK_LABELS = ["Buttons", "Encoders", "HID", "LEDs", "Loop period"] as const;
+
+export type LatencyStats = {
+  samples: number;
+  dropped: number;
+  minUs: number;
+  maxUs: number;
+  avgUs: number;
+  // bucket n counts samples below 1024 << n microseconds, the last one everything above
+  histogram: number[];
+};
+
+const getHid = (): HidLike | null => {
+  if (typeof navigator === "undefined") return null;
+  const candidate = (navigator as Navigator & { hid?: HidLike }).hid;
+  return candidate ?? null;
+};
+
+export const webHidAvailable = (): boolean => getHid() != null;
+
+export const histogramBucketLabel = (index: number): string => {
+  const upper = (1024 << index) / 1000;
+  if (index === HISTOGRAM_BUCKETS - 1) return `≥ ${((1024 << (index - 1)) / 1000).toFixed(1)} ms`;
+  return `< ${upper.toFixed(1)} ms`;
+};
+
+export type TaskTiming = {
+  samples: number;
+  maxUs: number;
+  avgUs: number;
+};
+
+// Chrome strips the report ID from the returned data on some platforms; accept both layouts
+const payloadOffset = (view: DataView, reportId: number, payloadSize: number): number =>
+  view.byteLength >= payloadSize + 1 && view.getUint8(0) === reportId ? 1 : 0;
+
+const checkPayload = (view: DataView, offset: number, payloadSize: number, version: number, label: string) => {
+  if (view.byteLength < offset + payloadSize) {
+    throw new Error(`${label} report is too short.`);
+  }
+  const actual = view.getUint8(offset);
+  if (actual !== version) {
+    throw new Error(`Unsupported ${label.toLowerCase()} report version ${actual}.`);
+  }
+};
+
+export const parseLatencyReport = (view: DataView): LatencyStats => {
+  const offset = payloadOffset(view, LATENCY_REPORT_ID, 29);
+  checkPayload(view, offset, 29, LATENCY_REPORT_VERSION, "Latency");
+
+  const samples = view.getUint16(offset + 1, true);
+  const totalUs = view.getUint32(offset + 9, true);
+  const histogram: number[] = [];
+  for (let i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    histogram.push(view.getUint16(offset + 13 + i * 2, true));
+  }
+
+  return {
+    samples,
+    dropped: view.getUint16(offset + 3, true),
+    minUs: view.getUint16(offset + 5, true),
+    maxUs: view.getUint16(offset + 7, true),
+    avgUs: samples > 0 ? Math.round(totalUs / samples) : 0,
+    histogram,
+  };
+};
+
+export const parseProfileReport = (view: DataView): TaskTiming[] => {
+  const payloadSize = 1 + PROFILE_STAT_SIZE * PROFILE_TASK_LABELS.length;
+  const offset = payloadOffset(view, PROFILE_REPORT_ID, payloadSize);
+  checkPayload(view, offset, payloadSize, PROFILE_REPORT_VERSION, "Profile");
+
+  return PROFILE_TASK_LABELS.map((_, index) => {
+    const base = offset + 1 + index * PROFILE_STAT_SIZE;
+    const samples = view.getUint16(base, true);
+    const totalUs = view.getUint32(base + 4, true);
+    return {
+      samples,
+      maxUs: view.getUint16(base + 2, true),
+      avgUs: samples > 0 ? Math.round(totalUs / samples) : 0,
+    };
+  });
+};
+
+async function readFeatureReport(reportId: number): Promise<DataView> {
+  const hid = getHid();
+  if (!hid) {
+    throw new Error("WebHID is not available in this browser.");
+  }
+
+  const devices = await hid.requestDevice({
+    filters: [{ vendorId: VENDOR_ID, productId: PRODUCT_ID, usagePage: VENDOR_USAGE_PAGE, usage: INSTRUMENTATION_USAGE }],
+  });
+  const device = devices[0];
+  if (!device) {
+    throw new Error("No keypad with instrumentation selected.");
+  }
+
+  const wasOpen = device.opened;
+  if (!wasOpen) await device.open();
+  try {
+    return await device.receiveFeatureReport(reportId);
+  } finally {
+    if (!wasOpen) await device.close();
+  }
+}
+
+export async function readLatencyStats(): Promise<LatencyStats> {
+  return parseLatencyReport(await readFeatureReport(LATENCY_REPORT_ID));
+}
+
+export async function readLoopProfile(): Promise<TaskTiming[]> {
+  return parseProfileReport(await readFeatureReport(PROFILE_REPORT_ID));
+}
@@ -0,0 +1,36 @@
+// How much of the CH552 a layout takes, from POST flasher/budget: the configuration blob is
+// measured exactly without compiling; flash, xdata and internal RAM are what the linker reported
+// the last time the server compiled a layout of the same shape, and null before that.
+
+export type MemoryUsage = { used: number; limit: number };
+
+export type FirmwareFootprint = {
+  code: MemoryUsage | null;
+  xdata: MemoryUsage | null;
+  data: MemoryUsage | null;
+};
+
+export type FirmwareBudget = {
+  blob: MemoryUsage;
+  footprint: FirmwareFootprint | null;
+  fits: boolean;
+};
+
+// above this share of a section the meter warns that the next binding may not fit
+export const BUDGET_WARN_FRACTION = 0.9;
+
+export const usageFraction = (usage: MemoryUsage) => (usage.limit > 0 ? usage.used / usage.limit : 0);
+
+export const fetchFirmwareBudget = async (body: unknown, signal?: AbortSignal): Promise<FirmwareBudget> => {
+  const resp = await fetch("flasher/budget", {
+    method: "POST",
+    headers: { "Content-Type": "application/json" },
+    body: JSON.stringify(body),
+    signal,
+  });
+  if (!resp.ok) {
+    const detail = (await resp.json().catch(() => null)) as { error?: string } | null;
+    throw new Error(detail?.error ?? `Budget check failed: ${resp.status} ${resp.statusText}`);
+  }
+  return (await resp.json()) as FirmwareBudget;
+};
@@ -0,0 +1,104 @@
+// Built firmware images kept in IndexedDB, so flashing the same configuration onto a batch of
+// pads downloads once. Entries are keyed by a hash of the normalised request plus the server's
+// firmware version; each image is checked against the ETag it was served with, and that ETag is
+// sent back as If-None-Match so the server confirms the image before it is reused.
+
+const DB_NAME = "keypad-flasher-firmware";
+const STORE_NAME = "images";
+const MAX_ENTRIES = 32;
+
+// usedAt is missing on entries stored before it was tracked
+type CachedImage = { key: string; image: Uint8Array; etag: string; storedAt: number; usedAt?: number };
+
+export type CachedFirmware = { image: Uint8Array; etag: string };
+
+const indexedDbAvailable = typeof indexedDB !== "undefined" && typeof crypto !== "undefined" && !!crypto.subtle;
+
+const requestResult = <T>(request: IDBRequest<T>): Promise<T> =>
+  new Promise((resolve, reject) => {
+    request.onsuccess = () => resolve(request.result);
+    request.onerror = () => reject(request.error);
+  });
+
+let dbPromise: Promise<IDBDatabase> | null = null;
+
+const openDb = (): Promise<IDBDatabase> => {
+  if (!dbPromise) {
+    const request = indexedDB.open(DB_NAME, 1);
+    request.onupgradeneeded = () => {
+      request.result.createObjectStore(STORE_NAME, { keyPath: "key" });
+    };
+    dbPromise = requestResult(request);
+    dbPromise.catch(() => { dbPromise = null; });
+  }
+  return dbPromise;
+};
+
+const toHex = (bytes: ArrayBuffer, length = bytes.byteLength) =>
+  Array.from(new Uint8Array(bytes, 0, length), (b) => b.toString(16).padStart(2, "0")).join("");
+
+// Same value the server sends: the first 16 bytes of the image's SHA-256, quoted
+const imageEtag = async (image: Uint8Array): Promise<string> =>
+  `"${toHex(await crypto.subtle.digest("SHA-256", image as Uint8Array<ArrayBuffer>), 16).toUpperCase()}"`;
+
+// Object keys sorted at every level, so equal requests hash equally whatever order they were built in
+const normalise = (value: unknown): unknown => {
+  if (Array.isArray(value)) return value.map(normalise);
+  if (value && typeof value === "object") {
+    const record = value as Record<string, unknown>;
+    return Object.fromEntries(Object.keys(record).sort().filter((k) => record[k] !== undefined).map((k) => [k, normalise(record[k])]));
+  }
+  return value;
+};
+
+export const fetchFirmwareVersion = async (): Promise<string | null> => {
+  try {
+    const resp = await fetch("flasher/version");
+    if (!resp.ok) return null;
+    const body = (await resp.json()) as { firmware?: string };
+    return body.firmware ?? null;
+  } catch {
+    return null;
+  }
+};
+
+export const firmwareCacheKey = async (firmwareVersion: string, request: unknown): Promise<string | null> => {
+  if (!indexedDbAvailable) return null;
+  const text = `${firmwareVersion}\n${JSON.stringify(normalise(request))}`;
+  return toHex(await crypto.subtle.digest("SHA-256", new TextEncoder().encode(text)));
+};
+
+const lastUsed = (entry: CachedImage) => entry.usedAt ?? entry.storedAt;
+
+// Marks the entry used, so eviction drops the ones read least recently
+export const loadCachedFirmware = async (key: string): Promise<CachedFirmware | null> => {
+  try {
+    const db = await openDb();
+    const entry = await requestResult<CachedImage | undefined>(db.transaction(STORE_NAME).objectStore(STORE_NAME).get(key));
+    if (!entry) return null;
+    if ((await imageEtag(entry.image)) !== entry.etag) {
+      await requestResult(db.transaction(STORE_NAME, "readwrite").objectStore(STORE_NAME).delete(key));
+      return null;
+    }
+    await requestResult(db.transaction(STORE_NAME, "readwrite").objectStore(STORE_NAME).put({ ...entry, usedAt: Date.now() }));
+    return { image: entry.image, etag: entry.etag };
+  } catch {
+    return null;
+  }
+};
+
+// Least recently used entries are dropped beyond MAX_ENTRIES; storage errors only cost the next download
+export const storeCachedFirmware = async (key: string, image: Uint8Array, etag: string | null): Promise<void> => {
+  try {
+    const db = await openDb();
+    const now = Date.now();
+    const entry: CachedImage = { key, image, etag: etag ?? (await imageEtag(image)), storedAt: now, usedAt: now };
+    const store = db.transaction(STORE_NAME, "readwrite").objectStore(STORE_NAME);
+    await requestResult(store.put(entry));
+    const entries = await requestResult<CachedImage[]>(store.getAll());
+    const stale = entries.sort((a, b) => lastUsed(b) - lastUsed(a)).slice(MAX_ENTRIES);
+    await Promise.all(stale.map((e) => requestResult(store.delete(e.key))));
+  } catch {
+    // ignore storage errors
+  }
+};
@@ -24,7 +24,9 @@ export type HidStepDto =
     }
   | { kind: "Pause"; gapMs: number; pointerType?: HidPointerType; pointerValue?: number; keycode?: number; modifiers?: number; holdMs?: number; functionPointer?: undefined }
   | { kind: "Function"; functionPointer: string; gapMs: number; functionValue?: number; keycode?: number; modifiers?: number; holdMs?: number; pointerType?: HidPointerType; pointerValue?: number }
-  | { kind: "Mouse"; pointerType: HidPointerType; pointerValue: number; gapMs: number; keycode?: number; modifiers?: number; holdMs?: number; functionPointer?: string };
+  | { kind: "Mouse"; pointerType: HidPointerType; pointerValue: number; gapMs: number; keycode?: number; modifiers?: number; holdMs?: number; functionPointer?: string }
+  | { kind: "Text"; text: string; modifiers: number; gapMs: number; keycode?: number; holdMs?: number; pointerType?: HidPointerType; pointerValue?: number; functionPointer?: undefined }
+  | { kind: "Layer"; layer: number; gapMs: number; keycode?: number; modifiers?: number; holdMs?: number; pointerType?: HidPointerType; pointerValue?: number; functionPointer?: undefined };
 
 export type HidBindingDto = { type: "Sequence"; steps: HidStepDto[] };
 
@@ -47,17 +49,30 @@ export type EncoderLayoutDto = {
   press?: InputLayoutDto;
 };
 
+export type LatencyProfile = "Standard" | "LowLatency"; // LowLatency polls USB every 1 ms instead of 10 ms
+
 export type DeviceLayoutDto = {
   buttons: ButtonLayoutDto[];
   encoders: EncoderLayoutDto[];
   neoPixelPin: number;
   neoPixelReversed: boolean;
+  debounceMs?: number; // switch debounce window; server default when omitted
+  latencyProfile?: LatencyProfile;
   displayRows?: number[];
 };
 
+// Inputs a layer leaves out keep their base binding on that layer
+export type BindingLayerDto = {
+  buttons: { id: number; binding: HidBindingDto }[];
+  encoders: { id: number; clockwise?: HidBindingDto; counterClockwise?: HidBindingDto; press?: HidBindingDto }[];
+};
+
+export const MAX_LAYERS = 8; // including the base layer
+
 export type BindingProfileDto = {
   buttons: { id: number; binding: HidBindingDto }[];
   encoders: { id: number; clockwise: HidBindingDto; counterClockwise: HidBindingDto; press?: HidBindingDto }[];
+  layers?: BindingLayerDto[]; // layers[i] is layer i + 1
 };
 
 export type KnownDeviceProfile = { name: string; layout: DeviceLayoutDto; defaultBindings: BindingProfileDto; hideFromDemo?: boolean };
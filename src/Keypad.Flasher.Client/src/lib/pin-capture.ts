@@ -0,0 +1,153 @@
+// Reads the binary pin capture stream that debug firmware built with
+// DEBUG_CAPTURE_RATE_HZ streams over USB CDC (see src/debug_capture.h).
+
+// Minimal Web Serial surface; the DOM lib does not ship these types yet.
+type SerialPortLike = {
+  readable: ReadableStream<Uint8Array> | null;
+  open(options: { baudRate: number }): Promise<void>;
+  close(): Promise<void>;
+};
+
+type SerialLike = {
+  requestPort(options: { filters: { usbVendorId?: number; usbProductId?: number }[] }): Promise<SerialPortLike>;
+};
+
+const VENDOR_ID = 0x1209;
+const DEBUG_PRODUCT_ID = 0xc56d;
+const SYNC_0 = 0xa5;
+const SYNC_1 = 0x5a;
+const FRAME_VERSION = 1;
+const HEADER_SIZE = 11;
+const RECORD_SIZE = 4;
+
+export type PinSample = {
+  timeUs: number;
+  p1: number;
+  p3: number;
+};
+
+export type CaptureChunk = {
+  samples: PinSample[];
+  dropped: number;
+};
+
+const getSerial = (): SerialLike | null => {
+  if (typeof navigator === "undefined") return null;
+  const candidate = (navigator as Navigator & { serial?: SerialLike }).serial;
+  return candidate ?? null;
+};
+
+export const webSerialAvailable = (): boolean => getSerial() != null;
+
+// Incremental frame parser; the banner text ahead of the first frame and any
+// corrupted bytes are skipped by resynchronising on the next sync pair.
+export class PinCaptureDecoder {
+  private pending = new Uint8Array(0);
+
+  push(chunk: Uint8Array): CaptureChunk {
+    const merged = new Uint8Array(this.pending.length + chunk.length);
+    merged.set(this.pending);
+    merged.set(chunk, this.pending.length);
+
+    const result: CaptureChunk = { samples: [], dropped: 0 };
+    let offset = 0;
+    while (offset + HEADER_SIZE <= merged.length) {
+      if (merged[offset] !== SYNC_0 || merged[offset + 1] !== SYNC_1 || merged[offset + 2] !== FRAME_VERSION) {
+        offset++;
+        continue;
+      }
+
+      const count = merged[offset + 3];
+      const frameSize = HEADER_SIZE + count * RECORD_SIZE + 1;
+      if (offset + frameSize > merged.length) break;
+
+      let checksum = 0;
+      for (let i = offset + 2; i < offset + frameSize - 1; i++) {
+        checksum = (checksum + merged[i]) & 0xff;
+      }
+      if (checksum !== merged[offset + frameSize - 1]) {
+        offset++;
+        continue;
+      }
+
+      const view = new DataView(merged.buffer, merged.byteOffset + offset, frameSize);
+      const frameTick = view.getUint32(5, true);
+      const rateHz = view.getUint16(9, true);
+      result.dropped += view.getUint8(4);
+      for (let i = 0; i < count; i++) {
+        const base = HEADER_SIZE + i * RECORD_SIZE;
+        // records carry the low 16 bits of their tick and are never newer than the frame
+        const age = (frameTick - view.getUint16(base, true)) & 0xffff;
+        result.samples.push({
+          timeUs: rateHz > 0 ? ((frameTick - age) * 1_000_000) / rateHz : 0,
+          p1: view.getUint8(base + 2),
+          p3: view.getUint8(base + 3),
+        });
+      }
+      offset += frameSize;
+    }
+
+    this.pending = merged.slice(offset);
+    return result;
+  }
+}
+
+// Opens the debug keypad's serial port and feeds decoded samples to onChunk until the returned stop function is called.
+export async function startPinCapture(onChunk: (chunk: CaptureChunk) => void, onError: (error: Error) => void): Promise<() => Promise<void>> {
+  const serial = getSerial();
+  if (!serial) {
+    throw new Error("Web Serial is not available in this browser.");
+  }
+
+  const port = await serial.requestPort({ filters: [{ usbVendorId: VENDOR_ID, usbProductId: DEBUG_PRODUCT_ID }] });
+  await port.open({ baudRate: 115200 });
+  const reader = port.readable?.getReader();
+  if (!reader) {
+    await port.close();
+    throw new Error("Serial port is not readable.");
+  }
+
+  const decoder = new PinCaptureDecoder();
+  let stopped = false;
+  const pump = (async () => {
+    try {
+      while (!stopped) {
+        const { value, done } = await reader.read();
+        if (done) break;
+        if (value) {
+          const chunk = decoder.push(value);
+          if (chunk.samples.length > 0 || chunk.dropped > 0) onChunk(chunk);
+        }
+      }
+    } catch (err) {
+      if (!stopped) onError(err as Error);
+    } finally {
+      reader.releaseLock();
+    }
+  })();
+
+  return async () => {
+    stopped = true;
+    await reader.cancel().catch(() => undefined);
+    await pump;
+    await port.close().catch(() => undefined);
+  };
+}
+
+// Pins that changed at least once, as { port, bit } in capture order.
+export const togglingPins = (samples: PinSample[]): { port: 1 | 3; bit: number }[] => {
+  let p1 = 0;
+  let p3 = 0;
+  for (let i = 1; i < samples.length; i++) {
+    p1 |= samples[i].p1 ^ samples[i - 1].p1;
+    p3 |= samples[i].p3 ^ samples[i - 1].p3;
+  }
+  const pins: { port: 1 | 3; bit: number }[] = [];
+  for (let bit = 0; bit < 8; bit++) {
+    if (p1 & (1 << bit)) pins.push({ port: 1, bit });
+  }
+  for (let bit = 0; bit < 8; bit++) {
+    if (p3 & (1 << bit)) pins.push({ port: 3, bit });
+  }
+  return pins;
+};
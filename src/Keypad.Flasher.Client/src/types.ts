@@ -16,4 +16,5 @@ export type LedConfigurationDto = {
   rainbowStepMs: number;
   breathingMinPercent: number;
   breathingStepMs: number;
+  gammaCorrection?: boolean;
 };
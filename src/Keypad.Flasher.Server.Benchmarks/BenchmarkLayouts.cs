@@ -0,0 +1,49 @@
+using Keypad.Flasher.Server.Configuration;
+
+namespace Keypad.Flasher.Server.Benchmarks
+{
+    // Synthetic layouts from the smallest pad to every free CH552 pin in use; P3.6/P3.7 carry USB
+    public static class BenchmarkLayouts
+    {
+        private static readonly int[] FreePins = { 10, 11, 12, 13, 14, 15, 16, 17, 30, 31, 32, 33, 34, 35 };
+
+        public static IEnumerable<LayoutShape> Shapes => new[]
+        {
+            new LayoutShape(2, 0),
+            new LayoutShape(6, 1),
+            new LayoutShape(10, 0),
+            new LayoutShape(10, 2)
+        };
+
+        public static DeviceLayout Layout(LayoutShape shape)
+        {
+            var buttons = Enumerable.Range(0, shape.Buttons)
+                .Select(i => new ButtonLayout(i, FreePins[i], true, -1, i == 0, false))
+                .ToList();
+            var encoders = Enumerable.Range(0, shape.Encoders)
+                .Select(i => new EncoderLayout(i, FreePins[shape.Buttons + i * 2], FreePins[shape.Buttons + i * 2 + 1], Press: null))
+                .ToList();
+            return new DeviceLayout(buttons, encoders, NeoPixelPin: -1, NeoPixelReversed: false);
+        }
+
+        public static BindingProfile Bindings(LayoutShape shape, string variant = "")
+        {
+            var buttons = Enumerable.Range(0, shape.Buttons)
+                .Select(i => new ButtonBindingEntry(i, new HidSequenceBinding(variant + (char)('a' + i), 0)))
+                .ToList();
+            var encoders = Enumerable.Range(0, shape.Encoders)
+                .Select(i => new EncoderBindingEntry(
+                    i,
+                    HidSequenceBinding.FromFunction("hid_consumer_volume_up"),
+                    HidSequenceBinding.FromFunction("hid_consumer_volume_down"),
+                    Press: null))
+                .ToList();
+            return new BindingProfile(buttons, encoders);
+        }
+    }
+
+    public sealed record LayoutShape(int Buttons, int Encoders)
+    {
+        public override string ToString() => $"{Buttons}b{Encoders}e";
+    }
+}
@@ -0,0 +1,136 @@
+using BenchmarkDotNet.Attributes;
+using BenchmarkDotNet.Engines;
+using Keypad.Flasher.Server.Configuration;
+using Keypad.Flasher.Server.Services;
+using Microsoft.Extensions.Logging.Abstractions;
+using Microsoft.Extensions.Options;
+using Builder = Keypad.Flasher.Server.Configuration.ConfigurationBuilder;
+
+namespace Keypad.Flasher.Server.Benchmarks
+{
+    // End to end through FirmwareBuilder; needs arduino-cli with the CH55xDuino core installed, as
+    // in the server image. KEYPAD_FIRMWARE_PATH overrides the firmware tree found next to this project
+    internal static class BenchmarkFirmware
+    {
+        public static FirmwareBuilder CreateBuilder(string workspacePath)
+        {
+            var settings = Options.Create(new Settings { FirmwarePath = FirmwarePath(), WorkspacePath = workspacePath, CompileWorkers = 1 });
+            return new FirmwareBuilder(
+                settings,
+                new ConfigurationGenerator(),
+                new LocalFirmwareCompiler(settings, NullLogger<LocalFirmwareCompiler>.Instance),
+                NullLogger<FirmwareBuilder>.Instance);
+        }
+
+        public static string WorkspaceRoot(string name) => Path.Combine(Path.GetTempPath(), "keypad-flasher-benchmarks", name);
+
+        public static void Require(FirmwareBuildResult result)
+        {
+            if (!result.Success)
+            {
+                throw new InvalidOperationException($"Benchmark build failed: {result.Error}\n{result.Stderr}");
+            }
+        }
+
+        private static string FirmwarePath()
+        {
+            var configured = Environment.GetEnvironmentVariable("KEYPAD_FIRMWARE_PATH");
+            if (!string.IsNullOrEmpty(configured))
+            {
+                return configured;
+            }
+
+            for (var directory = new DirectoryInfo(AppContext.BaseDirectory); directory != null; directory = directory.Parent)
+            {
+                var candidate = Path.Combine(directory.FullName, "Keypad.Firmware");
+                if (File.Exists(Path.Combine(candidate, "Keypad.Firmware.ino")))
+                {
+                    return candidate;
+                }
+            }
+
+            throw new DirectoryNotFoundException("Keypad.Firmware not found; set KEYPAD_FIRMWARE_PATH.");
+        }
+    }
+
+    // Requests that never reach arduino-cli: a repeat served from the result cache, and a new
+    // binding set patched into the cached base image of its layout shape
+    public class FirmwareBuilderBenchmarks
+    {
+        // more distinct binding sets than the result cache holds, so every patched call misses it
+        private const int PatchVariants = 512;
+
+        private FirmwareBuilder _builder = null!;
+        private ConfigurationDefinition _repeated = null!;
+        private ConfigurationDefinition[] _variants = null!;
+        private int _next;
+
+        public static IEnumerable<LayoutShape> Shapes => BenchmarkLayouts.Shapes;
+
+        [ParamsSource(nameof(Shapes))]
+        public LayoutShape Shape { get; set; } = null!;
+
+        [GlobalSetup]
+        public void Setup()
+        {
+            var layout = BenchmarkLayouts.Layout(Shape);
+            _builder = BenchmarkFirmware.CreateBuilder(BenchmarkFirmware.WorkspaceRoot("warm"));
+            _repeated = Builder.FromLayout(layout, BenchmarkLayouts.Bindings(Shape), debugMode: false);
+            _variants = Enumerable.Range(0, PatchVariants)
+                .Select(i => Builder.FromLayout(layout, BenchmarkLayouts.Bindings(Shape, i.ToString()), debugMode: false))
+                .ToArray();
+            BenchmarkFirmware.Require(_builder.BuildFirmware(_repeated));
+        }
+
+        [Benchmark]
+        public FirmwareBuildResult Cached() => _builder.BuildFirmware(_repeated);
+
+        [Benchmark]
+        public FirmwareBuildResult Patched() => _builder.BuildFirmware(_variants[_next++ % PatchVariants]);
+    }
+
+    // A layout shape the process has not built yet, so arduino-cli runs; a warm workspace only
+    // recompiles configuration.c, a cold one the whole tree
+    [SimpleJob(RunStrategy.Monitoring, launchCount: 1, warmupCount: 1, iterationCount: 5)]
+    public class FirmwareCompileBenchmarks
+    {
+        private ConfigurationDefinition _configuration = null!;
+        private FirmwareBuilder _builder = null!;
+        private string _workspace = null!;
+
+        public static IEnumerable<LayoutShape> Shapes => BenchmarkLayouts.Shapes;
+
+        [ParamsSource(nameof(Shapes))]
+        public LayoutShape Shape { get; set; } = null!;
+
+        [Params(false, true)]
+        public bool ColdWorkspace { get; set; }
+
+        [GlobalSetup]
+        public void Setup()
+        {
+            _configuration = Builder.FromLayout(BenchmarkLayouts.Layout(Shape), BenchmarkLayouts.Bindings(Shape), debugMode: false);
+            _workspace = BenchmarkFirmware.WorkspaceRoot($"compile-{Shape}");
+        }
+
+        // a fresh builder has empty result and base-image caches, so every iteration compiles
+        [IterationSetup]
+        public void ResetBuilder()
+        {
+            if (ColdWorkspace && Directory.Exists(_workspace))
+            {
+                Directory.Delete(_workspace, true);
+            }
+
+            _builder = BenchmarkFirmware.CreateBuilder(_workspace);
+        }
+
+        [Benchmark]
+        public FirmwareBuildResult Compile()
+        {
+            var result = _builder.BuildFirmware(_configuration);
+            BenchmarkFirmware.Require(result);
+            return result;
+        }
+    }
+}
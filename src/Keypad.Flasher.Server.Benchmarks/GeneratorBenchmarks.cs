@@ -0,0 +1,40 @@
+using BenchmarkDotNet.Attributes;
+using Keypad.Flasher.Server.Configuration;
+using Builder = Keypad.Flasher.Server.Configuration.ConfigurationBuilder;
+
+namespace Keypad.Flasher.Server.Benchmarks
+{
+    // Everything a request does before arduino-cli or the image patch
+    public class GeneratorBenchmarks
+    {
+        private readonly ConfigurationGenerator _generator = new();
+        private DeviceLayout _layout = null!;
+        private BindingProfile _bindings = null!;
+        private ConfigurationDefinition _configuration = null!;
+
+        public static IEnumerable<LayoutShape> Shapes => BenchmarkLayouts.Shapes;
+
+        [ParamsSource(nameof(Shapes))]
+        public LayoutShape Shape { get; set; } = null!;
+
+        [GlobalSetup]
+        public void Setup()
+        {
+            _layout = BenchmarkLayouts.Layout(Shape);
+            _bindings = BenchmarkLayouts.Bindings(Shape);
+            _configuration = Builder.FromLayout(_layout, _bindings, debugMode: false);
+        }
+
+        [Benchmark]
+        public ConfigurationDefinition FromLayout() => Builder.FromLayout(_layout, _bindings, debugMode: false);
+
+        [Benchmark]
+        public string GenerateHeader() => _generator.GenerateHeader(_configuration);
+
+        [Benchmark]
+        public string GenerateSource() => _generator.GenerateSource(_configuration);
+
+        [Benchmark]
+        public byte[] GenerateBlob() => _generator.GenerateBlob(_configuration);
+    }
+}
@@ -0,0 +1,15 @@
+using BenchmarkDotNet.Configs;
+using BenchmarkDotNet.Diagnosers;
+using BenchmarkDotNet.Exporters;
+using BenchmarkDotNet.Exporters.Csv;
+using BenchmarkDotNet.Exporters.Json;
+using BenchmarkDotNet.Running;
+
+// dotnet run -c Release -- --filter '*'
+// Results land in BenchmarkDotNet.Artifacts/results as JSON (compare runs with the ResultsComparer
+// tool from dotnet/performance), CSV and GitHub markdown
+var config = DefaultConfig.Instance
+    .AddDiagnoser(MemoryDiagnoser.Default)
+    .AddExporter(JsonExporter.Full, CsvExporter.Default, MarkdownExporter.GitHub);
+
+BenchmarkSwitcher.FromAssembly(typeof(Program).Assembly).Run(args, config);
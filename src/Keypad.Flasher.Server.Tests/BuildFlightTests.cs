@@ -0,0 +1,37 @@
+using Keypad.Flasher.Server.Services;
+using NUnit.Framework;
+
+namespace Keypad.Flasher.Server.Tests
+{
+    [TestFixture]
+    public class BuildFlightTests
+    {
+        [Test]
+        public async Task Wait_FromConcurrentCallers_BuildsOnceAndSharesResult()
+        {
+            var builds = 0;
+            using var release = new ManualResetEventSlim();
+            var flight = new BuildFlight(report =>
+            {
+                Interlocked.Increment(ref builds);
+                report(BuildStage.Compiling);
+                release.Wait();
+                return new FirmwareBuildResult(true, new byte[] { 4 });
+            });
+
+            var first = Task.Run(() => flight.Wait(null));
+            SpinWait.SpinUntil(() => Volatile.Read(ref builds) == 1, TimeSpan.FromSeconds(5));
+            var stages = new List<BuildStage>();
+            var second = Task.Run(() => flight.Wait(stages.Add));
+            SpinWait.SpinUntil(() => flight.Joined == 1, TimeSpan.FromSeconds(5));
+            release.Set();
+
+            var results = await Task.WhenAll(first, second);
+
+            Assert.That(builds, Is.EqualTo(1));
+            Assert.That(results[1].FileBytes, Is.EqualTo(new byte[] { 4 }));
+            Assert.That(stages, Is.EqualTo(new[] { BuildStage.Compiling }));
+            Assert.That(flight.Joined, Is.EqualTo(1));
+        }
+    }
+}
@@ -0,0 +1,162 @@
+using Keypad.Flasher.Server.Configuration;
+using Keypad.Flasher.Server.Services;
+using Microsoft.Extensions.Logging.Abstractions;
+using Microsoft.Extensions.Options;
+using NUnit.Framework;
+
+namespace Keypad.Flasher.Server.Tests
+{
+    [TestFixture]
+    public class BuildJobTests
+    {
+        [Test]
+        public async Task Enqueue_WithWorkerRunning_ReportsStagesAndKeepsResult()
+        {
+            var builder = new StagedBuilder();
+            var settings = Options.Create(new Settings { FirmwarePath = ".", CompileWorkers = 1 });
+            var queue = new BuildJobQueue(settings);
+            using var worker = new BuildJobWorker(queue, builder, settings, NullLogger<BuildJobWorker>.Instance);
+            await worker.StartAsync(CancellationToken.None);
+
+            var job = queue.TryEnqueue(EmptyConfiguration(), "client").Job!;
+            var seen = new List<BuildStage> { job.Stage };
+            using var timeout = new CancellationTokenSource(TimeSpan.FromSeconds(5));
+            while (true)
+            {
+                if (job.Stage != seen[^1])
+                {
+                    seen.Add(job.Stage);
+                }
+
+                if (job.IsFinished)
+                {
+                    break;
+                }
+
+                await job.WaitForChangeAsync(seen[^1], timeout.Token);
+            }
+
+            await worker.StopAsync(CancellationToken.None);
+
+            // stages only move forward, though a fast build may finish before the first look
+            Assert.That(seen, Is.EqualTo(seen.OrderBy(stage => stage).ToList()));
+            Assert.That(seen[^1], Is.EqualTo(BuildStage.Done));
+            Assert.That(job.Result!.FileBytes, Is.EqualTo(new byte[] { 1, 2, 3 }));
+            Assert.That(queue.TryGet(job.Id, out _), Is.True);
+        }
+
+        [Test]
+        public void TryGet_UnknownId_ReturnsFalse()
+        {
+            Assert.That(Queue().TryGet(Guid.NewGuid(), out _), Is.False);
+        }
+
+        [Test]
+        public void TryEnqueue_CountsPositionsInAdmissionOrder()
+        {
+            var queue = Queue();
+
+            var first = queue.TryEnqueue(EmptyConfiguration(), "a");
+            var second = queue.TryEnqueue(EmptyConfiguration(), "b");
+
+            Assert.That(first.QueueLength, Is.EqualTo(1));
+            Assert.That(queue.PositionOf(first.Job!), Is.EqualTo(1));
+            Assert.That(queue.PositionOf(second.Job!), Is.EqualTo(2));
+        }
+
+        [Test]
+        public void TryEnqueue_PastClientShare_RejectsOnlyThatClient()
+        {
+            var queue = Queue(maxQueued: 8, perClient: 2);
+            queue.TryEnqueue(EmptyConfiguration(), "noisy");
+            queue.TryEnqueue(EmptyConfiguration(), "noisy");
+
+            var rejected = queue.TryEnqueue(EmptyConfiguration(), "noisy");
+            var other = queue.TryEnqueue(EmptyConfiguration(), "quiet");
+
+            Assert.That(rejected.Job, Is.Null);
+            Assert.That(rejected.Rejection, Is.EqualTo(BuildRejection.ClientLimit));
+            Assert.That(rejected.RetryAfter, Is.GreaterThanOrEqualTo(TimeSpan.FromSeconds(1)));
+            Assert.That(other.Rejection, Is.EqualTo(BuildRejection.None));
+            Assert.That(queue.PositionOf(other.Job!), Is.EqualTo(3));
+        }
+
+        [Test]
+        public void TryEnqueue_WhenFull_RejectsWithQueueLength()
+        {
+            var queue = Queue(maxQueued: 2, perClient: 2);
+            queue.TryEnqueue(EmptyConfiguration(), "a");
+            queue.TryEnqueue(EmptyConfiguration(), "b");
+
+            var rejected = queue.TryEnqueue(EmptyConfiguration(), "c");
+
+            Assert.That(rejected.Rejection, Is.EqualTo(BuildRejection.QueueFull));
+            Assert.That(rejected.QueueLength, Is.EqualTo(2));
+            Assert.That(rejected.RetryAfter, Is.GreaterThan(TimeSpan.Zero));
+        }
+
+        [Test]
+        public async Task TryEnqueue_AfterJobStarts_FreesClientShare()
+        {
+            var settings = Options.Create(new Settings { FirmwarePath = ".", CompileWorkers = 1, MaxQueuedBuildsPerClient = 1 });
+            var queue = new BuildJobQueue(settings);
+            using var worker = new BuildJobWorker(queue, new StagedBuilder(), settings, NullLogger<BuildJobWorker>.Instance);
+
+            var first = queue.TryEnqueue(EmptyConfiguration(), "a").Job!;
+            Assert.That(queue.TryEnqueue(EmptyConfiguration(), "a").Rejection, Is.EqualTo(BuildRejection.ClientLimit));
+
+            await worker.StartAsync(CancellationToken.None);
+            using var timeout = new CancellationTokenSource(TimeSpan.FromSeconds(5));
+            while (!first.IsFinished)
+            {
+                await first.WaitForChangeAsync(first.Stage, timeout.Token);
+            }
+            await worker.StopAsync(CancellationToken.None);
+
+            Assert.That(queue.PositionOf(first), Is.EqualTo(0));
+            Assert.That(queue.TryEnqueue(EmptyConfiguration(), "a").Rejection, Is.EqualTo(BuildRejection.None));
+        }
+
+        private static BuildJobQueue Queue(int maxQueued = 32, int perClient = 4) => new(Options.Create(new Settings
+        {
+            FirmwarePath = ".",
+            CompileWorkers = 1,
+            MaxQueuedBuilds = maxQueued,
+            MaxQueuedBuildsPerClient = perClient
+        }));
+
+        private static ConfigurationDefinition EmptyConfiguration() => new(
+            Array.Empty<ButtonBinding>(),
+            Array.Empty<EncoderBinding>(),
+            DebugMode: true,
+            NeoPixelPin: -1,
+            NeoPixelReversed: false,
+            LedConfig: new LedConfiguration(
+                PassiveModes: Array.Empty<PassiveLedMode>(),
+                PassiveColors: Array.Empty<LedColor>(),
+                ActiveModes: Array.Empty<ActiveLedMode>(),
+                ActiveColors: Array.Empty<LedColor>()),
+            DebugOptions: DebugOptions.Default,
+            FirmwareOptions: FirmwareOptions.Default);
+
+        private sealed class StagedBuilder : IFirmwareBuilder
+        {
+            public string FirmwareVersion => "test";
+
+            public FirmwareBudget MeasureBudget(ConfigurationDefinition configuration) => new(new MemoryUsage(0, 1024), null);
+
+            public bool TryGetCached(ConfigurationDefinition configuration, out byte[] image)
+            {
+                image = Array.Empty<byte>();
+                return false;
+            }
+
+            public FirmwareBuildResult BuildFirmware(ConfigurationDefinition configuration, Action<BuildStage>? onStage = null)
+            {
+                onStage?.Invoke(BuildStage.Generating);
+                onStage?.Invoke(BuildStage.Compiling);
+                return new FirmwareBuildResult(true, new byte[] { 1, 2, 3 });
+            }
+        }
+    }
+}
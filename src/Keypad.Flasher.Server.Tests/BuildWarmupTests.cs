@@ -0,0 +1,76 @@
+using Keypad.Flasher.Server.Configuration;
+using Keypad.Flasher.Server.Services;
+using Microsoft.Extensions.Diagnostics.HealthChecks;
+using Microsoft.Extensions.Logging.Abstractions;
+using Microsoft.Extensions.Options;
+using NUnit.Framework;
+
+namespace Keypad.Flasher.Server.Tests
+{
+    [TestFixture]
+    public class BuildWarmupTests
+    {
+        [Test]
+        public async Task Start_BuildsEveryFqbnThenReportsReady()
+        {
+            var compiler = new RecordingCompiler(success: true);
+            using var warmup = new BuildWarmup(compiler, new ConfigurationGenerator(), Options.Create(new Settings { FirmwarePath = "." }), NullLogger<BuildWarmup>.Instance);
+            var check = new BuildWarmupHealthCheck(warmup);
+
+            Assert.That((await check.CheckHealthAsync(new HealthCheckContext())).Status, Is.EqualTo(HealthStatus.Unhealthy));
+
+            await warmup.StartAsync(CancellationToken.None);
+            await warmup.ExecuteTask!;
+
+            Assert.That(compiler.Fqbns, Is.EqualTo(BuildWarmup.Configurations().Select(entry => FirmwareBuilder.FqbnFor(entry.Configuration)).ToList()));
+            Assert.That((await check.CheckHealthAsync(new HealthCheckContext())).Status, Is.EqualTo(HealthStatus.Healthy));
+        }
+
+        [Test]
+        public async Task Start_WithFailingBuild_ReportsDegraded()
+        {
+            using var warmup = new BuildWarmup(new RecordingCompiler(success: false), new ConfigurationGenerator(), Options.Create(new Settings { FirmwarePath = "." }), NullLogger<BuildWarmup>.Instance);
+
+            await warmup.StartAsync(CancellationToken.None);
+            await warmup.ExecuteTask!;
+
+            Assert.That(warmup.State, Is.EqualTo(WarmupState.Failed));
+            Assert.That((await new BuildWarmupHealthCheck(warmup).CheckHealthAsync(new HealthCheckContext())).Status, Is.EqualTo(HealthStatus.Degraded));
+        }
+
+        [Test]
+        public async Task Start_WhenDisabled_IsReadyWithoutBuilding()
+        {
+            var compiler = new RecordingCompiler(success: true);
+            using var warmup = new BuildWarmup(compiler, new ConfigurationGenerator(), Options.Create(new Settings { FirmwarePath = ".", WarmupOnStartup = false }), NullLogger<BuildWarmup>.Instance);
+
+            await warmup.StartAsync(CancellationToken.None);
+            await warmup.ExecuteTask!;
+
+            Assert.That(warmup.State, Is.EqualTo(WarmupState.Ready));
+            Assert.That(compiler.Fqbns, Is.Empty);
+        }
+
+        private sealed class RecordingCompiler : IFirmwareCompiler
+        {
+            private readonly bool _success;
+
+            public RecordingCompiler(bool success)
+            {
+                _success = success;
+            }
+
+            public List<string> Fqbns { get; } = new();
+
+            public FirmwareBuildResult Compile(CompileRequest request, Action<BuildStage>? onStage = null)
+            {
+                lock (Fqbns)
+                {
+                    Fqbns.Add(request.Fqbn);
+                }
+
+                return _success ? new FirmwareBuildResult(true, new byte[] { 1 }) : new FirmwareBuildResult(false, null, "no toolchain");
+            }
+        }
+    }
+}
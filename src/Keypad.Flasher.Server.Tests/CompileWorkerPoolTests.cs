@@ -0,0 +1,52 @@
+using Keypad.Flasher.Server.Services;
+using NUnit.Framework;
+
+namespace Keypad.Flasher.Server.Tests
+{
+    [TestFixture]
+    public class CompileWorkerPoolTests
+    {
+        [Test]
+        public void Acquire_ConcurrentLeases_GetSeparateDirectories()
+        {
+            var pool = new CompileWorkerPool(2, "/tmp/workers");
+
+            using var first = pool.Acquire();
+            using var second = pool.Acquire();
+
+            Assert.That(first.Slot, Is.Not.EqualTo(second.Slot));
+            Assert.That(first.WorkspaceFor("a:b"), Is.Not.EqualTo(second.WorkspaceFor("a:b")));
+            Assert.That(first.BuildCachePath, Is.Not.EqualTo(second.BuildCachePath));
+            Assert.That(pool.Busy, Is.EqualTo(2));
+        }
+
+        [Test]
+        public void WorkspaceFor_SeparatesFqbnsOnOneWorker()
+        {
+            var pool = new CompileWorkerPool(1, "/tmp/workers");
+
+            using var lease = pool.Acquire();
+
+            var normal = lease.WorkspaceFor("CH55xDuino:mcs51:ch552:usb_settings=user148,clock=16internal");
+            var debug = lease.WorkspaceFor("CH55xDuino:mcs51:ch552:usb_settings=usbcdc,clock=16internal");
+            Assert.That(normal, Is.Not.EqualTo(debug));
+            Assert.That(Path.GetFileName(normal), Does.Not.Contain(":"));
+        }
+
+        [Test]
+        public void Acquire_WhenAllWorkersBusy_WaitsForARelease()
+        {
+            var pool = new CompileWorkerPool(1, "/tmp/workers");
+            var lease = pool.Acquire();
+
+            var waiting = Task.Run(() => pool.Acquire());
+            Assert.That(waiting.Wait(TimeSpan.FromMilliseconds(100)), Is.False);
+
+            lease.Dispose();
+            Assert.That(waiting.Wait(TimeSpan.FromSeconds(5)), Is.True);
+            Assert.That(waiting.Result.Slot, Is.EqualTo(lease.Slot));
+            waiting.Result.Dispose();
+            Assert.That(pool.Busy, Is.EqualTo(0));
+        }
+    }
+}
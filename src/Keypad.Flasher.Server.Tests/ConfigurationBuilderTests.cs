@@ -110,6 +110,136 @@ namespace Keypad.Flasher.Server.Tests
             Assert.Throws<InvalidOperationException>(() => Builder.FromLayout(layout, bindings, debugMode: false));
         }
 
+        [Test]
+        public void FromLayout_WithLayers_KeepsBaseBindingsForInputsALayerLeavesOut()
+        {
+            var layout = new DeviceLayout(
+                Buttons: new List<ButtonLayout>
+                {
+                    new ButtonLayout(0, 11, true, -1, false, false),
+                    new ButtonLayout(1, 14, true, -1, false, false)
+                },
+                Encoders: new List<EncoderLayout> { new EncoderLayout(0, 31, 30, Press: null) },
+                NeoPixelPin: -1,
+                NeoPixelReversed: false);
+
+            var layerBinding = new HidSequenceBinding("q", 0);
+            var bindings = new BindingProfile(
+                Buttons: new List<ButtonBindingEntry>
+                {
+                    new ButtonBindingEntry(0, new HidSequenceBinding("a", 0)),
+                    new ButtonBindingEntry(1, new HidSequenceBinding("b", 0))
+                },
+                Encoders: new List<EncoderBindingEntry>
+                {
+                    new EncoderBindingEntry(0, HidSequenceBinding.FromFunction("hid_consumer_volume_up"), HidSequenceBinding.FromFunction("hid_consumer_volume_down"), Press: null)
+                },
+                Layers: new List<BindingLayer>
+                {
+                    new BindingLayer(new List<ButtonBindingEntry> { new ButtonBindingEntry(1, layerBinding) }, Encoders: null)
+                });
+
+            var configuration = Builder.FromLayout(layout, bindings, debugMode: false);
+
+            Assert.That(configuration.LayerCount, Is.EqualTo(2));
+            Assert.That(MacroProgram.ForLayer(configuration.Buttons[0].Function, configuration.Buttons[0].LayerFunctions, 1), Is.EqualTo(configuration.Buttons[0].Function));
+            Assert.That(MacroProgram.ForLayer(configuration.Buttons[1].Function, configuration.Buttons[1].LayerFunctions, 1), Is.EqualTo(layerBinding));
+            Assert.That(MacroProgram.ForLayer(configuration.Encoders[0].Clockwise, configuration.Encoders[0].LayerClockwise, 1), Is.EqualTo(configuration.Encoders[0].Clockwise));
+        }
+
+        [Test]
+        public void FromLayout_WithLayerBindingForUnknownButton_Throws()
+        {
+            var layout = new DeviceLayout(
+                Buttons: new List<ButtonLayout> { new ButtonLayout(0, 11, true, -1, false, false) },
+                Encoders: Array.Empty<EncoderLayout>(),
+                NeoPixelPin: -1,
+                NeoPixelReversed: false);
+
+            var bindings = new BindingProfile(
+                Buttons: new List<ButtonBindingEntry> { new ButtonBindingEntry(0, new HidSequenceBinding("a", 0)) },
+                Encoders: new List<EncoderBindingEntry>(),
+                Layers: new List<BindingLayer>
+                {
+                    new BindingLayer(new List<ButtonBindingEntry> { new ButtonBindingEntry(7, new HidSequenceBinding("b", 0)) }, Encoders: null)
+                });
+
+            Assert.Throws<InvalidOperationException>(() => Builder.FromLayout(layout, bindings, debugMode: false));
+        }
+
+        [Test]
+        public void FromLayout_WithLayoutDebounce_OverridesRequestedOptions()
+        {
+            var layout = new DeviceLayout(
+                Buttons: new List<ButtonLayout> { new ButtonLayout(0, 11, true, -1, false, false) },
+                Encoders: Array.Empty<EncoderLayout>(),
+                NeoPixelPin: -1,
+                NeoPixelReversed: false,
+                DebounceMs: 12);
+
+            var bindings = new BindingProfile(
+                Buttons: new List<ButtonBindingEntry> { new ButtonBindingEntry(0, new HidSequenceBinding("a", 0)) },
+                Encoders: new List<EncoderBindingEntry>());
+
+            var configuration = Builder.FromLayout(layout, bindings, debugMode: false, firmwareOptions: new FirmwareOptions(ScanRateHz: 1000, DebounceMs: 2));
+
+            Assert.That(configuration.FirmwareOptions.DebounceMs, Is.EqualTo((byte)12));
+            Assert.That(configuration.FirmwareOptions.ScanRateHz, Is.EqualTo((ushort)1000));
+        }
+
+        [Test]
+        public void FromLayout_WithLowLatencyProfile_SelectsOneMillisecondPolling()
+        {
+            var layout = new DeviceLayout(
+                Buttons: new List<ButtonLayout> { new ButtonLayout(0, 11, true, -1, false, false) },
+                Encoders: Array.Empty<EncoderLayout>(),
+                NeoPixelPin: -1,
+                NeoPixelReversed: false,
+                LatencyProfile: LatencyProfile.LowLatency);
+
+            var bindings = new BindingProfile(
+                Buttons: new List<ButtonBindingEntry> { new ButtonBindingEntry(0, new HidSequenceBinding("a", 0)) },
+                Encoders: new List<EncoderBindingEntry>());
+
+            var configuration = Builder.FromLayout(layout, bindings, debugMode: false);
+
+            Assert.That(configuration.FirmwareOptions.PollingIntervalMs, Is.EqualTo((byte)1));
+        }
+
+        [Test]
+        public void FromLayout_WithExcessiveDebounce_Throws()
+        {
+            var layout = new DeviceLayout(
+                Buttons: new List<ButtonLayout> { new ButtonLayout(0, 11, true, -1, false, false) },
+                Encoders: Array.Empty<EncoderLayout>(),
+                NeoPixelPin: -1,
+                NeoPixelReversed: false,
+                DebounceMs: 200);
+
+            var bindings = new BindingProfile(
+                Buttons: new List<ButtonBindingEntry> { new ButtonBindingEntry(0, new HidSequenceBinding("a", 0)) },
+                Encoders: new List<EncoderBindingEntry>());
+
+            Assert.Throws<ArgumentException>(() => Builder.FromLayout(layout, bindings, debugMode: false));
+        }
+
+        [Test]
+        public void FromLayout_WithEncoderAccelerationOutOfRange_Throws()
+        {
+            var layout = new DeviceLayout(
+                Buttons: new List<ButtonLayout> { new ButtonLayout(0, 11, true, -1, false, false) },
+                Encoders: Array.Empty<EncoderLayout>(),
+                NeoPixelPin: -1,
+                NeoPixelReversed: false);
+
+            var bindings = new BindingProfile(
+                Buttons: new List<ButtonBindingEntry> { new ButtonBindingEntry(0, new HidSequenceBinding("a", 0)) },
+                Encoders: new List<EncoderBindingEntry>());
+
+            Assert.Throws<ArgumentException>(() => Builder.FromLayout(layout, bindings, debugMode: false,
+                firmwareOptions: new FirmwareOptions(EncoderAccelerationMs: 60, EncoderAccelerationMax: 0)));
+        }
+
         private static string ReadExpected(string fileName)
         {
             var directory = Path.Combine(TestContext.CurrentContext.TestDirectory, "ExpectedOutputs", "ConfigurationGenerator");
@@ -17,14 +17,14 @@ namespace Keypad.Flasher.Server.Tests
             var buttons = new List<ButtonBinding>
             {
                 new ButtonBinding(
-                    Pin: 1,
+                    Pin: 11,
                     ActiveLow: true,
                     LedIndex: -1,
                     BootloaderOnBoot: false,
                     BootloaderChordMember: false,
                     Function: new HidSequenceBinding("a", 0)),
                 new ButtonBinding(
-                    Pin: 2,
+                    Pin: 12,
                     ActiveLow: false,
                     LedIndex: 0,
                     BootloaderOnBoot: true,
@@ -39,7 +39,8 @@ namespace Keypad.Flasher.Server.Tests
                 NeoPixelPin: 34,
                 NeoPixelReversed: false,
                 LedConfig: DefaultLedConfig(buttons),
-                DebugOptions: DebugOptions.Default);
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
 
             var expected = Lines(
                 "// This file is auto-generated. Do not edit manually.",
@@ -55,7 +56,25 @@ namespace Keypad.Flasher.Server.Tests
                 "#define DEBUG_PULLUPS_ENABLED 1",
                 "#define DEBUG_CONFIRM_SAMPLES 3",
                 "#define DEBUG_CONFIRM_DELAY_MS 1",
-                "#define HID_MAX_KEY_STEPS 1",
+                "#define DEBUG_CAPTURE_RATE_HZ 0",
+                "#define CONFIGURATION_SCAN_RATE_HZ 0",
+                "#define CONFIGURATION_DEBOUNCE_MS 5",
+                "#define CONFIGURATION_ENCODER_ISR 0",
+                "#define CONFIGURATION_ENCODER_ACCELERATION_MS 0",
+                "#define CONFIGURATION_ENCODER_ACCELERATION_MAX 8",
+                "#define CONFIGURATION_HID_POLL_INTERVAL_MS 10",
+                "#define CONFIGURATION_HID_NKRO 0",
+                "#define CONFIGURATION_LED_MAX_REFRESH_HZ 50",
+                "#define CONFIGURATION_LATENCY_PROBE 0",
+                "#define CONFIGURATION_LOOP_PROFILER 0",
+                "#define CONFIGURATION_LAYER_FEEDBACK 1",
+                string.Empty,
+                "#define CONFIGURATION_BUTTON_P1_MASK 0x06",
+                "#define CONFIGURATION_BUTTON_P3_MASK 0x00",
+                "#define CONFIGURATION_BUTTON_P1_ACTIVE_LOW 0x02",
+                "#define CONFIGURATION_BUTTON_P3_ACTIVE_LOW 0x00",
+                "#define CONFIGURATION_ENCODER_P1_MASK 0x00",
+                "#define CONFIGURATION_ENCODER_P3_MASK 0x00",
                 string.Empty,
                 "#define PIN_NEO P34",
                 "#define NEO_COUNT 1",
@@ -73,14 +92,14 @@ namespace Keypad.Flasher.Server.Tests
             var buttons = new List<ButtonBinding>
             {
                 new ButtonBinding(
-                    Pin: 1,
+                    Pin: 11,
                     ActiveLow: true,
                     LedIndex: -1,
                     BootloaderOnBoot: false,
                     BootloaderChordMember: false,
                     Function: new HidSequenceBinding("a", 0)),
                 new ButtonBinding(
-                    Pin: 2,
+                    Pin: 12,
                     ActiveLow: true,
                     LedIndex: 4,
                     BootloaderOnBoot: false,
@@ -95,7 +114,8 @@ namespace Keypad.Flasher.Server.Tests
                 NeoPixelPin: 34,
                 NeoPixelReversed: false,
                 LedConfig: DefaultLedConfig(buttons),
-                DebugOptions: DebugOptions.Default);
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
 
             var result = Generator.GenerateHeader(configuration);
 
@@ -108,7 +128,7 @@ namespace Keypad.Flasher.Server.Tests
             var buttons = new List<ButtonBinding>
             {
                 new ButtonBinding(
-                    Pin: 1,
+                    Pin: 11,
                     ActiveLow: true,
                     LedIndex: 0,
                     BootloaderOnBoot: false,
@@ -123,7 +143,8 @@ namespace Keypad.Flasher.Server.Tests
                 NeoPixelPin: 31,
                 NeoPixelReversed: false,
                 LedConfig: DefaultLedConfig(buttons),
-                DebugOptions: DebugOptions.Default);
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
 
             var result = Generator.GenerateHeader(configuration);
 
@@ -136,7 +157,7 @@ namespace Keypad.Flasher.Server.Tests
             var buttons = new List<ButtonBinding>
             {
                 new ButtonBinding(
-                    Pin: 1,
+                    Pin: 11,
                     ActiveLow: true,
                     LedIndex: 0,
                     BootloaderOnBoot: false,
@@ -151,7 +172,8 @@ namespace Keypad.Flasher.Server.Tests
                 NeoPixelPin: 31,
                 NeoPixelReversed: true,
                 LedConfig: DefaultLedConfig(buttons),
-                DebugOptions: DebugOptions.Default);
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
 
             var result = Generator.GenerateHeader(configuration);
 
@@ -164,7 +186,7 @@ namespace Keypad.Flasher.Server.Tests
             var buttons = new List<ButtonBinding>
             {
                 new ButtonBinding(
-                    Pin: 1,
+                    Pin: 11,
                     ActiveLow: true,
                     LedIndex: -1,
                     BootloaderOnBoot: false,
@@ -179,7 +201,8 @@ namespace Keypad.Flasher.Server.Tests
                 NeoPixelPin: 34,
                 NeoPixelReversed: false,
                 LedConfig: DefaultLedConfig(buttons),
-                DebugOptions: DebugOptions.Default);
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
 
             var result = Generator.GenerateHeader(configuration);
 
@@ -192,19 +215,173 @@ namespace Keypad.Flasher.Server.Tests
         [Test]
         public void GenerateHeader_WithDebugMode_EmitsFlag()
         {
-            var buttons = Array.Empty<ButtonBinding>();
+            var configuration = EmptyLayout(debugMode: true);
+
+            var result = Generator.GenerateHeader(configuration);
+
+            Assert.That(result, Does.Contain("#define CONFIGURATION_DEBUG_MODE 1"));
+        }
+
+        [Test]
+        public void GenerateHeader_WithCaptureRate_EmitsRate()
+        {
+            var configuration = EmptyLayout(debugOptions: new DebugOptions(CaptureRateHz: 10000), debugMode: true);
+
+            var result = Generator.GenerateHeader(configuration);
+
+            Assert.That(result, Does.Contain("#define DEBUG_CAPTURE_RATE_HZ 10000"));
+        }
+
+        [Test]
+        public void GenerateHeader_WithCaptureRateOutOfRange_Throws()
+        {
+            var configuration = EmptyLayout(debugOptions: new DebugOptions(CaptureRateHz: 50), debugMode: true);
+
+            Assert.Throws<ArgumentOutOfRangeException>(() => Generator.GenerateHeader(configuration));
+        }
+
+        [Test]
+        public void GenerateHeader_WithScanRate_EmitsRate()
+        {
+            var configuration = EmptyLayout(new FirmwareOptions(ScanRateHz: 1000));
+
+            var result = Generator.GenerateHeader(configuration);
+
+            Assert.That(result, Does.Contain("#define CONFIGURATION_SCAN_RATE_HZ 1000"));
+        }
+
+        [Test]
+        public void GenerateHeader_WithNKeyRollover_EnablesBitmapReport()
+        {
+            var configuration = EmptyLayout(new FirmwareOptions(NKeyRollover: true));
+
+            var result = Generator.GenerateHeader(configuration);
+
+            Assert.That(result, Does.Contain("#define CONFIGURATION_HID_NKRO 1"));
+        }
+
+        [Test]
+        public void GenerateHeader_WithLatencyProbe_EnablesInstrumentation()
+        {
+            var configuration = EmptyLayout(new FirmwareOptions(LatencyProbe: true));
+
+            var result = Generator.GenerateHeader(configuration);
+
+            Assert.That(result, Does.Contain("#define CONFIGURATION_LATENCY_PROBE 1"));
+        }
+
+        [Test]
+        public void GenerateHeader_WithLoopProfiler_EnablesTaskTimings()
+        {
+            var configuration = EmptyLayout(new FirmwareOptions(LoopProfiler: true));
+
+            var result = Generator.GenerateHeader(configuration);
+
+            Assert.That(result, Does.Contain("#define CONFIGURATION_LOOP_PROFILER 1"));
+        }
+
+        [Test]
+        public void GenerateHeader_WithoutLayerFeedback_TurnsItOff()
+        {
+            var configuration = EmptyLayout(new FirmwareOptions(LayerFeedback: false));
+
+            var result = Generator.GenerateHeader(configuration);
+
+            Assert.That(result, Does.Contain("#define CONFIGURATION_LAYER_FEEDBACK 0"));
+        }
+
+        [Test]
+        public void GenerateHeader_WithEncoderAcceleration_EmitsCurve()
+        {
+            var configuration = EmptyLayout(new FirmwareOptions(EncoderAccelerationMs: 60, EncoderAccelerationMax: 4));
+
+            var result = Generator.GenerateHeader(configuration);
+
+            Assert.That(result, Does.Contain("#define CONFIGURATION_ENCODER_ACCELERATION_MS 60"));
+            Assert.That(result, Does.Contain("#define CONFIGURATION_ENCODER_ACCELERATION_MAX 4"));
+        }
+
+        [Test]
+        public void GenerateHeader_WithScanRateOutOfRange_Throws()
+        {
+            var configuration = EmptyLayout(new FirmwareOptions(ScanRateHz: 20000));
+
+            Assert.Throws<ArgumentOutOfRangeException>(() => Generator.GenerateHeader(configuration));
+        }
+
+        [Test]
+        public void GenerateHeader_WithPortPins_EmitsPortMasks()
+        {
+            var buttons = new List<ButtonBinding>
+            {
+                new ButtonBinding(
+                    Pin: 11,
+                    ActiveLow: true,
+                    LedIndex: -1,
+                    BootloaderOnBoot: false,
+                    BootloaderChordMember: false,
+                    Function: new HidSequenceBinding("a", 0)),
+                new ButtonBinding(
+                    Pin: 17,
+                    ActiveLow: false,
+                    LedIndex: -1,
+                    BootloaderOnBoot: false,
+                    BootloaderChordMember: false,
+                    Function: new HidSequenceBinding("b", 0)),
+                new ButtonBinding(
+                    Pin: 33,
+                    ActiveLow: true,
+                    LedIndex: -1,
+                    BootloaderOnBoot: false,
+                    BootloaderChordMember: false,
+                    Function: new HidSequenceBinding("c", 0))
+            };
+
+            var encoders = new List<EncoderBinding>
+            {
+                new EncoderBinding(31, 30, HidSequenceBinding.FromFunction("hid_consumer_volume_up"), HidSequenceBinding.FromFunction("hid_consumer_volume_down"))
+            };
+
             var configuration = new ConfigurationDefinition(
                 buttons,
-                Array.Empty<EncoderBinding>(),
-                DebugMode: true,
+                encoders,
+                DebugMode: false,
                 NeoPixelPin: 34,
                 NeoPixelReversed: false,
                 LedConfig: DefaultLedConfig(buttons),
-                DebugOptions: DebugOptions.Default);
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
 
             var result = Generator.GenerateHeader(configuration);
 
-            Assert.That(result, Does.Contain("#define CONFIGURATION_DEBUG_MODE 1"));
+            Assert.That(result, Does.Contain("#define CONFIGURATION_BUTTON_P1_MASK 0x82"));
+            Assert.That(result, Does.Contain("#define CONFIGURATION_BUTTON_P3_MASK 0x08"));
+            Assert.That(result, Does.Contain("#define CONFIGURATION_BUTTON_P1_ACTIVE_LOW 0x02"));
+            Assert.That(result, Does.Contain("#define CONFIGURATION_BUTTON_P3_ACTIVE_LOW 0x08"));
+            Assert.That(result, Does.Contain("#define CONFIGURATION_ENCODER_P1_MASK 0x00"));
+            Assert.That(result, Does.Contain("#define CONFIGURATION_ENCODER_P3_MASK 0x03"));
+        }
+
+        [Test]
+        public void GenerateHeader_WithPinOffThePorts_Throws()
+        {
+            var buttons = Array.Empty<ButtonBinding>();
+            var encoders = new List<EncoderBinding>
+            {
+                new EncoderBinding(31, 22, HidSequenceBinding.FromFunction("hid_consumer_volume_up"), HidSequenceBinding.FromFunction("hid_consumer_volume_down"))
+            };
+            var configuration = new ConfigurationDefinition(
+                buttons,
+                encoders,
+                DebugMode: false,
+                NeoPixelPin: 34,
+                NeoPixelReversed: false,
+                LedConfig: DefaultLedConfig(buttons),
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
+
+            var ex = Assert.Throws<ArgumentOutOfRangeException>(() => Generator.GenerateHeader(configuration));
+            Assert.That(ex!.Message, Does.Contain("Pin 22"));
         }
 
         [Test]
@@ -233,12 +410,18 @@ namespace Keypad.Flasher.Server.Tests
                 NeoPixelPin: 34,
                 NeoPixelReversed: false,
                 LedConfig: DefaultLedConfig(buttons),
-                DebugOptions: DebugOptions.Default);
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
 
             var result = Generator.GenerateSource(configuration);
 
-            Assert.That(result, Does.Contain(".type = HID_BINDING_NULL"));
-            Assert.That(result, Does.Contain(".function.functionPointer = 0"));
+            Assert.That(result, Does.Contain("    5, 1, 0, 0, 0,"));
+            Assert.That(result, Does.Contain("    10, 11,"));
+            Assert.That(result, Does.Contain(Lines(
+                "    CONFIGURATION_BLOB_U16(0), CONFIGURATION_BLOB_U16(0),",
+                "    CONFIGURATION_BLOB_U16(0), CONFIGURATION_BLOB_U16(0),",
+                "    CONFIGURATION_BLOB_U16(0), CONFIGURATION_BLOB_U16(0),") + "    // lighting"));
+            Assert.That(result, Does.Not.Contain("HID_OP_"));
         }
 
         [Test]
@@ -283,7 +466,8 @@ namespace Keypad.Flasher.Server.Tests
                 NeoPixelPin: 34,
                 NeoPixelReversed: false,
                 LedConfig: DefaultLedConfig(buttons),
-                DebugOptions: DebugOptions.Default);
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
 
             var expected = ReadExpected("generate_source_4_buttons.c");
 
@@ -320,7 +504,8 @@ namespace Keypad.Flasher.Server.Tests
                 NeoPixelPin: -1,
                 NeoPixelReversed: false,
                 LedConfig: DefaultLedConfig(buttons),
-                DebugOptions: DebugOptions.Default);
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
 
             var expected = ReadExpected("generate_source_2_buttons.c");
 
@@ -413,7 +598,8 @@ namespace Keypad.Flasher.Server.Tests
                 NeoPixelPin: -1,
                 NeoPixelReversed: false,
                 LedConfig: DefaultLedConfig(buttons),
-                DebugOptions: DebugOptions.Default);
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
 
             var expected = ReadExpected("generate_source_10_buttons.c");
 
@@ -473,7 +659,8 @@ namespace Keypad.Flasher.Server.Tests
                 NeoPixelPin: 34,
                 NeoPixelReversed: false,
                 LedConfig: DefaultLedConfig(buttons),
-                DebugOptions: DebugOptions.Default);
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
 
             var expected = ReadExpected("generate_source_3_buttons_1_encoder.c");
 
@@ -482,6 +669,380 @@ namespace Keypad.Flasher.Server.Tests
             Assert.That(result, Is.EqualTo(expected));
         }
 
+        [Test]
+        public void GenerateSource_WithGammaCorrection_FoldsBrightnessIntoTable()
+        {
+            var buttons = new List<ButtonBinding>
+            {
+                new ButtonBinding(
+                    Pin: 11,
+                    ActiveLow: true,
+                    LedIndex: 0,
+                    BootloaderOnBoot: false,
+                    BootloaderChordMember: false,
+                    Function: new HidSequenceBinding("a", 0))
+            };
+
+            var configuration = new ConfigurationDefinition(
+                buttons,
+                Array.Empty<EncoderBinding>(),
+                DebugMode: false,
+                NeoPixelPin: 34,
+                NeoPixelReversed: false,
+                LedConfig: DefaultLedConfig(buttons) with { BrightnessPercent = 50, GammaCorrection = true },
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
+
+            var result = Generator.GenerateSource(configuration);
+
+            const string marker = "// led brightness table";
+            var start = result.IndexOf(marker, StringComparison.Ordinal) + marker.Length;
+            var end = result.IndexOf("//", start, StringComparison.Ordinal);
+            var table = result[start..end]
+                .Split(',', StringSplitOptions.RemoveEmptyEntries | StringSplitOptions.TrimEntries)
+                .Select(int.Parse)
+                .ToArray();
+
+            Assert.That(table.Length, Is.EqualTo(256));
+            Assert.That(table[0], Is.EqualTo(0));
+            Assert.That(table[128], Is.EqualTo(28));
+            Assert.That(table[255], Is.EqualTo(127));
+        }
+
+        [Test]
+        public void GenerateSource_WithTextStep_EncodesCharactersInline()
+        {
+            var buttons = new List<ButtonBinding>
+            {
+                new ButtonBinding(
+                    Pin: 11,
+                    ActiveLow: true,
+                    LedIndex: 0,
+                    BootloaderOnBoot: false,
+                    BootloaderChordMember: false,
+                    Function: new HidSequenceBinding(new[] { HidStep.TypeText("enter", modifiers: 2, gapMs: 5) }))
+            };
+
+            var configuration = new ConfigurationDefinition(
+                buttons,
+                Array.Empty<EncoderBinding>(),
+                DebugMode: false,
+                NeoPixelPin: 34,
+                NeoPixelReversed: false,
+                LedConfig: DefaultLedConfig(buttons),
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
+
+            var result = Generator.GenerateSource(configuration);
+
+            Assert.That(result, Does.Contain("HID_OP_TEXT | 2, 5, 5, 'e', 'n', 't', 'e', 'r'"));
+            Assert.That(result, Does.Contain(Lines(
+                "    // layer 0: macro offset, length per button, then per encoder clockwise, counter-clockwise",
+                "    CONFIGURATION_BLOB_U16(0), CONFIGURATION_BLOB_U16(8),")));
+        }
+
+        [Test]
+        public void GenerateSource_WithNonAsciiText_Throws()
+        {
+            var buttons = new List<ButtonBinding>
+            {
+                new ButtonBinding(
+                    Pin: 11,
+                    ActiveLow: true,
+                    LedIndex: 0,
+                    BootloaderOnBoot: false,
+                    BootloaderChordMember: false,
+                    Function: new HidSequenceBinding(new[] { HidStep.TypeText("café") }))
+            };
+
+            var configuration = new ConfigurationDefinition(
+                buttons,
+                Array.Empty<EncoderBinding>(),
+                DebugMode: false,
+                NeoPixelPin: 34,
+                NeoPixelReversed: false,
+                LedConfig: DefaultLedConfig(buttons),
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
+
+            Assert.Throws<InvalidOperationException>(() => Generator.GenerateSource(configuration));
+        }
+
+        [Test]
+        public void GenerateBlob_WritesHeaderWithPayloadChecksum()
+        {
+            var buttons = new List<ButtonBinding>
+            {
+                new ButtonBinding(
+                    Pin: 11,
+                    ActiveLow: true,
+                    LedIndex: -1,
+                    BootloaderOnBoot: true,
+                    BootloaderChordMember: false,
+                    Function: HidSequenceBinding.FromFunction("hid_consumer_mute"))
+            };
+
+            var configuration = new ConfigurationDefinition(
+                buttons,
+                Array.Empty<EncoderBinding>(),
+                DebugMode: false,
+                NeoPixelPin: 34,
+                NeoPixelReversed: false,
+                LedConfig: DefaultLedConfig(buttons),
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
+
+            var blob = Generator.GenerateBlob(configuration);
+
+            var payloadLength = blob[8] | (blob[9] << 8);
+            var checksum = blob[10] | (blob[11] << 8);
+            var payload = blob.Skip(12).ToArray();
+            Assert.That(blob.Take(8), Is.EqualTo(new byte[] { (byte)'K', (byte)'P', 2, 1, 0, 0, 1, 3 }));
+            Assert.That(payloadLength, Is.EqualTo(payload.Length));
+            Assert.That(checksum, Is.EqualTo(payload.Sum(b => b) & 0xFFFF));
+            // button, its base layer span, lighting settings, then the single function step
+            Assert.That(payload, Is.EqualTo(new byte[] { 11, 1, 0xFF, 1, 0, 0, 0, 4, 0, 0, 0, 0, 0, 0x30, 2, 1, 0 }));
+        }
+
+        [Test]
+        public void GenerateSource_WithMacrosBeyondBlobCapacity_Throws()
+        {
+            var buttons = new List<ButtonBinding>
+            {
+                new ButtonBinding(
+                    Pin: 11,
+                    ActiveLow: true,
+                    LedIndex: -1,
+                    BootloaderOnBoot: false,
+                    BootloaderChordMember: false,
+                    Function: new HidSequenceBinding(new string('a', 600), 0))
+            };
+
+            var configuration = new ConfigurationDefinition(
+                buttons,
+                Array.Empty<EncoderBinding>(),
+                DebugMode: false,
+                NeoPixelPin: 34,
+                NeoPixelReversed: false,
+                LedConfig: DefaultLedConfig(buttons),
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
+
+            Assert.Throws<InvalidOperationException>(() => Generator.GenerateSource(configuration));
+        }
+
+        [Test]
+        public void MeasureBlob_MatchesGeneratedBlobAndReportsOverflow()
+        {
+            var fits = new List<ButtonBinding>
+            {
+                new ButtonBinding(
+                    Pin: 11,
+                    ActiveLow: true,
+                    LedIndex: 0,
+                    BootloaderOnBoot: false,
+                    BootloaderChordMember: false,
+                    Function: new HidSequenceBinding("hello", 0))
+            };
+            var overflows = new List<ButtonBinding>
+            {
+                fits[0] with { LedIndex = -1, Function = new HidSequenceBinding(new string('a', 600), 0) }
+            };
+
+            var small = new ConfigurationDefinition(
+                fits,
+                Array.Empty<EncoderBinding>(),
+                DebugMode: false,
+                NeoPixelPin: 34,
+                NeoPixelReversed: false,
+                LedConfig: DefaultLedConfig(fits),
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
+            var large = small with { Buttons = overflows, LedConfig = DefaultLedConfig(overflows) };
+
+            Assert.That(Generator.MeasureBlob(small), Is.EqualTo(Generator.GenerateBlob(small).Length));
+            Assert.That(Generator.MeasureBlob(large), Is.GreaterThan(1024));
+        }
+
+        [Test]
+        public void GenerateBlob_WithRepeatedMacroBytes_PointsIntoExistingCode()
+        {
+            var buttons = new List<ButtonBinding>
+            {
+                new ButtonBinding(Pin: 11, ActiveLow: true, LedIndex: -1, BootloaderOnBoot: false, BootloaderChordMember: false, Function: new HidSequenceBinding("abc", 0)),
+                new ButtonBinding(Pin: 14, ActiveLow: true, LedIndex: -1, BootloaderOnBoot: false, BootloaderChordMember: false, Function: new HidSequenceBinding("abc", 0)),
+                new ButtonBinding(Pin: 15, ActiveLow: true, LedIndex: -1, BootloaderOnBoot: false, BootloaderChordMember: false, Function: new HidSequenceBinding("bc", 0))
+            };
+
+            var configuration = new ConfigurationDefinition(
+                buttons,
+                Array.Empty<EncoderBinding>(),
+                DebugMode: false,
+                NeoPixelPin: -1,
+                NeoPixelReversed: false,
+                LedConfig: DefaultLedConfig(buttons),
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
+
+            var blob = Generator.GenerateBlob(configuration);
+
+            // three 5-byte button rows, then one span per button; only the first macro is stored
+            var spans = blob.Skip(12 + 15).Take(3 * 4).ToArray();
+            Assert.That(spans, Is.EqualTo(new byte[] { 0, 0, 6, 0, 0, 0, 6, 0, 2, 0, 4, 0 }));
+            Assert.That(blob.Skip(12 + 15 + 12 + 4).ToArray(), Is.EqualTo(new byte[] { 0x70, (byte)'a', 0x70, (byte)'b', 0x70, (byte)'c' }));
+            Assert.That(Generator.GenerateSource(configuration), Does.Contain("// macro: button 2 reuses 4 bytes at 2"));
+        }
+
+        [Test]
+        public void GenerateSource_WithNonDefaultKeyTiming_KeepsFullKeyStep()
+        {
+            var buttons = new List<ButtonBinding>
+            {
+                new ButtonBinding(Pin: 11, ActiveLow: true, LedIndex: -1, BootloaderOnBoot: false, BootloaderChordMember: false,
+                    Function: new HidSequenceBinding(new[] { HidStep.Key((byte)'a'), HidStep.Key((byte)'b', holdMs: 30) }))
+            };
+
+            var configuration = new ConfigurationDefinition(
+                buttons,
+                Array.Empty<EncoderBinding>(),
+                DebugMode: false,
+                NeoPixelPin: -1,
+                NeoPixelReversed: false,
+                LedConfig: DefaultLedConfig(buttons),
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
+
+            var result = Generator.GenerateSource(configuration);
+
+            Assert.That(result, Does.Contain("HID_OP_TAP, 'a',"));
+            Assert.That(result, Does.Contain("HID_OP_KEY, 'b', 30, 10"));
+        }
+
+        [Test]
+        public void GenerateBlob_WithLayers_WritesSpanPerLayerAndFallsThroughToBase()
+        {
+            var baseBinding = new HidSequenceBinding(new[] { HidStep.Key((byte)'a'), HidStep.SetLayer(1) });
+            var layerBinding = new HidSequenceBinding(new[] { HidStep.Key((byte)'b'), HidStep.SetLayer(0) });
+            var buttons = new List<ButtonBinding>
+            {
+                new ButtonBinding(
+                    Pin: 11,
+                    ActiveLow: true,
+                    LedIndex: -1,
+                    BootloaderOnBoot: false,
+                    BootloaderChordMember: false,
+                    Function: baseBinding,
+                    LayerFunctions: new HidBinding?[] { layerBinding })
+            };
+
+            var encoders = new List<EncoderBinding>
+            {
+                new EncoderBinding(31, 30, HidSequenceBinding.FromFunction("hid_consumer_volume_up"), HidSequenceBinding.FromFunction("hid_consumer_volume_down"))
+            };
+
+            var configuration = new ConfigurationDefinition(
+                buttons,
+                encoders,
+                DebugMode: false,
+                NeoPixelPin: 34,
+                NeoPixelReversed: false,
+                LedConfig: DefaultLedConfig(buttons),
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default,
+                LayerCount: 2);
+
+            var blob = Generator.GenerateBlob(configuration);
+
+            Assert.That(blob[6], Is.EqualTo((byte)2));
+            // after 5 button bytes and 2 encoder bytes: base layer spans, then layer 1 where the encoder keeps its base bindings
+            var spans = blob.Skip(12 + 7).Take(2 * 3 * 4).ToArray();
+            Assert.That(spans, Is.EqualTo(new byte[]
+            {
+                0, 0, 4, 0, 4, 0, 4, 0, 8, 0, 4, 0,
+                12, 0, 4, 0, 4, 0, 4, 0, 8, 0, 4, 0
+            }));
+            Assert.That(Generator.GenerateSource(configuration), Does.Contain("HID_OP_LAYER | 1, 0,"));
+        }
+
+        [Test]
+        public void GenerateSource_WithLayerStepBeyondLayerCount_Throws()
+        {
+            var buttons = new List<ButtonBinding>
+            {
+                new ButtonBinding(
+                    Pin: 11,
+                    ActiveLow: true,
+                    LedIndex: -1,
+                    BootloaderOnBoot: false,
+                    BootloaderChordMember: false,
+                    Function: new HidSequenceBinding(new[] { HidStep.SetLayer(1) }))
+            };
+
+            var configuration = new ConfigurationDefinition(
+                buttons,
+                Array.Empty<EncoderBinding>(),
+                DebugMode: false,
+                NeoPixelPin: 34,
+                NeoPixelReversed: false,
+                LedConfig: DefaultLedConfig(buttons),
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: FirmwareOptions.Default);
+
+            Assert.Throws<InvalidOperationException>(() => Generator.GenerateSource(configuration));
+        }
+
+        [Test]
+        public void GenerateFixedSource_WithDifferentBindings_IsUnchanged()
+        {
+            ConfigurationDefinition WithBinding(HidBinding function)
+            {
+                var buttons = new List<ButtonBinding>
+                {
+                    new ButtonBinding(
+                        Pin: 11,
+                        ActiveLow: true,
+                        LedIndex: 0,
+                        BootloaderOnBoot: false,
+                        BootloaderChordMember: false,
+                        Function: function)
+                };
+
+                return new ConfigurationDefinition(
+                    buttons,
+                    Array.Empty<EncoderBinding>(),
+                    DebugMode: false,
+                    NeoPixelPin: 34,
+                    NeoPixelReversed: false,
+                    LedConfig: DefaultLedConfig(buttons),
+                    DebugOptions: DebugOptions.Default,
+                    FirmwareOptions: FirmwareOptions.Default);
+            }
+
+            var first = WithBinding(new HidSequenceBinding("a", 0));
+            var second = WithBinding(HidSequenceBinding.FromFunction("hid_consumer_mute"));
+
+            var fixedSource = Generator.GenerateFixedSource(first);
+            Assert.That(fixedSource, Does.Not.Contain("configuration_blob"));
+            Assert.That(Generator.GenerateFixedSource(second), Is.EqualTo(fixedSource));
+            Assert.That(Generator.GenerateHeader(second), Is.EqualTo(Generator.GenerateHeader(first)));
+            Assert.That(Generator.GenerateBlob(second), Is.Not.EqualTo(Generator.GenerateBlob(first)));
+        }
+
+        // No buttons or encoders, so only the options decide what the header says about them
+        private static ConfigurationDefinition EmptyLayout(FirmwareOptions? firmwareOptions = null, DebugOptions? debugOptions = null, bool debugMode = false)
+        {
+            var buttons = Array.Empty<ButtonBinding>();
+            return new ConfigurationDefinition(
+                buttons,
+                Array.Empty<EncoderBinding>(),
+                DebugMode: debugMode,
+                NeoPixelPin: 34,
+                NeoPixelReversed: false,
+                LedConfig: DefaultLedConfig(buttons),
+                DebugOptions: debugOptions ?? DebugOptions.Default,
+                FirmwareOptions: firmwareOptions ?? FirmwareOptions.Default);
+        }
+
         private static LedConfiguration DefaultLedConfig(IReadOnlyList<ButtonBinding> buttons)
         {
             var maxLedIndex = -1;
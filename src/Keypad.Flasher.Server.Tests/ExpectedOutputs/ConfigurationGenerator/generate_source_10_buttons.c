@@ -1,285 +1,62 @@
 #include "configuration.h"
 #include "src/userUsbHidKeyboardMouse/USBHIDKeyboardMouse.h"
 
-const button_binding_t button_bindings[] = {
-    {
-        .pin = 32,
-        .active_low = true,
-        .led_index = -1,
-        .bootloader_on_boot = true,
-        .bootloader_chord_member = true,
-        .function = {
-            .type = HID_BINDING_SEQUENCE,
-            .function.sequence = {
-                .steps = {
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = '0',
-                        .modifiers = 0,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    }
-                },
-                .length = 1
-            }
-        }
-    },
-    {
-        .pin = 14,
-        .active_low = true,
-        .led_index = -1,
-        .bootloader_on_boot = false,
-        .bootloader_chord_member = true,
-        .function = {
-            .type = HID_BINDING_SEQUENCE,
-            .function.sequence = {
-                .steps = {
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = '1',
-                        .modifiers = 0,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    }
-                },
-                .length = 1
-            }
-        }
-    },
-    {
-        .pin = 15,
-        .active_low = true,
-        .led_index = -1,
-        .bootloader_on_boot = false,
-        .bootloader_chord_member = true,
-        .function = {
-            .type = HID_BINDING_SEQUENCE,
-            .function.sequence = {
-                .steps = {
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = '2',
-                        .modifiers = 0,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    }
-                },
-                .length = 1
-            }
-        }
-    },
-    {
-        .pin = 16,
-        .active_low = true,
-        .led_index = -1,
-        .bootloader_on_boot = false,
-        .bootloader_chord_member = true,
-        .function = {
-            .type = HID_BINDING_SEQUENCE,
-            .function.sequence = {
-                .steps = {
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = '3',
-                        .modifiers = 0,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    }
-                },
-                .length = 1
-            }
-        }
-    },
-    {
-        .pin = 17,
-        .active_low = true,
-        .led_index = -1,
-        .bootloader_on_boot = false,
-        .bootloader_chord_member = true,
-        .function = {
-            .type = HID_BINDING_SEQUENCE,
-            .function.sequence = {
-                .steps = {
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = '4',
-                        .modifiers = 0,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    }
-                },
-                .length = 1
-            }
-        }
-    },
-    {
-        .pin = 31,
-        .active_low = true,
-        .led_index = -1,
-        .bootloader_on_boot = false,
-        .bootloader_chord_member = true,
-        .function = {
-            .type = HID_BINDING_SEQUENCE,
-            .function.sequence = {
-                .steps = {
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = '5',
-                        .modifiers = 0,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    }
-                },
-                .length = 1
-            }
-        }
-    },
-    {
-        .pin = 30,
-        .active_low = true,
-        .led_index = -1,
-        .bootloader_on_boot = false,
-        .bootloader_chord_member = true,
-        .function = {
-            .type = HID_BINDING_SEQUENCE,
-            .function.sequence = {
-                .steps = {
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = '6',
-                        .modifiers = 0,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    }
-                },
-                .length = 1
-            }
-        }
-    },
-    {
-        .pin = 11,
-        .active_low = true,
-        .led_index = -1,
-        .bootloader_on_boot = false,
-        .bootloader_chord_member = true,
-        .function = {
-            .type = HID_BINDING_SEQUENCE,
-            .function.sequence = {
-                .steps = {
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = '7',
-                        .modifiers = 0,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    }
-                },
-                .length = 1
-            }
-        }
-    },
-    {
-        .pin = 33,
-        .active_low = true,
-        .led_index = -1,
-        .bootloader_on_boot = false,
-        .bootloader_chord_member = true,
-        .function = {
-            .type = HID_BINDING_SEQUENCE,
-            .function.sequence = {
-                .steps = {
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = '8',
-                        .modifiers = 0,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    }
-                },
-                .length = 1
-            }
-        }
-    },
-    {
-        .pin = 34,
-        .active_low = true,
-        .led_index = -1,
-        .bootloader_on_boot = false,
-        .bootloader_chord_member = true,
-        .function = {
-            .type = HID_BINDING_SEQUENCE,
-            .function.sequence = {
-                .steps = {
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = '9',
-                        .modifiers = 0,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    }
-                },
-                .length = 1
-            }
-        }
-    }
+const hid_function_t hid_function_table[] = {
+    hid_consumer_volume_up,
+    hid_consumer_volume_down,
+    hid_consumer_mute,
+    hid_consumer_media_play_pause,
+    hid_consumer_media_next,
+    hid_consumer_media_previous,
+    hid_consumer_media_stop
 };
+const uint8_t hid_function_count = 7;
 
-const size_t button_binding_count = sizeof(button_bindings) / sizeof(button_bindings[0]);
-
-const encoder_binding_t encoder_bindings[] = {
-    {0}
-};
-
-const size_t encoder_binding_count = 0;
-
-const led_configuration_t led_configuration = {
-    .passive_modes = 0,
-    .passive_colors = 0,
-    .active_modes = 0,
-    .active_colors = 0,
-    .count = 0,
-    .brightness_percent = 0,
-    .rainbow_step_ms = 0,
-    .breathing_min_percent = 0,
-    .breathing_step_ms = 0
+__code const uint8_t __at(CONFIGURATION_BLOB_ADDRESS) configuration_blob[CONFIGURATION_BLOB_CAPACITY] = {
+    // header: magic, version, buttons, encoders, leds, layers, functions, payload length, checksum
+    'K', 'P', 2, 10, 0, 0, 1, 0, CONFIGURATION_BLOB_U16(114), CONFIGURATION_BLOB_U16(4559),
+    // buttons: pin, active_low, led_index, bootloader_on_boot, bootloader_chord_member
+    32, 1, 0xFF, 1, 1,
+    14, 1, 0xFF, 0, 1,
+    15, 1, 0xFF, 0, 1,
+    16, 1, 0xFF, 0, 1,
+    17, 1, 0xFF, 0, 1,
+    31, 1, 0xFF, 0, 1,
+    30, 1, 0xFF, 0, 1,
+    11, 1, 0xFF, 0, 1,
+    33, 1, 0xFF, 0, 1,
+    34, 1, 0xFF, 0, 1,
+    // layer 0: macro offset, length per button, then per encoder clockwise, counter-clockwise
+    CONFIGURATION_BLOB_U16(0), CONFIGURATION_BLOB_U16(2),
+    CONFIGURATION_BLOB_U16(2), CONFIGURATION_BLOB_U16(2),
+    CONFIGURATION_BLOB_U16(4), CONFIGURATION_BLOB_U16(2),
+    CONFIGURATION_BLOB_U16(6), CONFIGURATION_BLOB_U16(2),
+    CONFIGURATION_BLOB_U16(8), CONFIGURATION_BLOB_U16(2),
+    CONFIGURATION_BLOB_U16(10), CONFIGURATION_BLOB_U16(2),
+    CONFIGURATION_BLOB_U16(12), CONFIGURATION_BLOB_U16(2),
+    CONFIGURATION_BLOB_U16(14), CONFIGURATION_BLOB_U16(2),
+    CONFIGURATION_BLOB_U16(16), CONFIGURATION_BLOB_U16(2),
+    CONFIGURATION_BLOB_U16(18), CONFIGURATION_BLOB_U16(2),
+    // lighting: brightness_percent, rainbow_step_ms, breathing_min_percent, breathing_step_ms
+    0, 0, 0, 0,
+    // macro: button 0
+    HID_OP_TAP, '0',
+    // macro: button 1
+    HID_OP_TAP, '1',
+    // macro: button 2
+    HID_OP_TAP, '2',
+    // macro: button 3
+    HID_OP_TAP, '3',
+    // macro: button 4
+    HID_OP_TAP, '4',
+    // macro: button 5
+    HID_OP_TAP, '5',
+    // macro: button 6
+    HID_OP_TAP, '6',
+    // macro: button 7
+    HID_OP_TAP, '7',
+    // macro: button 8
+    HID_OP_TAP, '8',
+    // macro: button 9
+    HID_OP_TAP, '9'
 };
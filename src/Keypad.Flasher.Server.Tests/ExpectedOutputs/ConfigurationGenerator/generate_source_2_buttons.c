@@ -1,77 +1,30 @@
 #include "configuration.h"
 #include "src/userUsbHidKeyboardMouse/USBHIDKeyboardMouse.h"
 
-const button_binding_t button_bindings[] = {
-    {
-        .pin = 32,
-        .active_low = true,
-        .led_index = -1,
-        .bootloader_on_boot = true,
-        .bootloader_chord_member = false,
-        .function = {
-            .type = HID_BINDING_SEQUENCE,
-            .function.sequence = {
-                .steps = {
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = '1',
-                        .modifiers = 0,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    }
-                },
-                .length = 1
-            }
-        }
-    },
-    {
-        .pin = 14,
-        .active_low = true,
-        .led_index = -1,
-        .bootloader_on_boot = false,
-        .bootloader_chord_member = false,
-        .function = {
-            .type = HID_BINDING_SEQUENCE,
-            .function.sequence = {
-                .steps = {
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = '2',
-                        .modifiers = 0,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    }
-                },
-                .length = 1
-            }
-        }
-    }
+const hid_function_t hid_function_table[] = {
+    hid_consumer_volume_up,
+    hid_consumer_volume_down,
+    hid_consumer_mute,
+    hid_consumer_media_play_pause,
+    hid_consumer_media_next,
+    hid_consumer_media_previous,
+    hid_consumer_media_stop
 };
+const uint8_t hid_function_count = 7;
 
-const size_t button_binding_count = sizeof(button_bindings) / sizeof(button_bindings[0]);
-
-const encoder_binding_t encoder_bindings[] = {
-    {0}
-};
-
-const size_t encoder_binding_count = 0;
-
-const led_configuration_t led_configuration = {
-    .passive_modes = 0,
-    .passive_colors = 0,
-    .active_modes = 0,
-    .active_colors = 0,
-    .count = 0,
-    .brightness_percent = 0,
-    .rainbow_step_ms = 0,
-    .breathing_min_percent = 0,
-    .breathing_step_ms = 0
+__code const uint8_t __at(CONFIGURATION_BLOB_ADDRESS) configuration_blob[CONFIGURATION_BLOB_CAPACITY] = {
+    // header: magic, version, buttons, encoders, leds, layers, functions, payload length, checksum
+    'K', 'P', 2, 2, 0, 0, 1, 0, CONFIGURATION_BLOB_U16(26), CONFIGURATION_BLOB_U16(888),
+    // buttons: pin, active_low, led_index, bootloader_on_boot, bootloader_chord_member
+    32, 1, 0xFF, 1, 0,
+    14, 1, 0xFF, 0, 0,
+    // layer 0: macro offset, length per button, then per encoder clockwise, counter-clockwise
+    CONFIGURATION_BLOB_U16(0), CONFIGURATION_BLOB_U16(2),
+    CONFIGURATION_BLOB_U16(2), CONFIGURATION_BLOB_U16(2),
+    // lighting: brightness_percent, rainbow_step_ms, breathing_min_percent, breathing_step_ms
+    0, 0, 0, 0,
+    // macro: button 0
+    HID_OP_TAP, '1',
+    // macro: button 1
+    HID_OP_TAP, '2'
 };
@@ -1,234 +1,89 @@
 #include "configuration.h"
 #include "src/userUsbHidKeyboardMouse/USBHIDKeyboardMouse.h"
 
-const button_binding_t button_bindings[] = {
-    {
-        .pin = 33,
-        .active_low = true,
-        .led_index = -1,
-        .bootloader_on_boot = true,
-        .bootloader_chord_member = false,
-        .function = {
-            .type = HID_BINDING_SEQUENCE,
-            .function.sequence = {
-                .steps = {
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = 'e',
-                        .modifiers = 5,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    },
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = 'n',
-                        .modifiers = 5,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    },
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = 't',
-                        .modifiers = 5,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    },
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = 'e',
-                        .modifiers = 5,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    },
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = 'r',
-                        .modifiers = 5,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    }
-                },
-                .length = 5
-            }
-        }
-    },
-    {
-        .pin = 16,
-        .active_low = true,
-        .led_index = 2,
-        .bootloader_on_boot = false,
-        .bootloader_chord_member = true,
-        .function = {
-            .type = HID_BINDING_SEQUENCE,
-            .function.sequence = {
-                .steps = {
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = 'a',
-                        .modifiers = 0,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    }
-                },
-                .length = 1
-            }
-        }
-    },
-    {
-        .pin = 17,
-        .active_low = true,
-        .led_index = 1,
-        .bootloader_on_boot = false,
-        .bootloader_chord_member = true,
-        .function = {
-            .type = HID_BINDING_SEQUENCE,
-            .function.sequence = {
-                .steps = {
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = 'b',
-                        .modifiers = 0,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    }
-                },
-                .length = 1
-            }
-        }
-    },
-    {
-        .pin = 11,
-        .active_low = true,
-        .led_index = 0,
-        .bootloader_on_boot = false,
-        .bootloader_chord_member = true,
-        .function = {
-            .type = HID_BINDING_SEQUENCE,
-            .function.sequence = {
-                .steps = {
-                    {
-                        .kind = HID_STEP_KEY,
-                        .keycode = 'c',
-                        .modifiers = 0,
-                        .hold_ms = 10,
-                        .gap_ms = 10,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = 0
-                    }
-                },
-                .length = 1
-            }
-        }
-    }
+const hid_function_t hid_function_table[] = {
+    hid_consumer_volume_up,
+    hid_consumer_volume_down,
+    hid_consumer_mute,
+    hid_consumer_media_play_pause,
+    hid_consumer_media_next,
+    hid_consumer_media_previous,
+    hid_consumer_media_stop
 };
+const uint8_t hid_function_count = 7;
 
-const size_t button_binding_count = sizeof(button_bindings) / sizeof(button_bindings[0]);
-
-const encoder_binding_t encoder_bindings[] = {
-    {
-        .pin_a = 31,
-        .pin_b = 30,
-        .clockwise = {
-            .type = HID_BINDING_SEQUENCE,
-            .function.sequence = {
-                .steps = {
-                    {
-                        .kind = HID_STEP_FUNCTION,
-                        .keycode = 0,
-                        .modifiers = 0,
-                        .hold_ms = 0,
-                        .gap_ms = 0,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = hid_consumer_volume_up
-                    }
-                },
-                .length = 1
-            }
-        },
-        .counter_clockwise = {
-            .type = HID_BINDING_SEQUENCE,
-            .function.sequence = {
-                .steps = {
-                    {
-                        .kind = HID_STEP_FUNCTION,
-                        .keycode = 0,
-                        .modifiers = 0,
-                        .hold_ms = 0,
-                        .gap_ms = 0,
-                        .function_value = 1,
-                        .pointer_type = 0,
-                        .pointer_value = 0,
-                        .functionPointer = hid_consumer_volume_down
-                    }
-                },
-                .length = 1
-            }
-        }
-    }
+__code const uint8_t __at(CONFIGURATION_BLOB_ADDRESS) configuration_blob[CONFIGURATION_BLOB_CAPACITY] = {
+    // header: magic, version, buttons, encoders, leds, layers, functions, payload length, checksum
+    'K', 'P', 2, 4, 1, 3, 1, 2, CONFIGURATION_BLOB_U16(354), CONFIGURATION_BLOB_U16(38477),
+    // buttons: pin, active_low, led_index, bootloader_on_boot, bootloader_chord_member
+    33, 1, 0xFF, 1, 0,
+    16, 1, 2, 0, 1,
+    17, 1, 1, 0, 1,
+    11, 1, 0, 0, 1,
+    // encoders: pin_a, pin_b
+    31, 30,
+    // layer 0: macro offset, length per button, then per encoder clockwise, counter-clockwise
+    CONFIGURATION_BLOB_U16(0), CONFIGURATION_BLOB_U16(10),
+    CONFIGURATION_BLOB_U16(10), CONFIGURATION_BLOB_U16(2),
+    CONFIGURATION_BLOB_U16(12), CONFIGURATION_BLOB_U16(2),
+    CONFIGURATION_BLOB_U16(14), CONFIGURATION_BLOB_U16(2),
+    CONFIGURATION_BLOB_U16(16), CONFIGURATION_BLOB_U16(4),
+    CONFIGURATION_BLOB_U16(20), CONFIGURATION_BLOB_U16(4),
+    // lighting: brightness_percent, rainbow_step_ms, breathing_min_percent, breathing_step_ms
+    100, 20, 20, 20,
+    // led passive modes
+    LED_PASSIVE_RAINBOW, LED_PASSIVE_RAINBOW, LED_PASSIVE_RAINBOW,
+    // led passive colors
+    255, 0, 0,
+    255, 255, 0,
+    0, 255, 0,
+    // led active modes
+    LED_ACTIVE_SOLID, LED_ACTIVE_SOLID, LED_ACTIVE_SOLID,
+    // led active colors
+    255, 255, 255,
+    255, 255, 255,
+    255, 255, 255,
+    // led brightness table
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+    32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47,
+    48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63,
+    64, 65, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76, 77, 78, 79,
+    80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95,
+    96, 97, 98, 99, 100, 101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 111,
+    112, 113, 114, 115, 116, 117, 118, 119, 120, 121, 122, 123, 124, 125, 126, 127,
+    128, 129, 130, 131, 132, 133, 134, 135, 136, 137, 138, 139, 140, 141, 142, 143,
+    144, 145, 146, 147, 148, 149, 150, 151, 152, 153, 154, 155, 156, 157, 158, 159,
+    160, 161, 162, 163, 164, 165, 166, 167, 168, 169, 170, 171, 172, 173, 174, 175,
+    176, 177, 178, 179, 180, 181, 182, 183, 184, 185, 186, 187, 188, 189, 190, 191,
+    192, 193, 194, 195, 196, 197, 198, 199, 200, 201, 202, 203, 204, 205, 206, 207,
+    208, 209, 210, 211, 212, 213, 214, 215, 216, 217, 218, 219, 220, 221, 222, 223,
+    224, 225, 226, 227, 228, 229, 230, 231, 232, 233, 234, 235, 236, 237, 238, 239,
+    240, 241, 242, 243, 244, 245, 246, 247, 248, 249, 250, 251, 252, 253, 254, 255,
+    // macro: button 0
+    HID_OP_TAP | 5, 'e',
+    HID_OP_TAP | 5, 'n',
+    HID_OP_TAP | 5, 't',
+    HID_OP_TAP | 5, 'e',
+    HID_OP_TAP | 5, 'r',
+    // macro: button 1
+    HID_OP_TAP, 'a',
+    // macro: button 2
+    HID_OP_TAP, 'b',
+    // macro: button 3
+    HID_OP_TAP, 'c',
+    // macro: encoder 0 clockwise
+    HID_OP_FUNCTION, 0, 1, 0,
+    // macro: encoder 0 counter-clockwise
+    HID_OP_FUNCTION, 1, 1, 0
 };
 
-const size_t encoder_binding_count = sizeof(encoder_bindings) / sizeof(encoder_bindings[0]);
-
-static const led_passive_mode_t led_passive_modes[] = {
-    LED_PASSIVE_RAINBOW,
-    LED_PASSIVE_RAINBOW,
-    LED_PASSIVE_RAINBOW
-};
-static const led_rgb_t led_passive_colors[] = {
-    { .r = 255, .g = 0, .b = 0 },
-    { .r = 255, .g = 255, .b = 0 },
-    { .r = 0, .g = 255, .b = 0 }
-};
-static const led_active_mode_t led_active_modes[] = {
-    LED_ACTIVE_SOLID,
-    LED_ACTIVE_SOLID,
-    LED_ACTIVE_SOLID
-};
-static const led_rgb_t led_active_colors[] = {
-    { .r = 255, .g = 255, .b = 255 },
-    { .r = 255, .g = 255, .b = 255 },
-    { .r = 255, .g = 255, .b = 255 }
-};
-const led_configuration_t led_configuration = {
-    .passive_modes = led_passive_modes,
-    .passive_colors = led_passive_colors,
-    .active_modes = led_active_modes,
-    .active_colors = led_active_colors,
-    .count = 3,
-    .brightness_percent = 100,
-    .rainbow_step_ms = 20,
-    .breathing_min_percent = 20,
-    .breathing_step_ms = 20
+__code const uint8_t led_breathing_curve[101] = {
+    0, 2, 5, 7, 10, 12, 15, 17, 20, 22, 25, 28, 30, 33, 35, 38,
+    40, 43, 45, 48, 51, 53, 56, 58, 61, 63, 66, 68, 71, 73, 76, 79,
+    81, 84, 86, 89, 91, 94, 96, 99, 102, 104, 107, 109, 112, 114, 117, 119,
+    122, 124, 127, 130, 132, 135, 137, 140, 142, 145, 147, 150, 153, 155, 158, 160,
+    163, 165, 168, 170, 173, 175, 178, 181, 183, 186, 188, 191, 193, 196, 198, 201,
+    204, 206, 209, 211, 214, 216, 219, 221, 224, 226, 229, 232, 234, 237, 239, 242,
+    244, 247, 249, 252, 255
 };
@@ -0,0 +1,136 @@
+using Keypad.Flasher.Server.Services;
+using NUnit.Framework;
+
+namespace Keypad.Flasher.Server.Tests
+{
+    [TestFixture]
+    public class FirmwareCacheTests
+    {
+        [Test]
+        public void TryGet_AfterCapacityReached_EvictsLeastRecentlyUsed()
+        {
+            var cache = new FirmwareCache(2);
+            cache.Put("a", new byte[] { 1 });
+            cache.Put("b", new byte[] { 2 });
+            Assert.That(cache.TryGet("a", out _), Is.True);
+
+            cache.Put("c", new byte[] { 3 });
+
+            Assert.That(cache.TryGet("b", out _), Is.False);
+            Assert.That(cache.TryGet("a", out var a), Is.True);
+            Assert.That(a, Is.EqualTo(new byte[] { 1 }));
+            Assert.That(cache.Count, Is.EqualTo(2));
+        }
+
+        [Test]
+        public void Remove_DropsTheImageFromMemoryAndDisk()
+        {
+            var directory = Path.Combine(Path.GetTempPath(), Guid.NewGuid().ToString());
+            try
+            {
+                var cache = new FirmwareCache(2, directory);
+                cache.Put("a", new byte[] { 1 });
+
+                cache.Remove("a");
+
+                Assert.That(cache.TryGet("a", out _), Is.False);
+                Assert.That(new FirmwareCache(2, directory).TryGet("a", out _), Is.False);
+            }
+            finally
+            {
+                Directory.Delete(directory, true);
+            }
+        }
+
+        [Test]
+        public void TryGet_CountsHitsAndMisses()
+        {
+            var cache = new FirmwareCache(4);
+            cache.TryGet("a", out _);
+            cache.Put("a", new byte[] { 1 });
+            cache.TryGet("a", out _);
+            cache.TryGet("a", out _);
+
+            Assert.That(cache.Hits, Is.EqualTo(2L));
+            Assert.That(cache.Misses, Is.EqualTo(1L));
+        }
+
+        [Test]
+        public void TryPeek_LeavesHitsAndMissesAlone()
+        {
+            var cache = new FirmwareCache(4);
+            cache.Put("a", new byte[] { 1 });
+
+            Assert.That(cache.TryPeek("a", out var a), Is.True);
+            Assert.That(a, Is.EqualTo(new byte[] { 1 }));
+            Assert.That(cache.TryPeek("b", out _), Is.False);
+            Assert.That(cache.Hits, Is.EqualTo(0L));
+            Assert.That(cache.Misses, Is.EqualTo(0L));
+        }
+
+        [Test]
+        public void TryGet_WithDirectory_ReadsImagesWrittenByAnotherInstance()
+        {
+            var directory = Path.Combine(Path.GetTempPath(), Guid.NewGuid().ToString());
+            try
+            {
+                new FirmwareCache(1, directory).Put("a", new byte[] { 7, 8 });
+
+                var cache = new FirmwareCache(1, directory);
+
+                Assert.That(cache.TryGet("a", out var image), Is.True);
+                Assert.That(image, Is.EqualTo(new byte[] { 7, 8 }));
+                Assert.That(cache.Hits, Is.EqualTo(1L));
+            }
+            finally
+            {
+                Directory.Delete(directory, true);
+            }
+        }
+
+        [Test]
+        public void Put_WithDirectoryPastDiskCapacity_DropsLeastRecentlyUsedFiles()
+        {
+            var directory = Path.Combine(Path.GetTempPath(), Guid.NewGuid().ToString());
+            try
+            {
+                var cache = new FirmwareCache(4, directory, diskCapacity: 2);
+                cache.Put("a", new byte[] { 1 });
+                cache.Put("b", new byte[] { 2 });
+                File.SetLastWriteTimeUtc(Path.Combine(directory, "a.hex"), DateTime.UtcNow.AddMinutes(-2));
+                File.SetLastWriteTimeUtc(Path.Combine(directory, "b.hex"), DateTime.UtcNow.AddMinutes(-1));
+                Assert.That(cache.TryGet("a", out _), Is.True);
+
+                cache.Put("c", new byte[] { 3 });
+
+                Assert.That(Directory.GetFiles(directory, "*.hex").Select(Path.GetFileName).Order(), Is.EqualTo(new[] { "a.hex", "c.hex" }));
+            }
+            finally
+            {
+                Directory.Delete(directory, true);
+            }
+        }
+
+        [Test]
+        public void ComputeFirmwareHash_IgnoresGeneratedConfigurationFiles()
+        {
+            var directory = Path.Combine(Path.GetTempPath(), Guid.NewGuid().ToString());
+            try
+            {
+                Directory.CreateDirectory(directory);
+                File.WriteAllText(Path.Combine(directory, "main.c"), "int main;");
+                var before = FirmwareBuilder.ComputeFirmwareHash(directory);
+
+                File.WriteAllText(Path.Combine(directory, "configuration.c"), "generated");
+                Assert.That(FirmwareBuilder.ComputeFirmwareHash(directory), Is.EqualTo(before));
+
+                File.WriteAllText(Path.Combine(directory, "main.c"), "int main2;");
+                Assert.That(FirmwareBuilder.ComputeFirmwareHash(directory), Is.Not.EqualTo(before));
+            }
+            finally
+            {
+                Directory.Delete(directory, true);
+            }
+        }
+    }
+}
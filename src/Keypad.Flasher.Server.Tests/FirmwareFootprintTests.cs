@@ -0,0 +1,61 @@
+using Keypad.Flasher.Server.Services;
+using NUnit.Framework;
+
+namespace Keypad.Flasher.Server.Tests
+{
+    [TestFixture]
+    public class FirmwareFootprintTests
+    {
+        private const string MemoryMap =
+            "Internal RAM layout:\n" +
+            "      0 1 2 3 4 5 6 7 8 9 A B C D E F\n" +
+            "0x00:|0|0|0|0|0|0|0|0|a|a|a|a|a|a|a|a|\n" +
+            "0-3:Reg Banks, T:Bit regs, a-z:Data, B:Bits, Q:Overlay, I:iData, S:Stack, A:Absolute\n" +
+            "\n" +
+            "Stack starts at: 0x3c (sp set to 0x3b) with 196 bytes available.\n" +
+            "\n" +
+            "Other memory:\n" +
+            "   Name             Start    End      Size     Max     \n" +
+            "   ---------------- -------- -------- -------- --------\n" +
+            "   PAGED EXT. RAM                         0      256   \n" +
+            "   EXTERNAL RAM     0x0001   0x02b5      693      876   \n" +
+            "   ROM/EPROM/FLASH  0x0000   0x37ff    13641    14336   \n";
+
+        private const string Stdout =
+            "Sketch uses 13500 bytes (94%) of program storage space. Maximum is 14336 bytes.\n" +
+            "Global variables use 690 bytes (78%) of dynamic memory, leaving 186 bytes for local variables. Maximum is 876 bytes.\n";
+
+        [Test]
+        public void Parse_MemoryMap_ReadsAllSections()
+        {
+            var footprint = FirmwareFootprint.Parse(MemoryMap, Stdout);
+
+            Assert.That(footprint, Is.EqualTo(new FirmwareFootprint(
+                new MemoryUsage(13641, 14336),
+                new MemoryUsage(693, 876),
+                new MemoryUsage(0x3c, 256))));
+        }
+
+        [Test]
+        public void Parse_WithoutMemoryMap_FallsBackToCliSummary()
+        {
+            var footprint = FirmwareFootprint.Parse(null, Stdout);
+
+            Assert.That(footprint, Is.EqualTo(new FirmwareFootprint(new MemoryUsage(13500, 14336), new MemoryUsage(690, 876), null)));
+        }
+
+        [Test]
+        public void Parse_UnusedXdata_HasNoAddressColumns()
+        {
+            var footprint = FirmwareFootprint.Parse("   EXTERNAL RAM                          0      876   \n", null);
+
+            Assert.That(footprint?.Xdata, Is.EqualTo(new MemoryUsage(0, 876)));
+        }
+
+        [Test]
+        public void Parse_NothingRecognised_ReturnsNull()
+        {
+            Assert.That(FirmwareFootprint.Parse("", "Compiling sketch..."), Is.Null);
+        }
+    }
+}
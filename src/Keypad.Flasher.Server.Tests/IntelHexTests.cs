@@ -0,0 +1,95 @@
+using Keypad.Flasher.Server.Services;
+using NUnit.Framework;
+
+namespace Keypad.Flasher.Server.Tests
+{
+    [TestFixture]
+    public class IntelHexTests
+    {
+        private const string Image =
+            ":0400000001020304F2\n" +
+            ":0400040005060708DE\n" +
+            ":00000001FF\n";
+
+        [Test]
+        public void Patch_AcrossRecords_RewritesBytesAndChecksums()
+        {
+            var patched = IntelHex.Patch(Image, 0x0002, new byte[] { 0xAA, 0xBB, 0xCC });
+
+            Assert.That(patched, Is.EqualTo(
+                ":040000000102AABB94\n" +
+                ":04000400CC06070817\n" +
+                ":00000001FF\n"));
+            Assert.That(IntelHex.Read(patched, 0x0000, 8), Is.EqualTo(new byte[] { 1, 2, 0xAA, 0xBB, 0xCC, 6, 7, 8 }));
+        }
+
+        [Test]
+        public void Patch_WithExtendedLinearAddress_UsesUpperAddress()
+        {
+            const string image =
+                ":020000040001F9\n" +
+                ":020010001122BB\n" +
+                ":00000001FF\n";
+
+            var patched = IntelHex.Patch(image, 0x10011, new byte[] { 0x33 });
+
+            Assert.That(IntelHex.Read(patched, 0x10010, 2), Is.EqualTo(new byte[] { 0x11, 0x33 }));
+        }
+
+        [Test]
+        public void Patch_PreservesCrLfLineEndings()
+        {
+            var patched = IntelHex.Patch(Image.Replace("\n", "\r\n"), 0x0000, new byte[] { 0x01 });
+
+            Assert.That(patched, Is.EqualTo(Image.Replace("\n", "\r\n")));
+        }
+
+        [Test]
+        public void Patch_OutsideImageData_Throws()
+        {
+            Assert.Throws<InvalidOperationException>(() => IntelHex.Patch(Image, 0x0006, new byte[] { 0, 0, 0 }));
+        }
+
+        [Test]
+        public void CountBytes_OverlappingRecords_CountsEveryWrite()
+        {
+            var overlapping = Image.Replace(":00000001FF\n", ":02000200AABB97\n:00000001FF\n");
+
+            Assert.That(IntelHex.CountBytes(Image, 0x0000, 4), Is.EqualTo(4));
+            Assert.That(IntelHex.CountBytes(overlapping, 0x0000, 4), Is.EqualTo(6));
+            Assert.That(IntelHex.CountBytes(overlapping, 0x0006, 10), Is.EqualTo(2));
+        }
+
+        [Test]
+        public void ToBinary_FillsGapsWithErasedFlash()
+        {
+            const string image =
+                ":020000000102FB\n" +
+                ":020005000304F2\n" +
+                ":00000001FF\n";
+
+            Assert.That(IntelHex.ToBinary(image), Is.EqualTo(new byte[] { 1, 2, 0xFF, 0xFF, 0xFF, 3, 4 }));
+        }
+
+        [Test]
+        public void ToBinary_WithExtendedLinearAddress_UsesUpperAddress()
+        {
+            const string image =
+                ":020000040001F9\n" +
+                ":020010001122BB\n" +
+                ":00000001FF\n";
+
+            var binary = IntelHex.ToBinary(image);
+
+            Assert.That(binary.Length, Is.EqualTo(0x10012));
+            Assert.That(binary[0x10010], Is.EqualTo((byte)0x11));
+            Assert.That(binary[0x0000], Is.EqualTo((byte)0xFF));
+        }
+
+        [Test]
+        public void Patch_WithBadChecksum_Throws()
+        {
+            Assert.Throws<FormatException>(() => IntelHex.Patch(":0400000001020304F3\n", 0x0000, new byte[] { 0 }));
+        }
+    }
+}
@@ -0,0 +1,189 @@
+using Keypad.Flasher.Server.Services;
+using Microsoft.Extensions.Logging.Abstractions;
+using Microsoft.Extensions.Options;
+using NUnit.Framework;
+
+namespace Keypad.Flasher.Server.Tests
+{
+    [TestFixture]
+    public class SharedBuildQueueTests
+    {
+        private static readonly CompileRequest Request = new("CH55xDuino:mcs51:ch552", "#define A 1", "int a;");
+
+        private string _directory = null!;
+
+        [SetUp]
+        public void SetUp()
+        {
+            _directory = Path.Combine(Path.GetTempPath(), Guid.NewGuid().ToString());
+        }
+
+        [TearDown]
+        public void TearDown()
+        {
+            if (Directory.Exists(_directory))
+            {
+                Directory.Delete(_directory, true);
+            }
+        }
+
+        private IOptions<Settings> SettingsWith(int compileTimeoutSeconds = 120) =>
+            Options.Create(new Settings
+            {
+                FirmwarePath = "unused",
+                BuildQueuePath = _directory,
+                CompileTimeoutSeconds = compileTimeoutSeconds,
+                RemoteCompileTimeoutSeconds = 10
+            });
+
+        [Test]
+        public void TryClaim_AfterSubmitFromAnotherPod_RoundTripsTheResult()
+        {
+            var web = new SharedBuildQueue(SettingsWith());
+            var worker = new SharedBuildQueue(SettingsWith());
+            var key = SharedBuildQueue.KeyOf(Request);
+            web.Submit(key, Request);
+
+            Assert.That(worker.TryClaim(out var claimedKey, out var claimed), Is.True);
+            Assert.That(claimedKey, Is.EqualTo(key));
+            Assert.That(claimed, Is.EqualTo(Request));
+            Assert.That(web.IsClaimed(key), Is.True);
+            Assert.That(worker.TryClaim(out _, out _), Is.False);
+
+            worker.Complete(key, new FirmwareBuildResult(true, new byte[] { 1, 2 }, Footprint: new FirmwareFootprint(new MemoryUsage(10, 20), null, null)));
+
+            Assert.That(web.TryReadResult(key, out var result), Is.True);
+            Assert.That(result.Success, Is.True);
+            Assert.That(result.FileBytes, Is.EqualTo(new byte[] { 1, 2 }));
+            Assert.That(result.Footprint?.Code, Is.EqualTo(new MemoryUsage(10, 20)));
+            Assert.That(web.IsClaimed(key), Is.False);
+        }
+
+        [Test]
+        public void Submit_IdenticalRequestInFlight_QueuesOneCompile()
+        {
+            var queue = new SharedBuildQueue(SettingsWith());
+            var key = SharedBuildQueue.KeyOf(Request);
+            queue.Submit(key, Request);
+            new SharedBuildQueue(SettingsWith()).Submit(key, Request);
+
+            Assert.That(queue.PendingCount, Is.EqualTo(1));
+        }
+
+        [Test]
+        public void Submit_AfterEarlierRunCompleted_DropsTheOldResult()
+        {
+            var queue = new SharedBuildQueue(SettingsWith());
+            var key = SharedBuildQueue.KeyOf(Request);
+            queue.Submit(key, Request);
+            queue.TryClaim(out _, out _);
+            queue.Complete(key, new FirmwareBuildResult(false, null, "timed out"));
+
+            queue.Submit(key, Request);
+
+            Assert.That(queue.TryReadResult(key, out _), Is.False);
+            Assert.That(queue.PendingCount, Is.EqualTo(1));
+        }
+
+        [Test]
+        public void Maintain_ClaimOfWorkerThatWentAway_IsQueuedAgain()
+        {
+            var queue = new SharedBuildQueue(SettingsWith(compileTimeoutSeconds: 0));
+            var key = SharedBuildQueue.KeyOf(Request);
+            queue.Submit(key, Request);
+            queue.TryClaim(out _, out _);
+
+            queue.Maintain();
+
+            Assert.That(queue.IsClaimed(key), Is.False);
+            Assert.That(queue.TryClaim(out var again, out _), Is.True);
+            Assert.That(again, Is.EqualTo(key));
+        }
+
+        [Test]
+        public void Submit_MarkerLeftWithoutEntry_QueuesTheCompileAgain()
+        {
+            var queue = new SharedBuildQueue(SettingsWith());
+            var key = SharedBuildQueue.KeyOf(Request);
+            var marker = Path.Combine(_directory, "requests", key);
+            File.WriteAllBytes(marker, Array.Empty<byte>());
+            File.SetLastWriteTimeUtc(marker, DateTime.UtcNow.AddMinutes(-1));
+
+            queue.Submit(key, Request);
+
+            Assert.That(queue.PendingCount, Is.EqualTo(1));
+        }
+
+        [Test]
+        public void Maintain_OldMarkerWithPendingEntry_IsKept()
+        {
+            var queue = new SharedBuildQueue(SettingsWith());
+            var key = SharedBuildQueue.KeyOf(Request);
+            queue.Submit(key, Request);
+            var marker = Path.Combine(_directory, "requests", key);
+            File.SetLastWriteTimeUtc(marker, DateTime.UtcNow.AddHours(-1));
+
+            queue.Maintain();
+            new SharedBuildQueue(SettingsWith()).Submit(key, Request);
+
+            Assert.That(File.Exists(marker), Is.True);
+            Assert.That(queue.PendingCount, Is.EqualTo(1));
+        }
+
+        [Test]
+        public void Maintain_MarkerWithNothingQueued_IsCleared()
+        {
+            var queue = new SharedBuildQueue(SettingsWith());
+            var key = SharedBuildQueue.KeyOf(Request);
+            var marker = Path.Combine(_directory, "requests", key);
+            File.WriteAllBytes(marker, Array.Empty<byte>());
+            File.SetLastWriteTimeUtc(marker, DateTime.UtcNow.AddMinutes(-1));
+
+            queue.Maintain();
+
+            Assert.That(File.Exists(marker), Is.False);
+        }
+
+        [Test]
+        public void TryClaim_CorruptEntry_CompletesItAsFailed()
+        {
+            var queue = new SharedBuildQueue(SettingsWith());
+            var key = SharedBuildQueue.KeyOf(Request);
+            queue.Submit(key, Request);
+            var pending = Directory.GetFiles(Path.Combine(_directory, "pending")).Single();
+            File.WriteAllText(pending, "{ not json");
+
+            Assert.That(queue.TryClaim(out _, out _), Is.False);
+            Assert.That(queue.TryReadResult(key, out var result), Is.True);
+            Assert.That(result.Success, Is.False);
+            Assert.That(queue.IsClaimed(key), Is.False);
+        }
+
+        [Test]
+        public void Compile_Remote_ReportsCompilingAndReturnsTheWorkersResult()
+        {
+            var queue = new SharedBuildQueue(SettingsWith());
+            var compiler = new RemoteFirmwareCompiler(queue, SettingsWith(), NullLogger<RemoteFirmwareCompiler>.Instance);
+            var worker = new Thread(() =>
+            {
+                string key;
+                CompileRequest request;
+                while (!queue.TryClaim(out key, out request))
+                {
+                    Thread.Sleep(20);
+                }
+                Thread.Sleep(400);
+                queue.Complete(key, new FirmwareBuildResult(true, new byte[] { 9 }));
+            });
+            worker.Start();
+
+            var stages = new List<BuildStage>();
+            var result = compiler.Compile(Request, stages.Add);
+            worker.Join();
+
+            Assert.That(result.Success, Is.True);
+            Assert.That(result.FileBytes, Is.EqualTo(new byte[] { 9 }));
+            Assert.That(stages, Is.EqualTo(new[] { BuildStage.Compiling }));
+        }
+    }
+}
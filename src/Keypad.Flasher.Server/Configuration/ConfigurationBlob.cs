@@ -0,0 +1,220 @@
+using System.Text;
+
+namespace Keypad.Flasher.Server.Configuration
+{
+    // One value in the blob: its bytes plus the C initializer that produces them
+    internal readonly record struct BlobField(byte[] Bytes, string Literal)
+    {
+        public static BlobField Byte(byte value) => new(new[] { value }, value.ToString());
+
+        public static BlobField Byte(byte value, string literal) => new(new[] { value }, literal);
+
+        public static BlobField UInt16(ushort value)
+            => new(new[] { (byte)(value & 0xFF), (byte)(value >> 8) }, $"CONFIGURATION_BLOB_U16({value})");
+    }
+
+    // A row of fields, or a comment when Comment is set
+    internal sealed record BlobRow(string? Comment, IReadOnlyList<BlobField> Fields)
+    {
+        public static BlobRow Note(string comment) => new(comment, Array.Empty<BlobField>());
+    }
+
+    // Bindings, lighting and macro bytecode in the layout configuration_load() in configuration_data.c reads,
+    // so the same bytes can be compiled into configuration.c or written over a built image
+    internal sealed class ConfigurationBlob
+    {
+        public const int Address = 0x3400;
+        public const int Capacity = 0x0400;
+        public const int HeaderSize = 12;
+        public const byte Version = 2;
+
+        private readonly List<BlobRow> rows = new();
+
+        private ConfigurationBlob()
+        {
+        }
+
+        public static ConfigurationBlob Build(ConfigurationDefinition configuration, MacroProgram program, int ledCount, byte[]? brightnessTable)
+        {
+            var payload = BuildPayload(configuration, program, ledCount, brightnessTable);
+            var payloadBytes = payload.SelectMany(row => row.Fields).SelectMany(field => field.Bytes).ToArray();
+            if (HeaderSize + payloadBytes.Length > Capacity)
+            {
+                throw new InvalidOperationException($"Configuration needs {HeaderSize + payloadBytes.Length} bytes but the blob holds {Capacity}.");
+            }
+
+            var checksum = (ushort)payloadBytes.Aggregate(0, (sum, value) => (sum + value) & 0xFFFF);
+            var blob = new ConfigurationBlob();
+            blob.rows.Add(BlobRow.Note("header: magic, version, buttons, encoders, leds, layers, functions, payload length, checksum"));
+            blob.rows.Add(new BlobRow(null, new[]
+            {
+                BlobField.Byte((byte)'K', "'K'"),
+                BlobField.Byte((byte)'P', "'P'"),
+                BlobField.Byte(Version),
+                BlobField.Byte((byte)configuration.Buttons.Count),
+                BlobField.Byte((byte)configuration.Encoders.Count),
+                BlobField.Byte((byte)ledCount),
+                BlobField.Byte((byte)configuration.LayerCount),
+                BlobField.Byte((byte)program.FunctionsUsed),
+                BlobField.UInt16((ushort)payloadBytes.Length),
+                BlobField.UInt16(checksum)
+            }));
+            blob.rows.AddRange(payload);
+            return blob;
+        }
+
+        // Bytes Build would write, without failing when they exceed Capacity
+        public static int Measure(ConfigurationDefinition configuration, MacroProgram program, int ledCount, byte[]? brightnessTable)
+            => HeaderSize + BuildPayload(configuration, program, ledCount, brightnessTable).Sum(row => row.Fields.Sum(field => field.Bytes.Length));
+
+        private static List<BlobRow> BuildPayload(ConfigurationDefinition configuration, MacroProgram program, int ledCount, byte[]? brightnessTable)
+        {
+            if (configuration.LayerCount < 1 || configuration.LayerCount > BindingProfile.MaxLayers)
+            {
+                throw new InvalidOperationException($"Layer count must be between 1 and {BindingProfile.MaxLayers}.");
+            }
+
+            var payload = new List<BlobRow>();
+
+            if (configuration.Buttons.Count > 0)
+            {
+                payload.Add(BlobRow.Note("buttons: pin, active_low, led_index, bootloader_on_boot, bootloader_chord_member"));
+            }
+            foreach (var button in configuration.Buttons)
+            {
+                payload.Add(new BlobRow(null, new[]
+                {
+                    BlobField.Byte(checked((byte)button.Pin)),
+                    BlobField.Byte(ToByte(button.ActiveLow)),
+                    button.LedIndex < 0 ? BlobField.Byte(0xFF, "0xFF") : BlobField.Byte(checked((byte)button.LedIndex)),
+                    BlobField.Byte(ToByte(button.BootloaderOnBoot)),
+                    BlobField.Byte(ToByte(button.BootloaderChordMember))
+                }));
+            }
+
+            if (configuration.Encoders.Count > 0)
+            {
+                payload.Add(BlobRow.Note("encoders: pin_a, pin_b"));
+            }
+            foreach (var encoder in configuration.Encoders)
+            {
+                payload.Add(new BlobRow(null, new[]
+                {
+                    BlobField.Byte(checked((byte)encoder.PinA)),
+                    BlobField.Byte(checked((byte)encoder.PinB))
+                }));
+            }
+
+            AppendLayers(payload, configuration, program);
+            AppendLighting(payload, configuration.LedConfig, ledCount, brightnessTable);
+            payload.AddRange(program.Rows);
+            return payload;
+        }
+
+        public byte[] ToArray() => rows.SelectMany(row => row.Fields).SelectMany(field => field.Bytes).ToArray();
+
+        public void AppendTo(StringBuilder sb)
+        {
+            sb.AppendLine("__code const uint8_t __at(CONFIGURATION_BLOB_ADDRESS) configuration_blob[CONFIGURATION_BLOB_CAPACITY] = {");
+            var lastRow = rows.FindLastIndex(row => row.Comment == null);
+            for (int i = 0; i < rows.Count; i++)
+            {
+                if (rows[i].Comment != null)
+                {
+                    sb.Append("    // ").AppendLine(rows[i].Comment);
+                    continue;
+                }
+
+                var tail = i == lastRow ? string.Empty : ",";
+                sb.Append("    ").AppendLine(string.Join(", ", rows[i].Fields.Select(field => field.Literal)) + tail);
+            }
+            sb.AppendLine("};");
+        }
+
+        // One macro span per binding slot, layer-major: every button, then clockwise and
+        // counter-clockwise for each encoder, so the firmware indexes a layer with one multiply
+        private static void AppendLayers(List<BlobRow> payload, ConfigurationDefinition configuration, MacroProgram program)
+        {
+            if (configuration.Buttons.Count == 0 && configuration.Encoders.Count == 0)
+            {
+                return;
+            }
+
+            for (int layer = 0; layer < configuration.LayerCount; layer++)
+            {
+                payload.Add(BlobRow.Note($"layer {layer}: macro offset, length per button, then per encoder clockwise, counter-clockwise"));
+                foreach (var button in configuration.Buttons)
+                {
+                    payload.Add(SpanRow(program.SpanOf(MacroProgram.ForLayer(button.Function, button.LayerFunctions, layer))));
+                }
+                foreach (var encoder in configuration.Encoders)
+                {
+                    payload.Add(SpanRow(program.SpanOf(MacroProgram.ForLayer(encoder.Clockwise, encoder.LayerClockwise, layer))));
+                    payload.Add(SpanRow(program.SpanOf(MacroProgram.ForLayer(encoder.CounterClockwise, encoder.LayerCounterClockwise, layer))));
+                }
+            }
+        }
+
+        private static BlobRow SpanRow((int Offset, int Length) span)
+            => new(null, new[] { BlobField.UInt16((ushort)span.Offset), BlobField.UInt16((ushort)span.Length) });
+
+        private static void AppendLighting(List<BlobRow> payload, LedConfiguration? led, int ledCount, byte[]? brightnessTable)
+        {
+            payload.Add(BlobRow.Note("lighting: brightness_percent, rainbow_step_ms, breathing_min_percent, breathing_step_ms"));
+            if (ledCount <= 0)
+            {
+                payload.Add(new BlobRow(null, new[] { BlobField.Byte(0), BlobField.Byte(0), BlobField.Byte(0), BlobField.Byte(0) }));
+                return;
+            }
+
+            if (led == null || brightnessTable == null)
+            {
+                throw new InvalidOperationException("LED configuration missing.");
+            }
+
+            payload.Add(new BlobRow(null, new[]
+            {
+                BlobField.Byte(led.BrightnessPercent),
+                BlobField.Byte(led.RainbowStepMs),
+                BlobField.Byte(led.BreathingMinPercent),
+                BlobField.Byte(led.BreathingStepMs)
+            }));
+
+            payload.Add(BlobRow.Note("led passive modes"));
+            payload.Add(new BlobRow(null, led.PassiveModes.Take(ledCount).Select(PassiveModeField).ToArray()));
+            payload.Add(BlobRow.Note("led passive colors"));
+            payload.AddRange(led.PassiveColors.Take(ledCount).Select(ColorRow));
+            payload.Add(BlobRow.Note("led active modes"));
+            payload.Add(new BlobRow(null, led.ActiveModes.Take(ledCount).Select(ActiveModeField).ToArray()));
+            payload.Add(BlobRow.Note("led active colors"));
+            payload.AddRange(led.ActiveColors.Take(ledCount).Select(ColorRow));
+
+            payload.Add(BlobRow.Note("led brightness table"));
+            const int perLine = 16;
+            for (int i = 0; i < brightnessTable.Length; i += perLine)
+            {
+                payload.Add(new BlobRow(null, brightnessTable.Skip(i).Take(perLine).Select(BlobField.Byte).ToArray()));
+            }
+        }
+
+        private static BlobRow ColorRow(LedColor color)
+            => new(null, new[] { BlobField.Byte(color.R), BlobField.Byte(color.G), BlobField.Byte(color.B) });
+
+        private static BlobField PassiveModeField(PassiveLedMode mode) => mode switch
+        {
+            PassiveLedMode.Off => BlobField.Byte(0, "LED_PASSIVE_OFF"),
+            PassiveLedMode.Static => BlobField.Byte(2, "LED_PASSIVE_STATIC"),
+            PassiveLedMode.Breathing => BlobField.Byte(3, "LED_PASSIVE_BREATHING"),
+            _ => BlobField.Byte(1, "LED_PASSIVE_RAINBOW")
+        };
+
+        private static BlobField ActiveModeField(ActiveLedMode mode) => mode switch
+        {
+            ActiveLedMode.Off => BlobField.Byte(0, "LED_ACTIVE_OFF"),
+            ActiveLedMode.Nothing => BlobField.Byte(2, "LED_ACTIVE_NOTHING"),
+            _ => BlobField.Byte(1, "LED_ACTIVE_SOLID")
+        };
+
+        private static byte ToByte(bool value) => value ? (byte)1 : (byte)0;
+    }
+}
@@ -4,7 +4,25 @@ namespace Keypad.Flasher.Server.Configuration
 {
     public static class ConfigurationBuilder
     {
-        public static ConfigurationDefinition FromLayout(DeviceLayout layout, BindingProfile bindingProfile, bool debugMode, LedConfiguration? ledConfig = null)
+        // Debug firmware only reports pins, so it carries no inputs, LEDs or runtime options
+        public static ConfigurationDefinition ForDebug(DebugOptions debugOptions)
+        {
+            return new ConfigurationDefinition(
+                Array.Empty<ButtonBinding>(),
+                Array.Empty<EncoderBinding>(),
+                DebugMode: true,
+                NeoPixelPin: -1,
+                NeoPixelReversed: false,
+                LedConfig: new LedConfiguration(
+                    PassiveModes: Array.Empty<PassiveLedMode>(),
+                    PassiveColors: Array.Empty<LedColor>(),
+                    ActiveModes: Array.Empty<ActiveLedMode>(),
+                    ActiveColors: Array.Empty<LedColor>()),
+                DebugOptions: debugOptions,
+                FirmwareOptions: FirmwareOptions.Default);
+        }
+
+        public static ConfigurationDefinition FromLayout(DeviceLayout layout, BindingProfile bindingProfile, bool debugMode, LedConfiguration? ledConfig = null, FirmwareOptions? firmwareOptions = null)
         {
             if (layout == null) throw new ArgumentNullException(nameof(layout));
             if (bindingProfile == null) throw new ArgumentNullException(nameof(bindingProfile));
@@ -16,10 +34,12 @@ namespace Keypad.Flasher.Server.Configuration
 
             var buttonBindings = BuildButtonBindingLookup(bindingProfile.Buttons);
             var encoderBindings = BuildEncoderBindingLookup(bindingProfile.Encoders);
-            var buttons = BuildButtons(layout, buttonBindings, encoderBindings);
-            var encoders = BuildEncoders(layout, encoderBindings);
+            var layers = BuildLayerLookups(layout, bindingProfile.Layers);
+            var buttons = BuildButtons(layout, buttonBindings, encoderBindings, layers);
+            var encoders = BuildEncoders(layout, encoderBindings, layers);
             var ledCount = CalculateNeoPixelCount(buttons);
             var ledConfiguration = BuildLedConfiguration(ledConfig, ledCount);
+            var options = BuildFirmwareOptions(layout, firmwareOptions);
 
             return new ConfigurationDefinition(
                 Buttons: buttons,
@@ -28,13 +48,116 @@ namespace Keypad.Flasher.Server.Configuration
                 NeoPixelPin: layout.NeoPixelPin,
                 NeoPixelReversed: layout.NeoPixelReversed,
                 LedConfig: ledConfiguration,
-                DebugOptions: DebugOptions.Default);
+                DebugOptions: DebugOptions.Default,
+                FirmwareOptions: options,
+                LayerCount: layers.Count + 1);
+        }
+
+        private sealed record LayerLookup(
+            IReadOnlyDictionary<int, HidBinding> Buttons,
+            IReadOnlyDictionary<int, EncoderLayerBindingEntry> Encoders);
+
+        private static List<LayerLookup> BuildLayerLookups(DeviceLayout layout, IReadOnlyList<BindingLayer>? layers)
+        {
+            var results = new List<LayerLookup>();
+            if (layers == null)
+            {
+                return results;
+            }
+
+            if (layers.Count + 1 > BindingProfile.MaxLayers)
+            {
+                throw new ArgumentException($"At most {BindingProfile.MaxLayers} layers are supported, including the base layer.", nameof(layers));
+            }
+
+            var buttonIds = layout.Buttons.Select(b => b.Id).ToHashSet();
+            var encoderIds = layout.Encoders.Select(e => e.Id).ToHashSet();
+            for (int i = 0; i < layers.Count; i++)
+            {
+                var layerNumber = i + 1;
+                var buttons = new Dictionary<int, HidBinding>();
+                foreach (var entry in layers[i].Buttons ?? Array.Empty<ButtonBindingEntry>())
+                {
+                    if (!buttonIds.Contains(entry.Id))
+                    {
+                        throw new InvalidOperationException($"Layer {layerNumber} binds unknown button '{entry.Id}'.");
+                    }
+                    if (!buttons.TryAdd(entry.Id, entry.Binding))
+                    {
+                        throw new InvalidOperationException($"Duplicate button binding id '{entry.Id}' in layer {layerNumber}.");
+                    }
+                }
+
+                var encoders = new Dictionary<int, EncoderLayerBindingEntry>();
+                foreach (var entry in layers[i].Encoders ?? Array.Empty<EncoderLayerBindingEntry>())
+                {
+                    if (!encoderIds.Contains(entry.Id))
+                    {
+                        throw new InvalidOperationException($"Layer {layerNumber} binds unknown encoder '{entry.Id}'.");
+                    }
+                    if (!encoders.TryAdd(entry.Id, entry))
+                    {
+                        throw new InvalidOperationException($"Duplicate encoder binding id '{entry.Id}' in layer {layerNumber}.");
+                    }
+                }
+
+                results.Add(new LayerLookup(buttons, encoders));
+            }
+
+            return results;
+        }
+
+        private static IReadOnlyList<HidBinding?>? LayerOverrides(IReadOnlyList<LayerLookup> layers, Func<LayerLookup, HidBinding?> select)
+            => layers.Count == 0 ? null : layers.Select(select).ToList();
+
+        private static FirmwareOptions BuildFirmwareOptions(DeviceLayout layout, FirmwareOptions? firmwareOptions)
+        {
+            var options = firmwareOptions ?? FirmwareOptions.Default;
+
+            // Switch chatter is a property of the hardware, so the layout's debounce wins over the request
+            if (layout.DebounceMs.HasValue)
+            {
+                options = options with { DebounceMs = layout.DebounceMs.Value };
+            }
+
+            if (layout.LatencyProfile.HasValue)
+            {
+                options = options with
+                {
+                    PollingIntervalMs = layout.LatencyProfile.Value == LatencyProfile.LowLatency
+                        ? FirmwareOptions.LowLatencyPollingIntervalMs
+                        : FirmwareOptions.Default.PollingIntervalMs
+                };
+            }
+
+            if (options.ScanRateHz != 0 && (options.ScanRateHz < FirmwareOptions.MinScanRateHz || options.ScanRateHz > FirmwareOptions.MaxScanRateHz))
+            {
+                throw new ArgumentException($"Scan rate must be 0 or between {FirmwareOptions.MinScanRateHz} and {FirmwareOptions.MaxScanRateHz} Hz.", nameof(firmwareOptions));
+            }
+
+            if (options.DebounceMs > FirmwareOptions.MaxDebounceMs)
+            {
+                throw new ArgumentException($"Debounce time cannot exceed {FirmwareOptions.MaxDebounceMs} ms.", nameof(layout));
+            }
+
+            if (options.PollingIntervalMs == 0)
+            {
+                throw new ArgumentException("Polling interval must be at least 1 ms.", nameof(firmwareOptions));
+            }
+
+            if (options.EncoderAccelerationMax < 1 || options.EncoderAccelerationMax > FirmwareOptions.MaxEncoderAcceleration)
+            {
+                throw new ArgumentException($"Encoder acceleration must be between 1 and {FirmwareOptions.MaxEncoderAcceleration} steps per detent.", nameof(firmwareOptions));
+            }
+
+            return options;
         }
 
         private static List<ButtonBinding> BuildButtons(
             DeviceLayout layout,
             IReadOnlyDictionary<int, HidBinding> buttonBindings,
-            IReadOnlyDictionary<int, EncoderBindingEntry> encoderBindings)
+            IReadOnlyDictionary<int, EncoderBindingEntry> encoderBindings,
+            IReadOnlyList<LayerLookup> layers)
         {
             var results = new List<ButtonBinding>(layout.Buttons.Count + layout.Encoders.Count);
 
@@ -46,7 +169,8 @@ namespace Keypad.Flasher.Server.Configuration
                     LedIndex: button.LedIndex,
                     BootloaderOnBoot: button.BootloaderOnBoot,
                     BootloaderChordMember: button.BootloaderChordMember,
-                    Function: ResolveButtonBinding(buttonBindings, button.Id)));
+                    Function: ResolveButtonBinding(buttonBindings, button.Id),
+                    LayerFunctions: LayerOverrides(layers, layer => layer.Buttons.GetValueOrDefault(button.Id))));
             }
 
             foreach (var encoder in layout.Encoders)
@@ -65,13 +189,14 @@ namespace Keypad.Flasher.Server.Configuration
                     LedIndex: -1,
                     BootloaderOnBoot: encoder.Press.BootloaderOnBoot,
                     BootloaderChordMember: encoder.Press.BootloaderChordMember,
-                    Function: encoderBinding.Press));
+                    Function: encoderBinding.Press,
+                    LayerFunctions: LayerOverrides(layers, layer => layer.Encoders.GetValueOrDefault(encoder.Id)?.Press)));
             }
 
             return results;
         }
 
-        private static List<EncoderBinding> BuildEncoders(DeviceLayout layout, IReadOnlyDictionary<int, EncoderBindingEntry> encoderBindings)
+        private static List<EncoderBinding> BuildEncoders(DeviceLayout layout, IReadOnlyDictionary<int, EncoderBindingEntry> encoderBindings, IReadOnlyList<LayerLookup> layers)
         {
             var results = new List<EncoderBinding>(layout.Encoders.Count);
 
@@ -91,7 +216,9 @@ namespace Keypad.Flasher.Server.Configuration
                     PinA: encoder.PinA,
                     PinB: encoder.PinB,
                     Clockwise: bindingEntry.Clockwise,
-                    CounterClockwise: bindingEntry.CounterClockwise));
+                    CounterClockwise: bindingEntry.CounterClockwise,
+                    LayerClockwise: LayerOverrides(layers, layer => layer.Encoders.GetValueOrDefault(encoder.Id)?.Clockwise),
+                    LayerCounterClockwise: LayerOverrides(layers, layer => layer.Encoders.GetValueOrDefault(encoder.Id)?.CounterClockwise)));
             }
 
             return results;
@@ -4,11 +4,12 @@ namespace Keypad.Flasher.Server.Configuration
 {
     public class ConfigurationGenerator
     {
+        private const double LedGamma = 2.2;
+
         public string GenerateHeader(ConfigurationDefinition configuration)
         {
             var neoPixelCount = CalculateNeoPixelCount(configuration.Buttons);
             var neoPixelReversed = neoPixelCount > 0 && configuration.NeoPixelReversed;
-            var maxKeySteps = Math.Max(1, CalculateMaxKeySteps(configuration));
             var sb = new StringBuilder();
             sb.AppendLine("// This file is auto-generated. Do not edit manually.");
             sb.AppendLine();
@@ -23,7 +24,20 @@ namespace Keypad.Flasher.Server.Configuration
             sb.AppendLine($"#define DEBUG_PULLUPS_ENABLED {ToCInteger(configuration.DebugOptions.EnablePullups)}");
             sb.AppendLine($"#define DEBUG_CONFIRM_SAMPLES {configuration.DebugOptions.ConfirmSamples}");
             sb.AppendLine($"#define DEBUG_CONFIRM_DELAY_MS {configuration.DebugOptions.ConfirmDelayMs}");
-            sb.AppendLine($"#define HID_MAX_KEY_STEPS {maxKeySteps}");
+            sb.AppendLine($"#define DEBUG_CAPTURE_RATE_HZ {ResolveCaptureRate(configuration.DebugOptions)}");
+            sb.AppendLine($"#define CONFIGURATION_SCAN_RATE_HZ {ResolveScanRate(configuration.FirmwareOptions)}");
+            sb.AppendLine($"#define CONFIGURATION_DEBOUNCE_MS {ResolveDebounce(configuration.FirmwareOptions)}");
+            sb.AppendLine($"#define CONFIGURATION_ENCODER_ISR {ToCInteger(configuration.FirmwareOptions.EncoderInterrupts)}");
+            sb.AppendLine($"#define CONFIGURATION_ENCODER_ACCELERATION_MS {configuration.FirmwareOptions.EncoderAccelerationMs}");
+            sb.AppendLine($"#define CONFIGURATION_ENCODER_ACCELERATION_MAX {configuration.FirmwareOptions.EncoderAccelerationMax}");
+            sb.AppendLine($"#define CONFIGURATION_HID_POLL_INTERVAL_MS {ResolvePollingInterval(configuration.FirmwareOptions)}");
+            sb.AppendLine($"#define CONFIGURATION_HID_NKRO {ToCInteger(configuration.FirmwareOptions.NKeyRollover)}");
+            sb.AppendLine($"#define CONFIGURATION_LED_MAX_REFRESH_HZ {configuration.FirmwareOptions.LedMaxRefreshHz}");
+            sb.AppendLine($"#define CONFIGURATION_LATENCY_PROBE {ToCInteger(configuration.FirmwareOptions.LatencyProbe)}");
+            sb.AppendLine($"#define CONFIGURATION_LOOP_PROFILER {ToCInteger(configuration.FirmwareOptions.LoopProfiler)}");
+            sb.AppendLine($"#define CONFIGURATION_LAYER_FEEDBACK {ToCInteger(configuration.FirmwareOptions.LayerFeedback)}");
+            sb.AppendLine();
+            AppendPortMasks(sb, configuration);
             sb.AppendLine();
             if (neoPixelCount > 0)
             {
@@ -46,319 +60,224 @@ namespace Keypad.Flasher.Server.Configuration
             return sb.ToString();
         }
 
-        public string GenerateSource(ConfigurationDefinition configuration)
+        public string GenerateSource(ConfigurationDefinition configuration) => GenerateSource(configuration, includeBlob: true);
+
+        // GenerateSource without the configuration blob; builds that agree on this and the header compile
+        // to the same image apart from the bytes at CONFIGURATION_BLOB_ADDRESS
+        public string GenerateFixedSource(ConfigurationDefinition configuration) => GenerateSource(configuration, includeBlob: false);
+
+        private string GenerateSource(ConfigurationDefinition configuration, bool includeBlob)
         {
             var sb = new StringBuilder();
             var neoPixelCount = CalculateNeoPixelCount(configuration.Buttons);
+            var program = MacroProgram.Build(configuration);
             sb.AppendLine("#include \"configuration.h\"");
             sb.AppendLine("#include \"src/userUsbHidKeyboardMouse/USBHIDKeyboardMouse.h\"");
             sb.AppendLine();
-            AppendButtonBindings(sb, configuration.Buttons, configuration.DebugMode);
-            sb.AppendLine();
-            AppendButtonCount(sb, configuration.Buttons);
-            sb.AppendLine();
-            AppendEncoderBindings(sb, configuration.Encoders, configuration.DebugMode);
-            sb.AppendLine();
-            AppendEncoderCount(sb, configuration.Encoders);
-            sb.AppendLine();
-            AppendLedConfiguration(sb, configuration, neoPixelCount);
-            return sb.ToString();
-        }
-
-        private static void AppendButtonBindings(StringBuilder sb, IReadOnlyList<ButtonBinding> buttons, bool debugMode)
-        {
-            if (buttons.Count == 0)
+            program.AppendTo(sb);
+            if (includeBlob)
             {
-                sb.AppendLine("const button_binding_t button_bindings[] = {");
-                AppendLine(sb, 1, "{0}");
-                sb.AppendLine("};");
-                return;
+                sb.AppendLine();
+                BuildBlob(configuration, program, neoPixelCount).AppendTo(sb);
             }
-
-            sb.AppendLine("const button_binding_t button_bindings[] = {");
-            for (int i = 0; i < buttons.Count; i++)
+            if (neoPixelCount > 0)
             {
-                AppendButton(sb, buttons[i], i == buttons.Count - 1, debugMode);
+                sb.AppendLine();
+                AppendByteTable(sb, "led_breathing_curve", BuildBreathingCurve());
             }
-            sb.AppendLine("};");
+            return sb.ToString();
         }
 
-        private static void AppendButtonCount(StringBuilder sb, IReadOnlyCollection<ButtonBinding> buttons)
+        // The bytes GenerateSource places at CONFIGURATION_BLOB_ADDRESS, for patching a built image
+        public byte[] GenerateBlob(ConfigurationDefinition configuration)
         {
-            if (buttons.Count == 0)
-            {
-                sb.AppendLine("const size_t button_binding_count = 0;");
-                return;
-            }
+            var program = MacroProgram.Build(configuration);
+            return BuildBlob(configuration, program, CalculateNeoPixelCount(configuration.Buttons)).ToArray();
+        }
 
-            sb.AppendLine("const size_t button_binding_count = sizeof(button_bindings) / sizeof(button_bindings[0]);");
+        // Size of the blob GenerateBlob would produce, also when it is over ConfigurationBlob.Capacity
+        public int MeasureBlob(ConfigurationDefinition configuration)
+        {
+            var program = MacroProgram.Build(configuration);
+            var neoPixelCount = CalculateNeoPixelCount(configuration.Buttons);
+            return ConfigurationBlob.Measure(configuration, program, neoPixelCount, BrightnessTableFor(configuration, neoPixelCount));
         }
 
-        private static void AppendEncoderBindings(StringBuilder sb, IReadOnlyList<EncoderBinding> encoders, bool debugMode)
+        private static ConfigurationBlob BuildBlob(ConfigurationDefinition configuration, MacroProgram program, int neoPixelCount)
         {
-            if (encoders.Count == 0)
-            {
-                sb.AppendLine("const encoder_binding_t encoder_bindings[] = {");
-                AppendLine(sb, 1, "{0}");
-                sb.AppendLine("};");
-                return;
-            }
+            return ConfigurationBlob.Build(configuration, program, neoPixelCount, BrightnessTableFor(configuration, neoPixelCount));
+        }
 
-            sb.AppendLine("const encoder_binding_t encoder_bindings[] = {");
-            for (int i = 0; i < encoders.Count; i++)
-            {
-                AppendEncoder(sb, encoders[i], i == encoders.Count - 1, debugMode);
-            }
-            sb.AppendLine("};");
+        private static byte[]? BrightnessTableFor(ConfigurationDefinition configuration, int neoPixelCount)
+        {
+            var led = configuration.LedConfig;
+            return neoPixelCount > 0 && led != null
+                ? BuildBrightnessTable(led.BrightnessPercent, led.GammaCorrection)
+                : null;
         }
 
-        private static void AppendEncoderCount(StringBuilder sb, IReadOnlyCollection<EncoderBinding> encoders)
+        // Folds global brightness (and optional gamma) into one lookup so the firmware never divides per channel
+        private static byte[] BuildBrightnessTable(byte brightnessPercent, bool gammaCorrection)
         {
-            if (encoders.Count == 0)
+            var scale = Math.Min((int)brightnessPercent, 100);
+            var table = new byte[256];
+            for (int i = 0; i < table.Length; i++)
             {
-                sb.AppendLine("const size_t encoder_binding_count = 0;");
-                return;
+                var value = gammaCorrection
+                    ? (int)Math.Round(Math.Pow(i / 255.0, LedGamma) * 255.0)
+                    : i;
+                table[i] = (byte)(value * scale / 100);
             }
 
-            sb.AppendLine("const size_t encoder_binding_count = sizeof(encoder_bindings) / sizeof(encoder_bindings[0]);");
+            return table;
         }
 
-        private static void AppendLedConfiguration(StringBuilder sb, ConfigurationDefinition configuration, int neoPixelCount)
+        // Breathing level 0..100% as a 0..255 factor; the firmware applies it with an 8x8 multiply
+        private static byte[] BuildBreathingCurve()
         {
-            if (neoPixelCount <= 0)
+            var curve = new byte[101];
+            for (int i = 0; i < curve.Length; i++)
             {
-                sb.AppendLine("const led_configuration_t led_configuration = {");
-                AppendLine(sb, 1, ".passive_modes = 0,");
-                AppendLine(sb, 1, ".passive_colors = 0,");
-                AppendLine(sb, 1, ".active_modes = 0,");
-                AppendLine(sb, 1, ".active_colors = 0,");
-                AppendLine(sb, 1, ".count = 0,");
-                AppendLine(sb, 1, ".brightness_percent = 0,");
-                AppendLine(sb, 1, ".rainbow_step_ms = 0,");
-                AppendLine(sb, 1, ".breathing_min_percent = 0,");
-                AppendLine(sb, 1, ".breathing_step_ms = 0");
-                AppendLine(sb, 0, "};");
-                return;
+                curve[i] = (byte)(i * 255 / 100);
             }
 
-            var led = configuration.LedConfig ?? throw new InvalidOperationException("LED configuration missing.");
+            return curve;
+        }
 
-            AppendLine(sb, 0, "static const led_passive_mode_t led_passive_modes[] = {");
-            for (int i = 0; i < neoPixelCount; i++)
-            {
-                var modeLiteral = ToPassiveModeLiteral(led.PassiveModes[i]);
-                var tail = i == neoPixelCount - 1 ? string.Empty : ",";
-                AppendLine(sb, 1, modeLiteral + tail);
-            }
-            AppendLine(sb, 0, "};");
-            AppendLine(sb, 0, "static const led_rgb_t led_passive_colors[] = {");
-            for (int i = 0; i < neoPixelCount; i++)
-            {
-                var color = led.PassiveColors[i];
-                var tail = i == neoPixelCount - 1 ? string.Empty : ",";
-                AppendLine(sb, 1, $"{{ .r = {color.R}, .g = {color.G}, .b = {color.B} }}{tail}");
-            }
-            AppendLine(sb, 0, "};");
-            AppendLine(sb, 0, "static const led_active_mode_t led_active_modes[] = {");
-            for (int i = 0; i < neoPixelCount; i++)
+        private static void AppendByteTable(StringBuilder sb, string name, IReadOnlyList<byte> values)
+        {
+            const int perLine = 16;
+            sb.AppendLine($"__code const uint8_t {name}[{values.Count}] = {{");
+            for (int i = 0; i < values.Count; i += perLine)
             {
-                var modeLiteral = ToActiveModeLiteral(led.ActiveModes[i]);
-                var tail = i == neoPixelCount - 1 ? string.Empty : ",";
-                AppendLine(sb, 1, modeLiteral + tail);
+                var row = values.Skip(i).Take(perLine).Select(v => v.ToString());
+                var tail = i + perLine >= values.Count ? string.Empty : ",";
+                AppendLine(sb, 1, string.Join(", ", row) + tail);
             }
-            AppendLine(sb, 0, "};");
-            AppendLine(sb, 0, "static const led_rgb_t led_active_colors[] = {");
-            for (int i = 0; i < neoPixelCount; i++)
+            sb.AppendLine("};");
+        }
+
+        private static int CalculateNeoPixelCount(IReadOnlyCollection<ButtonBinding> buttons)
+        {
+            var maxLedIndex = -1;
+            foreach (var button in buttons)
             {
-                var color = led.ActiveColors[i];
-                var tail = i == neoPixelCount - 1 ? string.Empty : ",";
-                AppendLine(sb, 1, $"{{ .r = {color.R}, .g = {color.G}, .b = {color.B} }}{tail}");
+                if (button.LedIndex > maxLedIndex)
+                {
+                    maxLedIndex = button.LedIndex;
+                }
             }
-            AppendLine(sb, 0, "};");
-            sb.AppendLine("const led_configuration_t led_configuration = {");
-            AppendLine(sb, 1, ".passive_modes = led_passive_modes,");
-            AppendLine(sb, 1, ".passive_colors = led_passive_colors,");
-            AppendLine(sb, 1, ".active_modes = led_active_modes,");
-            AppendLine(sb, 1, ".active_colors = led_active_colors,");
-            AppendLine(sb, 1, $".count = {neoPixelCount},");
-            AppendLine(sb, 1, $".brightness_percent = {led.BrightnessPercent},");
-            AppendLine(sb, 1, $".rainbow_step_ms = {led.RainbowStepMs},");
-            AppendLine(sb, 1, $".breathing_min_percent = {led.BreathingMinPercent},");
-            AppendLine(sb, 1, $".breathing_step_ms = {led.BreathingStepMs}");
-            AppendLine(sb, 0, "};");
+
+            var count = maxLedIndex + 1;
+            return count < 0 ? 0 : count;
         }
 
-        private static int CalculateMaxKeySteps(ConfigurationDefinition configuration)
+        // Firmware samples P1/P3 in one read per port, so emit which bits belong to inputs and which are active-low
+        private static void AppendPortMasks(StringBuilder sb, ConfigurationDefinition configuration)
         {
-            int maxSteps = 0;
-
+            var buttonMasks = new byte[4];
+            var activeLowMasks = new byte[4];
+            var activeHighMasks = new byte[4];
             foreach (var button in configuration.Buttons)
             {
-                if (button.Function is HidSequenceBinding sequence)
+                var (port, bit) = GetPortBit(button.Pin);
+                buttonMasks[port] |= bit;
+                if (button.ActiveLow)
                 {
-                    if (sequence.Steps.Count > maxSteps)
-                    {
-                        maxSteps = sequence.Steps.Count;
-                    }
+                    activeLowMasks[port] |= bit;
+                }
+                else
+                {
+                    activeHighMasks[port] |= bit;
                 }
             }
 
-            foreach (var encoder in configuration.Encoders)
+            for (int port = 0; port < activeLowMasks.Length; port++)
             {
-                if (encoder.Clockwise is HidSequenceBinding clockwise && clockwise.Steps.Count > maxSteps)
+                if ((activeLowMasks[port] & activeHighMasks[port]) != 0)
                 {
-                    maxSteps = clockwise.Steps.Count;
+                    throw new InvalidOperationException($"A pin on port P{port} is bound as both active-low and active-high.");
                 }
+            }
 
-                if (encoder.CounterClockwise is HidSequenceBinding counter && counter.Steps.Count > maxSteps)
-                {
-                    maxSteps = counter.Steps.Count;
-                }
+            var encoderMasks = new byte[4];
+            foreach (var encoder in configuration.Encoders)
+            {
+                var (portA, bitA) = GetPortBit(encoder.PinA);
+                encoderMasks[portA] |= bitA;
+                var (portB, bitB) = GetPortBit(encoder.PinB);
+                encoderMasks[portB] |= bitB;
             }
 
-            return maxSteps;
+            sb.AppendLine($"#define CONFIGURATION_BUTTON_P1_MASK {ToCHexByte(buttonMasks[1])}");
+            sb.AppendLine($"#define CONFIGURATION_BUTTON_P3_MASK {ToCHexByte(buttonMasks[3])}");
+            sb.AppendLine($"#define CONFIGURATION_BUTTON_P1_ACTIVE_LOW {ToCHexByte(activeLowMasks[1])}");
+            sb.AppendLine($"#define CONFIGURATION_BUTTON_P3_ACTIVE_LOW {ToCHexByte(activeLowMasks[3])}");
+            sb.AppendLine($"#define CONFIGURATION_ENCODER_P1_MASK {ToCHexByte(encoderMasks[1])}");
+            sb.AppendLine($"#define CONFIGURATION_ENCODER_P3_MASK {ToCHexByte(encoderMasks[3])}");
         }
 
-        private static int CalculateNeoPixelCount(IReadOnlyCollection<ButtonBinding> buttons)
+        // CH55xDuino pin numbers are PORT * 10 + BIT; only P1 and P3 are bonded out on the CH552
+        private static (int Port, byte Bit) GetPortBit(int pin)
         {
-            var maxLedIndex = -1;
-            foreach (var button in buttons)
+            var port = pin / 10;
+            var index = pin % 10;
+            if (pin < 0 || (port != 1 && port != 3) || index > 7)
             {
-                if (button.LedIndex > maxLedIndex)
-                {
-                    maxLedIndex = button.LedIndex;
-                }
+                throw new ArgumentOutOfRangeException(nameof(pin), $"Pin {pin} is not on P1 or P3; inputs must be pins 10-17 or 30-37.");
             }
 
-            var count = maxLedIndex + 1;
-            return count < 0 ? 0 : count;
+            return (port, (byte)(1 << index));
         }
 
-        private static string ToPassiveModeLiteral(PassiveLedMode mode) => mode switch
+        private static int ResolveDebounce(FirmwareOptions options)
         {
-            PassiveLedMode.Off => "LED_PASSIVE_OFF",
-            PassiveLedMode.Rainbow => "LED_PASSIVE_RAINBOW",
-            PassiveLedMode.Static => "LED_PASSIVE_STATIC",
-            PassiveLedMode.Breathing => "LED_PASSIVE_BREATHING",
-            _ => "LED_PASSIVE_RAINBOW"
-        };
-
-        private static string ToActiveModeLiteral(ActiveLedMode mode) => mode switch
-        {
-            ActiveLedMode.Off => "LED_ACTIVE_OFF",
-            ActiveLedMode.Solid => "LED_ACTIVE_SOLID",
-            ActiveLedMode.Nothing => "LED_ACTIVE_NOTHING",
-            _ => "LED_ACTIVE_SOLID"
-        };
+            if (options.DebounceMs > FirmwareOptions.MaxDebounceMs)
+            {
+                throw new ArgumentOutOfRangeException(nameof(options), $"Debounce time cannot exceed {FirmwareOptions.MaxDebounceMs} ms.");
+            }
 
-        private static void AppendButton(StringBuilder sb, ButtonBinding button, bool isLast, bool debugMode)
-        {
-            AppendLine(sb, 1, "{");
-            AppendLine(sb, 2, $".pin = {button.Pin},");
-            AppendLine(sb, 2, $".active_low = {ToCBoolean(button.ActiveLow)},");
-            AppendLine(sb, 2, $".led_index = {button.LedIndex},");
-            AppendLine(sb, 2, $".bootloader_on_boot = {ToCBoolean(button.BootloaderOnBoot)},");
-            AppendLine(sb, 2, $".bootloader_chord_member = {ToCBoolean(button.BootloaderChordMember)},");
-            AppendBindingBlock(sb, 2, "function", button.Function, debugMode, appendTrailingComma: false);
-            AppendLine(sb, 1, isLast ? "}" : "},");
+            return options.DebounceMs;
         }
 
-        private static void AppendEncoder(StringBuilder sb, EncoderBinding encoder, bool isLast, bool debugMode)
+        private static int ResolvePollingInterval(FirmwareOptions options)
         {
-            AppendLine(sb, 1, "{");
-            AppendLine(sb, 2, $".pin_a = {encoder.PinA},");
-            AppendLine(sb, 2, $".pin_b = {encoder.PinB},");
-            AppendBindingBlock(sb, 2, "clockwise", encoder.Clockwise, debugMode, appendTrailingComma: true);
-            AppendBindingBlock(sb, 2, "counter_clockwise", encoder.CounterClockwise, debugMode, appendTrailingComma: false);
-            AppendLine(sb, 1, isLast ? "}" : "},");
+            if (options.PollingIntervalMs == 0)
+            {
+                throw new ArgumentOutOfRangeException(nameof(options), "Polling interval must be at least 1 ms.");
+            }
+
+            return options.PollingIntervalMs;
         }
 
-        private static void AppendBindingBlock(StringBuilder sb, int indentLevel, string fieldName, HidBinding binding, bool debugMode, bool appendTrailingComma)
+        private static int ResolveScanRate(FirmwareOptions options)
         {
-            AppendLine(sb, indentLevel, $".{fieldName} = {{");
-            if (debugMode)
+            if (options.ScanRateHz == 0)
             {
-                AppendLine(sb, indentLevel + 1, ".type = HID_BINDING_NULL,");
-                AppendLine(sb, indentLevel + 1, ".function.functionPointer = 0");
+                return 0;
             }
-            else
+
+            if (options.ScanRateHz < FirmwareOptions.MinScanRateHz || options.ScanRateHz > FirmwareOptions.MaxScanRateHz)
             {
-                AppendBindingContent(sb, indentLevel + 1, binding);
+                throw new ArgumentOutOfRangeException(nameof(options), $"Scan rate must be 0 or between {FirmwareOptions.MinScanRateHz} and {FirmwareOptions.MaxScanRateHz} Hz.");
             }
-            AppendLine(sb, indentLevel, appendTrailingComma ? "}," : "}");
+
+            return options.ScanRateHz;
         }
 
-        private static void AppendBindingContent(StringBuilder sb, int indentLevel, HidBinding binding)
+        private static int ResolveCaptureRate(DebugOptions options)
         {
-            if (binding is not HidSequenceBinding sequenceBinding)
+            if (options.CaptureRateHz == 0)
             {
-                throw new InvalidOperationException($"Unsupported binding type: {binding.GetType().Name}");
+                return 0;
             }
 
-            AppendLine(sb, indentLevel, ".type = HID_BINDING_SEQUENCE,");
-            AppendLine(sb, indentLevel, ".function.sequence = {");
-            AppendLine(sb, indentLevel + 1, ".steps = {");
-            if (sequenceBinding.Steps.Count == 0)
+            if (options.CaptureRateHz < DebugOptions.MinCaptureRateHz || options.CaptureRateHz > DebugOptions.MaxCaptureRateHz)
             {
-                // SDCC balks at an empty initializer list; seed with a zeroed element
-                AppendLine(sb, indentLevel + 2, "{0}");
+                throw new ArgumentOutOfRangeException(nameof(options), $"Capture rate must be 0 or between {DebugOptions.MinCaptureRateHz} and {DebugOptions.MaxCaptureRateHz} Hz.");
             }
-            else
-            {
-                for (int i = 0; i < sequenceBinding.Steps.Count; i++)
-                {
-                    var step = sequenceBinding.Steps[i];
-                    var isLast = i == sequenceBinding.Steps.Count - 1;
-                    var kindLiteral = step.Kind switch
-                    {
-                        HidStepKind.Key => "HID_STEP_KEY",
-                        HidStepKind.Pause => "HID_STEP_PAUSE",
-                        HidStepKind.Function => "HID_STEP_FUNCTION",
-                        HidStepKind.Mouse => "HID_STEP_MOUSE",
-                        _ => throw new InvalidOperationException($"Unsupported step kind: {step.Kind}")
-                    };
-                    var functionPointer = step.Kind == HidStepKind.Function
-                        ? step.FunctionPointer ?? throw new InvalidOperationException("Function steps must specify a functionPointer.")
-                        : "0";
-                    var keycodeLiteral = step.Kind == HidStepKind.Key
-                        ? ToCharLiteral((char)step.Keycode)
-                        : step.Keycode.ToString();
-                    var pointerType = step.Kind == HidStepKind.Mouse ? step.PointerType : HidPointerType.MoveUp;
-                    var pointerTypeLiteral = ((byte)pointerType).ToString();
-                    var pointerValue = (byte)0;
-                    if (step.Kind == HidStepKind.Mouse)
-                    {
-                        if (pointerType is HidPointerType.LeftClick or HidPointerType.RightClick)
-                        {
-                            pointerValue = 0;
-                        }
-                        else if (pointerType is HidPointerType.ScrollUp or HidPointerType.ScrollDown)
-                        {
-                            pointerValue = step.PointerValue == 0 ? (byte)1 : step.PointerValue;
-                        }
-                        else
-                        {
-                            pointerValue = step.PointerValue == 0 ? (byte)100 : step.PointerValue;
-                        }
-                    }
-                    var functionValue = step.Kind == HidStepKind.Function ? (step.FunctionValue == 0 ? (byte)1 : step.FunctionValue) : (byte)1;
-
-                    AppendLine(sb, indentLevel + 2, "{");
-                    AppendLine(sb, indentLevel + 3, $".kind = {kindLiteral},");
-                    AppendLine(sb, indentLevel + 3, $".keycode = {keycodeLiteral},");
-                    AppendLine(sb, indentLevel + 3, $".modifiers = {step.Modifiers},");
-                    AppendLine(sb, indentLevel + 3, $".hold_ms = {step.HoldMs},");
-                    AppendLine(sb, indentLevel + 3, $".gap_ms = {step.GapMs},");
-                    AppendLine(sb, indentLevel + 3, $".function_value = {functionValue},");
-                    AppendLine(sb, indentLevel + 3, $".pointer_type = {pointerTypeLiteral},");
-                    AppendLine(sb, indentLevel + 3, $".pointer_value = {pointerValue},");
-                    AppendLine(sb, indentLevel + 3, $".functionPointer = {functionPointer}");
-                    AppendLine(sb, indentLevel + 2, isLast ? "}" : "},");
-                }
-            }
-            AppendLine(sb, indentLevel + 1, "},");
-            AppendLine(sb, indentLevel + 1, $".length = {sequenceBinding.Steps.Count}");
-            AppendLine(sb, indentLevel, "}");
+
+            return options.CaptureRateHz;
         }
 
         private static void AppendLine(StringBuilder sb, int indentLevel, string text)
@@ -367,23 +286,8 @@ namespace Keypad.Flasher.Server.Configuration
             sb.AppendLine(text);
         }
 
-        private static string ToCBoolean(bool value) => value ? "true" : "false";
-
         private static string ToCInteger(bool value) => value ? "1" : "0";
 
-        private static string ToCharLiteral(char value)
-        {
-            return value switch
-            {
-                '\\' => "'\\\\'",
-                '\'' => "'\\\''",
-                '\n' => "'\\n'",
-                '\r' => "'\\r'",
-                '\t' => "'\\t'",
-                _ when value < 32 || value > 126 => $"0x{((int)value):X2}",
-                _ => $"'{value}'"
-            };
-        }
-
+        private static string ToCHexByte(byte value) => $"0x{value:X2}";
     }
 }
@@ -15,7 +15,9 @@ namespace Keypad.Flasher.Server.Configuration
         Key,
         Pause,
         Function,
-        Mouse
+        Mouse,
+        Text,
+        Layer
     }
 
     public enum HidPointerType : byte
@@ -47,6 +49,13 @@ namespace Keypad.Flasher.Server.Configuration
         Nothing
     }
 
+    [JsonConverter(typeof(JsonStringEnumConverter))]
+    public enum LatencyProfile
+    {
+        Standard,
+        LowLatency
+    }
+
     public sealed record HidStep(
         HidStepKind Kind,
         byte Keycode,
@@ -56,7 +65,9 @@ namespace Keypad.Flasher.Server.Configuration
         byte FunctionValue,
         HidPointerType PointerType,
         byte PointerValue,
-        string? FunctionPointer = null)
+        string? FunctionPointer = null,
+        string? Text = null,
+        byte Layer = 0)
     {
         public static HidStep Key(byte keycode, byte modifiers = 0, byte holdMs = 10, byte gapMs = 10)
             => new(HidStepKind.Key, keycode, modifiers, holdMs, gapMs, 1, 0, 0, null);
@@ -69,6 +80,12 @@ namespace Keypad.Flasher.Server.Configuration
 
         public static HidStep Mouse(HidPointerType pointerType, byte pointerValue, byte gapMs = 0)
             => new(HidStepKind.Mouse, 0, 0, 0, gapMs, 1, pointerType, pointerValue, null);
+
+        public static HidStep TypeText(string text, byte modifiers = 0, byte gapMs = 0)
+            => new(HidStepKind.Text, 0, modifiers, 0, gapMs, 1, 0, 0, null, text);
+
+        public static HidStep SetLayer(byte layer, byte gapMs = 0)
+            => new(HidStepKind.Layer, 0, 0, 0, gapMs, 1, 0, 0, null, null, layer);
     }
 
     [JsonPolymorphic(TypeDiscriminatorPropertyName = "type")]
@@ -95,13 +112,15 @@ namespace Keypad.Flasher.Server.Configuration
             => new(new[] { HidStep.Function(functionPointer, gapMs) });
     }
 
+    // Function is the base layer; LayerFunctions[i] is layer i + 1, and a missing or null entry falls through to Function
     public sealed record ButtonBinding(
         int Pin,
         bool ActiveLow,
         int LedIndex,
         bool BootloaderOnBoot,
         bool BootloaderChordMember,
-        HidBinding Function);
+        HidBinding Function,
+        IReadOnlyList<HidBinding?>? LayerFunctions = null);
 
     public sealed record ButtonBindingEntry(int Id, HidBinding Binding);
 
@@ -109,7 +128,9 @@ namespace Keypad.Flasher.Server.Configuration
         int PinA,
         int PinB,
         HidBinding Clockwise,
-        HidBinding CounterClockwise);
+        HidBinding CounterClockwise,
+        IReadOnlyList<HidBinding?>? LayerClockwise = null,
+        IReadOnlyList<HidBinding?>? LayerCounterClockwise = null);
 
     public sealed record EncoderBindingEntry(
         int Id,
@@ -127,17 +148,49 @@ namespace Keypad.Flasher.Server.Configuration
         byte BrightnessPercent = 100,
         byte RainbowStepMs = 20,
         byte BreathingMinPercent = 20,
-        byte BreathingStepMs = 20);
+        byte BreathingStepMs = 20,
+        bool GammaCorrection = false);
 
+    // CaptureRateHz of 0 keeps the human-readable change log; otherwise P1/P3 are sampled at that rate and streamed as binary frames
     public sealed record DebugOptions(
         bool EnableNoiseFilter = true,
         bool EnablePullups = true,
         byte ConfirmSamples = 3,
-        byte ConfirmDelayMs = 1)
+        byte ConfirmDelayMs = 1,
+        ushort CaptureRateHz = 0)
     {
+        public const ushort MinCaptureRateHz = 1000;
+        public const ushort MaxCaptureRateHz = 20000;
+
         public static readonly DebugOptions Default = new();
     }
 
+    // Runtime tuning for the keypad firmware; ScanRateHz of 0 keeps the free-running loop, LedMaxRefreshHz of 0 leaves LED frames uncapped,
+    // LatencyProbe and LoopProfiler expose press-to-report latency and per-task loop timings as HID feature reports.
+    // Encoder detents closer together than EncoderAccelerationMs count for up to EncoderAccelerationMax steps; 0 ms turns acceleration off.
+    // LayerFeedback briefly lights the key LED whose index is the newly selected layer
+    public sealed record FirmwareOptions(
+        ushort ScanRateHz = 0,
+        byte DebounceMs = 5,
+        bool EncoderInterrupts = false,
+        byte PollingIntervalMs = 10,
+        bool NKeyRollover = false,
+        byte LedMaxRefreshHz = 50,
+        bool LatencyProbe = false,
+        bool LoopProfiler = false,
+        byte EncoderAccelerationMs = 0,
+        byte EncoderAccelerationMax = 8,
+        bool LayerFeedback = true)
+    {
+        public const ushort MinScanRateHz = 100;
+        public const ushort MaxScanRateHz = 4000;
+        public const byte MaxDebounceMs = 50;
+        public const byte LowLatencyPollingIntervalMs = 1;
+        public const byte MaxEncoderAcceleration = 16;
+
+        public static readonly FirmwareOptions Default = new();
+    }
+
     public sealed record ConfigurationDefinition(
         IReadOnlyList<ButtonBinding> Buttons,
         IReadOnlyList<EncoderBinding> Encoders,
@@ -145,7 +198,9 @@ namespace Keypad.Flasher.Server.Configuration
         int NeoPixelPin,
         bool NeoPixelReversed,
         LedConfiguration LedConfig,
-        DebugOptions DebugOptions);
+        DebugOptions DebugOptions,
+        FirmwareOptions FirmwareOptions,
+        int LayerCount = 1);
 
     // Hardware-only shape; no bindings attached so UI can present physical controls separately from actions
     public abstract record InputLayout(
@@ -178,9 +233,26 @@ namespace Keypad.Flasher.Server.Configuration
         IReadOnlyList<ButtonLayout> Buttons,
         IReadOnlyList<EncoderLayout> Encoders,
         int NeoPixelPin,
-        bool NeoPixelReversed);
+        bool NeoPixelReversed,
+        byte? DebounceMs = null,
+        LatencyProfile? LatencyProfile = null);
 
+    // Layers[i] is layer i + 1; inputs it leaves out keep their base-layer binding
     public sealed record BindingProfile(
         IReadOnlyList<ButtonBindingEntry> Buttons,
-        IReadOnlyList<EncoderBindingEntry> Encoders);
+        IReadOnlyList<EncoderBindingEntry> Encoders,
+        IReadOnlyList<BindingLayer>? Layers = null)
+    {
+        public const int MaxLayers = 8;
+    }
+
+    public sealed record EncoderLayerBindingEntry(
+        int Id,
+        HidBinding? Clockwise,
+        HidBinding? CounterClockwise,
+        HidBinding? Press);
+
+    public sealed record BindingLayer(
+        IReadOnlyList<ButtonBindingEntry>? Buttons,
+        IReadOnlyList<EncoderLayerBindingEntry>? Encoders);
 }
@@ -0,0 +1,315 @@
+using System.Text;
+
+namespace Keypad.Flasher.Server.Configuration
+{
+    // Packs every binding's steps into one bytecode stream using the HID_OP_* layout from hid.h,
+    // so flash use follows the total macro length instead of bindings * longest macro. A macro whose
+    // bytes already appear in the stream points into them instead of being written again
+    internal sealed class MacroProgram
+    {
+        private const byte OpKey = 0x10;
+        private const byte OpPause = 0x20;
+        private const byte OpFunction = 0x30;
+        private const byte OpMouse = 0x40;
+        private const byte OpText = 0x50;
+        private const byte OpLayer = 0x60;
+        private const byte OpTap = 0x70;
+
+        // hold and gap of an HID_OP_TAP step, HID_TAP_MS in hid.h
+        private const byte TapMs = 10;
+
+        // Always first in hid_function_table, so bindings that only use these keep the same
+        // compiled table and can be swapped by rewriting the configuration blob alone
+        public static readonly IReadOnlyList<string> BuiltinFunctions = new[]
+        {
+            "hid_consumer_volume_up",
+            "hid_consumer_volume_down",
+            "hid_consumer_mute",
+            "hid_consumer_media_play_pause",
+            "hid_consumer_media_next",
+            "hid_consumer_media_previous",
+            "hid_consumer_media_stop"
+        };
+
+        private readonly List<BlobRow> rows = new();
+        private readonly List<byte> code = new();
+        private readonly List<string> functions = new();
+        private readonly Dictionary<HidBinding, (int Offset, int Length)> spans = new(ReferenceEqualityComparer.Instance);
+        private bool unbound;
+        private int layerCount = 1;
+
+        public IReadOnlyList<BlobRow> Rows => rows;
+
+        // Table entries the bytecode can reach; the firmware rejects a blob that needs more than it was built with
+        public int FunctionsUsed { get; private set; }
+
+        public static MacroProgram Build(ConfigurationDefinition configuration)
+        {
+            var program = new MacroProgram();
+            if (configuration.DebugMode)
+            {
+                // debug firmware only reports pins, every input stays unbound
+                program.unbound = true;
+                return program;
+            }
+
+            program.functions.AddRange(BuiltinFunctions);
+            program.layerCount = configuration.LayerCount;
+
+            for (int layer = 0; layer < configuration.LayerCount; layer++)
+            {
+                var suffix = layer == 0 ? string.Empty : $" layer {layer}";
+                for (int i = 0; i < configuration.Buttons.Count; i++)
+                {
+                    var button = configuration.Buttons[i];
+                    program.Add(ForLayer(button.Function, button.LayerFunctions, layer), $"button {i}{suffix}");
+                }
+
+                for (int i = 0; i < configuration.Encoders.Count; i++)
+                {
+                    var encoder = configuration.Encoders[i];
+                    program.Add(ForLayer(encoder.Clockwise, encoder.LayerClockwise, layer), $"encoder {i} clockwise{suffix}");
+                    program.Add(ForLayer(encoder.CounterClockwise, encoder.LayerCounterClockwise, layer), $"encoder {i} counter-clockwise{suffix}");
+                }
+            }
+
+            return program;
+        }
+
+        // The binding an input runs on a layer; layers without an override fall through to the base binding
+        public static HidBinding ForLayer(HidBinding baseBinding, IReadOnlyList<HidBinding?>? overrides, int layer)
+        {
+            if (layer == 0 || overrides == null || layer > overrides.Count)
+            {
+                return baseBinding;
+            }
+
+            return overrides[layer - 1] ?? baseBinding;
+        }
+
+        public (int Offset, int Length) SpanOf(HidBinding binding)
+        {
+            if (unbound)
+            {
+                return (0, 0);
+            }
+
+            return spans.TryGetValue(binding, out var span)
+                ? span
+                : throw new InvalidOperationException("Binding was not added to the macro program.");
+        }
+
+        public void AppendTo(StringBuilder sb)
+        {
+            sb.AppendLine("const hid_function_t hid_function_table[] = {");
+            AppendRows(sb, functions.Count == 0 ? new[] { "0" } : functions);
+            sb.AppendLine("};");
+            sb.AppendLine($"const uint8_t hid_function_count = {functions.Count};");
+        }
+
+        private void Add(HidBinding binding, string label)
+        {
+            if (spans.ContainsKey(binding))
+            {
+                return;
+            }
+
+            if (binding is not HidSequenceBinding sequence)
+            {
+                throw new InvalidOperationException($"Unsupported binding type: {binding.GetType().Name}");
+            }
+
+            var steps = sequence.Steps.Select(Encode).ToList();
+            var bytes = steps.SelectMany(fields => fields.SelectMany(field => field.Bytes)).ToArray();
+
+            // decoding depends only on the bytes from the start offset, so any earlier match will do
+            var shared = bytes.Length == 0 ? -1 : IndexOf(bytes);
+            if (shared >= 0)
+            {
+                rows.Add(BlobRow.Note($"macro: {label} reuses {bytes.Length} bytes at {shared}"));
+                spans[binding] = (shared, bytes.Length);
+                return;
+            }
+
+            var offset = code.Count;
+            if (steps.Count > 0)
+            {
+                rows.Add(BlobRow.Note($"macro: {label}"));
+            }
+
+            foreach (var encoded in steps)
+            {
+                rows.Add(new BlobRow(null, encoded));
+            }
+            code.AddRange(bytes);
+
+            if (code.Count > ushort.MaxValue)
+            {
+                throw new InvalidOperationException($"Macros exceed {ushort.MaxValue} bytes of bytecode.");
+            }
+
+            spans[binding] = (offset, bytes.Length);
+        }
+
+        private int IndexOf(byte[] bytes)
+        {
+            for (int start = 0; start + bytes.Length <= code.Count; start++)
+            {
+                var match = true;
+                for (int i = 0; i < bytes.Length && match; i++)
+                {
+                    match = code[start + i] == bytes[i];
+                }
+
+                if (match)
+                {
+                    return start;
+                }
+            }
+
+            return -1;
+        }
+
+        private BlobField[] Encode(HidStep step)
+        {
+            switch (step.Kind)
+            {
+                case HidStepKind.Key:
+                    if (step.Modifiers > 0x0F)
+                    {
+                        throw new InvalidOperationException("Key step modifiers must fit in the low nibble.");
+                    }
+
+                    // the firmware holds a key for 10 ms when hold_ms is 0
+                    if (step.HoldMs is 0 or TapMs && step.GapMs == TapMs)
+                    {
+                        return new[] { WithArgument("HID_OP_TAP", OpTap, step.Modifiers), CharField((char)step.Keycode) };
+                    }
+
+                    return new[]
+                    {
+                        WithArgument("HID_OP_KEY", OpKey, step.Modifiers),
+                        CharField((char)step.Keycode),
+                        BlobField.Byte(step.HoldMs),
+                        BlobField.Byte(step.GapMs)
+                    };
+                case HidStepKind.Pause:
+                    return new[] { BlobField.Byte(OpPause, "HID_OP_PAUSE"), BlobField.Byte(step.GapMs) };
+                case HidStepKind.Function:
+                    var functionPointer = step.FunctionPointer ?? throw new InvalidOperationException("Function steps must specify a functionPointer.");
+                    var functionValue = step.FunctionValue == 0 ? (byte)1 : step.FunctionValue;
+                    return new[]
+                    {
+                        BlobField.Byte(OpFunction, "HID_OP_FUNCTION"),
+                        BlobField.Byte(FunctionIndex(functionPointer)),
+                        BlobField.Byte(functionValue),
+                        BlobField.Byte(step.GapMs)
+                    };
+                case HidStepKind.Mouse:
+                    return new[]
+                    {
+                        WithArgument("HID_OP_MOUSE", OpMouse, (byte)step.PointerType),
+                        BlobField.Byte(PointerValue(step)),
+                        BlobField.Byte(step.GapMs)
+                    };
+                case HidStepKind.Text:
+                    return EncodeText(step);
+                case HidStepKind.Layer:
+                    if (step.Layer >= layerCount)
+                    {
+                        throw new InvalidOperationException($"Layer step targets layer {step.Layer} but only {layerCount} layers are configured.");
+                    }
+
+                    return new[] { WithArgument("HID_OP_LAYER", OpLayer, step.Layer), BlobField.Byte(step.GapMs) };
+                default:
+                    throw new InvalidOperationException($"Unsupported step kind: {step.Kind}");
+            }
+        }
+
+        private static BlobField[] EncodeText(HidStep step)
+        {
+            var text = step.Text ?? throw new InvalidOperationException("Text steps must specify text.");
+            if (text.Length > byte.MaxValue)
+            {
+                throw new InvalidOperationException($"Text steps are limited to {byte.MaxValue} characters.");
+            }
+
+            if (text.Any(c => c > 127))
+            {
+                throw new InvalidOperationException("Text steps only support ASCII characters.");
+            }
+
+            if (step.Modifiers > 0x0F)
+            {
+                throw new InvalidOperationException("Text step modifiers must fit in the low nibble.");
+            }
+
+            return new[]
+            {
+                WithArgument("HID_OP_TEXT", OpText, step.Modifiers),
+                BlobField.Byte(step.GapMs),
+                BlobField.Byte((byte)text.Length)
+            }.Concat(text.Select(CharField)).ToArray();
+        }
+
+        private byte FunctionIndex(string functionPointer)
+        {
+            var index = functions.IndexOf(functionPointer);
+            if (index < 0)
+            {
+                if (functions.Count > byte.MaxValue)
+                {
+                    throw new InvalidOperationException("Too many distinct functions for the macro function table.");
+                }
+
+                functions.Add(functionPointer);
+                index = functions.Count - 1;
+            }
+
+            FunctionsUsed = Math.Max(FunctionsUsed, index + 1);
+            return (byte)index;
+        }
+
+        private static byte PointerValue(HidStep step)
+        {
+            if (step.PointerType is HidPointerType.LeftClick or HidPointerType.RightClick)
+            {
+                return 0;
+            }
+
+            if (step.PointerType is HidPointerType.ScrollUp or HidPointerType.ScrollDown)
+            {
+                return step.PointerValue == 0 ? (byte)1 : step.PointerValue;
+            }
+
+            return step.PointerValue == 0 ? (byte)100 : step.PointerValue;
+        }
+
+        private static BlobField WithArgument(string opcode, byte value, byte argument)
+            => BlobField.Byte((byte)(value | argument), argument == 0 ? opcode : $"{opcode} | {argument}");
+
+        private static void AppendRows(StringBuilder sb, IReadOnlyList<string> values)
+        {
+            for (int i = 0; i < values.Count; i++)
+            {
+                sb.Append("    ").AppendLine(i == values.Count - 1 ? values[i] : values[i] + ",");
+            }
+        }
+
+        private static BlobField CharField(char value) => BlobField.Byte((byte)value, ToCharLiteral(value));
+
+        private static string ToCharLiteral(char value)
+        {
+            return value switch
+            {
+                '\\' => "'\\\\'",
+                '\'' => "'\\\''",
+                '\n' => "'\\n'",
+                '\r' => "'\\r'",
+                '\t' => "'\\t'",
+                _ when value < 32 || value > 126 => $"0x{((int)value):X2}",
+                _ => $"'{value}'"
+            };
+        }
+    }
+}
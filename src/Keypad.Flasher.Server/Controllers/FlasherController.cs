@@ -1,6 +1,12 @@
+using System.Globalization;
+using System.Security.Cryptography;
+using System.Text;
+using System.Text.Json;
 using Keypad.Flasher.Server.Configuration;
 using Keypad.Flasher.Server.Services;
 using Microsoft.AspNetCore.Mvc;
+using Microsoft.AspNetCore.RateLimiting;
+using Microsoft.Net.Http.Headers;
 using LayoutConfigurationBuilder = Keypad.Flasher.Server.Configuration.ConfigurationBuilder;
 
 namespace Keypad.Flasher.Server.Controllers
@@ -10,76 +16,177 @@ namespace Keypad.Flasher.Server.Controllers
     public class FlasherController : ControllerBase
     {
         private readonly IFirmwareBuilder _firmwareBuilder;
+        private readonly IBuildJobQueue _jobs;
 
-        public FlasherController(IFirmwareBuilder firmwareBuilder)
+        public FlasherController(IFirmwareBuilder firmwareBuilder, IBuildJobQueue jobs)
         {
             _firmwareBuilder = firmwareBuilder;
+            _jobs = jobs;
         }
 
+        // Rate limiter policy on the endpoints that start builds, partitioned by ClientKeyOf
+        public const string BuildRateLimitPolicy = "builds";
+
+        // Builds go through the job queue so they share its limits, but the answer comes on this connection
         [HttpPost(Name = "GetFirmware")]
-        public ActionResult<Firmware> Post([FromBody] FirmwareRequest? request)
+        [EnableRateLimiting(BuildRateLimitPolicy)]
+        public async Task<ActionResult<Firmware>> Post([FromBody] FirmwareRequest? request, CancellationToken cancellationToken)
         {
-            if (request == null)
+            if (!TryCreateConfiguration(request, out var configuration, out var error) || !FitsBudget(configuration, out error))
             {
-                return BadRequest(new { error = "A configuration payload is required." });
+                return BadRequest(new { error });
             }
 
-            // Enforce explicit debug/non-debug contract
-            if (request.Debug)
+            var admission = _jobs.TryEnqueue(configuration, ClientKeyOf(HttpContext));
+            if (admission.Job is not { } job)
             {
-                if (request.Layout != null || request.BindingProfile != null)
-                {
-                    return BadRequest(new { error = "Debug mode must not include layout or bindingProfile." });
-                }
+                return Rejected(admission);
+            }
+
+            while (!job.IsFinished)
+            {
+                await job.WaitForChangeAsync(job.Stage, cancellationToken);
+            }
+
+            return ToFirmwareResponse(job.Result!, conditional: false);
+        }
+
+        // Same payload as Post, answered without compiling, for a meter that follows the editor
+        [HttpPost("budget")]
+        public ActionResult<FirmwareBudget> PostBudget([FromBody] FirmwareRequest? request)
+        {
+            if (!TryCreateConfiguration(request, out var configuration, out var error))
+            {
+                return BadRequest(new { error });
+            }
 
-                var debugOptions = request.DebugOptions ?? DebugOptions.Default;
-
-                var debugOnlyConfiguration = new ConfigurationDefinition(
-                    Array.Empty<ButtonBinding>(),
-                    Array.Empty<EncoderBinding>(),
-                    DebugMode: true,
-                    NeoPixelPin: -1,
-                    NeoPixelReversed: false,
-                    LedConfig: new LedConfiguration(
-                        PassiveModes: Array.Empty<PassiveLedMode>(),
-                        PassiveColors: Array.Empty<LedColor>(),
-                        ActiveModes: Array.Empty<ActiveLedMode>(),
-                        ActiveColors: Array.Empty<LedColor>()),
-                    DebugOptions: debugOptions);
-
-                var debugResult = _firmwareBuilder.BuildFirmware(debugOnlyConfiguration);
-                if (!debugResult.Success)
+            try
+            {
+                return _firmwareBuilder.MeasureBudget(configuration);
+            }
+            catch (Exception ex) when (ex is InvalidOperationException or ArgumentException)
+            {
+                return BadRequest(new { error = ex.Message });
+            }
+        }
+
+        // Lets clients key their own image caches; a change here invalidates every cached image
+        [HttpGet("version")]
+        public ActionResult<ServerVersion> GetVersion()
+        {
+            Response.Headers.CacheControl = "no-cache";
+            return new ServerVersion(_firmwareBuilder.FirmwareVersion);
+        }
+
+        // Same payload as Post, but answers at once with a job to follow instead of holding the
+        // connection for the whole compile
+        [HttpPost("jobs")]
+        [EnableRateLimiting(BuildRateLimitPolicy)]
+        public IActionResult PostJob([FromBody] FirmwareRequest? request)
+        {
+            if (!TryCreateConfiguration(request, out var configuration, out var error) || !FitsBudget(configuration, out error))
+            {
+                return BadRequest(new { error });
+            }
+
+            // a client holding the image from an earlier build sends its ETag; when the result cache
+            // still has that image it is confirmed here, without queueing a build to fetch it
+            var ifNoneMatch = Request.GetTypedHeaders().IfNoneMatch;
+            if (ifNoneMatch.Count > 0 && _firmwareBuilder.TryGetCached(configuration, out var cached))
+            {
+                var entityTag = EntityTagOf(IntelHex.ToBinary(Encoding.ASCII.GetString(cached)));
+                if (ifNoneMatch.Any(tag => tag.Compare(entityTag, useStrongComparison: false)))
                 {
-                    return StatusCode(500, new
-                    {
-                        error = debugResult.Error ?? "Compile failed",
-                        exitCode = debugResult.ExitCode,
-                        stdout = debugResult.Stdout,
-                        stderr = debugResult.Stderr
-                    });
+                    Response.Headers.ETag = entityTag.ToString();
+                    return StatusCode(StatusCodes.Status304NotModified);
                 }
+            }
 
-                return new Firmware(debugResult.FileBytes ?? Array.Empty<byte>());
+            var admission = _jobs.TryEnqueue(configuration, ClientKeyOf(HttpContext));
+            if (admission.Job is not { } job)
+            {
+                return Rejected(admission);
             }
 
-            if (request.Layout == null || request.BindingProfile == null)
+            return AcceptedAtAction(nameof(GetJob), new { id = job.Id }, new BuildJobStatus(job.Id, job.Stage, null, QueuePosition: admission.QueueLength));
+        }
+
+        [HttpGet("jobs/{id:guid}")]
+        public ActionResult<BuildJobStatus> GetJob(Guid id)
+        {
+            if (!_jobs.TryGet(id, out var job))
             {
-                return BadRequest(new { error = "Layout and bindingProfile are required when debug is false." });
+                return NotFound(new { error = "Unknown or expired build job." });
             }
 
-            ConfigurationDefinition configuration;
-            try
+            return Describe(job);
+        }
+
+        // Server-sent events: one "stage" event per change of stage or queue position, ending after
+        // Done or Failed
+        [HttpGet("jobs/{id:guid}/events")]
+        public async Task GetJobEvents(Guid id, CancellationToken cancellationToken)
+        {
+            if (!_jobs.TryGet(id, out var job))
             {
-                configuration = LayoutConfigurationBuilder.FromLayout(request.Layout, request.BindingProfile, request.Debug, request.LedConfig);
+                Response.StatusCode = StatusCodes.Status404NotFound;
+                return;
             }
-            catch (Exception ex)
+
+            Response.ContentType = "text/event-stream";
+            Response.Headers.CacheControl = "no-cache";
+
+            BuildJobStatus? sent = null;
+            while (!cancellationToken.IsCancellationRequested)
             {
-                return BadRequest(new { error = ex.Message });
+                var status = Describe(job);
+                if (status != sent)
+                {
+                    sent = status;
+                    await Response.WriteAsync($"event: stage\ndata: {JsonSerializer.Serialize(status, EventJsonOptions)}\n\n", cancellationToken);
+                    await Response.Body.FlushAsync(cancellationToken);
+                }
+
+                if (job.IsFinished)
+                {
+                    return;
+                }
+
+                try
+                {
+                    // the position moves without a stage change, so a queued job is looked at again
+                    var change = job.WaitForChangeAsync(status.Stage, cancellationToken);
+                    await (status.Stage == BuildStage.Queued ? change.WaitAsync(QueuedRefresh, cancellationToken) : change);
+                }
+                catch (TimeoutException)
+                {
+                }
+                catch (OperationCanceledException)
+                {
+                    return;
+                }
             }
+        }
 
-            configuration = configuration with { DebugMode = request.Debug, DebugOptions = DebugOptions.Default };
+        [HttpGet("jobs/{id:guid}/firmware")]
+        public ActionResult<Firmware> GetJobFirmware(Guid id)
+        {
+            if (!_jobs.TryGet(id, out var job))
+            {
+                return NotFound(new { error = "Unknown or expired build job." });
+            }
+
+            if (job.Result == null)
+            {
+                return Conflict(new { error = $"Build job is still {job.Stage.ToString().ToLowerInvariant()}." });
+            }
+
+            return ToFirmwareResponse(job.Result, conditional: true);
+        }
 
-            var buildResult = _firmwareBuilder.BuildFirmware(configuration);
+        // conditional only for GETs: a POST carrying a matching If-None-Match would be answered 412
+        private ActionResult<Firmware> ToFirmwareResponse(FirmwareBuildResult buildResult, bool conditional)
+        {
             if (!buildResult.Success)
             {
                 return StatusCode(500, new
@@ -91,17 +198,140 @@ namespace Keypad.Flasher.Server.Controllers
                 });
             }
 
-            return new Firmware(buildResult.FileBytes ?? Array.Empty<byte>());
+            var fileBytes = buildResult.FileBytes ?? Array.Empty<byte>();
+            Response.Headers.Vary = "Accept";
+            if (!AcceptsBinary())
+            {
+                return new Firmware(fileBytes, buildResult.Footprint);
+            }
+
+            // the flat image is about a third of the base64 HEX and needs no parsing before flashing.
+            // With an ETag, File answers a GET whose If-None-Match matches with 304 and no body
+            var image = IntelHex.ToBinary(Encoding.ASCII.GetString(fileBytes));
+            if (!conditional)
+            {
+                return File(image, BinaryContentType);
+            }
+
+            return File(image, BinaryContentType, lastModified: null, EntityTagOf(image));
+        }
+
+        // The first 16 bytes of the flat image's SHA-256, which the client cache recomputes to check its copies
+        private static EntityTagHeaderValue EntityTagOf(byte[] image) =>
+            new($"\"{Convert.ToHexString(SHA256.HashData(image), 0, 16)}\"");
+
+        private bool AcceptsBinary()
+        {
+            return Request.GetTypedHeaders().Accept.Any(accept => accept.MediaType.Equals(BinaryContentType, StringComparison.OrdinalIgnoreCase));
+        }
+
+        private BuildJobStatus Describe(BuildJob job)
+        {
+            var result = job.Result;
+            var position = _jobs.PositionOf(job);
+            return new BuildJobStatus(job.Id, job.Stage, result is { Success: false } ? result.Error ?? "Compile failed" : null, result?.Footprint, position > 0 ? position : null);
+        }
+
+        private ObjectResult Rejected(BuildAdmission admission)
+        {
+            var retryAfterSeconds = (int)Math.Ceiling(admission.RetryAfter.TotalSeconds);
+            Response.Headers.RetryAfter = retryAfterSeconds.ToString(CultureInfo.InvariantCulture);
+            var queueFull = admission.Rejection == BuildRejection.QueueFull;
+            return StatusCode(queueFull ? StatusCodes.Status503ServiceUnavailable : StatusCodes.Status429TooManyRequests, new
+            {
+                error = queueFull ? "The build queue is full." : "Too many builds are already queued from this address.",
+                queueLength = admission.QueueLength,
+                retryAfterSeconds
+            });
+        }
+
+        // The remote address, which is the client's behind the ingress once forwarded headers are on
+        public static string ClientKeyOf(HttpContext context) => context.Connection.RemoteIpAddress?.ToString() ?? "unknown";
+
+        // A layout whose blob cannot fit would only fail once a worker generates it, so it is
+        // turned away before it queues
+        private bool FitsBudget(ConfigurationDefinition configuration, out string? error)
+        {
+            error = null;
+            try
+            {
+                var budget = _firmwareBuilder.MeasureBudget(configuration);
+                if (!budget.Fits)
+                {
+                    error = $"Configuration needs {budget.Blob.Used} bytes but the blob holds {budget.Blob.Limit}.";
+                }
+            }
+            catch (Exception ex) when (ex is InvalidOperationException or ArgumentException)
+            {
+                error = ex.Message;
+            }
+
+            return error == null;
         }
 
-        public record Firmware(byte[] FileBytes);
+        private static bool TryCreateConfiguration(FirmwareRequest? request, out ConfigurationDefinition configuration, out string? error)
+        {
+            configuration = null!;
+            error = null;
+            if (request == null)
+            {
+                error = "A configuration payload is required.";
+                return false;
+            }
+
+            // Enforce explicit debug/non-debug contract
+            if (request.Debug)
+            {
+                if (request.Layout != null || request.BindingProfile != null)
+                {
+                    error = "Debug mode must not include layout or bindingProfile.";
+                    return false;
+                }
+
+                configuration = LayoutConfigurationBuilder.ForDebug(request.DebugOptions ?? DebugOptions.Default);
+                return true;
+            }
+
+            if (request.Layout == null || request.BindingProfile == null)
+            {
+                error = "Layout and bindingProfile are required when debug is false.";
+                return false;
+            }
+
+            try
+            {
+                configuration = LayoutConfigurationBuilder.FromLayout(request.Layout, request.BindingProfile, request.Debug, request.LedConfig, request.FirmwareOptions);
+            }
+            catch (Exception ex)
+            {
+                error = ex.Message;
+                return false;
+            }
+
+            configuration = configuration with { DebugMode = request.Debug, DebugOptions = DebugOptions.Default };
+            return true;
+        }
+
+        private const string BinaryContentType = "application/octet-stream";
+
+        private static readonly JsonSerializerOptions EventJsonOptions = new(JsonSerializerDefaults.Web);
+
+        private static readonly TimeSpan QueuedRefresh = TimeSpan.FromSeconds(1);
+
+        public record Firmware(byte[] FileBytes, FirmwareFootprint? Footprint = null);
+
+        public record ServerVersion(string Firmware);
+
+        // QueuePosition is 1 for the job that starts next and null once the job has left the queue
+        public record BuildJobStatus(Guid Id, BuildStage Stage, string? Error, FirmwareFootprint? Footprint = null, int? QueuePosition = null);
 
         public record FirmwareRequest(
             DeviceLayout? Layout,
             BindingProfile? BindingProfile,
             bool Debug = false,
             LedConfiguration? LedConfig = null,
-            DebugOptions? DebugOptions = null);
+            DebugOptions? DebugOptions = null,
+            FirmwareOptions? FirmwareOptions = null);
 
     }
 }
@@ -1,26 +1,132 @@
 using Keypad.Flasher.Server;
+using System.Globalization;
+using System.Threading.RateLimiting;
 using Keypad.Flasher.Server.Configuration;
+using Keypad.Flasher.Server.Controllers;
 using Keypad.Flasher.Server.Services;
+using Microsoft.AspNetCore.Diagnostics.HealthChecks;
+using Microsoft.AspNetCore.ResponseCompression;
+using Microsoft.Extensions.Options;
+using OpenTelemetry.Metrics;
+using OpenTelemetry.Resources;
+using OpenTelemetry.Trace;
 
 var builder = WebApplication.CreateBuilder(args);
 
 // Add services to the container.
 
 builder.Services.AddControllers();
-builder.Services.AddHealthChecks();
+builder.Services.AddHealthChecks()
+    .AddCheck<BuildWarmupHealthCheck>("warmup", tags: new[] { BuildWarmupHealthCheck.ReadyTag });
+
+// Firmware goes out as application/octet-stream when the client asks for it; the flat image is
+// mostly erased 0xFF gaps between code and compresses well
+builder.Services.AddResponseCompression(options =>
+{
+    options.EnableForHttps = true;
+    options.Providers.Add<BrotliCompressionProvider>();
+    options.Providers.Add<GzipCompressionProvider>();
+    options.MimeTypes = ResponseCompressionDefaults.MimeTypes.Append("application/octet-stream");
+});
 builder.Services.Configure<Settings>(builder.Configuration.GetSection("Settings"));
+
+// Token bucket per client address on the build endpoints, refilled every tenth of a minute; the
+// job queue adds its own bounds on top for clients that stay under the rate
+builder.Services.AddRateLimiter(options =>
+{
+    options.AddPolicy(FlasherController.BuildRateLimitPolicy, context =>
+    {
+        var perMinute = Math.Max(1, context.RequestServices.GetRequiredService<IOptions<Settings>>().Value.BuildRequestsPerMinute);
+        return RateLimitPartition.GetTokenBucketLimiter(FlasherController.ClientKeyOf(context), _ => new TokenBucketRateLimiterOptions
+        {
+            TokenLimit = perMinute,
+            TokensPerPeriod = Math.Max(1, perMinute / 10),
+            ReplenishmentPeriod = TimeSpan.FromSeconds(6),
+            QueueLimit = 0,
+            AutoReplenishment = true
+        });
+    });
+    options.OnRejected = async (context, cancellationToken) =>
+    {
+        BuildMetrics.Rejections.Add(1, new KeyValuePair<string, object?>("reason", "rate_limit"));
+        var retryAfterSeconds = context.Lease.TryGetMetadata(MetadataName.RetryAfter, out var retryAfter)
+            ? (int)Math.Ceiling(retryAfter.TotalSeconds)
+            : 6;
+        var response = context.HttpContext.Response;
+        response.StatusCode = StatusCodes.Status429TooManyRequests;
+        response.Headers.RetryAfter = retryAfterSeconds.ToString(CultureInfo.InvariantCulture);
+        await response.WriteAsJsonAsync(new { error = "Too many build requests from this address.", retryAfterSeconds }, cancellationToken);
+    };
+});
 builder.Services.AddSingleton<ConfigurationGenerator>();
+builder.Services.AddSingleton<LocalFirmwareCompiler>();
+// With a shared build queue, web pods hand compiles to the worker deployment and the workers
+// compile; the caches and coalescing in FirmwareBuilder stay in front of either
+var sharedBuildQueue = !string.IsNullOrEmpty(builder.Configuration["Settings:BuildQueuePath"]);
+var buildWorker = builder.Configuration.GetValue<bool>("Settings:BuildWorker");
+if (sharedBuildQueue)
+{
+    builder.Services.AddSingleton(sp =>
+    {
+        var queue = new SharedBuildQueue(sp.GetRequiredService<IOptions<Settings>>());
+        BuildMetrics.ObserveSharedQueue(() => queue.PendingCount);
+        return queue;
+    });
+}
+if (sharedBuildQueue && !buildWorker)
+{
+    builder.Services.AddSingleton<IFirmwareCompiler, RemoteFirmwareCompiler>();
+}
+else
+{
+    builder.Services.AddSingleton<IFirmwareCompiler>(sp => sp.GetRequiredService<LocalFirmwareCompiler>());
+}
+if (sharedBuildQueue && buildWorker)
+{
+    builder.Services.AddHostedService<SharedBuildWorker>();
+}
 builder.Services.AddSingleton<IFirmwareBuilder, FirmwareBuilder>();
+builder.Services.AddSingleton<BuildJobQueue>();
+builder.Services.AddSingleton<IBuildJobQueue>(sp => sp.GetRequiredService<BuildJobQueue>());
+builder.Services.AddHostedService<BuildJobWorker>();
+// warm-up always compiles in this process; web pods that hand compiles to workers turn it off
+builder.Services.AddSingleton(sp => new BuildWarmup(
+    sp.GetRequiredService<LocalFirmwareCompiler>(),
+    sp.GetRequiredService<ConfigurationGenerator>(),
+    sp.GetRequiredService<IOptions<Settings>>(),
+    sp.GetRequiredService<ILogger<BuildWarmup>>()));
+builder.Services.AddHostedService(sp => sp.GetRequiredService<BuildWarmup>());
+
+// Metrics are scraped from /metrics; traces are only exported when OTEL_EXPORTER_OTLP_ENDPOINT is set
+var telemetry = builder.Services.AddOpenTelemetry()
+    .ConfigureResource(resource => resource.AddService("keypad-flasher"))
+    .WithMetrics(metrics => metrics
+        .AddMeter(BuildMetrics.Name)
+        .AddAspNetCoreInstrumentation()
+        .AddPrometheusExporter());
+if (!string.IsNullOrEmpty(builder.Configuration["OTEL_EXPORTER_OTLP_ENDPOINT"]))
+{
+    telemetry.WithTracing(tracing => tracing
+        .AddSource(BuildMetrics.Name)
+        .AddAspNetCoreInstrumentation(options => options.Filter = context => context.Request.Path != "/healthz" && context.Request.Path != "/readyz" && context.Request.Path != "/metrics")
+        .AddOtlpExporter());
+}
 
 var app = builder.Build();
 
+app.UseResponseCompression();
 app.UseDefaultFiles();
 app.MapStaticAssets();
 
-app.UseHealthChecks(new PathString("/healthz"));
+// /healthz is liveness and skips readiness checks, so a pod still warming up is not restarted
+app.UseHealthChecks(new PathString("/healthz"), new HealthCheckOptions { Predicate = check => !check.Tags.Contains(BuildWarmupHealthCheck.ReadyTag) });
+app.UseHealthChecks(new PathString("/readyz"), new HealthCheckOptions { Predicate = check => check.Tags.Contains(BuildWarmupHealthCheck.ReadyTag) });
+app.MapPrometheusScrapingEndpoint();
 
 app.UseHttpsRedirection();
 
+app.UseRateLimiter();
+
 app.UseAuthorization();
 
 app.MapControllers();
@@ -0,0 +1,57 @@
+namespace Keypad.Flasher.Server.Services
+{
+    // One in-flight build that any number of identical requests wait on. The build runs once, on the
+    // first caller's thread; every caller hears its stages, late joiners starting from the latest one
+    internal sealed class BuildFlight
+    {
+        private readonly object _lock = new();
+        private readonly Lazy<FirmwareBuildResult> _result;
+        private readonly List<Action<BuildStage>> _listeners = new();
+        private BuildStage? _stage;
+        private int _waiters;
+
+        public BuildFlight(Func<Action<BuildStage>, FirmwareBuildResult> build)
+        {
+            _result = new Lazy<FirmwareBuildResult>(() => build(Report), LazyThreadSafetyMode.ExecutionAndPublication);
+        }
+
+        // Callers beyond the first, i.e. builds this flight saved
+        public int Joined => Math.Max(0, Volatile.Read(ref _waiters) - 1);
+
+        public FirmwareBuildResult Wait(Action<BuildStage>? onStage)
+        {
+            Interlocked.Increment(ref _waiters);
+            if (onStage != null)
+            {
+                BuildStage? current;
+                lock (_lock)
+                {
+                    _listeners.Add(onStage);
+                    current = _stage;
+                }
+
+                if (current is { } stage)
+                {
+                    onStage(stage);
+                }
+            }
+
+            return _result.Value;
+        }
+
+        private void Report(BuildStage stage)
+        {
+            Action<BuildStage>[] listeners;
+            lock (_lock)
+            {
+                _stage = stage;
+                listeners = _listeners.ToArray();
+            }
+
+            foreach (var listener in listeners)
+            {
+                listener(stage);
+            }
+        }
+    }
+}
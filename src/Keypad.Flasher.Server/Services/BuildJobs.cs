@@ -0,0 +1,328 @@
+using System.Collections.Concurrent;
+using System.Diagnostics;
+using System.Text.Json.Serialization;
+using System.Threading.Channels;
+using Keypad.Flasher.Server.Configuration;
+using Microsoft.Extensions.Hosting;
+using Microsoft.Extensions.Logging;
+using Microsoft.Extensions.Options;
+
+namespace Keypad.Flasher.Server.Services
+{
+    [JsonConverter(typeof(JsonStringEnumConverter))]
+    public enum BuildStage
+    {
+        Queued,
+        Generating,
+        Compiling,
+        Done,
+        Failed
+    }
+
+    public enum BuildRejection
+    {
+        None,
+        QueueFull,
+        ClientLimit
+    }
+
+    // The job when the build was admitted; otherwise why not, and when asking again should succeed
+    public sealed record BuildAdmission(BuildJob? Job, BuildRejection Rejection, int QueueLength, TimeSpan RetryAfter);
+
+    public sealed class BuildJob
+    {
+        private readonly object _lock = new();
+        private TaskCompletionSource _changed = new(TaskCreationOptions.RunContinuationsAsynchronously);
+
+        internal BuildJob(Guid id, ConfigurationDefinition configuration, string client, long sequence)
+        {
+            Id = id;
+            Configuration = configuration;
+            Client = client;
+            Sequence = sequence;
+            EnqueuedAt = Stopwatch.GetTimestamp();
+            Parent = Activity.Current?.Context ?? default;
+        }
+
+        public Guid Id { get; }
+
+        public BuildStage Stage { get; private set; } = BuildStage.Queued;
+
+        public FirmwareBuildResult? Result { get; private set; }
+
+        public DateTimeOffset? FinishedAt { get; private set; }
+
+        internal ConfigurationDefinition Configuration { get; }
+
+        // who asked, for the per-client share of the queue, and the order it was admitted in
+        internal string Client { get; }
+
+        internal long Sequence { get; }
+
+        internal long EnqueuedAt { get; }
+
+        // the span of the POST that created the job, so its build shows up under that request
+        internal ActivityContext Parent { get; }
+
+        public bool IsFinished => Stage is BuildStage.Done or BuildStage.Failed;
+
+        // Completes on the next stage change after the caller last looked at Stage
+        public Task WaitForChangeAsync(BuildStage seen, CancellationToken cancellationToken)
+        {
+            lock (_lock)
+            {
+                return Stage != seen ? Task.CompletedTask : _changed.Task.WaitAsync(cancellationToken);
+            }
+        }
+
+        internal void Advance(BuildStage stage)
+        {
+            TaskCompletionSource changed;
+            lock (_lock)
+            {
+                if (IsFinished || Stage == stage)
+                {
+                    return;
+                }
+
+                Stage = stage;
+                changed = _changed;
+                _changed = new TaskCompletionSource(TaskCreationOptions.RunContinuationsAsynchronously);
+            }
+            changed.TrySetResult();
+        }
+
+        internal void Finish(FirmwareBuildResult result)
+        {
+            TaskCompletionSource changed;
+            lock (_lock)
+            {
+                Result = result;
+                Stage = result.Success ? BuildStage.Done : BuildStage.Failed;
+                FinishedAt = DateTimeOffset.UtcNow;
+                changed = _changed;
+            }
+            changed.TrySetResult();
+        }
+    }
+
+    public interface IBuildJobQueue
+    {
+        BuildAdmission TryEnqueue(ConfigurationDefinition configuration, string client);
+        bool TryGet(Guid id, out BuildJob job);
+
+        // 1 for the job a consumer takes next, 0 once it has left the queue
+        int PositionOf(BuildJob job);
+    }
+
+    // Jobs wait in a channel for BuildJobWorker; finished jobs are kept long enough for the client to
+    // fetch the result and are swept on later enqueues. The queue is bounded overall and per client,
+    // so a burst is turned away at once with a wait estimate instead of timing out behind it
+    public sealed class BuildJobQueue : IBuildJobQueue
+    {
+        private static readonly TimeSpan Retention = TimeSpan.FromMinutes(10);
+
+        // assumed for Retry-After until jobs have finished to measure
+        private const double InitialBuildSeconds = 10;
+        private const double BuildSecondsWeight = 0.2;
+        private static readonly TimeSpan MaxRetryAfter = TimeSpan.FromMinutes(2);
+
+        private readonly ConcurrentDictionary<Guid, BuildJob> _jobs = new();
+        private readonly Channel<BuildJob> _pending = Channel.CreateUnbounded<BuildJob>(new UnboundedChannelOptions { SingleWriter = false, SingleReader = false });
+        private readonly int _maxQueued;
+        private readonly int _maxQueuedPerClient;
+        private readonly int _consumers;
+
+        // Admission state. Consumers take jobs in admission order, so a client's oldest queued job
+        // is always the next of theirs to start and a job's position is its sequence past _started
+        private readonly object _lock = new();
+        private readonly Dictionary<string, Queue<long>> _queuedByClient = new();
+        private int _queued;
+        private long _admitted;
+        private long _started;
+        private double _buildSeconds = InitialBuildSeconds;
+
+        public BuildJobQueue(IOptions<Settings> settings)
+        {
+            _maxQueued = Math.Max(1, settings.Value.MaxQueuedBuilds);
+            _maxQueuedPerClient = Math.Max(1, settings.Value.MaxQueuedBuildsPerClient);
+            _consumers = ConsumersFor(settings.Value);
+        }
+
+        internal static int ConsumersFor(Settings settings) =>
+            Math.Max(1, settings.BuildConsumers ?? settings.CompileWorkers ?? Environment.ProcessorCount);
+
+        internal ChannelReader<BuildJob> Pending => _pending.Reader;
+
+        public BuildAdmission TryEnqueue(ConfigurationDefinition configuration, string client)
+        {
+            SweepFinished();
+            BuildJob job;
+            lock (_lock)
+            {
+                if (_queued >= _maxQueued)
+                {
+                    return Reject(BuildRejection.QueueFull, EstimateWait(1));
+                }
+
+                if (!_queuedByClient.TryGetValue(client, out var mine))
+                {
+                    mine = new Queue<long>();
+                }
+                else if (mine.Count >= _maxQueuedPerClient)
+                {
+                    return Reject(BuildRejection.ClientLimit, EstimateWait(mine.Peek() - _started));
+                }
+
+                job = new BuildJob(Guid.NewGuid(), configuration, client, ++_admitted);
+                _jobs[job.Id] = job;
+                if (!_pending.Writer.TryWrite(job))
+                {
+                    _jobs.TryRemove(job.Id, out _);
+                    _admitted--;
+                    throw new InvalidOperationException("Build queue is closed.");
+                }
+
+                mine.Enqueue(job.Sequence);
+                _queuedByClient[client] = mine;
+                _queued++;
+            }
+
+            BuildMetrics.QueueDepth.Add(1);
+            return new BuildAdmission(job, BuildRejection.None, PositionOf(job), TimeSpan.Zero);
+        }
+
+        public bool TryGet(Guid id, out BuildJob job) => _jobs.TryGetValue(id, out job!);
+
+        public int PositionOf(BuildJob job)
+        {
+            if (job.Stage != BuildStage.Queued)
+            {
+                return 0;
+            }
+
+            lock (_lock)
+            {
+                return (int)Math.Max(0, job.Sequence - _started);
+            }
+        }
+
+        internal void Started(BuildJob job)
+        {
+            lock (_lock)
+            {
+                _queued--;
+                _started++;
+                if (_queuedByClient.TryGetValue(job.Client, out var mine))
+                {
+                    mine.Dequeue();
+                    if (mine.Count == 0)
+                    {
+                        _queuedByClient.Remove(job.Client);
+                    }
+                }
+            }
+
+            BuildMetrics.QueueDepth.Add(-1);
+        }
+
+        // Cache hits and patches count as much as compiles: the estimate is for whatever is queued
+        internal void Finished(double seconds)
+        {
+            lock (_lock)
+            {
+                _buildSeconds += (seconds - _buildSeconds) * BuildSecondsWeight;
+            }
+        }
+
+        // Time for the first `jobs` queued jobs to leave the queue, with every consumer busy
+        private TimeSpan EstimateWait(long jobs)
+        {
+            var rounds = Math.Ceiling(Math.Max(1, jobs) / (double)_consumers);
+            var wait = TimeSpan.FromSeconds(Math.Max(1, rounds * _buildSeconds));
+            return wait < MaxRetryAfter ? wait : MaxRetryAfter;
+        }
+
+        private BuildAdmission Reject(BuildRejection rejection, TimeSpan retryAfter)
+        {
+            BuildMetrics.Rejections.Add(1, new KeyValuePair<string, object?>("reason", rejection == BuildRejection.QueueFull ? "queue_full" : "client_limit"));
+            return new BuildAdmission(null, rejection, _queued, retryAfter);
+        }
+
+        private void SweepFinished()
+        {
+            var cutoff = DateTimeOffset.UtcNow - Retention;
+            foreach (var (id, job) in _jobs)
+            {
+                if (job.FinishedAt is { } finishedAt && finishedAt < cutoff)
+                {
+                    _jobs.TryRemove(id, out _);
+                }
+            }
+        }
+    }
+
+    // One consumer per compile worker, or BuildConsumers, so queued jobs never hold more threads than
+    // can build at once. A build blocks for its whole compile, local or on a worker pod, so each
+    // consumer has a dedicated thread rather than holding one of the thread pool's
+    public sealed class BuildJobWorker : BackgroundService
+    {
+        private readonly BuildJobQueue _queue;
+        private readonly IFirmwareBuilder _firmwareBuilder;
+        private readonly ILogger<BuildJobWorker> _logger;
+        private readonly int _consumers;
+
+        public BuildJobWorker(BuildJobQueue queue, IFirmwareBuilder firmwareBuilder, IOptions<Settings> settings, ILogger<BuildJobWorker> logger)
+        {
+            _queue = queue;
+            _firmwareBuilder = firmwareBuilder;
+            _logger = logger;
+            _consumers = BuildJobQueue.ConsumersFor(settings.Value);
+        }
+
+        protected override Task ExecuteAsync(CancellationToken stoppingToken)
+        {
+            return Task.WhenAll(Enumerable.Range(0, _consumers).Select(_ => Task.Factory.StartNew(
+                () => Consume(stoppingToken), stoppingToken, TaskCreationOptions.LongRunning, TaskScheduler.Default)));
+        }
+
+        private void Consume(CancellationToken stoppingToken)
+        {
+            try
+            {
+                while (_queue.Pending.WaitToReadAsync(stoppingToken).AsTask().GetAwaiter().GetResult())
+                {
+                    while (_queue.Pending.TryRead(out var job))
+                    {
+                        Run(job);
+                    }
+                }
+            }
+            catch (OperationCanceledException) when (stoppingToken.IsCancellationRequested)
+            {
+            }
+        }
+
+        private void Run(BuildJob job)
+        {
+            _queue.Started(job);
+            BuildMetrics.QueueWait.Record(BuildMetrics.Seconds(job.EnqueuedAt));
+            using var activity = BuildMetrics.ActivitySource.StartActivity("BuildJob", ActivityKind.Internal, job.Parent);
+            activity?.SetTag("keypad.job_id", job.Id);
+            var started = Stopwatch.GetTimestamp();
+            try
+            {
+                job.Finish(_firmwareBuilder.BuildFirmware(job.Configuration, job.Advance));
+            }
+            catch (Exception ex)
+            {
+                _logger.LogError(ex, "Build job {JobId} failed.", job.Id);
+                job.Finish(new FirmwareBuildResult(false, null, ex.Message));
+            }
+            finally
+            {
+                _queue.Finished(BuildMetrics.Seconds(started));
+            }
+        }
+    }
+}
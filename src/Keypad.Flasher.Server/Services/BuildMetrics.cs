@@ -0,0 +1,58 @@
+using System.Diagnostics;
+using System.Diagnostics.Metrics;
+
+namespace Keypad.Flasher.Server.Services
+{
+    // Instruments for the build pipeline. They are plain System.Diagnostics types, so recording
+    // costs nothing until something listens; Program.cs exports them through OpenTelemetry
+    internal static class BuildMetrics
+    {
+        public const string Name = "Keypad.Flasher.Build";
+
+        public static readonly ActivitySource ActivitySource = new(Name);
+
+        private static readonly Meter Meter = new(Name);
+
+        public static readonly Histogram<double> QueueWait = Meter.CreateHistogram<double>(
+            "keypad.build.queue.wait", "s", "Time a build job spent queued before a consumer picked it up.");
+
+        public static readonly Histogram<double> WorkerWait = Meter.CreateHistogram<double>(
+            "keypad.build.worker.wait", "s", "Time a compile waited for a free compile worker.");
+
+        public static readonly Histogram<double> GenerationDuration = Meter.CreateHistogram<double>(
+            "keypad.build.generation.duration", "s", "Time to generate configuration.h and configuration.c.");
+
+        public static readonly Histogram<double> WorkspaceDuration = Meter.CreateHistogram<double>(
+            "keypad.build.workspace.duration", "s", "Time to prepare a compile workspace, by warm or cold.");
+
+        public static readonly Histogram<double> CompileDuration = Meter.CreateHistogram<double>(
+            "keypad.build.compile.duration", "s", "arduino-cli compile time, by fqbn and outcome.");
+
+        public static readonly Histogram<long> OutputSize = Meter.CreateHistogram<long>(
+            "keypad.build.output.size", "By", "Size of the Intel HEX image returned to the client.");
+
+        public static readonly Counter<long> CacheLookups = Meter.CreateCounter<long>(
+            "keypad.build.cache.lookups", "{lookup}", "Finished-image cache lookups, by hit or miss.");
+
+        public static readonly Counter<long> Builds = Meter.CreateCounter<long>(
+            "keypad.build.builds", "{build}", "Builds past the cache, by how they were produced: patched or compiled.");
+
+        public static readonly Counter<long> Coalesced = Meter.CreateCounter<long>(
+            "keypad.build.coalesced", "{request}", "Requests served by joining an identical in-flight build.");
+
+        public static readonly UpDownCounter<long> ActiveCompiles = Meter.CreateUpDownCounter<long>(
+            "keypad.build.compiles.active", "{compile}", "arduino-cli processes running right now.");
+
+        public static readonly UpDownCounter<long> QueueDepth = Meter.CreateUpDownCounter<long>(
+            "keypad.build.queue.depth", "{job}", "Build jobs waiting for a consumer.");
+
+        public static readonly Counter<long> Rejections = Meter.CreateCounter<long>(
+            "keypad.build.rejections", "{request}", "Build requests turned away, by reason: queue_full, client_limit or rate_limit.");
+
+        // Compiles waiting in the shared queue for a worker pod; the worker autoscaler follows it
+        public static void ObserveSharedQueue(Func<int> depth) => Meter.CreateObservableGauge(
+            "keypad.build.shared_queue.depth", depth, "{job}", "Compiles in the shared build queue waiting for a worker pod.");
+
+        public static double Seconds(long startTimestamp) => Stopwatch.GetElapsedTime(startTimestamp).TotalSeconds;
+    }
+}
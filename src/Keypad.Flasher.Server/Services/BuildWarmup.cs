@@ -0,0 +1,125 @@
+using Keypad.Flasher.Server.Configuration;
+using Microsoft.Extensions.Diagnostics.HealthChecks;
+using Microsoft.Extensions.Hosting;
+using Microsoft.Extensions.Logging;
+using Microsoft.Extensions.Options;
+using LayoutConfigurationBuilder = Keypad.Flasher.Server.Configuration.ConfigurationBuilder;
+
+namespace Keypad.Flasher.Server.Services
+{
+    // Compiles once per fqbn at startup so the first real request finds the core index loaded, the
+    // toolchain extracted and the core already in the build cache. The pod reports not-ready on
+    // /readyz until this has finished. It goes to the compiler directly: an image another pod left
+    // in a shared FirmwareBuilder cache would otherwise answer it and leave this pod's workspaces cold
+    public sealed class BuildWarmup : BackgroundService
+    {
+        private readonly IFirmwareCompiler _compiler;
+        private readonly ConfigurationGenerator _generator;
+        private readonly ILogger<BuildWarmup> _logger;
+        private readonly bool _enabled;
+        private volatile WarmupState _state = WarmupState.Running;
+
+        public BuildWarmup(IFirmwareCompiler compiler, ConfigurationGenerator generator, IOptions<Settings> settings, ILogger<BuildWarmup> logger)
+        {
+            _compiler = compiler;
+            _generator = generator;
+            _logger = logger;
+            _enabled = settings.Value.WarmupOnStartup;
+        }
+
+        public WarmupState State => _state;
+
+        // One configuration per fqbn FirmwareBuilder can pick
+        internal static IEnumerable<(string Name, ConfigurationDefinition Configuration)> Configurations()
+        {
+            yield return ("keypad", LayoutConfigurationBuilder.FromLayout(
+                new DeviceLayout(
+                    Buttons: new[] { new ButtonLayout(0, 11, true, -1, false, false) },
+                    Encoders: Array.Empty<EncoderLayout>(),
+                    NeoPixelPin: -1,
+                    NeoPixelReversed: false),
+                new BindingProfile(
+                    Buttons: new[] { new ButtonBindingEntry(0, new HidSequenceBinding("a", 0)) },
+                    Encoders: Array.Empty<EncoderBindingEntry>()),
+                debugMode: false));
+            yield return ("debug", LayoutConfigurationBuilder.ForDebug(DebugOptions.Default));
+        }
+
+        protected override Task ExecuteAsync(CancellationToken stoppingToken)
+        {
+            if (!_enabled)
+            {
+                _state = WarmupState.Ready;
+                return Task.CompletedTask;
+            }
+
+            // compiles block, so keep them off the thread that is starting the host
+            return Task.Run(() => Run(stoppingToken), stoppingToken);
+        }
+
+        private void Run(CancellationToken stoppingToken)
+        {
+            var failed = false;
+            foreach (var (name, configuration) in Configurations())
+            {
+                if (stoppingToken.IsCancellationRequested)
+                {
+                    return;
+                }
+
+                try
+                {
+                    var result = _compiler.Compile(new CompileRequest(
+                        FirmwareBuilder.FqbnFor(configuration),
+                        _generator.GenerateHeader(configuration),
+                        _generator.GenerateSource(configuration)));
+                    if (result.Success)
+                    {
+                        _logger.LogInformation("Warm-up build for {Name} firmware finished.", name);
+                        continue;
+                    }
+
+                    _logger.LogWarning("Warm-up build for {Name} firmware failed: {Error}", name, result.Error);
+                }
+                catch (Exception ex)
+                {
+                    _logger.LogWarning(ex, "Warm-up build for {Name} firmware threw.", name);
+                }
+                failed = true;
+            }
+
+            _state = failed ? WarmupState.Failed : WarmupState.Ready;
+        }
+    }
+
+    public enum WarmupState
+    {
+        Running,
+        Ready,
+        Failed
+    }
+
+    // Readiness only: a failed warm-up leaves the pod in rotation as degraded, since real requests
+    // may still compile and liveness restarts would not fix a broken toolchain
+    public sealed class BuildWarmupHealthCheck : IHealthCheck
+    {
+        public const string ReadyTag = "ready";
+
+        private readonly BuildWarmup _warmup;
+
+        public BuildWarmupHealthCheck(BuildWarmup warmup)
+        {
+            _warmup = warmup;
+        }
+
+        public Task<HealthCheckResult> CheckHealthAsync(HealthCheckContext context, CancellationToken cancellationToken = default)
+        {
+            return Task.FromResult(_warmup.State switch
+            {
+                WarmupState.Ready => HealthCheckResult.Healthy(),
+                WarmupState.Failed => HealthCheckResult.Degraded("Warm-up build failed."),
+                _ => HealthCheckResult.Unhealthy("Warm-up build is still running.")
+            });
+        }
+    }
+}
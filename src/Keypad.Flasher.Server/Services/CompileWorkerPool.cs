@@ -0,0 +1,88 @@
+using System.Collections.Concurrent;
+
+namespace Keypad.Flasher.Server.Services
+{
+    // Bounds concurrent arduino-cli runs and hands each one a worker slot with directories no other
+    // running compile touches, so builds only contend for CPU
+    internal sealed class CompileWorkerPool
+    {
+        private readonly SemaphoreSlim _available;
+        private readonly ConcurrentQueue<int> _free = new();
+        private readonly string _root;
+
+        public CompileWorkerPool(int workers, string root)
+        {
+            if (workers < 1)
+            {
+                throw new ArgumentOutOfRangeException(nameof(workers), "At least one compile worker is required.");
+            }
+
+            Workers = workers;
+            _root = root;
+            _available = new SemaphoreSlim(workers, workers);
+            for (int i = 0; i < workers; i++)
+            {
+                _free.Enqueue(i);
+            }
+        }
+
+        public int Workers { get; }
+
+        public int Busy => Workers - _available.CurrentCount;
+
+        public Lease Acquire()
+        {
+            _available.Wait();
+            if (!_free.TryDequeue(out var slot))
+            {
+                _available.Release();
+                throw new InvalidOperationException("Compile worker pool has no free slot despite a free permit.");
+            }
+
+            return new Lease(this, slot, Path.Combine(_root, slot.ToString()));
+        }
+
+        private void Return(int slot)
+        {
+            _free.Enqueue(slot);
+            _available.Release();
+        }
+
+        public sealed class Lease : IDisposable
+        {
+            private readonly CompileWorkerPool _pool;
+            private bool _disposed;
+
+            private readonly string _directory;
+
+            internal Lease(CompileWorkerPool pool, int slot, string directory)
+            {
+                _pool = pool;
+                _directory = directory;
+                Slot = slot;
+                BuildCachePath = Path.Combine(directory, "cache");
+            }
+
+            public int Slot { get; }
+
+            // Sketch copy and --build-path for one fqbn on this worker; kept between leases so the
+            // next compile with the same fqbn only rebuilds what its configuration changed
+            public string WorkspaceFor(string fqbn)
+                => Path.Combine(_directory, string.Concat(fqbn.Select(c => char.IsAsciiLetterOrDigit(c) ? c : '_')));
+
+            // ARDUINO_BUILD_CACHE_PATH; the precompiled core for this worker only
+            public string BuildCachePath { get; }
+
+            public void Dispose()
+            {
+                if (_disposed)
+                {
+                    return;
+                }
+
+                _disposed = true;
+                _pool.Return(Slot);
+            }
+        }
+    }
+}
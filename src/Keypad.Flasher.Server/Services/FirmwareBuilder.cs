@@ -1,4 +1,6 @@
+using System.Collections.Concurrent;
 using System.Diagnostics;
+using System.Security.Cryptography;
 using System.Text;
 using Keypad.Flasher.Server.Configuration;
 using Microsoft.Extensions.Logging;
@@ -6,11 +8,21 @@ using Microsoft.Extensions.Options;
 
 namespace Keypad.Flasher.Server.Services
 {
-    public sealed record FirmwareBuildResult(bool Success, byte[]? FileBytes, string? Error = null, int? ExitCode = null, string? Stdout = null, string? Stderr = null);
+    public sealed record FirmwareBuildResult(bool Success, byte[]? FileBytes, string? Error = null, int? ExitCode = null, string? Stdout = null, string? Stderr = null, FirmwareFootprint? Footprint = null);
 
     public interface IFirmwareBuilder
     {
-        FirmwareBuildResult BuildFirmware(ConfigurationDefinition configuration);
+        // onStage hears Generating, then Compiling only when arduino-cli actually runs
+        FirmwareBuildResult BuildFirmware(ConfigurationDefinition configuration, Action<BuildStage>? onStage = null);
+
+        // Hash of the firmware sources; images built from the same request and version are identical
+        string FirmwareVersion { get; }
+
+        // Cheap enough to run on every edit: generates the configuration but never compiles
+        FirmwareBudget MeasureBudget(ConfigurationDefinition configuration);
+
+        // The finished image when the result cache already holds it; generates sources, never compiles
+        bool TryGetCached(ConfigurationDefinition configuration, out byte[] image);
     }
 
     public sealed class FirmwareBuilder : IFirmwareBuilder
@@ -18,163 +30,231 @@ namespace Keypad.Flasher.Server.Services
         private readonly Settings _settings;
         private readonly ConfigurationGenerator _generator;
         private readonly ILogger<FirmwareBuilder> _logger;
-        private readonly object _compileLock = new();
+        private readonly IFirmwareCompiler _compiler;
+
+        // Compiled images by layout shape; a request whose shape was compiled before only needs its
+        // configuration blob written into the cached image. Shapes seen least recently go first
+        private const int MaxBaseImages = 64;
+        private readonly FirmwareCache _baseImages = new(MaxBaseImages);
 
-        public FirmwareBuilder(IOptions<Settings> settings, ConfigurationGenerator generator, ILogger<FirmwareBuilder> logger)
+        // Section sizes by layout shape, as the linker reported them; patching the blob changes none
+        private readonly ConcurrentDictionary<string, FirmwareFootprint> _footprints = new();
+
+        private readonly FirmwareCache _buildCache;
+        private readonly ConcurrentDictionary<string, BuildFlight> _inFlight = new();
+        private readonly Lazy<string> _firmwareHash;
+
+        public FirmwareBuilder(IOptions<Settings> settings, ConfigurationGenerator generator, IFirmwareCompiler compiler, ILogger<FirmwareBuilder> logger)
         {
             _settings = settings.Value;
             _generator = generator;
+            _compiler = compiler;
             _logger = logger;
+            _buildCache = new FirmwareCache(_settings.BuildCacheSize, _settings.BuildCachePath, _settings.BuildCacheDiskSize);
+            _firmwareHash = new Lazy<string>(() => ComputeFirmwareHash(Path.GetFullPath(_settings.FirmwarePath)));
         }
 
-        public FirmwareBuildResult BuildFirmware(ConfigurationDefinition configuration)
+        public string FirmwareVersion => _firmwareHash.Value;
+
+        public FirmwareBuildResult BuildFirmware(ConfigurationDefinition configuration, Action<BuildStage>? onStage = null)
         {
-            var firmwarePath = Path.GetFullPath(_settings.FirmwarePath);
-            var tempPath = Path.Combine(Path.GetTempPath(), Guid.NewGuid().ToString());
-
-            lock (_compileLock)
-            {
-                Directory.CreateDirectory(tempPath);
-                var workingFirmwarePath = Path.Combine(tempPath, "Keypad.Firmware");
-                CopyDirectory(firmwarePath, workingFirmwarePath);
-                var outputPath = Path.Combine(tempPath, "output");
-
-                var fqbn = configuration.DebugMode
-                    ? "CH55xDuino:mcs51:ch552:usb_settings=usbcdc,clock=16internal"
-                    : "CH55xDuino:mcs51:ch552:usb_settings=user148,clock=16internal";
-                var headerPath = Path.Combine(workingFirmwarePath, "configuration.h");
-                var sourcePath = Path.Combine(workingFirmwarePath, "configuration.c");
-                File.WriteAllText(headerPath, _generator.GenerateHeader(configuration));
-                File.WriteAllText(sourcePath, _generator.GenerateSource(configuration));
-
-                Directory.CreateDirectory(outputPath);
-                try
+            onStage?.Invoke(BuildStage.Generating);
+            var fqbn = FqbnFor(configuration);
+            using var activity = BuildMetrics.ActivitySource.StartActivity("BuildFirmware");
+            activity?.SetTag("keypad.fqbn", fqbn);
+
+            var generationStarted = Stopwatch.GetTimestamp();
+            var header = _generator.GenerateHeader(configuration);
+            var firmwareHash = _firmwareHash.Value;
+            var buildKey = ComputeKey(fqbn, firmwareHash, header, _generator.GenerateSource(configuration));
+            var imageKey = ComputeKey(fqbn, firmwareHash, header, _generator.GenerateFixedSource(configuration));
+            BuildMetrics.GenerationDuration.Record(BuildMetrics.Seconds(generationStarted));
+            activity?.SetTag("keypad.build_key", buildKey);
+
+            if (_buildCache.TryGet(buildKey, out var cached))
+            {
+                _logger.LogInformation("Build cache hit {BuildKey} ({Hits} hits, {Misses} misses).", buildKey, _buildCache.Hits, _buildCache.Misses);
+                BuildMetrics.CacheLookups.Add(1, new KeyValuePair<string, object?>("result", "hit"));
+                activity?.SetTag("keypad.served_from", "cache");
+                BuildMetrics.OutputSize.Record(cached.Length);
+                return new FirmwareBuildResult(true, cached, Footprint: _footprints.GetValueOrDefault(imageKey));
+            }
+
+            BuildMetrics.CacheLookups.Add(1, new KeyValuePair<string, object?>("result", "miss"));
+            _logger.LogInformation("Build cache miss {BuildKey} ({Hits} hits, {Misses} misses).", buildKey, _buildCache.Hits, _buildCache.Misses);
+
+            // identical requests arriving before the first one finishes share its build instead of
+            // queueing their own; the result cache takes over once it is stored
+            var flight = _inFlight.GetOrAdd(buildKey, _ => new BuildFlight(report => BuildUncached(configuration, fqbn, header, imageKey, buildKey, report)));
+            try
+            {
+                var result = flight.Wait(onStage);
+                activity?.SetTag("keypad.success", result.Success);
+                if (result.FileBytes != null)
                 {
-                    var args = new ProcessStartInfo
-                    {
-                        FileName = "arduino-cli",
-                        RedirectStandardOutput = true,
-                        RedirectStandardError = true,
-                        WorkingDirectory = workingFirmwarePath,
-                        UseShellExecute = false,
-                        CreateNoWindow = true
-                    };
-                    args.ArgumentList.Add("compile");
-                    args.ArgumentList.Add("--fqbn");
-                    args.ArgumentList.Add(fqbn);
-                    args.ArgumentList.Add("--config-file");
-                    args.ArgumentList.Add("arduino-cli.yaml");
-                    args.ArgumentList.Add("--export-binaries");
-                    args.ArgumentList.Add("--no-color");
-                    args.ArgumentList.Add("--output-dir");
-                    args.ArgumentList.Add(outputPath);
-
-                    var stdout = new StringBuilder();
-                    var stderr = new StringBuilder();
-
-                    using (var process = Process.Start(args))
-                    {
-                        if (process == null)
-                        {
-                            _logger.LogError("Failed to start arduino-cli process.");
-                            return new FirmwareBuildResult(false, null, "Failed to start arduino-cli process.");
-                        }
-
-                        process.OutputDataReceived += (_, e) => { if (e.Data != null) stdout.AppendLine(e.Data); };
-                        process.ErrorDataReceived += (_, e) => { if (e.Data != null) stderr.AppendLine(e.Data); };
-                        process.BeginOutputReadLine();
-                        process.BeginErrorReadLine();
-
-                        process.WaitForExit();
-
-                        if (process.ExitCode != 0)
-                        {
-                            var stderrWithConfig = new StringBuilder(stderr.ToString());
-                            try
-                            {
-                                if (File.Exists(sourcePath))
-                                {
-                                    stderrWithConfig.AppendLine("\n--- configuration.c (generated) ---\n");
-                                    stderrWithConfig.AppendLine(File.ReadAllText(sourcePath));
-                                }
-                                if (File.Exists(headerPath))
-                                {
-                                    stderrWithConfig.AppendLine("\n--- configuration.h (generated) ---\n");
-                                    stderrWithConfig.AppendLine(File.ReadAllText(headerPath));
-                                }
-                            }
-                            catch (Exception ex)
-                            {
-                                stderrWithConfig.AppendLine($"\n--- config capture failed: {ex.Message} ---\n");
-                            }
-
-                            var stderrCombined = stderrWithConfig.ToString();
-                            _logger.LogError("arduino-cli compile failed. ExitCode: {ExitCode}\nStdOut:\n{StdOut}\nStdErr:\n{StdErr}", process.ExitCode, stdout.ToString(), stderrCombined);
-                            return new FirmwareBuildResult(false, null, "Compile failed", process.ExitCode, stdout.ToString(), stderrCombined);
-                        }
-
-                        _logger.LogInformation("arduino-cli compile succeeded. ExitCode: {ExitCode}\nStdOut:\n{StdOut}", process.ExitCode, stdout.ToString());
-                    }
-
-                    var path = Path.Combine(outputPath, "Keypad.Firmware.ino.hex");
-
-                    if (!File.Exists(path))
-                    {
-                        _logger.LogError("Compiled firmware file not found at {Path}", path);
-                        return new FirmwareBuildResult(false, null, "Compiled firmware file not found.");
-                    }
-
-                    var fileBytes = File.ReadAllBytes(path);
-
-                    return new FirmwareBuildResult(true, fileBytes);
+                    BuildMetrics.OutputSize.Record(result.FileBytes.Length);
                 }
-                finally
+                return result;
+            }
+            finally
+            {
+                if (_inFlight.TryRemove(new KeyValuePair<string, BuildFlight>(buildKey, flight)) && flight.Joined > 0)
                 {
-                    try
-                    {
-                        Directory.Delete(tempPath, true);
-                    }
-                    catch (Exception ex)
-                    {
-                        _logger.LogWarning(ex, "Failed to cleanup temp directory {TempPath}", tempPath);
-                    }
+                    BuildMetrics.Coalesced.Add(flight.Joined);
+                    _logger.LogInformation("Build {BuildKey} served {Joined} coalesced requests.", buildKey, flight.Joined);
                 }
             }
         }
 
-        private static void CopyDirectory(string sourceDir, string destinationDir)
+        public FirmwareBudget MeasureBudget(ConfigurationDefinition configuration)
         {
-            if (!Directory.Exists(sourceDir))
+            var blob = new MemoryUsage(_generator.MeasureBlob(configuration), ConfigurationBlob.Capacity);
+            if (blob.Used > blob.Limit)
             {
-                throw new DirectoryNotFoundException($"Source directory not found: {sourceDir}");
+                return new FirmwareBudget(blob, null);
             }
 
-            Directory.CreateDirectory(destinationDir);
+            var imageKey = ComputeKey(FqbnFor(configuration), _firmwareHash.Value, _generator.GenerateHeader(configuration), _generator.GenerateFixedSource(configuration));
+            return new FirmwareBudget(blob, _footprints.GetValueOrDefault(imageKey));
+        }
 
-            var options = new EnumerationOptions
-            {
-                RecurseSubdirectories = true,
-                IgnoreInaccessible = false
-            };
+        public bool TryGetCached(ConfigurationDefinition configuration, out byte[] image)
+        {
+            var fqbn = FqbnFor(configuration);
+            var buildKey = ComputeKey(fqbn, _firmwareHash.Value, _generator.GenerateHeader(configuration), _generator.GenerateSource(configuration));
+            return _buildCache.TryPeek(buildKey, out image);
+        }
 
-            foreach (var directoryPath in Directory.EnumerateDirectories(sourceDir, "*", options))
+        internal static string FqbnFor(ConfigurationDefinition configuration) => configuration.DebugMode
+            ? "CH55xDuino:mcs51:ch552:usb_settings=usbcdc,clock=16internal"
+            : "CH55xDuino:mcs51:ch552:usb_settings=user148,clock=16internal";
+
+        private FirmwareBuildResult BuildUncached(ConfigurationDefinition configuration, string fqbn, string header, string imageKey, string buildKey, Action<BuildStage> onStage)
+        {
+            if (_baseImages.TryGet(imageKey, out var baseImage) && TryPatchImage(imageKey, baseImage, configuration, out var patched))
             {
-                var relativePath = Path.GetRelativePath(sourceDir, directoryPath);
-                Directory.CreateDirectory(Path.Combine(destinationDir, relativePath));
+                BuildMetrics.Builds.Add(1, new KeyValuePair<string, object?>("method", "patched"));
+                Activity.Current?.SetTag("keypad.served_from", "patch");
+                _buildCache.Put(buildKey, patched);
+                return new FirmwareBuildResult(true, patched, Footprint: _footprints.GetValueOrDefault(imageKey));
             }
 
-            foreach (var filePath in Directory.EnumerateFiles(sourceDir, "*", options))
+            BuildMetrics.Builds.Add(1, new KeyValuePair<string, object?>("method", "compiled"));
+            Activity.Current?.SetTag("keypad.served_from", "compile");
+            var result = _compiler.Compile(new CompileRequest(fqbn, header, _generator.GenerateSource(configuration)), onStage);
+            if (result.Success && result.FileBytes != null && CodeOverlapsBlob(result.FileBytes, out var overlap))
+            {
+                _logger.LogError("Compiled image for {ImageKey} is unusable: {Error}", imageKey, overlap);
+                return new FirmwareBuildResult(false, null, overlap, Footprint: result.Footprint);
+            }
+            if (result.Success && result.FileBytes != null)
             {
-                var relativePath = Path.GetRelativePath(sourceDir, filePath);
-                var targetPath = Path.Combine(destinationDir, relativePath);
-                var targetDirectory = Path.GetDirectoryName(targetPath);
-                if (!string.IsNullOrEmpty(targetDirectory))
+                if (result.Footprint != null)
                 {
-                    Directory.CreateDirectory(targetDirectory);
+                    _footprints[imageKey] = result.Footprint;
                 }
+                RememberBaseImage(imageKey, result.FileBytes);
+                _buildCache.Put(buildKey, result.FileBytes);
+            }
+            return result;
+        }
+
+        // With the full source this identifies the finished image. With the fixed source it identifies
+        // a base image: anything the configuration blob cannot carry (capacities, port masks, options,
+        // custom functions in hid_function_table) is in the header or fixed source
+        private static string ComputeKey(string fqbn, string firmwareHash, string header, string source)
+        {
+            var bytes = Encoding.UTF8.GetBytes(fqbn + "\n" + firmwareHash + "\n" + header + "\n" + source);
+            return Convert.ToHexString(SHA256.HashData(bytes));
+        }
+
+        // Firmware sources change only between deployments, so this is computed once per process;
+        // the generated configuration files are excluded because every build overwrites them
+        internal static string ComputeFirmwareHash(string firmwarePath)
+        {
+            if (!Directory.Exists(firmwarePath))
+            {
+                throw new DirectoryNotFoundException($"Source directory not found: {firmwarePath}");
+            }
+
+            using var hash = IncrementalHash.CreateHash(HashAlgorithmName.SHA256);
+            var files = Directory.EnumerateFiles(firmwarePath, "*", new EnumerationOptions { RecurseSubdirectories = true })
+                .Select(path => Path.GetRelativePath(firmwarePath, path).Replace('\\', '/'))
+                .Where(relative => relative is not ("configuration.c" or "configuration.h"))
+                .OrderBy(relative => relative, StringComparer.Ordinal);
+            foreach (var relative in files)
+            {
+                hash.AppendData(Encoding.UTF8.GetBytes(relative + "\n"));
+                hash.AppendData(File.ReadAllBytes(Path.Combine(firmwarePath, relative)));
+            }
+
+            return Convert.ToHexString(hash.GetHashAndReset());
+        }
+
+        private bool TryPatchImage(string imageKey, byte[] baseImage, ConfigurationDefinition configuration, out byte[] patched)
+        {
+            var stopwatch = Stopwatch.StartNew();
+            try
+            {
+                // configuration_load() only reads the header and payload, so bytes past them can stay as they were
+                var blob = _generator.GenerateBlob(configuration);
+                patched = Encoding.ASCII.GetBytes(IntelHex.Patch(Encoding.ASCII.GetString(baseImage), ConfigurationBlob.Address, blob));
+            }
+            catch (Exception ex) when (ex is InvalidOperationException or FormatException)
+            {
+                _logger.LogWarning(ex, "Patching base image {ImageKey} failed, compiling instead.", imageKey);
+                _baseImages.Remove(imageKey);
+                patched = Array.Empty<byte>();
+                return false;
+            }
+
+            _logger.LogInformation("Patched configuration blob into base image {ImageKey} in {ElapsedMs} ms.", imageKey, stopwatch.ElapsedMilliseconds);
+            return true;
+        }
+
+        // The blob is an absolute area the linker does not place code around, so code that has grown
+        // past CONFIGURATION_BLOB_ADDRESS links on top of it and only shows as flash written twice
+        internal static bool CodeOverlapsBlob(byte[] image, out string error)
+        {
+            error = string.Empty;
+            int written;
+            try
+            {
+                written = IntelHex.CountBytes(Encoding.ASCII.GetString(image), ConfigurationBlob.Address, ConfigurationBlob.Capacity);
+            }
+            catch (FormatException ex)
+            {
+                error = $"Compiled image could not be read: {ex.Message}";
+                return true;
+            }
+
+            if (written > ConfigurationBlob.Capacity)
+            {
+                error = $"Firmware code reaches 0x{ConfigurationBlob.Address:X4}, where the configuration blob starts; {written - ConfigurationBlob.Capacity} bytes of it overlap the blob.";
+                return true;
+            }
+
+            return false;
+        }
 
-                File.Copy(filePath, targetPath, overwrite: true);
+        private void RememberBaseImage(string imageKey, byte[] image)
+        {
+            try
+            {
+                var magic = IntelHex.Read(Encoding.ASCII.GetString(image), ConfigurationBlob.Address, 2);
+                if (magic[0] != (byte)'K' || magic[1] != (byte)'P')
+                {
+                    _logger.LogWarning("Compiled image has no configuration blob at 0x{Address:X4}; not reusing it.", ConfigurationBlob.Address);
+                    return;
+                }
+            }
+            catch (Exception ex) when (ex is InvalidOperationException or FormatException)
+            {
+                _logger.LogWarning(ex, "Compiled image could not be read as a base image; not reusing it.");
+                return;
             }
+
+            _baseImages.Put(imageKey, image);
         }
     }
 }
@@ -0,0 +1,244 @@
+namespace Keypad.Flasher.Server.Services
+{
+    // Finished images by build key, least recently used first out. With a directory the images also
+    // survive restarts and can be shared between instances mounting the same volume; the directory
+    // holds up to diskCapacity of them, by last write time, which every hit refreshes
+    internal sealed class FirmwareCache
+    {
+        private readonly int _capacity;
+        private readonly int _diskCapacity;
+        private readonly string? _directory;
+        private readonly object _lock = new();
+        private readonly LinkedList<(string Key, byte[] Image)> _order = new();
+        private readonly Dictionary<string, LinkedListNode<(string Key, byte[] Image)>> _entries = new();
+        private long _hits;
+        private long _misses;
+
+        public FirmwareCache(int capacity, string? directory = null, int? diskCapacity = null)
+        {
+            if (capacity < 1)
+            {
+                throw new ArgumentOutOfRangeException(nameof(capacity), "The build cache must hold at least one image.");
+            }
+            if (diskCapacity < 1)
+            {
+                throw new ArgumentOutOfRangeException(nameof(diskCapacity), "The build cache directory must hold at least one image.");
+            }
+
+            _capacity = capacity;
+            _diskCapacity = diskCapacity ?? capacity;
+            _directory = string.IsNullOrWhiteSpace(directory) ? null : Path.GetFullPath(directory);
+            if (_directory != null)
+            {
+                Directory.CreateDirectory(_directory);
+            }
+        }
+
+        public long Hits => Interlocked.Read(ref _hits);
+
+        public long Misses => Interlocked.Read(ref _misses);
+
+        public int Count
+        {
+            get
+            {
+                lock (_lock)
+                {
+                    return _entries.Count;
+                }
+            }
+        }
+
+        public bool TryGet(string key, out byte[] image)
+        {
+            if (Lookup(key, out image))
+            {
+                Interlocked.Increment(ref _hits);
+                return true;
+            }
+
+            Interlocked.Increment(ref _misses);
+            return false;
+        }
+
+        // A lookup that leaves Hits and Misses alone, for checks made ahead of a build that will look again
+        public bool TryPeek(string key, out byte[] image) => Lookup(key, out image);
+
+        private bool Lookup(string key, out byte[] image)
+        {
+            var found = false;
+            image = Array.Empty<byte>();
+            lock (_lock)
+            {
+                if (_entries.TryGetValue(key, out var node))
+                {
+                    _order.Remove(node);
+                    _order.AddFirst(node);
+                    image = node.Value.Image;
+                    found = true;
+                }
+            }
+
+            if (found)
+            {
+                TouchOnDisk(key);
+                return true;
+            }
+
+            var stored = ReadFromDisk(key);
+            if (stored != null)
+            {
+                TouchOnDisk(key);
+                Remember(key, stored);
+                image = stored;
+                return true;
+            }
+
+            return false;
+        }
+
+        public void Put(string key, byte[] image)
+        {
+            Remember(key, image);
+            if (WriteToDisk(key, image))
+            {
+                TrimDisk();
+            }
+        }
+
+        // Drops an image that turned out to be unusable, on disk as well so no instance reads it back
+        public void Remove(string key)
+        {
+            lock (_lock)
+            {
+                if (_entries.Remove(key, out var node))
+                {
+                    _order.Remove(node);
+                }
+            }
+
+            if (_directory != null)
+            {
+                try
+                {
+                    File.Delete(PathFor(key));
+                }
+                catch (Exception ex) when (ex is IOException or UnauthorizedAccessException)
+                {
+                }
+            }
+        }
+
+        private void Remember(string key, byte[] image)
+        {
+            lock (_lock)
+            {
+                if (_entries.TryGetValue(key, out var existing))
+                {
+                    _order.Remove(existing);
+                }
+
+                _entries[key] = _order.AddFirst((key, image));
+                while (_entries.Count > _capacity)
+                {
+                    var oldest = _order.Last!;
+                    _order.RemoveLast();
+                    _entries.Remove(oldest.Value.Key);
+                }
+            }
+        }
+
+        private byte[]? ReadFromDisk(string key)
+        {
+            if (_directory == null)
+            {
+                return null;
+            }
+
+            try
+            {
+                return File.ReadAllBytes(PathFor(key));
+            }
+            catch (Exception ex) when (ex is IOException or UnauthorizedAccessException)
+            {
+                return null;
+            }
+        }
+
+        private bool WriteToDisk(string key, byte[] image)
+        {
+            if (_directory == null)
+            {
+                return false;
+            }
+
+            // write then rename so a reader on another instance never sees half an image
+            var temporary = Path.Combine(_directory, $"{key}.{Guid.NewGuid():N}.tmp");
+            try
+            {
+                File.WriteAllBytes(temporary, image);
+                File.Move(temporary, PathFor(key), overwrite: true);
+                return true;
+            }
+            catch (Exception ex) when (ex is IOException or UnauthorizedAccessException)
+            {
+                try
+                {
+                    File.Delete(temporary);
+                }
+                catch (Exception cleanup) when (cleanup is IOException or UnauthorizedAccessException)
+                {
+                }
+                return false;
+            }
+        }
+
+        private void TouchOnDisk(string key)
+        {
+            if (_directory == null)
+            {
+                return;
+            }
+
+            try
+            {
+                File.SetLastWriteTimeUtc(PathFor(key), DateTime.UtcNow);
+            }
+            catch (Exception ex) when (ex is IOException or UnauthorizedAccessException)
+            {
+            }
+        }
+
+        // Other instances trim the same directory, so files may already be gone when deleted
+        private void TrimDisk()
+        {
+            FileInfo[] files;
+            try
+            {
+                files = new DirectoryInfo(_directory!).GetFiles("*.hex");
+            }
+            catch (Exception ex) when (ex is IOException or UnauthorizedAccessException)
+            {
+                return;
+            }
+
+            if (files.Length <= _diskCapacity)
+            {
+                return;
+            }
+
+            foreach (var stale in files.OrderByDescending(file => file.LastWriteTimeUtc).Skip(_diskCapacity))
+            {
+                try
+                {
+                    stale.Delete();
+                }
+                catch (Exception ex) when (ex is IOException or UnauthorizedAccessException)
+                {
+                }
+            }
+        }
+
+        private string PathFor(string key) => Path.Combine(_directory!, key + ".hex");
+    }
+}
@@ -0,0 +1,59 @@
+using System.Globalization;
+using System.Text.RegularExpressions;
+
+namespace Keypad.Flasher.Server.Services
+{
+    public sealed record MemoryUsage(int Used, int Limit);
+
+    // What a linked image occupies: flash, xdata globals, and internal RAM below the stack
+    public sealed record FirmwareFootprint(MemoryUsage? Code, MemoryUsage? Xdata, MemoryUsage? Data)
+    {
+        // SDCC writes "<sketch>.mem" next to the .ihx; its "Other memory" table has the flash and
+        // xdata totals and the stack line says how much of the 256 bytes of internal RAM is left
+        private static readonly Regex MemFlash = new(@"^\s*ROM/EPROM/FLASH\s+(?:0x[0-9a-fA-F]+\s+0x[0-9a-fA-F]+\s+)?(\d+)\s+(\d+)", RegexOptions.Multiline);
+        private static readonly Regex MemXdata = new(@"^\s*EXTERNAL RAM\s+(?:0x[0-9a-fA-F]+\s+0x[0-9a-fA-F]+\s+)?(\d+)\s+(\d+)", RegexOptions.Multiline);
+        private static readonly Regex MemStack = new(@"Stack starts at: 0x([0-9a-fA-F]+) \(sp set to 0x[0-9a-fA-F]+\) with (\d+) bytes available");
+
+        // arduino-cli's own summary; CH55xDuino counts xdata as its dynamic memory
+        private static readonly Regex CliFlash = new(@"Sketch uses (\d+) bytes .*?Maximum is (\d+) bytes");
+        private static readonly Regex CliXdata = new(@"Global variables use (\d+) bytes .*?Maximum is (\d+) bytes");
+
+        // The memory map wins where both have a section; null when neither names any
+        public static FirmwareFootprint? Parse(string? memoryMap, string? stdout)
+        {
+            memoryMap ??= string.Empty;
+            stdout ??= string.Empty;
+
+            var code = Usage(MemFlash.Match(memoryMap)) ?? Usage(CliFlash.Match(stdout));
+            var xdata = Usage(MemXdata.Match(memoryMap)) ?? Usage(CliXdata.Match(stdout));
+            MemoryUsage? data = null;
+            var stack = MemStack.Match(memoryMap);
+            if (stack.Success)
+            {
+                var start = int.Parse(stack.Groups[1].Value, NumberStyles.HexNumber, CultureInfo.InvariantCulture);
+                data = new MemoryUsage(start, start + int.Parse(stack.Groups[2].Value, CultureInfo.InvariantCulture));
+            }
+
+            return code == null && xdata == null && data == null ? null : new FirmwareFootprint(code, xdata, data);
+        }
+
+        private static MemoryUsage? Usage(Match match)
+        {
+            if (!match.Success)
+            {
+                return null;
+            }
+
+            return new MemoryUsage(
+                int.Parse(match.Groups[1].Value, CultureInfo.InvariantCulture),
+                int.Parse(match.Groups[2].Value, CultureInfo.InvariantCulture));
+        }
+    }
+
+    // What a layout will take before it is compiled: the configuration blob exactly, and the sections
+    // from the last compile of the same layout shape when there has been one
+    public sealed record FirmwareBudget(MemoryUsage Blob, FirmwareFootprint? Footprint)
+    {
+        public bool Fits => Blob.Used <= Blob.Limit;
+    }
+}
@@ -0,0 +1,260 @@
+using System.Globalization;
+using System.Text;
+
+namespace Keypad.Flasher.Server.Services
+{
+    // Minimal Intel HEX editing for the images arduino-cli exports: rewrites bytes inside existing
+    // data records and recomputes their checksums, leaving every other record as it was
+    internal static class IntelHex
+    {
+        private const byte DataRecord = 0x00;
+        private const byte ExtendedSegmentAddressRecord = 0x02;
+        private const byte ExtendedLinearAddressRecord = 0x04;
+        private const byte ErasedByte = 0xFF;
+
+        public static string Patch(string image, int address, ReadOnlySpan<byte> data)
+        {
+            var newline = image.Contains("\r\n") ? "\r\n" : "\n";
+            var lines = image.Split('\n');
+            var written = new bool[data.Length];
+            var patched = 0;
+            var baseAddress = 0;
+            var sb = new StringBuilder(image.Length);
+
+            for (int i = 0; i < lines.Length; i++)
+            {
+                var line = lines[i].TrimEnd('\r');
+                if (line.Length == 0)
+                {
+                    continue;
+                }
+
+                var record = ParseRecord(line, i + 1);
+                var type = record[3];
+                var offset = (record[1] << 8) | record[2];
+                if (type == ExtendedLinearAddressRecord)
+                {
+                    baseAddress = ((record[4] << 8) | record[5]) << 16;
+                }
+                else if (type == ExtendedSegmentAddressRecord)
+                {
+                    baseAddress = ((record[4] << 8) | record[5]) << 4;
+                }
+                else if (type == DataRecord)
+                {
+                    var changed = false;
+                    for (int j = 0; j < record[0]; j++)
+                    {
+                        var index = baseAddress + offset + j - address;
+                        if (index < 0 || index >= data.Length)
+                        {
+                            continue;
+                        }
+
+                        if (!written[index])
+                        {
+                            written[index] = true;
+                            patched++;
+                        }
+                        record[4 + j] = data[index];
+                        changed = true;
+                    }
+
+                    if (changed)
+                    {
+                        record[^1] = Checksum(record.AsSpan(0, record.Length - 1));
+                        line = FormatRecord(record);
+                    }
+                }
+
+                sb.Append(line).Append(newline);
+            }
+
+            if (patched != data.Length)
+            {
+                throw new InvalidOperationException($"Image has no data at {data.Length - patched} of the {data.Length} bytes from 0x{address:X4}.");
+            }
+
+            return sb.ToString();
+        }
+
+        public static byte[] Read(string image, int address, int length)
+        {
+            var result = new byte[length];
+            var found = 0;
+            var baseAddress = 0;
+            var lines = image.Split('\n');
+            for (int i = 0; i < lines.Length; i++)
+            {
+                var line = lines[i].TrimEnd('\r');
+                if (line.Length == 0)
+                {
+                    continue;
+                }
+
+                var record = ParseRecord(line, i + 1);
+                var offset = (record[1] << 8) | record[2];
+                switch (record[3])
+                {
+                    case ExtendedLinearAddressRecord:
+                        baseAddress = ((record[4] << 8) | record[5]) << 16;
+                        break;
+                    case ExtendedSegmentAddressRecord:
+                        baseAddress = ((record[4] << 8) | record[5]) << 4;
+                        break;
+                    case DataRecord:
+                        for (int j = 0; j < record[0]; j++)
+                        {
+                            var index = baseAddress + offset + j - address;
+                            if (index >= 0 && index < length)
+                            {
+                                result[index] = record[4 + j];
+                                found++;
+                            }
+                        }
+                        break;
+                }
+            }
+
+            if (found != length)
+            {
+                throw new InvalidOperationException($"Image has no data at {length - found} of the {length} bytes from 0x{address:X4}.");
+            }
+
+            return result;
+        }
+
+        // Data bytes the image places in [address, address + length), an address written twice counting
+        // twice; more than length means the linker put two areas over the same flash
+        public static int CountBytes(string image, int address, int length)
+        {
+            var count = 0;
+            var baseAddress = 0;
+            var lines = image.Split('\n');
+            for (int i = 0; i < lines.Length; i++)
+            {
+                var line = lines[i].TrimEnd('\r');
+                if (line.Length == 0)
+                {
+                    continue;
+                }
+
+                var record = ParseRecord(line, i + 1);
+                var offset = (record[1] << 8) | record[2];
+                switch (record[3])
+                {
+                    case ExtendedLinearAddressRecord:
+                        baseAddress = ((record[4] << 8) | record[5]) << 16;
+                        break;
+                    case ExtendedSegmentAddressRecord:
+                        baseAddress = ((record[4] << 8) | record[5]) << 4;
+                        break;
+                    case DataRecord:
+                        for (int j = 0; j < record[0]; j++)
+                        {
+                            var index = baseAddress + offset + j - address;
+                            if (index >= 0 && index < length)
+                            {
+                                count++;
+                            }
+                        }
+                        break;
+                }
+            }
+
+            return count;
+        }
+
+        // Flat image from address 0 to the last data byte, gaps filled with erased flash (0xFF),
+        // the same layout the client's parseIntelHexBrowser produces
+        public static byte[] ToBinary(string image)
+        {
+            var result = new byte[1024];
+            var length = 0;
+            var baseAddress = 0;
+            var lines = image.Split('\n');
+            for (int i = 0; i < lines.Length; i++)
+            {
+                var line = lines[i].TrimEnd('\r');
+                if (line.Length == 0)
+                {
+                    continue;
+                }
+
+                var record = ParseRecord(line, i + 1);
+                var offset = (record[1] << 8) | record[2];
+                switch (record[3])
+                {
+                    case ExtendedLinearAddressRecord:
+                        baseAddress = ((record[4] << 8) | record[5]) << 16;
+                        break;
+                    case ExtendedSegmentAddressRecord:
+                        baseAddress = ((record[4] << 8) | record[5]) << 4;
+                        break;
+                    case DataRecord:
+                        var end = baseAddress + offset + record[0];
+                        if (end > result.Length)
+                        {
+                            var grown = new byte[Math.Max(end, result.Length * 2)];
+                            result.AsSpan(0, length).CopyTo(grown);
+                            grown.AsSpan(length).Fill(ErasedByte);
+                            result = grown;
+                        }
+                        else if (end > length)
+                        {
+                            result.AsSpan(length, end - length).Fill(ErasedByte);
+                        }
+
+                        record.AsSpan(4, record[0]).CopyTo(result.AsSpan(baseAddress + offset));
+                        length = Math.Max(length, end);
+                        break;
+                }
+            }
+
+            return result.AsSpan(0, length).ToArray();
+        }
+
+        // Bytes of one record: count, address high, address low, type, data..., checksum
+        private static byte[] ParseRecord(string line, int lineNumber)
+        {
+            if (line[0] != ':' || line.Length < 11 || (line.Length - 1) % 2 != 0)
+            {
+                throw new FormatException($"Line {lineNumber} is not an Intel HEX record.");
+            }
+
+            var record = new byte[(line.Length - 1) / 2];
+            for (int i = 0; i < record.Length; i++)
+            {
+                if (!byte.TryParse(line.AsSpan(1 + i * 2, 2), NumberStyles.HexNumber, CultureInfo.InvariantCulture, out record[i]))
+                {
+                    throw new FormatException($"Line {lineNumber} has a malformed byte at column {2 + i * 2}.");
+                }
+            }
+
+            if (record.Length != record[0] + 5)
+            {
+                throw new FormatException($"Line {lineNumber} length does not match its byte count.");
+            }
+
+            if (Checksum(record.AsSpan(0, record.Length - 1)) != record[^1])
+            {
+                throw new FormatException($"Line {lineNumber} has a bad checksum.");
+            }
+
+            return record;
+        }
+
+        private static string FormatRecord(byte[] record) => ":" + Convert.ToHexString(record);
+
+        private static byte Checksum(ReadOnlySpan<byte> bytes)
+        {
+            var sum = 0;
+            foreach (var value in bytes)
+            {
+                sum += value;
+            }
+
+            return (byte)(-sum & 0xFF);
+        }
+    }
+}
@@ -0,0 +1,278 @@
+using System.Diagnostics;
+using System.Text;
+using Microsoft.Extensions.Logging;
+using Microsoft.Extensions.Options;
+
+namespace Keypad.Flasher.Server.Services
+{
+    // The generated files for one compile; with the firmware sources they are all arduino-cli reads
+    public sealed record CompileRequest(string Fqbn, string Header, string Source);
+
+    // Turns generated configuration files into an image. FirmwareBuilder keeps the caches, coalescing
+    // and blob patching in front of it, so only builds that really need arduino-cli come through here
+    public interface IFirmwareCompiler
+    {
+        // onStage hears Compiling once a compile worker has been found
+        FirmwareBuildResult Compile(CompileRequest request, Action<BuildStage>? onStage = null);
+    }
+
+    // Runs arduino-cli in this process on a pool of warm workspaces
+    public sealed class LocalFirmwareCompiler : IFirmwareCompiler
+    {
+        private readonly Settings _settings;
+        private readonly ILogger<LocalFirmwareCompiler> _logger;
+        private readonly CompileWorkerPool _workers;
+        private readonly Lazy<string> _firmwareHash;
+
+        public LocalFirmwareCompiler(IOptions<Settings> settings, ILogger<LocalFirmwareCompiler> logger)
+        {
+            _settings = settings.Value;
+            _logger = logger;
+            _workers = new CompileWorkerPool(
+                _settings.CompileWorkers ?? Environment.ProcessorCount,
+                _settings.WorkspacePath ?? Path.Combine(Path.GetTempPath(), "keypad-flasher-workers"));
+            _firmwareHash = new Lazy<string>(() => FirmwareBuilder.ComputeFirmwareHash(Path.GetFullPath(_settings.FirmwarePath)));
+        }
+
+        public FirmwareBuildResult Compile(CompileRequest request, Action<BuildStage>? onStage = null)
+        {
+            var firmwarePath = Path.GetFullPath(_settings.FirmwarePath);
+
+            var waitStarted = Stopwatch.GetTimestamp();
+            using (var worker = _workers.Acquire())
+            {
+                BuildMetrics.WorkerWait.Record(BuildMetrics.Seconds(waitStarted));
+                onStage?.Invoke(BuildStage.Compiling);
+                using var activity = BuildMetrics.ActivitySource.StartActivity("Compile");
+                activity?.SetTag("keypad.worker", worker.Slot);
+
+                var workspaceStarted = Stopwatch.GetTimestamp();
+                var workspace = worker.WorkspaceFor(request.Fqbn);
+                var workingFirmwarePath = Path.Combine(workspace, "Keypad.Firmware");
+                var buildPath = Path.Combine(workspace, "build");
+                var outputPath = Path.Combine(workspace, "output");
+                var warm = PrepareWorkspace(workspace, firmwarePath, workingFirmwarePath);
+                Directory.CreateDirectory(worker.BuildCachePath);
+                BuildMetrics.WorkspaceDuration.Record(BuildMetrics.Seconds(workspaceStarted), new KeyValuePair<string, object?>("warm", warm));
+                activity?.SetTag("keypad.warm", warm);
+
+                // arduino-cli rebuilds by timestamp and the .d dependency files, so unchanged files keep
+                // theirs: a new binding set recompiles configuration.c alone, a new layout shape also
+                // recompiles the modules that include configuration.h
+                var headerPath = Path.Combine(workingFirmwarePath, "configuration.h");
+                var sourcePath = Path.Combine(workingFirmwarePath, "configuration.c");
+                WriteIfChanged(headerPath, request.Header);
+                WriteIfChanged(sourcePath, request.Source);
+
+                ResetDirectory(outputPath);
+                var discardWorkspace = false;
+                var outcome = "failure";
+                var compileStarted = Stopwatch.GetTimestamp();
+                BuildMetrics.ActiveCompiles.Add(1);
+                _logger.LogInformation("Compiling on worker {Worker} with a {State} workspace.", worker.Slot, warm ? "warm" : "cold");
+                try
+                {
+                    var args = new ProcessStartInfo
+                    {
+                        FileName = "arduino-cli",
+                        RedirectStandardOutput = true,
+                        RedirectStandardError = true,
+                        WorkingDirectory = workingFirmwarePath,
+                        UseShellExecute = false,
+                        CreateNoWindow = true
+                    };
+                    args.ArgumentList.Add("compile");
+                    args.ArgumentList.Add("--fqbn");
+                    args.ArgumentList.Add(request.Fqbn);
+                    args.ArgumentList.Add("--config-file");
+                    args.ArgumentList.Add("arduino-cli.yaml");
+                    args.ArgumentList.Add("--export-binaries");
+                    args.ArgumentList.Add("--no-color");
+                    args.ArgumentList.Add("--output-dir");
+                    args.ArgumentList.Add(outputPath);
+                    args.ArgumentList.Add("--build-path");
+                    args.ArgumentList.Add(buildPath);
+                    args.Environment["ARDUINO_BUILD_CACHE_PATH"] = worker.BuildCachePath;
+
+                    var stdout = new StringBuilder();
+                    var stderr = new StringBuilder();
+
+                    using (var process = Process.Start(args))
+                    {
+                        if (process == null)
+                        {
+                            _logger.LogError("Failed to start arduino-cli process.");
+                            return new FirmwareBuildResult(false, null, "Failed to start arduino-cli process.");
+                        }
+
+                        process.OutputDataReceived += (_, e) => { if (e.Data != null) stdout.AppendLine(e.Data); };
+                        process.ErrorDataReceived += (_, e) => { if (e.Data != null) stderr.AppendLine(e.Data); };
+                        process.BeginOutputReadLine();
+                        process.BeginErrorReadLine();
+
+                        var timeout = TimeSpan.FromSeconds(_settings.CompileTimeoutSeconds);
+                        if (!process.WaitForExit(timeout))
+                        {
+                            try
+                            {
+                                process.Kill(entireProcessTree: true);
+                            }
+                            catch (InvalidOperationException)
+                            {
+                                // exited between the timeout and the kill
+                            }
+                            process.WaitForExit();
+                            // a killed compile can leave truncated objects newer than their sources
+                            discardWorkspace = true;
+                            outcome = "timeout";
+                            _logger.LogError("arduino-cli compile on worker {Worker} timed out after {Timeout}.\nStdOut:\n{StdOut}\nStdErr:\n{StdErr}", worker.Slot, timeout, stdout.ToString(), stderr.ToString());
+                            return new FirmwareBuildResult(false, null, $"Compile timed out after {_settings.CompileTimeoutSeconds} seconds.", null, stdout.ToString(), stderr.ToString());
+                        }
+
+                        // the timed wait does not wait for the redirected streams to drain
+                        process.WaitForExit();
+
+                        if (process.ExitCode != 0)
+                        {
+                            var stderrWithConfig = new StringBuilder(stderr.ToString());
+                            try
+                            {
+                                if (File.Exists(sourcePath))
+                                {
+                                    stderrWithConfig.AppendLine("\n--- configuration.c (generated) ---\n");
+                                    stderrWithConfig.AppendLine(File.ReadAllText(sourcePath));
+                                }
+                                if (File.Exists(headerPath))
+                                {
+                                    stderrWithConfig.AppendLine("\n--- configuration.h (generated) ---\n");
+                                    stderrWithConfig.AppendLine(File.ReadAllText(headerPath));
+                                }
+                            }
+                            catch (Exception ex)
+                            {
+                                stderrWithConfig.AppendLine($"\n--- config capture failed: {ex.Message} ---\n");
+                            }
+
+                            var stderrCombined = stderrWithConfig.ToString();
+                            _logger.LogError("arduino-cli compile failed. ExitCode: {ExitCode}\nStdOut:\n{StdOut}\nStdErr:\n{StdErr}", process.ExitCode, stdout.ToString(), stderrCombined);
+                            return new FirmwareBuildResult(false, null, "Compile failed", process.ExitCode, stdout.ToString(), stderrCombined);
+                        }
+
+                        _logger.LogInformation("arduino-cli compile succeeded. ExitCode: {ExitCode}\nStdOut:\n{StdOut}", process.ExitCode, stdout.ToString());
+                    }
+
+                    var path = Path.Combine(outputPath, "Keypad.Firmware.ino.hex");
+
+                    if (!File.Exists(path))
+                    {
+                        _logger.LogError("Compiled firmware file not found at {Path}", path);
+                        return new FirmwareBuildResult(false, null, "Compiled firmware file not found.");
+                    }
+
+                    var fileBytes = File.ReadAllBytes(path);
+                    var memoryMapPath = Path.Combine(buildPath, "Keypad.Firmware.ino.mem");
+                    var footprint = FirmwareFootprint.Parse(File.Exists(memoryMapPath) ? File.ReadAllText(memoryMapPath) : null, stdout.ToString());
+                    if (footprint != null)
+                    {
+                        _logger.LogInformation("Firmware footprint: code {Code}, xdata {Xdata}, data {Data}.", Describe(footprint.Code), Describe(footprint.Xdata), Describe(footprint.Data));
+                        activity?.SetTag("keypad.code_bytes", footprint.Code?.Used);
+                    }
+
+                    outcome = "success";
+                    return new FirmwareBuildResult(true, fileBytes, Footprint: footprint);
+                }
+                finally
+                {
+                    BuildMetrics.ActiveCompiles.Add(-1);
+                    BuildMetrics.CompileDuration.Record(
+                        BuildMetrics.Seconds(compileStarted),
+                        new KeyValuePair<string, object?>("fqbn", request.Fqbn),
+                        new KeyValuePair<string, object?>("outcome", outcome));
+                    activity?.SetTag("keypad.outcome", outcome);
+                    try
+                    {
+                        Directory.Delete(discardWorkspace ? workspace : outputPath, true);
+                    }
+                    catch (Exception ex)
+                    {
+                        _logger.LogWarning(ex, "Failed to cleanup workspace {Workspace}", workspace);
+                    }
+                }
+            }
+        }
+
+        private static string Describe(MemoryUsage? usage) => usage == null ? "unknown" : $"{usage.Used}/{usage.Limit}";
+
+        // Reuses the workspace when it holds a copy of the current firmware sources, otherwise starts
+        // it over; returns whether it was reused
+        private bool PrepareWorkspace(string workspace, string firmwarePath, string workingFirmwarePath)
+        {
+            var marker = Path.Combine(workspace, "firmware.sha256");
+            var firmwareHash = _firmwareHash.Value;
+            if (File.Exists(marker) && File.ReadAllText(marker) == firmwareHash)
+            {
+                return true;
+            }
+
+            ResetDirectory(workspace);
+            CopyDirectory(firmwarePath, workingFirmwarePath);
+            File.WriteAllText(marker, firmwareHash);
+            return false;
+        }
+
+        private static void WriteIfChanged(string path, string content)
+        {
+            if (File.Exists(path) && File.ReadAllText(path) == content)
+            {
+                return;
+            }
+
+            File.WriteAllText(path, content);
+        }
+
+        private static void ResetDirectory(string path)
+        {
+            if (Directory.Exists(path))
+            {
+                Directory.Delete(path, true);
+            }
+
+            Directory.CreateDirectory(path);
+        }
+
+        private static void CopyDirectory(string sourceDir, string destinationDir)
+        {
+            if (!Directory.Exists(sourceDir))
+            {
+                throw new DirectoryNotFoundException($"Source directory not found: {sourceDir}");
+            }
+
+            Directory.CreateDirectory(destinationDir);
+
+            var options = new EnumerationOptions
+            {
+                RecurseSubdirectories = true,
+                IgnoreInaccessible = false
+            };
+
+            foreach (var directoryPath in Directory.EnumerateDirectories(sourceDir, "*", options))
+            {
+                var relativePath = Path.GetRelativePath(sourceDir, directoryPath);
+                Directory.CreateDirectory(Path.Combine(destinationDir, relativePath));
+            }
+
+            foreach (var filePath in Directory.EnumerateFiles(sourceDir, "*", options))
+            {
+                var relativePath = Path.GetRelativePath(sourceDir, filePath);
+                var targetPath = Path.Combine(destinationDir, relativePath);
+                var targetDirectory = Path.GetDirectoryName(targetPath);
+                if (!string.IsNullOrEmpty(targetDirectory))
+                {
+                    Directory.CreateDirectory(targetDirectory);
+                }
+
+                File.Copy(filePath, targetPath, overwrite: true);
+            }
+        }
+    }
+}
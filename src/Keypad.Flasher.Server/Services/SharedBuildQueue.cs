@@ -0,0 +1,388 @@
+using System.Diagnostics;
+using System.Globalization;
+using System.Security.Cryptography;
+using System.Text;
+using System.Text.Json;
+using Microsoft.Extensions.Hosting;
+using Microsoft.Extensions.Logging;
+using Microsoft.Extensions.Options;
+
+namespace Keypad.Flasher.Server.Services
+{
+    // Compiles handed from web pods to worker pods through a directory every pod mounts, the same kind
+    // of shared volume BuildCachePath uses. Renames within one filesystem are atomic, which is all the
+    // coordination the pods need:
+    //   requests/<key>                   an identical compile is pending or running, so join it
+    //   pending/<ticks>-<key>.json       waiting for a worker, oldest name first
+    //   claimed/<key>.json               taken by a worker, touched when it was taken
+    //   results/<key>.json               the FirmwareBuildResult, kept for ResultRetention
+    public sealed class SharedBuildQueue
+    {
+        private static readonly TimeSpan ResultRetention = TimeSpan.FromMinutes(10);
+        // how long a new marker may go without its pending entry while the submitter writes it
+        private static readonly TimeSpan MarkerGrace = TimeSpan.FromSeconds(5);
+        private static readonly JsonSerializerOptions JsonOptions = new(JsonSerializerDefaults.Web);
+
+        private readonly string _requests;
+        private readonly string _pending;
+        private readonly string _claimed;
+        private readonly string _results;
+        private readonly TimeSpan _staleClaim;
+
+        public SharedBuildQueue(IOptions<Settings> settings)
+        {
+            var root = settings.Value.BuildQueuePath
+                ?? throw new InvalidOperationException("Settings:BuildQueuePath is required for the shared build queue.");
+            _requests = Directory.CreateDirectory(Path.Combine(root, "requests")).FullName;
+            _pending = Directory.CreateDirectory(Path.Combine(root, "pending")).FullName;
+            _claimed = Directory.CreateDirectory(Path.Combine(root, "claimed")).FullName;
+            _results = Directory.CreateDirectory(Path.Combine(root, "results")).FullName;
+            // a claim outlives its compile only when the worker holding it went away
+            _staleClaim = TimeSpan.FromSeconds(settings.Value.CompileTimeoutSeconds * 2);
+        }
+
+        // Content-addressed, so the same generated files from any pod land on one entry
+        public static string KeyOf(CompileRequest request)
+        {
+            var bytes = Encoding.UTF8.GetBytes(request.Fqbn + "\n" + request.Header + "\n" + request.Source);
+            return Convert.ToHexString(SHA256.HashData(bytes)).ToLowerInvariant();
+        }
+
+        public int PendingCount
+        {
+            get
+            {
+                try
+                {
+                    return Directory.EnumerateFiles(_pending, "*.json").Count();
+                }
+                catch (IOException)
+                {
+                    return 0;
+                }
+            }
+        }
+
+        // Queues the compile unless an identical one is already pending or running, whose result
+        // then answers this request as well
+        public void Submit(string key, CompileRequest request)
+        {
+            try
+            {
+                using (new FileStream(MarkerPath(key), FileMode.CreateNew, FileAccess.Write))
+                {
+                }
+            }
+            catch (IOException) when (File.Exists(MarkerPath(key)))
+            {
+                EnsureQueued(key, request);
+                return;
+            }
+
+            // a result left from an earlier run of the same files must not answer this one
+            TryDelete(ResultPath(key));
+            WritePending(key, request);
+        }
+
+        // Queues the compile again when nothing answers for it: the pod that created its marker went
+        // away before writing the pending entry, or the entry was lost. Waiters call this as they poll
+        public void EnsureQueued(string key, CompileRequest request)
+        {
+            var marker = MarkerPath(key);
+            if (File.Exists(ResultPath(key)) || IsQueued(key) || DateTime.UtcNow - File.GetLastWriteTimeUtc(marker) < MarkerGrace)
+            {
+                return;
+            }
+
+            // touching the marker holds other waiters off for the grace period while this one writes
+            File.WriteAllBytes(marker, Array.Empty<byte>());
+            WritePending(key, request);
+        }
+
+        // Takes the oldest pending compile; false when there is none or other workers took them all first
+        public bool TryClaim(out string key, out CompileRequest request)
+        {
+            foreach (var path in Directory.EnumerateFiles(_pending, "*.json").OrderBy(path => path, StringComparer.Ordinal))
+            {
+                var name = Path.GetFileNameWithoutExtension(path);
+                var candidate = name[(name.IndexOf('-') + 1)..];
+                var claimed = ClaimPath(candidate);
+                try
+                {
+                    File.Move(path, claimed);
+                }
+                catch (IOException)
+                {
+                    // a second entry for a compile that is already running only needs the one result
+                    if (File.Exists(claimed))
+                    {
+                        TryDelete(path);
+                    }
+                    continue;
+                }
+
+                File.SetLastWriteTimeUtc(claimed, DateTime.UtcNow);
+                CompileRequest? parsed;
+                try
+                {
+                    parsed = JsonSerializer.Deserialize<CompileRequest>(File.ReadAllBytes(claimed), JsonOptions);
+                }
+                catch (JsonException)
+                {
+                    parsed = null;
+                }
+                if (parsed == null)
+                {
+                    Complete(candidate, new FirmwareBuildResult(false, null, "Shared build queue entry was unreadable."));
+                    continue;
+                }
+
+                key = candidate;
+                request = parsed;
+                return true;
+            }
+
+            key = string.Empty;
+            request = null!;
+            return false;
+        }
+
+        public void Complete(string key, FirmwareBuildResult result)
+        {
+            WriteAtomically(ResultPath(key), JsonSerializer.SerializeToUtf8Bytes(result, JsonOptions));
+            TryDelete(ClaimPath(key));
+            TryDelete(MarkerPath(key));
+        }
+
+        public bool IsClaimed(string key) => File.Exists(ClaimPath(key));
+
+        public bool TryReadResult(string key, out FirmwareBuildResult result)
+        {
+            try
+            {
+                var parsed = JsonSerializer.Deserialize<FirmwareBuildResult>(File.ReadAllBytes(ResultPath(key)), JsonOptions);
+                if (parsed != null)
+                {
+                    result = parsed;
+                    return true;
+                }
+            }
+            catch (Exception ex) when (ex is IOException or JsonException)
+            {
+            }
+
+            result = null!;
+            return false;
+        }
+
+        // Puts the claims of workers that went away back in line, drops results everyone waiting has
+        // long since read, and clears markers with no pending or claimed entry left behind them
+        public void Maintain()
+        {
+            var now = DateTime.UtcNow;
+            foreach (var claimed in Directory.EnumerateFiles(_claimed, "*.json"))
+            {
+                if (now - File.GetLastWriteTimeUtc(claimed) < _staleClaim)
+                {
+                    continue;
+                }
+
+                var key = Path.GetFileNameWithoutExtension(claimed);
+                var name = now.Ticks.ToString("D19", CultureInfo.InvariantCulture) + "-" + key + ".json";
+                try
+                {
+                    File.Move(claimed, Path.Combine(_pending, name));
+                }
+                catch (IOException)
+                {
+                    // finished or requeued by someone else meanwhile
+                }
+            }
+
+            foreach (var path in Directory.EnumerateFiles(_results))
+            {
+                if (now - File.GetLastWriteTimeUtc(path) >= ResultRetention)
+                {
+                    TryDelete(path);
+                }
+            }
+
+            foreach (var marker in Directory.EnumerateFiles(_requests))
+            {
+                if (now - File.GetLastWriteTimeUtc(marker) >= MarkerGrace && !IsQueued(Path.GetFileName(marker)))
+                {
+                    TryDelete(marker);
+                }
+            }
+        }
+
+        private bool IsQueued(string key) =>
+            File.Exists(ClaimPath(key)) || Directory.EnumerateFiles(_pending, "*-" + key + ".json").Any();
+
+        private void WritePending(string key, CompileRequest request)
+        {
+            var name = DateTime.UtcNow.Ticks.ToString("D19", CultureInfo.InvariantCulture) + "-" + key + ".json";
+            WriteAtomically(Path.Combine(_pending, name), JsonSerializer.SerializeToUtf8Bytes(request, JsonOptions));
+        }
+
+        private string MarkerPath(string key) => Path.Combine(_requests, key);
+
+        private string ClaimPath(string key) => Path.Combine(_claimed, key + ".json");
+
+        private string ResultPath(string key) => Path.Combine(_results, key + ".json");
+
+        private static void WriteAtomically(string path, byte[] contents)
+        {
+            var temporary = path + "." + Guid.NewGuid().ToString("N") + ".tmp";
+            File.WriteAllBytes(temporary, contents);
+            File.Move(temporary, path, overwrite: true);
+        }
+
+        private static void TryDelete(string path)
+        {
+            try
+            {
+                File.Delete(path);
+            }
+            catch (IOException)
+            {
+            }
+        }
+    }
+
+    // Sends compiles to the worker deployment and waits for them, so this pod needs no arduino-cli time.
+    // The wait blocks, but only the calling build consumer's own thread (see BuildJobWorker)
+    public sealed class RemoteFirmwareCompiler : IFirmwareCompiler
+    {
+        private static readonly TimeSpan PollInterval = TimeSpan.FromMilliseconds(250);
+        // every few seconds a waiter checks the compile it joined is still queued somewhere
+        private const int RequeueCheckPolls = 20;
+
+        private readonly SharedBuildQueue _queue;
+        private readonly TimeSpan _timeout;
+        private readonly ILogger<RemoteFirmwareCompiler> _logger;
+
+        public RemoteFirmwareCompiler(SharedBuildQueue queue, IOptions<Settings> settings, ILogger<RemoteFirmwareCompiler> logger)
+        {
+            _queue = queue;
+            _timeout = TimeSpan.FromSeconds(settings.Value.RemoteCompileTimeoutSeconds);
+            _logger = logger;
+        }
+
+        public FirmwareBuildResult Compile(CompileRequest request, Action<BuildStage>? onStage = null)
+        {
+            var key = SharedBuildQueue.KeyOf(request);
+            using var activity = BuildMetrics.ActivitySource.StartActivity("RemoteCompile");
+            activity?.SetTag("keypad.fqbn", request.Fqbn);
+
+            var started = Stopwatch.GetTimestamp();
+            _queue.Submit(key, request);
+            var compiling = false;
+            for (var poll = 1; ; poll++)
+            {
+                if (_queue.TryReadResult(key, out var result))
+                {
+                    return result;
+                }
+                if (poll % RequeueCheckPolls == 0)
+                {
+                    _queue.EnsureQueued(key, request);
+                }
+
+                if (!compiling && _queue.IsClaimed(key))
+                {
+                    compiling = true;
+                    BuildMetrics.WorkerWait.Record(BuildMetrics.Seconds(started));
+                    onStage?.Invoke(BuildStage.Compiling);
+                }
+
+                if (Stopwatch.GetElapsedTime(started) >= _timeout)
+                {
+                    _logger.LogWarning("No build worker returned compile {Key} within {Timeout} seconds.", key, _timeout.TotalSeconds);
+                    return new FirmwareBuildResult(false, null, $"No build worker finished the compile within {_timeout.TotalSeconds} seconds.");
+                }
+
+                Thread.Sleep(PollInterval);
+            }
+        }
+    }
+
+    // Runs on the worker deployment: takes compiles off the shared queue with one consumer per local
+    // compile worker, so a pod never claims more than it can start right away
+    public sealed class SharedBuildWorker : BackgroundService
+    {
+        private static readonly TimeSpan PollInterval = TimeSpan.FromMilliseconds(250);
+        private static readonly TimeSpan MaintenanceInterval = TimeSpan.FromSeconds(30);
+
+        private readonly SharedBuildQueue _queue;
+        private readonly LocalFirmwareCompiler _compiler;
+        private readonly ILogger<SharedBuildWorker> _logger;
+        private readonly int _consumers;
+
+        public SharedBuildWorker(SharedBuildQueue queue, LocalFirmwareCompiler compiler, IOptions<Settings> settings, ILogger<SharedBuildWorker> logger)
+        {
+            _queue = queue;
+            _compiler = compiler;
+            _logger = logger;
+            _consumers = Math.Max(1, settings.Value.CompileWorkers ?? Environment.ProcessorCount);
+        }
+
+        protected override Task ExecuteAsync(CancellationToken stoppingToken)
+        {
+            // compiles block, so each consumer gets a thread of its own rather than one of the pool's
+            var consumers = Enumerable.Range(0, _consumers).Select(index => Task.Factory.StartNew(
+                () => Consume(index == 0, stoppingToken), stoppingToken, TaskCreationOptions.LongRunning, TaskScheduler.Default));
+            return Task.WhenAll(consumers);
+        }
+
+        private void Consume(bool maintains, CancellationToken stoppingToken)
+        {
+            var lastMaintenance = Stopwatch.GetTimestamp();
+            while (!stoppingToken.IsCancellationRequested)
+            {
+                try
+                {
+                    if (_queue.TryClaim(out var key, out var request))
+                    {
+                        _queue.Complete(key, Run(request));
+                        continue;
+                    }
+
+                    if (maintains && Stopwatch.GetElapsedTime(lastMaintenance) >= MaintenanceInterval)
+                    {
+                        _queue.Maintain();
+                        lastMaintenance = Stopwatch.GetTimestamp();
+                    }
+                }
+                catch (IOException ex)
+                {
+                    _logger.LogWarning(ex, "Shared build queue is unavailable.");
+                }
+                catch (Exception ex) when (ex is not OperationCanceledException)
+                {
+                    // anything left to fault the consumer would stop the host, and the requeued claim
+                    // would then take the next pod down the same way
+                    _logger.LogError(ex, "Shared build queue consumer failed; carrying on.");
+                }
+
+                if (stoppingToken.WaitHandle.WaitOne(PollInterval))
+                {
+                    return;
+                }
+            }
+        }
+
+        private FirmwareBuildResult Run(CompileRequest request)
+        {
+            try
+            {
+                return _compiler.Compile(request);
+            }
+            catch (Exception ex)
+            {
+                _logger.LogError(ex, "Compile taken from the shared build queue failed unexpectedly.");
+                return new FirmwareBuildResult(false, null, "Build worker failed unexpectedly.");
+            }
+        }
+    }
+}
@@ -3,5 +3,41 @@
 	public class Settings
 	{
 		public required string FirmwarePath { get; set; }
+
+		// Finished images kept in memory; BuildCachePath additionally keeps up to BuildCacheDiskSize of them
+		// on disk or a shared volume, least recently used first out
+		public int BuildCacheSize { get; set; } = 128;
+		public string? BuildCachePath { get; set; }
+		public int BuildCacheDiskSize { get; set; } = 4096;
+
+		// Concurrent arduino-cli runs, defaulting to one per core, and how long any one of them may take
+		public int? CompileWorkers { get; set; }
+		public int CompileTimeoutSeconds { get; set; } = 120;
+
+		// Build jobs this pod runs at once, each on a thread of its own; defaults to CompileWorkers. A web
+		// pod handing compiles to workers only waits on them, so it can run more than it has cores
+		public int? BuildConsumers { get; set; }
+
+		// A directory on a volume every pod mounts through which compiles go to the worker deployment;
+		// unset, this process compiles. BuildWorker makes this pod the one that takes them off it
+		public string? BuildQueuePath { get; set; }
+		public bool BuildWorker { get; set; }
+
+		// How long a web pod waits for a worker to return a compile, time in the shared queue included
+		public int RemoteCompileTimeoutSeconds { get; set; } = 600;
+
+		// Warm per-worker sketch copies and build directories; only one server process may use a path
+		public string? WorkspacePath { get; set; }
+
+		// Builds waiting for a consumer, in all and from one client address; past either limit the build
+		// endpoints answer 503 or 429 with Retry-After instead of queueing
+		public int MaxQueuedBuilds { get; set; } = 32;
+		public int MaxQueuedBuildsPerClient { get; set; } = 4;
+
+		// Build requests one client address may make per minute, whether or not they are admitted
+		public int BuildRequestsPerMinute { get; set; } = 30;
+
+		// Compile once per fqbn before /readyz reports ready, so new pods take traffic already warm
+		public bool WarmupOnStartup { get; set; } = true;
 	}
 }